@@ -0,0 +1,354 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Bit vector functions.
+ *
+ * A bit vector is stored in a buffer of one or more bytes in the same way as
+ * the TMS, TDI, TDO and direction buffers of jaylink_jtag_io() and
+ * jaylink_swd_io(): the first bit is the least significant bit of the first
+ * byte and the following bits are sequentially numbered in order of
+ * increasing bit significance and byte index.
+ *
+ * Bits are processed in words of up to 64 bits, and in whole bytes wherever
+ * the destination is byte aligned, rather than one at a time.
+ */
+
+/** @cond PRIVATE */
+static uint64_t low_mask(size_t length)
+{
+	if (length >= 64)
+		return UINT64_MAX;
+
+	return (UINT64_C(1) << length) - 1;
+}
+
+/* Load up to 64 bits. */
+static uint64_t load_bits(const uint8_t *buffer, size_t offset,
+		size_t length)
+{
+	const uint8_t *ptr;
+	size_t shift;
+	size_t num_bytes;
+	uint64_t value;
+
+	ptr = buffer + offset / 8;
+	shift = offset % 8;
+	num_bytes = (shift + length + 7) / 8;
+	value = 0;
+
+	for (size_t i = 0; i < MIN(num_bytes, 8); i++)
+		value |= (uint64_t)ptr[i] << (8 * i);
+
+	value >>= shift;
+
+	/* The bits span nine bytes if they are not byte aligned. */
+	if (num_bytes > 8)
+		value |= (uint64_t)ptr[8] << (64 - shift);
+
+	return value & low_mask(length);
+}
+
+/* Store up to 64 bits without modifying the surrounding bits. */
+static void store_bits(uint8_t *buffer, size_t offset, uint64_t value,
+		size_t length)
+{
+	uint8_t *ptr;
+	size_t shift;
+	size_t num_bytes;
+	uint64_t mask;
+	uint8_t tmp;
+
+	ptr = buffer + offset / 8;
+	shift = offset % 8;
+	num_bytes = (shift + length + 7) / 8;
+	mask = low_mask(length);
+	value &= mask;
+
+	tmp = mask << shift;
+	ptr[0] = (ptr[0] & ~tmp) | (uint8_t)(value << shift);
+
+	for (size_t i = 1; i < num_bytes; i++) {
+		tmp = mask >> (8 * i - shift);
+		ptr[i] = (ptr[i] & ~tmp) | (uint8_t)(value >> (8 * i - shift));
+	}
+}
+/** @endcond */
+
+/**
+ * Read bits from a bit vector.
+ *
+ * @param[in] buffer Buffer to read the bits from.
+ * @param[in] offset Offset of the first bit within the buffer in bits.
+ * @param[in] length Number of bits to read, at most 64.
+ *
+ * @return The bits read from the buffer where the first bit is the least
+ *         significant bit of the value, or 0 on invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API uint64_t jaylink_bits_get(const uint8_t *buffer, size_t offset,
+		size_t length)
+{
+	if (!buffer || !length || length > 64)
+		return 0;
+
+	return load_bits(buffer, offset, length);
+}
+
+/**
+ * Write bits into a bit vector.
+ *
+ * The bits of the buffer outside of the specified range are not modified.
+ * Nothing is written on invalid arguments.
+ *
+ * @param[in,out] buffer Buffer to write the bits into.
+ * @param[in] offset Offset of the first bit within the buffer in bits.
+ * @param[in] value Bits to write where the least significant bit of the value
+ *                  is written first.
+ * @param[in] length Number of bits to write, at most 64.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API void jaylink_bits_set(uint8_t *buffer, size_t offset,
+		uint64_t value, size_t length)
+{
+	if (!buffer || !length || length > 64)
+		return;
+
+	store_bits(buffer, offset, value, length);
+}
+
+/**
+ * Copy bits between bit vectors.
+ *
+ * The source and destination offsets are independent of each other, which
+ * means that a bit vector can be shifted by copying it into a buffer at a
+ * different offset. The bits of the destination buffer outside of the
+ * specified range are not modified.
+ *
+ * @note The source and destination ranges must not overlap.
+ *
+ * @param[in,out] dst Buffer to copy the bits into.
+ * @param[in] dst_offset Offset of the first bit within the destination buffer
+ *                       in bits.
+ * @param[in] src Buffer to copy the bits from.
+ * @param[in] src_offset Offset of the first bit within the source buffer in
+ *                       bits.
+ * @param[in] length Number of bits to copy.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API void jaylink_bits_copy(uint8_t *dst, size_t dst_offset,
+		const uint8_t *src, size_t src_offset, size_t length)
+{
+	uint8_t *dst_ptr;
+	const uint8_t *src_ptr;
+	size_t shift;
+	size_t num_bytes;
+	size_t tmp;
+
+	if (!dst || !src || !length)
+		return;
+
+	/* Align the destination to a byte boundary first. */
+	if (dst_offset % 8) {
+		tmp = MIN(length, 8 - dst_offset % 8);
+		store_bits(dst, dst_offset, load_bits(src, src_offset, tmp),
+			tmp);
+
+		dst_offset += tmp;
+		src_offset += tmp;
+		length -= tmp;
+	}
+
+	dst_ptr = dst + dst_offset / 8;
+	src_ptr = src + src_offset / 8;
+	shift = src_offset % 8;
+	num_bytes = length / 8;
+
+	if (!shift) {
+		memcpy(dst_ptr, src_ptr, num_bytes);
+	} else {
+		/*
+		 * Each destination byte is assembled from two adjacent source
+		 * bytes. Both bytes are within the source range because the
+		 * range is not byte aligned.
+		 */
+		for (size_t i = 0; i < num_bytes; i++)
+			dst_ptr[i] = (src_ptr[i] >> shift) |
+				(uint8_t)(src_ptr[i + 1] << (8 - shift));
+	}
+
+	dst_offset += num_bytes * 8;
+	src_offset += num_bytes * 8;
+	length %= 8;
+
+	if (length > 0)
+		store_bits(dst, dst_offset, load_bits(src, src_offset, length),
+			length);
+}
+
+/**
+ * Fill a bit vector with a repeating pattern.
+ *
+ * The first bit of the range is the least significant bit of the pattern.
+ * The bits of the buffer outside of the specified range are not modified.
+ * Nothing is written on invalid arguments.
+ *
+ * For example, a TMS sequence of five consecutive ones is generated with a
+ * pattern of 0x01 and a pattern length of 1 bit.
+ *
+ * @param[in,out] buffer Buffer to fill.
+ * @param[in] offset Offset of the first bit within the buffer in bits.
+ * @param[in] length Number of bits to fill.
+ * @param[in] pattern Pattern to fill the range with.
+ * @param[in] pattern_length Length of the pattern in bits, at most 64.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API void jaylink_bits_fill(uint8_t *buffer, size_t offset,
+		size_t length, uint64_t pattern, size_t pattern_length)
+{
+	uint8_t *ptr;
+	size_t tmp;
+
+	if (!buffer || !length || !pattern_length || pattern_length > 64)
+		return;
+
+	pattern &= low_mask(pattern_length);
+
+	/*
+	 * Patterns whose length is not a power of two do not repeat within a
+	 * word and are written one at a time.
+	 */
+	if (64 % pattern_length) {
+		while (length > 0) {
+			tmp = MIN(length, pattern_length);
+			store_bits(buffer, offset, pattern, tmp);
+
+			offset += tmp;
+			length -= tmp;
+		}
+
+		return;
+	}
+
+	for (size_t i = pattern_length; i < 64; i *= 2)
+		pattern |= pattern << i;
+
+	/*
+	 * Align the range to a byte boundary first and rotate the pattern
+	 * accordingly.
+	 */
+	if (offset % 8) {
+		tmp = MIN(length, 8 - offset % 8);
+		store_bits(buffer, offset, pattern, tmp);
+
+		pattern = (pattern >> tmp) | (pattern << (64 - tmp));
+		offset += tmp;
+		length -= tmp;
+	}
+
+	ptr = buffer + offset / 8;
+
+	if (pattern_length <= 8) {
+		memset(ptr, pattern & 0xff, length / 8);
+		ptr += length / 8;
+		length %= 8;
+	} else {
+		for (; length >= 64; length -= 64) {
+			for (size_t i = 0; i < 8; i++)
+				*ptr++ = pattern >> (8 * i);
+		}
+	}
+
+	if (length > 0)
+		store_bits(ptr, 0, pattern, length);
+}
+
+/**
+ * Compare two bit vectors.
+ *
+ * @param[in] a Buffer with the first bit vector.
+ * @param[in] a_offset Offset of the first bit within the first buffer in bits.
+ * @param[in] b Buffer with the second bit vector.
+ * @param[in] b_offset Offset of the first bit within the second buffer in
+ *                     bits.
+ * @param[in] mask Buffer with a bit vector which selects the bits to compare,
+ *                 or NULL to compare all bits. Only the bits which are set in
+ *                 the mask are compared.
+ * @param[in] mask_offset Offset of the first bit within the mask buffer in
+ *                        bits. Ignored if no mask is used.
+ * @param[in] length Number of bits to compare.
+ *
+ * @retval true Bit vectors are equal.
+ * @retval false Bit vectors are not equal or invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API bool jaylink_bits_compare(const uint8_t *a, size_t a_offset,
+		const uint8_t *b, size_t b_offset, const uint8_t *mask,
+		size_t mask_offset, size_t length)
+{
+	uint64_t diff;
+	size_t tmp;
+
+	if (!a || !b)
+		return false;
+
+	if (!mask && !(a_offset % 8) && !(b_offset % 8)) {
+		tmp = length / 8;
+
+		if (memcmp(a + a_offset / 8, b + b_offset / 8, tmp))
+			return false;
+
+		a_offset += tmp * 8;
+		b_offset += tmp * 8;
+		length %= 8;
+	}
+
+	while (length > 0) {
+		tmp = MIN(length, 64);
+		diff = load_bits(a, a_offset, tmp) ^ load_bits(b, b_offset, tmp);
+
+		if (mask) {
+			diff &= load_bits(mask, mask_offset, tmp);
+			mask_offset += tmp;
+		}
+
+		if (diff)
+			return false;
+
+		a_offset += tmp;
+		b_offset += tmp;
+		length -= tmp;
+	}
+
+	return true;
+}
@@ -138,3 +138,35 @@ JAYLINK_PRIV uint32_t buffer_get_u32(const uint8_t *buffer, size_t offset)
 
 	return value;
 }
+
+/**
+ * Write a 64-bit unsigned integer value to a buffer.
+ *
+ * The value is stored in the buffer in device byte order.
+ *
+ * @param[out] buffer Buffer to write the value into.
+ * @param[in] value Value to write into the buffer in host byte order.
+ * @param[in] offset Offset of the value within the buffer in bytes.
+ */
+JAYLINK_PRIV void buffer_set_u64(uint8_t *buffer, uint64_t value,
+		size_t offset)
+{
+	buffer_set_u32(buffer, value, offset);
+	buffer_set_u32(buffer, value >> 32, offset + 4);
+}
+
+/**
+ * Read a 64-bit unsigned integer value from a buffer.
+ *
+ * The value in the buffer is expected to be stored in device byte order.
+ *
+ * @param[in] buffer Buffer to read the value from.
+ * @param[in] offset Offset of the value within the buffer in bytes.
+ *
+ * @return The value read from the buffer in host byte order.
+ */
+JAYLINK_PRIV uint64_t buffer_get_u64(const uint8_t *buffer, size_t offset)
+{
+	return buffer_get_u32(buffer, offset) |
+		((uint64_t)buffer_get_u32(buffer, offset + 4) << 32);
+}
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "libjaylink.h"
@@ -35,6 +36,25 @@
 #define C2_CMD_DATA_WRITE	0x01
 #define C2_CMD_ADDR_READ	0x02
 #define C2_CMD_ADDR_WRITE	0x03
+
+/** Bit of the C2 status which indicates that output data is available. */
+#define C2_STATUS_OUT_READY	0x01
+/** Bit of the C2 status which indicates that input data is not consumed. */
+#define C2_STATUS_IN_BUSY	0x02
+
+#define FLASH_CMD_BLOCK_WRITE	0x07
+#define FLASH_STATUS_OK		0x0d
+
+/** Maximum number of bytes of a flash block write. */
+#define FLASH_BLOCK_SIZE	256
+
+/** Minimum number of reads of the C2 status of a queued poll. */
+#define POLL_COUNT		2
+/** Maximum number of reads of the C2 status of a queued poll. */
+#define MAX_POLL_COUNT		64
+
+/** Timeout of a C2 status poll in milliseconds. */
+#define POLL_TIMEOUT		100
 /** @endcond */
 
 /**
@@ -68,11 +88,13 @@ JAYLINK_API int jaylink_c2_read_address(struct jaylink_device_handle *devh,
 
 	ctx = devh->dev->ctx;
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 5, 1 + 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -87,6 +109,7 @@ JAYLINK_API int jaylink_c2_read_address(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -95,10 +118,12 @@ JAYLINK_API int jaylink_c2_read_address(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -145,11 +170,13 @@ JAYLINK_API int jaylink_c2_write_address(struct jaylink_device_handle *devh,
 
 	ctx = devh->dev->ctx;
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 5 + 1, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -165,10 +192,12 @@ JAYLINK_API int jaylink_c2_write_address(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -221,11 +250,13 @@ JAYLINK_API int jaylink_c2_read_data(struct jaylink_device_handle *devh,
 
 	ctx = devh->dev->ctx;
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 5, 4 + length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -239,6 +270,7 @@ JAYLINK_API int jaylink_c2_read_data(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -247,10 +279,12 @@ JAYLINK_API int jaylink_c2_read_data(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -302,11 +336,13 @@ JAYLINK_API int jaylink_c2_write_data(struct jaylink_device_handle *devh,
 
 	ctx = devh->dev->ctx;
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 5 + length, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -320,6 +356,7 @@ JAYLINK_API int jaylink_c2_write_data(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -328,10 +365,12 @@ JAYLINK_API int jaylink_c2_write_data(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -347,3 +386,345 @@ JAYLINK_API int jaylink_c2_write_data(struct jaylink_device_handle *devh,
 
 	return JAYLINK_OK;
 }
+
+/*
+ * Wait until the C2 status bits have the expected value. The number of reads
+ * of the address register is stored into count, if not NULL.
+ */
+static int wait_status(struct jaylink_device_handle *devh, uint8_t mask,
+		uint8_t value, size_t *count)
+{
+	int ret;
+	uint8_t status;
+	uint64_t start;
+	size_t num;
+
+	start = util_get_timestamp();
+	num = 0;
+
+	while (true) {
+		ret = jaylink_c2_read_address(devh, &status);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		num++;
+
+		if ((status & mask) == value)
+			break;
+
+		if (util_get_timestamp() - start > POLL_TIMEOUT * 1000) {
+			log_err(devh->dev->ctx, "C2 status poll timed out");
+			return JAYLINK_ERR_TIMEOUT;
+		}
+	}
+
+	if (count)
+		*count = num;
+
+	return JAYLINK_OK;
+}
+
+/* Write data interactively and wait for the response of the target. */
+static int write_data(struct jaylink_device_handle *devh,
+		const uint8_t *data, size_t length)
+{
+	int ret;
+
+	for (size_t i = 0; i < length; i++) {
+		ret = jaylink_c2_write_data(devh, data + i, 1);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		ret = wait_status(devh, C2_STATUS_IN_BUSY, 0, NULL);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	}
+
+	return wait_status(devh, C2_STATUS_OUT_READY, C2_STATUS_OUT_READY,
+		NULL);
+}
+
+static int queue_write(struct jaylink_queue *queue, const uint8_t *data,
+		size_t poll_count)
+{
+	int ret;
+
+	ret = jaylink_queue_c2_write_data(queue, data, 1);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	return jaylink_queue_c2_poll(queue, C2_STATUS_IN_BUSY, 0, poll_count);
+}
+
+/*
+ * Number of reads of the C2 status of the queued polls of a flash operation,
+ * or 0 if not measured yet.
+ */
+struct poll_counts {
+	/* Polls after a byte of a flash command. */
+	size_t command;
+	/* Polls after a byte of flash data. */
+	size_t data;
+};
+
+/* Write the first byte interactively and measure the time of the target. */
+static int measure_write(struct jaylink_device_handle *devh,
+		const uint8_t *data, size_t *poll_count)
+{
+	int ret;
+	size_t count;
+
+	ret = jaylink_c2_write_data(devh, data, 1);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = wait_status(devh, C2_STATUS_IN_BUSY, 0, &count);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	/* Use twice the measured number of reads as safety margin. */
+	*poll_count = MAX(2 * count, POLL_COUNT);
+
+	if (*poll_count > MAX_POLL_COUNT)
+		log_dbg(devh->dev->ctx, "C2 target is too slow for queued "
+			"polling");
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Execute a stage of a flash operation. The commands already in the queue are
+ * followed by the data writes of the stage, each with a poll of the InBusy
+ * flag, and the stage ends with a poll of the OutReady flag.
+ *
+ * If the number of reads of the polls was not measured yet, the first data
+ * write is done interactively in order to measure it. If the target is too
+ * slow for queued polls, all data writes are done interactively.
+ *
+ * A failed poll after the last data write is continued interactively. A
+ * failed poll within the stage is fatal because it is unknown which of the
+ * subsequent data writes were accepted by the target. Writing them again
+ * could feed extra bytes into the flash command interpreter of the target.
+ */
+static int execute_stage(struct jaylink_device_handle *devh,
+		struct jaylink_queue *queue, const uint8_t *data, size_t length,
+		size_t *poll_count)
+{
+	int ret;
+	size_t num;
+	size_t index;
+	int result;
+
+	if (!*poll_count || *poll_count > MAX_POLL_COUNT) {
+		ret = jaylink_queue_execute(queue);
+		jaylink_queue_clear(queue);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	}
+
+	if (!*poll_count) {
+		ret = measure_write(devh, data, poll_count);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		data++;
+		length--;
+	}
+
+	if (*poll_count > MAX_POLL_COUNT)
+		return write_data(devh, data, length);
+
+	ret = JAYLINK_OK;
+
+	for (size_t i = 0; ret == JAYLINK_OK && i < length; i++)
+		ret = queue_write(queue, data + i, *poll_count);
+
+	if (ret == JAYLINK_OK)
+		ret = jaylink_queue_c2_poll(queue, C2_STATUS_OUT_READY,
+			C2_STATUS_OUT_READY, *poll_count);
+
+	if (ret == JAYLINK_OK)
+		ret = jaylink_queue_execute(queue);
+
+	if (ret != JAYLINK_ERR_TIMEOUT) {
+		jaylink_queue_clear(queue);
+		return ret;
+	}
+
+	jaylink_queue_get_length(queue, &num);
+
+	for (index = 0; index < num; index++) {
+		jaylink_queue_get_result(queue, index, &result);
+
+		if (result != JAYLINK_OK)
+			break;
+	}
+
+	jaylink_queue_clear(queue);
+
+	if (index == num - 1 ||
+			(length > 0 && index == num - *poll_count - 1))
+		return write_data(devh, NULL, 0);
+
+	log_err(devh->dev->ctx, "C2 target was not ready during flash "
+		"operation");
+
+	return ret;
+}
+
+static int check_flash_status(struct jaylink_context *ctx, uint8_t status)
+{
+	if (status != FLASH_STATUS_OK) {
+		log_err(ctx, "C2 flash command failed: 0x%02x", status);
+		return JAYLINK_ERR_DEV;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int write_block(struct jaylink_device_handle *devh,
+		struct jaylink_queue *queue, uint8_t fpdat, uint16_t address,
+		const uint8_t *data, size_t length,
+		struct poll_counts *poll_counts)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[4];
+	uint8_t status;
+
+	ctx = devh->dev->ctx;
+
+	buf[0] = FLASH_CMD_BLOCK_WRITE;
+	buf[1] = address >> 8;
+	buf[2] = address;
+	/* A length of 0 corresponds to FLASH_BLOCK_SIZE bytes. */
+	buf[3] = length;
+
+	ret = jaylink_queue_c2_write_address(queue, fpdat);
+
+	if (ret == JAYLINK_OK)
+		ret = execute_stage(devh, queue, buf, 1,
+			&poll_counts->command);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	/*
+	 * The response of the previous command is read together with the
+	 * commands of the next stage.
+	 */
+	ret = jaylink_queue_c2_read_data(queue, &status, 1);
+
+	if (ret == JAYLINK_OK)
+		ret = execute_stage(devh, queue, buf + 1, 3,
+			&poll_counts->command);
+
+	if (ret == JAYLINK_OK)
+		ret = check_flash_status(ctx, status);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = jaylink_c2_read_data(devh, &status, 1);
+
+	if (ret == JAYLINK_OK)
+		ret = check_flash_status(ctx, status);
+
+	if (ret == JAYLINK_OK)
+		ret = execute_stage(devh, queue, data, length,
+			&poll_counts->data);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = jaylink_c2_read_data(devh, &status, 1);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	return check_flash_status(ctx, status);
+}
+
+/**
+ * Write to the flash memory of a C2 target.
+ *
+ * The data is written with flash block write commands of up to 256 bytes. The
+ * C2 operations of a block, including the polling of the C2 status after each
+ * byte, are sent to the device with a command queue. This way, a block is
+ * written with a few transfers only. The number of status reads of the queued
+ * polls is adapted to the time the target needs for the first command byte and
+ * the first data byte. If the target is too slow for queued polling, the bytes
+ * are written one at a time instead.
+ *
+ * @note Flash programming must be enabled and the flash must be erased
+ *       before. See Silicon Labs application note AN127 for details.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] fpdat Address of the flash programming data register (FPDAT) of
+ *                  the target.
+ * @param[in] address Flash address to start writing at.
+ * @param[in] data Buffer to read the data to be written from.
+ * @param[in] length Number of bytes to write.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred, or the target was not ready
+ *                             in time.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_DEV Unspecified device error, or a flash command failed.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_c2_flash_write(struct jaylink_device_handle *devh,
+		uint8_t fpdat, uint16_t address, const uint8_t *data,
+		size_t length)
+{
+	int ret;
+	struct jaylink_queue *queue;
+	size_t offset;
+	size_t tmp;
+	struct poll_counts poll_counts;
+
+	if (!devh || !data || !length)
+		return JAYLINK_ERR_ARG;
+
+	if (address + length > UINT16_MAX + 1)
+		return JAYLINK_ERR_ARG;
+
+	ret = jaylink_queue_new(devh, &queue);
+
+	if (ret != JAYLINK_OK) {
+		log_err(devh->dev->ctx, "jaylink_queue_new() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	offset = 0;
+	poll_counts.command = 0;
+	poll_counts.data = 0;
+
+	while (offset < length) {
+		tmp = MIN(length - offset, FLASH_BLOCK_SIZE);
+		ret = write_block(devh, queue, fpdat, address + offset,
+			data + offset, tmp, &poll_counts);
+
+		if (ret != JAYLINK_OK)
+			break;
+
+		offset += tmp;
+	}
+
+	jaylink_queue_free(queue);
+
+	return ret;
+}
@@ -0,0 +1,530 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Target interface speed calibration.
+ */
+
+/** @cond PRIVATE */
+/** Number of bits shifted through the data register of the JTAG scan chain. */
+#define JTAG_SHIFT_LENGTH	512
+
+/**
+ * Number of clock cycles to get from any TAP state to Shift-DR before the
+ * shift.
+ */
+#define JTAG_PREFIX_LENGTH	9
+
+/**
+ * Number of clock cycles to get from Exit1-DR to Run-Test/Idle after the
+ * shift.
+ */
+#define JTAG_SUFFIX_LENGTH	2
+
+/** Total number of bits of a JTAG test scan. */
+#define JTAG_SCAN_LENGTH \
+	(JTAG_PREFIX_LENGTH + JTAG_SHIFT_LENGTH + JTAG_SUFFIX_LENGTH)
+
+/**
+ * Minimum number of test pattern bits which must pass through the JTAG scan
+ * chain.
+ *
+ * This limits the supported length of the data register of the scan chain.
+ */
+#define JTAG_MIN_PATTERN_LENGTH	32
+
+/**
+ * Number of bits of the SWD line reset sequence, including the JTAG-to-SWD
+ * select sequence and idle cycles.
+ */
+#define SWD_RESET_LENGTH	136
+
+/** JTAG-to-SWD select sequence. */
+#define SWD_JTAG_TO_SWD		0xe79e
+
+/** Number of DP IDR reads for each test iteration. */
+#define SWD_NUM_READS		4
+
+/**
+ * Minimum speed step as fraction of the current speed.
+ *
+ * For example, a value of 32 means that the next tested speed is at least 1/32
+ * faster than the last speed which passed.
+ */
+#define MIN_SPEED_STEP		32
+/** @endcond */
+
+struct calibration {
+	/** Calibration parameters. */
+	const struct jaylink_speed_calibration *params;
+	/**
+	 * Length of the data register of the JTAG scan chain.
+	 *
+	 * This is the delay of the test pattern between TDI and TDO.
+	 */
+	size_t jtag_delay;
+	/** Data register content of the JTAG scan chain captured after reset. */
+	uint8_t jtag_capture[JTAG_SHIFT_LENGTH / 8];
+	/** SWD DP IDR value. */
+	uint32_t swd_idr;
+};
+
+/* Generate a pseudo-random test pattern with xorshift. */
+static void generate_pattern(uint8_t *pattern, size_t length, uint32_t seed)
+{
+	uint32_t state;
+
+	state = seed * 2654435761UL + 1;
+
+	for (size_t i = 0; i < length; i++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		pattern[i] = state;
+	}
+}
+
+/*
+ * Move all TAPs to Shift-DR via Test-Logic-Reset, shift the test pattern
+ * through the data registers and return to Run-Test/Idle. After the reset,
+ * the data register of each TAP is either its IDCODE or its bypass register.
+ */
+static int jtag_scan(struct jaylink_device_handle *devh,
+		const struct calibration *cal, const uint8_t *pattern,
+		uint8_t *output)
+{
+	int ret;
+	uint8_t tms[(JTAG_SCAN_LENGTH + 7) / 8];
+	uint8_t tdi[(JTAG_SCAN_LENGTH + 7) / 8];
+	uint8_t tdo[(JTAG_SCAN_LENGTH + 7) / 8];
+	size_t offset;
+
+	memset(tms, 0x00, sizeof(tms));
+	memset(tdi, 0x00, sizeof(tdi));
+
+	/* Test-Logic-Reset, Run-Test/Idle, Select-DR, Capture-DR, Shift-DR. */
+	jaylink_bits_fill(tms, 0, 5, 0x01, 1);
+	jaylink_bits_set(tms, 6, 0x01, 1);
+
+	offset = JTAG_PREFIX_LENGTH;
+
+	jaylink_bits_copy(tdi, offset, pattern, 0, JTAG_SHIFT_LENGTH);
+
+	/* Exit1-DR with the last bit, then Update-DR and Run-Test/Idle. */
+	jaylink_bits_fill(tms, offset + JTAG_SHIFT_LENGTH - 1, 2, 0x01, 1);
+
+	ret = jaylink_jtag_io(devh, tms, tdi, tdo, JTAG_SCAN_LENGTH,
+		cal->params->jtag_version);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	jaylink_bits_copy(output, 0, tdo, offset, JTAG_SHIFT_LENGTH);
+
+	return JAYLINK_OK;
+}
+
+static bool jtag_find_delay(const uint8_t *pattern, const uint8_t *output,
+		size_t *delay)
+{
+	/* Every TAP has a data register with at least one bit. */
+	for (size_t d = 1; d <= JTAG_SHIFT_LENGTH - JTAG_MIN_PATTERN_LENGTH;
+			d++) {
+		if (jaylink_bits_compare(output, d, pattern, 0, NULL, 0,
+				JTAG_SHIFT_LENGTH - d)) {
+			*delay = d;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int jtag_reference(struct jaylink_device_handle *devh,
+		struct calibration *cal, bool *valid)
+{
+	int ret;
+	uint8_t pattern[JTAG_SHIFT_LENGTH / 8];
+
+	generate_pattern(pattern, sizeof(pattern), 0);
+	ret = jtag_scan(devh, cal, pattern, cal->jtag_capture);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	*valid = jtag_find_delay(pattern, cal->jtag_capture, &cal->jtag_delay);
+
+	if (*valid)
+		log_dbg(devh->dev->ctx, "JTAG scan chain data register length: "
+			"%zu bits", cal->jtag_delay);
+
+	return JAYLINK_OK;
+}
+
+static int jtag_test(struct jaylink_device_handle *devh,
+		const struct calibration *cal, uint32_t iteration, bool *passed)
+{
+	int ret;
+	uint8_t pattern[JTAG_SHIFT_LENGTH / 8];
+	uint8_t output[JTAG_SHIFT_LENGTH / 8];
+
+	generate_pattern(pattern, sizeof(pattern), iteration + 1);
+	ret = jtag_scan(devh, cal, pattern, output);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	/*
+	 * The output starts with the data register content captured after
+	 * reset followed by the delayed test pattern.
+	 */
+	*passed = jaylink_bits_compare(output, 0, cal->jtag_capture, 0, NULL, 0,
+		cal->jtag_delay) && jaylink_bits_compare(output,
+		cal->jtag_delay, pattern, 0, NULL, 0,
+		JTAG_SHIFT_LENGTH - cal->jtag_delay);
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Perform a line reset, which includes the JTAG-to-SWD select sequence, and
+ * read the DP IDR register multiple times. The DP IDR register must be read
+ * after a line reset.
+ */
+static int swd_read_idr(struct jaylink_device_handle *devh,
+		struct jaylink_swd_transaction *transactions)
+{
+	int ret;
+	uint8_t direction[SWD_RESET_LENGTH / 8];
+	uint8_t out[SWD_RESET_LENGTH / 8];
+	uint8_t in[SWD_RESET_LENGTH / 8];
+
+	memset(direction, 0xff, sizeof(direction));
+	memset(out, 0x00, sizeof(out));
+
+	jaylink_bits_fill(out, 0, 56, 0x01, 1);
+	jaylink_bits_set(out, 56, SWD_JTAG_TO_SWD, 16);
+	jaylink_bits_fill(out, 72, 56, 0x01, 1);
+
+	/* The remaining bits are idle cycles. */
+	ret = jaylink_swd_io(devh, direction, out, in, SWD_RESET_LENGTH);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	for (size_t i = 0; i < SWD_NUM_READS; i++) {
+		transactions[i].ap = false;
+		transactions[i].read = true;
+		transactions[i].address = 0x00;
+	}
+
+	return jaylink_swd_transfer(devh, transactions, SWD_NUM_READS, 2);
+}
+
+static int swd_reference(struct jaylink_device_handle *devh,
+		struct calibration *cal, bool *valid)
+{
+	int ret;
+	struct jaylink_swd_transaction transactions[SWD_NUM_READS];
+
+	ret = swd_read_idr(devh, transactions);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	*valid = false;
+
+	if (transactions[0].ack != JAYLINK_SWD_ACK_OK)
+		return JAYLINK_OK;
+
+	if (transactions[0].parity_error)
+		return JAYLINK_OK;
+
+	/* Bit 0 of the DP IDR register is always set. */
+	if (!(transactions[0].data & 0x01))
+		return JAYLINK_OK;
+
+	cal->swd_idr = transactions[0].data;
+
+	for (size_t i = 1; i < SWD_NUM_READS; i++) {
+		if (transactions[i].ack != JAYLINK_SWD_ACK_OK)
+			return JAYLINK_OK;
+
+		if (transactions[i].parity_error)
+			return JAYLINK_OK;
+
+		if (transactions[i].data != cal->swd_idr)
+			return JAYLINK_OK;
+	}
+
+	log_dbg(devh->dev->ctx, "SWD DP IDR: 0x%08x", cal->swd_idr);
+	*valid = true;
+
+	return JAYLINK_OK;
+}
+
+static int swd_test(struct jaylink_device_handle *devh,
+		const struct calibration *cal, bool *passed)
+{
+	int ret;
+	struct jaylink_swd_transaction transactions[SWD_NUM_READS];
+
+	ret = swd_read_idr(devh, transactions);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	for (size_t i = 0; i < SWD_NUM_READS; i++) {
+		if (transactions[i].ack != JAYLINK_SWD_ACK_OK ||
+				transactions[i].parity_error ||
+				transactions[i].data != cal->swd_idr) {
+			*passed = false;
+			return JAYLINK_OK;
+		}
+	}
+
+	*passed = true;
+
+	return JAYLINK_OK;
+}
+
+static int test_speed(struct jaylink_device_handle *devh,
+		const struct calibration *cal, uint16_t speed, bool *passed)
+{
+	int ret;
+
+	ret = jaylink_set_speed(devh, speed);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	for (uint32_t i = 0; i < cal->params->iterations; i++) {
+		if (cal->params->iface == JAYLINK_TIF_JTAG)
+			ret = jtag_test(devh, cal, i, passed);
+		else
+			ret = swd_test(devh, cal, passed);
+
+		/*
+		 * A device error, for example when the target does not answer
+		 * properly, fails the test at this speed only.
+		 */
+		if (ret == JAYLINK_ERR_DEV) {
+			*passed = false;
+			return JAYLINK_OK;
+		} else if (ret != JAYLINK_OK) {
+			return ret;
+		}
+
+		if (!*passed)
+			break;
+	}
+
+	log_dbg(devh->dev->ctx, "Speed calibration: %u kHz %s", speed,
+		*passed ? "passed" : "failed");
+
+	return JAYLINK_OK;
+}
+
+/* Get the divider of the fastest speed which does not exceed a speed. */
+static uint32_t get_divider(const struct jaylink_speed *info, uint32_t speed)
+{
+	uint32_t div;
+
+	div = (info->freq + speed * 1000 - 1) / (speed * 1000);
+
+	return MAX(div, info->div);
+}
+
+/**
+ * Calibrate the target interface speed.
+ *
+ * The speeds which are supported by the device are tested in increasing order,
+ * starting at the given start speed, until a test fails. At each speed, test
+ * patterns are transferred and compared with a reference which is recorded at
+ * the start speed:
+ *
+ *  - For JTAG, a test pattern is shifted through the scan chain after a TAP
+ *    reset. Both the captured IDCODE and bypass registers and the delayed test
+ *    pattern are verified.
+ *  - For SWD, the DP IDR register is read after a line reset, which includes
+ *    the JTAG-to-SWD select sequence. The acknowledge responses, the parity
+ *    and the register value are verified.
+ *
+ * The resulting speed is the fastest supported speed which is slower than the
+ * fastest speed which passed all tests by at least the safety margin, but not
+ * slower than the start speed.
+ *
+ * @note This function must only be used if the device has the
+ *       #JAYLINK_DEV_CAP_GET_SPEEDS capability and the target interface given
+ *       by the calibration parameters is selected.
+ *
+ * @note Only a single target interface speed is tested at a time. A speed
+ *       which fails, for example due to reflections, is assumed to fail at
+ *       all faster speeds as well.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] params Calibration parameters.
+ * @param[in] apply Determines whether the resulting speed is set. Otherwise,
+ *                  the start speed is set at the end of the calibration.
+ * @param[out] speed Resulting speed in kHz on success, and undefined on
+ *                   failure. Can be NULL.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_NOT_AVAILABLE The test patterns do not pass at the start
+ *                                   speed, for example because the target is
+ *                                   not connected.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_PROTO Protocol violation.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_DEV Unspecified device error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @see jaylink_get_speeds()
+ * @see jaylink_set_speed()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_calibrate_speed(struct jaylink_device_handle *devh,
+		const struct jaylink_speed_calibration *params, bool apply,
+		uint16_t *speed)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct calibration cal;
+	struct jaylink_speed info;
+	uint32_t max_speed;
+	uint32_t best;
+	uint32_t tmp;
+	uint32_t result;
+	bool passed;
+
+	if (!devh || !params)
+		return JAYLINK_ERR_ARG;
+
+	if (params->iface != JAYLINK_TIF_JTAG &&
+			params->iface != JAYLINK_TIF_SWD)
+		return JAYLINK_ERR_ARG;
+
+	if (!params->start_speed ||
+			params->start_speed == JAYLINK_SPEED_ADAPTIVE_CLOCKING)
+		return JAYLINK_ERR_ARG;
+
+	if (params->margin >= 100 || !params->iterations)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+	ret = jaylink_get_speeds(devh, &info);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	max_speed = info.freq / info.div / 1000;
+
+	if (params->max_speed && params->max_speed < max_speed)
+		max_speed = params->max_speed;
+
+	/* Valid speeds are below JAYLINK_SPEED_ADAPTIVE_CLOCKING. */
+	max_speed = MIN(max_speed, JAYLINK_SPEED_ADAPTIVE_CLOCKING - 1);
+
+	if (params->start_speed > max_speed)
+		return JAYLINK_ERR_ARG;
+
+	cal.params = params;
+
+	ret = jaylink_set_speed(devh, params->start_speed);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (params->iface == JAYLINK_TIF_JTAG)
+		ret = jtag_reference(devh, &cal, &passed);
+	else
+		ret = swd_reference(devh, &cal, &passed);
+
+	if (ret == JAYLINK_OK && passed)
+		ret = test_speed(devh, &cal, params->start_speed, &passed);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (!passed) {
+		log_err(ctx, "Speed calibration failed at start speed of %u kHz",
+			params->start_speed);
+		return JAYLINK_ERR_NOT_AVAILABLE;
+	}
+
+	best = params->start_speed;
+
+	/*
+	 * Walk through the supported speeds which are faster. Skip speeds which
+	 * are only slightly faster than the last speed that passed to limit the
+	 * number of steps at low speeds.
+	 */
+	for (uint32_t div = get_divider(&info, best); div >= info.div; div--) {
+		tmp = info.freq / div / 1000;
+
+		if (tmp <= best || tmp - best < best / MIN_SPEED_STEP)
+			continue;
+
+		if (tmp > max_speed)
+			break;
+
+		ret = test_speed(devh, &cal, tmp, &passed);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		if (!passed)
+			break;
+
+		best = tmp;
+	}
+
+	tmp = best * (100 - params->margin) / 100;
+	result = params->start_speed;
+
+	if (tmp > params->start_speed)
+		result = MAX(info.freq / get_divider(&info, tmp) / 1000,
+			result);
+
+	log_info(ctx, "Speed calibration: fastest speed is %u kHz, resulting "
+		"speed is %u kHz", best, result);
+
+	ret = jaylink_set_speed(devh, apply ? result : params->start_speed);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (speed)
+		*speed = result;
+
+	return JAYLINK_OK;
+}
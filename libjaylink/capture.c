@@ -0,0 +1,611 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Capture and replay of transfers.
+ *
+ * A capture file starts with a header of #CAPTURE_HEADER_SIZE bytes which
+ * consists of the magic string "JLCAP" including its null-terminator and the
+ * 16-bit file format version. The header is followed by a sequence of events
+ * in chronological order. Each event consists of:
+ *
+ *  - Event type, see #capture_event_type (8-bit)
+ *  - Opcode of the current command, or 0 if unknown (8-bit)
+ *  - Timestamp in microseconds since the start of the capture (64-bit)
+ *  - Length of the payload in bytes (32-bit)
+ *  - Payload
+ *
+ * The payload of write and read events is the transferred data. The payload
+ * of the events which start a write and / or read operation consists of the
+ * 32-bit lengths of the operations followed by the 8-bit command flag, if
+ * applicable. A capture with dropped events ends with a
+ * #CAPTURE_EVENT_DROPPED event whose payload is the 32-bit number of dropped
+ * events. All values are stored in little-endian byte order.
+ */
+
+/** @cond PRIVATE */
+/** Magic string of a capture file. */
+#define CAPTURE_MAGIC		"JLCAP"
+/** Version of the capture file format. */
+#define CAPTURE_VERSION		1
+
+/** Size of the capture file header in bytes. */
+#define CAPTURE_HEADER_SIZE	8
+/** Size of the event header in bytes. */
+#define EVENT_HEADER_SIZE	14
+
+/** Size of the capture buffer in bytes. */
+#define CAPTURE_BUFFER_SIZE	(4 * 1024 * 1024)
+/** Polling interval of the capture writer thread in microseconds. */
+#define CAPTURE_INTERVAL	1000
+/** @endcond */
+
+static void writer_thread(void *arg)
+{
+	struct capture *capture;
+	const uint8_t *data;
+	size_t length;
+
+	capture = arg;
+
+	while (true) {
+		length = ringbuffer_get_read_area(&capture->ringbuffer, &data);
+
+		if (!length) {
+			if (ATOMIC_LOAD(&capture->stop))
+				break;
+
+			thread_sleep(CAPTURE_INTERVAL);
+			continue;
+		}
+
+		if (!capture->error) {
+			if (fwrite(data, 1, length, capture->file) != length)
+				capture->error = true;
+		}
+
+		ringbuffer_consume(&capture->ringbuffer, length);
+	}
+}
+
+static void capture_event(struct jaylink_device_handle *devh,
+		enum capture_event_type type, const uint8_t *data,
+		size_t length, const struct io_vector *iov, size_t count)
+{
+	struct capture *capture;
+	struct ringbuffer *rb;
+	uint8_t header[EVENT_HEADER_SIZE];
+	size_t payload_length;
+
+	capture = devh->capture;
+	rb = &capture->ringbuffer;
+
+	payload_length = length;
+
+	for (size_t i = 0; i < count; i++)
+		payload_length += iov[i].length;
+
+	/*
+	 * Drop the event rather than blocking the caller if the writer thread
+	 * cannot keep up.
+	 */
+	if (rb->size - ringbuffer_get_length(rb) <
+			EVENT_HEADER_SIZE + payload_length) {
+		capture->num_dropped++;
+		return;
+	}
+
+	header[0] = type;
+	header[1] = capture->opcode;
+	buffer_set_u64(header, util_get_timestamp() - capture->start, 2);
+	buffer_set_u32(header, payload_length, 10);
+
+	ringbuffer_write(rb, header, EVENT_HEADER_SIZE);
+
+	if (length > 0)
+		ringbuffer_write(rb, data, length);
+
+	for (size_t i = 0; i < count; i++)
+		ringbuffer_write(rb, iov[i].buffer, iov[i].length);
+}
+
+static void start_operation(struct jaylink_device_handle *devh,
+		bool has_command)
+{
+	/* The opcode is taken from the first data of the write operation. */
+	if (has_command) {
+		devh->capture->opcode = 0;
+		devh->capture->opcode_pending = true;
+	}
+}
+
+/**
+ * Capture the start of a write operation.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] length Number of bytes of the write operation.
+ * @param[in] has_command Determines whether the data of the write operation
+ *                        contains the protocol command.
+ */
+JAYLINK_PRIV void capture_start_write(struct jaylink_device_handle *devh,
+		size_t length, bool has_command)
+{
+	uint8_t buf[5];
+
+	start_operation(devh, has_command);
+
+	buffer_set_u32(buf, length, 0);
+	buf[4] = has_command;
+
+	capture_event(devh, CAPTURE_EVENT_START_WRITE, buf, sizeof(buf),
+		NULL, 0);
+}
+
+/**
+ * Capture the start of a read operation.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] length Number of bytes of the read operation.
+ */
+JAYLINK_PRIV void capture_start_read(struct jaylink_device_handle *devh,
+		size_t length)
+{
+	uint8_t buf[4];
+
+	buffer_set_u32(buf, length, 0);
+
+	capture_event(devh, CAPTURE_EVENT_START_READ, buf, sizeof(buf),
+		NULL, 0);
+}
+
+/**
+ * Capture the start of a write and read operation.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] write_length Number of bytes of the write operation.
+ * @param[in] read_length Number of bytes of the read operation.
+ * @param[in] has_command Determines whether the data of the write operation
+ *                        contains the protocol command.
+ */
+JAYLINK_PRIV void capture_start_write_read(struct jaylink_device_handle *devh,
+		size_t write_length, size_t read_length, bool has_command)
+{
+	uint8_t buf[9];
+
+	start_operation(devh, has_command);
+
+	buffer_set_u32(buf, write_length, 0);
+	buffer_set_u32(buf, read_length, 4);
+	buf[8] = has_command;
+
+	capture_event(devh, CAPTURE_EVENT_START_WRITE_READ, buf, sizeof(buf),
+		NULL, 0);
+}
+
+/**
+ * Capture written data.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] iov Array of segments with the written data.
+ * @param[in] count Number of segments.
+ */
+JAYLINK_PRIV void capture_write(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	struct capture *capture;
+
+	capture = devh->capture;
+
+	if (capture->opcode_pending) {
+		for (size_t i = 0; i < count; i++) {
+			if (iov[i].length > 0) {
+				capture->opcode = *(const uint8_t *)iov[i].buffer;
+				capture->opcode_pending = false;
+				break;
+			}
+		}
+	}
+
+	capture_event(devh, CAPTURE_EVENT_WRITE, NULL, 0, iov, count);
+}
+
+/**
+ * Capture read data.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] iov Array of segments with the read data.
+ * @param[in] count Number of segments.
+ */
+JAYLINK_PRIV void capture_read(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	capture_event(devh, CAPTURE_EVENT_READ, NULL, 0, iov, count);
+}
+
+/*
+ * Mark the capture file as incomplete such that it is rejected by
+ * jaylink_replay_open(). A replay with missing events would silently diverge
+ * from the captured session.
+ */
+static bool write_dropped_event(struct capture *capture)
+{
+	uint8_t buf[EVENT_HEADER_SIZE + 4];
+
+	buf[0] = CAPTURE_EVENT_DROPPED;
+	buf[1] = 0;
+	buffer_set_u64(buf, util_get_timestamp() - capture->start, 2);
+	buffer_set_u32(buf, 4, 10);
+	buffer_set_u32(buf, MIN(capture->num_dropped, UINT32_MAX),
+		EVENT_HEADER_SIZE);
+
+	return fwrite(buf, 1, sizeof(buf), capture->file) == sizeof(buf);
+}
+
+/** @private */
+JAYLINK_PRIV int capture_stop(struct jaylink_device_handle *devh)
+{
+	struct capture *capture;
+	struct jaylink_context *ctx;
+	int ret;
+
+	capture = devh->capture;
+	ctx = devh->dev->ctx;
+	ret = JAYLINK_OK;
+
+	ATOMIC_STORE(&capture->stop, true);
+
+	if (!thread_join(&capture->thread)) {
+		log_err(ctx, "Failed to join capture writer thread");
+		ret = JAYLINK_ERR;
+	}
+
+	if (capture->num_dropped > 0) {
+		log_err(ctx, "Capture is incomplete, %zu events were dropped",
+			capture->num_dropped);
+
+		if (!capture->error && !write_dropped_event(capture))
+			capture->error = true;
+
+		if (ret == JAYLINK_OK)
+			ret = JAYLINK_ERR;
+	}
+
+	if (fclose(capture->file) != 0 || capture->error) {
+		log_err(ctx, "Failed to write capture file");
+		ret = JAYLINK_ERR_IO;
+	}
+
+	ringbuffer_free(&capture->ringbuffer);
+	free(capture);
+	devh->capture = NULL;
+
+	return ret;
+}
+
+/**
+ * Start to capture the transfers of a device.
+ *
+ * All write and read operations of the device handle are recorded to a binary
+ * capture file until jaylink_capture_stop() is called. The file is written by
+ * a separate thread such that the transfers are not delayed. Events are
+ * dropped if the thread cannot keep up. In that case, the capture file is
+ * marked as incomplete, jaylink_capture_stop() fails and the capture file
+ * cannot be replayed.
+ *
+ * A capture file can be replayed with jaylink_replay_open().
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] filename Name of the capture file. An existing file is
+ *                     overwritten.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or a capture is already active.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_IO Failed to create the capture file.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_capture_start(struct jaylink_device_handle *devh,
+		const char *filename)
+{
+	struct jaylink_context *ctx;
+	struct capture *capture;
+	uint8_t header[CAPTURE_HEADER_SIZE];
+
+	if (!devh || !filename)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->capture)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+	capture = malloc(sizeof(struct capture));
+
+	if (!capture) {
+		log_err(ctx, "Capture malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	if (!ringbuffer_init(&capture->ringbuffer, CAPTURE_BUFFER_SIZE)) {
+		log_err(ctx, "Capture buffer malloc failed");
+		free(capture);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	capture->file = fopen(filename, "wb");
+
+	if (!capture->file) {
+		log_err(ctx, "Failed to create capture file");
+		ringbuffer_free(&capture->ringbuffer);
+		free(capture);
+		return JAYLINK_ERR_IO;
+	}
+
+	memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	buffer_set_u16(header, CAPTURE_VERSION, sizeof(CAPTURE_MAGIC));
+
+	if (fwrite(header, 1, sizeof(header), capture->file) != sizeof(header)) {
+		log_err(ctx, "Failed to write capture file");
+		fclose(capture->file);
+		ringbuffer_free(&capture->ringbuffer);
+		free(capture);
+		return JAYLINK_ERR_IO;
+	}
+
+	capture->start = util_get_timestamp();
+	capture->opcode = 0;
+	capture->opcode_pending = false;
+	capture->num_dropped = 0;
+	capture->stop = false;
+	capture->error = false;
+
+	if (!thread_create(&capture->thread, &writer_thread, capture)) {
+		log_err(ctx, "Failed to create capture writer thread");
+		fclose(capture->file);
+		ringbuffer_free(&capture->ringbuffer);
+		free(capture);
+		return JAYLINK_ERR;
+	}
+
+	devh->capture = capture;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Stop to capture the transfers of a device.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or no capture is active.
+ * @retval JAYLINK_ERR_IO Failed to write the capture file.
+ * @retval JAYLINK_ERR Events were dropped and the capture file is
+ *                     incomplete, or other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_capture_stop(struct jaylink_device_handle *devh)
+{
+	if (!devh || !devh->capture)
+		return JAYLINK_ERR_ARG;
+
+	return capture_stop(devh);
+}
+
+static bool append_data(uint8_t **buffer, size_t *length, size_t *size,
+		const uint8_t *data, size_t data_length)
+{
+	uint8_t *tmp;
+	size_t new_size;
+
+	if (*length + data_length > *size) {
+		new_size = MAX(*size * 2, *length + data_length);
+		tmp = realloc(*buffer, new_size);
+
+		if (!tmp)
+			return false;
+
+		*buffer = tmp;
+		*size = new_size;
+	}
+
+	memcpy(*buffer + *length, data, data_length);
+	*length += data_length;
+
+	return true;
+}
+
+/** @private */
+JAYLINK_PRIV int capture_load(struct jaylink_context *ctx,
+		const char *filename, struct replay_data *replay)
+{
+	FILE *file;
+	uint8_t header[EVENT_HEADER_SIZE];
+	uint8_t *payload;
+	uint8_t *tmp;
+	size_t payload_length;
+	size_t write_size;
+	size_t read_size;
+	bool success;
+
+	file = fopen(filename, "rb");
+
+	if (!file) {
+		log_err(ctx, "Failed to open capture file");
+		return JAYLINK_ERR_IO;
+	}
+
+	if (fread(header, 1, CAPTURE_HEADER_SIZE, file) != CAPTURE_HEADER_SIZE ||
+			memcmp(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC))) {
+		log_err(ctx, "Invalid capture file");
+		fclose(file);
+		return JAYLINK_ERR;
+	}
+
+	if (buffer_get_u16(header, sizeof(CAPTURE_MAGIC)) != CAPTURE_VERSION) {
+		log_err(ctx, "Unsupported capture file version: %u",
+			buffer_get_u16(header, sizeof(CAPTURE_MAGIC)));
+		fclose(file);
+		return JAYLINK_ERR;
+	}
+
+	replay->write_data = NULL;
+	replay->write_length = 0;
+	replay->write_pos = 0;
+	replay->read_data = NULL;
+	replay->read_length = 0;
+	replay->read_pos = 0;
+
+	write_size = 0;
+	read_size = 0;
+	payload = NULL;
+	success = true;
+
+	while (fread(header, 1, EVENT_HEADER_SIZE, file) == EVENT_HEADER_SIZE) {
+		payload_length = buffer_get_u32(header, 10);
+		tmp = realloc(payload, MAX(payload_length, 1));
+
+		if (!tmp) {
+			log_err(ctx, "Capture event malloc failed");
+			success = false;
+			break;
+		}
+
+		payload = tmp;
+
+		if (fread(payload, 1, payload_length, file) != payload_length) {
+			log_err(ctx, "Capture file is truncated");
+			success = false;
+			break;
+		}
+
+		if (header[0] == CAPTURE_EVENT_DROPPED) {
+			log_err(ctx, "Capture file is incomplete, %u events "
+				"were dropped", payload_length >= 4 ?
+				buffer_get_u32(payload, 0) : 0);
+			success = false;
+			break;
+		}
+
+		if (header[0] == CAPTURE_EVENT_WRITE)
+			success = append_data(&replay->write_data,
+				&replay->write_length, &write_size, payload,
+				payload_length);
+		else if (header[0] == CAPTURE_EVENT_READ)
+			success = append_data(&replay->read_data,
+				&replay->read_length, &read_size, payload,
+				payload_length);
+
+		if (!success) {
+			log_err(ctx, "Replay data malloc failed");
+			break;
+		}
+	}
+
+	free(payload);
+	fclose(file);
+
+	if (!success) {
+		free(replay->write_data);
+		free(replay->read_data);
+		return JAYLINK_ERR;
+	}
+
+	log_dbg(ctx, "Loaded capture file with %zu / %zu bytes of written / "
+		"read data", replay->write_length, replay->read_length);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Open a replay of a capture file.
+ *
+ * The returned device handle behaves like a handle of a real device. Data
+ * written to the device is compared with the captured data and read operations
+ * return the data captured from the device. The device instance of the handle
+ * has the host interface #JAYLINK_HIF_REPLAY.
+ *
+ * Use jaylink_close() to close the replay.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] filename Name of the capture file, see jaylink_capture_start().
+ * @param[out] devh Newly allocated device handle on success, and undefined on
+ *                  failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_IO Failed to read the capture file.
+ * @retval JAYLINK_ERR The capture file is invalid or incomplete, or other
+ *                     error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_replay_open(struct jaylink_context *ctx,
+		const char *filename, struct jaylink_device_handle **devh)
+{
+	int ret;
+	struct jaylink_device *dev;
+
+	if (!ctx || !filename || !devh)
+		return JAYLINK_ERR_ARG;
+
+	dev = device_allocate(ctx);
+
+	if (!dev) {
+		log_err(ctx, "Device instance malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	dev->iface = JAYLINK_HIF_REPLAY;
+	dev->has_serial_number = false;
+	dev->has_mac_address = false;
+	dev->has_product_name = false;
+	dev->has_nickname = false;
+	dev->has_hw_version = false;
+	dev->filename = malloc(strlen(filename) + 1);
+
+	if (!dev->filename) {
+		log_err(ctx, "Capture filename malloc failed");
+		jaylink_unref_device(dev);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	strcpy(dev->filename, filename);
+
+	/* The device handle holds its own reference to the device instance. */
+	ret = jaylink_open(dev, devh);
+	jaylink_unref_device(dev);
+
+	return ret;
+}
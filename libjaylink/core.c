@@ -57,6 +57,30 @@
  * perspective and because there is only a single reason for failure which is
  * clearly distinguishable from the result.
  *
+ * @section sec_threads Thread safety
+ *
+ * A single libjaylink context can be used by multiple threads concurrently,
+ * for example to operate one device per thread. The following rules apply:
+ *
+ *  - Device instances are reference counted atomically and can be referenced,
+ *    unreferenced and queried from any thread.
+ *  - Device discovery, hotplug event handling, jaylink_get_devices() and
+ *    jaylink_device_snapshot_update() are serialized internally.
+ *    jaylink_find_device_by_serial() can be called while a device discovery
+ *    is in progress.
+ *  - Different device handles are independent of each other and can be used
+ *    by different threads at the same time. A single device handle must not
+ *    be used by multiple threads at the same time without external
+ *    synchronization.
+ *  - The log level can be changed at any time. All other log settings should
+ *    be configured before the context is shared between threads.
+ *  - jaylink_exit() must only be called after all other threads have stopped
+ *    using the context.
+ *
+ * Callback functions, for example the log callback function, can be invoked
+ * from any thread which uses the context and must therefore be thread-safe
+ * themselves.
+ *
  * @section sec_license Copyright and license
  *
  * libjaylink is licensed under the terms of the GNU General Public
@@ -73,6 +97,14 @@
  * Core library functions.
  */
 
+/** @cond PRIVATE */
+/**
+ * Maximum number of released device instances and list items kept by a
+ * context for later reuse.
+ */
+#define DEVICE_POOL_SIZE	64
+/** @endcond */
+
 /**
  * Initialize libjaylink.
  *
@@ -131,18 +163,87 @@ JAYLINK_API int jaylink_init(struct jaylink_context **ctx)
 	}
 #endif
 
-	context->devs = NULL;
+	if (!mutex_init(&context->devs_mutex)) {
+#ifdef HAVE_LIBUSB
+		libusb_exit(context->usb_ctx);
+#endif
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		free(context);
+		return JAYLINK_ERR;
+	}
+
+	if (!mutex_init(&context->discovery_mutex)) {
+		mutex_destroy(&context->devs_mutex);
+#ifdef HAVE_LIBUSB
+		libusb_exit(context->usb_ctx);
+#endif
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		free(context);
+		return JAYLINK_ERR;
+	}
+
+#ifdef HAVE_LIBUSB
+	/*
+	 * The hotplug mutex lives as long as the context because the libusb
+	 * hotplug callback may still be running in another thread while the
+	 * hotplug mode is disabled.
+	 */
+	if (!mutex_init(&context->hotplug_mutex)) {
+		mutex_destroy(&context->discovery_mutex);
+		mutex_destroy(&context->devs_mutex);
+		libusb_exit(context->usb_ctx);
+		free(context);
+		return JAYLINK_ERR;
+	}
+#endif
+
+	hash_table_init(&context->devs_by_usb);
+	hash_table_init(&context->devs_by_serial);
+	hash_table_init(&context->devs_by_mac);
+	pool_init(&context->devs_pool, sizeof(struct jaylink_device),
+		DEVICE_POOL_SIZE);
 	context->discovered_devs = NULL;
+	context->num_discovered_devs = 0;
+	pool_init(&context->discovery_pool, sizeof(struct list),
+		DEVICE_POOL_SIZE);
+	context->tcp_targets = NULL;
+	context->num_tcp_targets = 0;
+	context->tcp_stop_serial_numbers = NULL;
+	context->num_tcp_stop_serial_numbers = 0;
+	context->tcp_stop_num_devices = 0;
+	context->tcp_connections = NULL;
+	context->num_tcp_connections = 0;
+	context->max_tcp_connections = 0;
+	context->tcp_idle_timeout = 0;
+	context->tcp_connect_retries = 0;
+	context->tcp_connect_retry_delay = 0;
+#ifdef HAVE_LIBUSB
+	context->hotplug = false;
+	context->hotplug_devs = NULL;
+	context->hotplug_events = NULL;
+#endif
 
 	/* Show error and warning messages by default. */
 	context->log_level = JAYLINK_LOG_LEVEL_WARNING;
 
 	context->log_callback = &log_vprintf;
 	context->log_callback_data = NULL;
+	context->log_message_callback = NULL;
+	context->log_message_callback_data = NULL;
+	context->info_cache = false;
 
 	ret = jaylink_log_set_domain(context, JAYLINK_LOG_DOMAIN_DEFAULT);
 
 	if (ret != JAYLINK_OK) {
+#ifdef HAVE_LIBUSB
+		mutex_destroy(&context->hotplug_mutex);
+#endif
+		mutex_destroy(&context->discovery_mutex);
+		mutex_destroy(&context->devs_mutex);
 #ifdef HAVE_LIBUSB
 		libusb_exit(context->usb_ctx);
 #endif
@@ -183,7 +284,25 @@ JAYLINK_API int jaylink_exit(struct jaylink_context *ctx)
 	}
 
 	list_free(ctx->discovered_devs);
-	list_free(ctx->devs);
+
+#ifdef HAVE_LIBUSB
+	if (ctx->hotplug)
+		discovery_usb_disable_hotplug(ctx);
+
+	discovery_usb_free_hotplug_events(ctx);
+	mutex_destroy(&ctx->hotplug_mutex);
+#endif
+
+	hash_table_free(&ctx->devs_by_usb);
+	hash_table_free(&ctx->devs_by_serial);
+	hash_table_free(&ctx->devs_by_mac);
+	pool_free(&ctx->devs_pool);
+	pool_free(&ctx->discovery_pool);
+	transport_tcp_set_max_connections(ctx, 0);
+	free(ctx->tcp_targets);
+	free(ctx->tcp_stop_serial_numbers);
+	mutex_destroy(&ctx->discovery_mutex);
+	mutex_destroy(&ctx->devs_mutex);
 
 #ifdef HAVE_LIBUSB
 	libusb_exit(ctx->usb_ctx);
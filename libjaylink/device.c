@@ -48,6 +48,7 @@
 #define CMD_GET_VERSION		0x01
 #define CMD_GET_HW_STATUS	0x07
 #define CMD_REGISTER		0x09
+#define CMD_GET_SPEEDS		0xc0
 #define CMD_GET_HW_INFO		0xc1
 #define CMD_GET_COUNTERS	0xc2
 #define CMD_GET_FREE_MEMORY	0xd4
@@ -78,28 +79,241 @@ JAYLINK_PRIV struct jaylink_device *device_allocate(
 		struct jaylink_context *ctx)
 {
 	struct jaylink_device *dev;
-	struct list *list;
 
-	dev = malloc(sizeof(struct jaylink_device));
+	mutex_lock(&ctx->devs_mutex);
+	dev = pool_alloc(&ctx->devs_pool);
+	mutex_unlock(&ctx->devs_mutex);
 
 	if (!dev)
 		return NULL;
 
-	list = list_prepend(ctx->devs, dev);
+	dev->ctx = ctx;
+	dev->ref_count = 1;
+	dev->registered = false;
+	dev->discovered = false;
 
-	if (!list) {
-		free(dev);
-		return NULL;
+	return dev;
+}
+
+static uint64_t get_mac_key(const uint8_t *mac_address)
+{
+	uint64_t key;
+
+	key = 0;
+
+	for (size_t i = 0; i < 6; i++)
+		key = (key << 8) | mac_address[i];
+
+	return key;
+}
+
+static void device_unregister(struct jaylink_device *dev)
+{
+	struct jaylink_context *ctx;
+
+	if (!dev->registered)
+		return;
+
+	ctx = dev->ctx;
+
+#ifdef HAVE_LIBUSB
+	if (dev->iface == JAYLINK_HIF_USB)
+		hash_table_remove(&ctx->devs_by_usb,
+			(uintptr_t)dev->usb_dev, dev);
+#endif
+
+	if (dev->iface == JAYLINK_HIF_TCP && dev->has_mac_address)
+		hash_table_remove(&ctx->devs_by_mac,
+			get_mac_key(dev->mac_address), dev);
+
+	if (dev->has_serial_number)
+		hash_table_remove(&ctx->devs_by_serial, dev->serial_number,
+			dev);
+
+	dev->registered = false;
+}
+
+/**
+ * Add a device instance to the registry of its context.
+ *
+ * The device instance is indexed by its libusb device instance (USB), its MAC
+ * address (TCP/IP) and its serial number. Device instances of virtual host
+ * interfaces are not registered.
+ *
+ * @param[in,out] dev Device instance with all fields already initialized.
+ *
+ * @return Whether the device instance was registered successfully.
+ *
+ * @private
+ */
+JAYLINK_PRIV bool device_register(struct jaylink_device *dev)
+{
+	struct jaylink_context *ctx;
+
+	ctx = dev->ctx;
+	mutex_lock(&ctx->devs_mutex);
+
+	if (dev->has_serial_number) {
+		if (!hash_table_insert(&ctx->devs_by_serial,
+				dev->serial_number, dev)) {
+			mutex_unlock(&ctx->devs_mutex);
+			return false;
+		}
+	}
+
+#ifdef HAVE_LIBUSB
+	if (dev->iface == JAYLINK_HIF_USB) {
+		if (!hash_table_insert(&ctx->devs_by_usb,
+				(uintptr_t)dev->usb_dev, dev))
+			goto error;
 	}
+#endif
 
-	ctx->devs = list;
+	if (dev->iface == JAYLINK_HIF_TCP && dev->has_mac_address) {
+		if (!hash_table_insert(&ctx->devs_by_mac,
+				get_mac_key(dev->mac_address), dev))
+			goto error;
+	}
 
-	dev->ctx = ctx;
-	dev->ref_count = 1;
+	dev->registered = true;
+	mutex_unlock(&ctx->devs_mutex);
+
+	return true;
+
+error:
+	/* Removing entries which were not inserted is harmless. */
+	if (dev->has_serial_number)
+		hash_table_remove(&ctx->devs_by_serial, dev->serial_number,
+			dev);
+
+#ifdef HAVE_LIBUSB
+	if (dev->iface == JAYLINK_HIF_USB)
+		hash_table_remove(&ctx->devs_by_usb,
+			(uintptr_t)dev->usb_dev, dev);
+#endif
+
+	mutex_unlock(&ctx->devs_mutex);
+
+	return false;
+}
+
+/**
+ * Find a registered USB device instance.
+ *
+ * @param[in] ctx libjaylink context.
+ * @param[in] usb_dev libusb device instance.
+ *
+ * @return The device instance on success, or NULL if not found. The reference
+ *         count of the device instance is increased.
+ *
+ * @private
+ */
+JAYLINK_PRIV struct jaylink_device *device_find_usb(
+		struct jaylink_context *ctx, const void *usb_dev)
+{
+	struct jaylink_device *dev;
+
+	mutex_lock(&ctx->devs_mutex);
+	dev = hash_table_find(&ctx->devs_by_usb, (uintptr_t)usb_dev, NULL,
+		NULL);
+	jaylink_ref_device(dev);
+	mutex_unlock(&ctx->devs_mutex);
 
 	return dev;
 }
 
+/**
+ * Find a registered TCP/IP device instance.
+ *
+ * @param[in] ctx libjaylink context.
+ * @param[in] mac_address MAC address of the device.
+ * @param[in] callback Callback function to select one of the device instances
+ *                     with the given MAC address, or NULL to select any of
+ *                     them.
+ * @param[in] user_data User data to be passed to the callback function.
+ *
+ * @return The device instance on success, or NULL if not found. The reference
+ *         count of the device instance is increased.
+ *
+ * @private
+ */
+JAYLINK_PRIV struct jaylink_device *device_find_mac(
+		struct jaylink_context *ctx, const uint8_t *mac_address,
+		list_compare_callback callback, const void *user_data)
+{
+	struct jaylink_device *dev;
+
+	mutex_lock(&ctx->devs_mutex);
+	dev = hash_table_find(&ctx->devs_by_mac, get_mac_key(mac_address),
+		callback, user_data);
+	jaylink_ref_device(dev);
+	mutex_unlock(&ctx->devs_mutex);
+
+	return dev;
+}
+
+static bool compare_iface(const void *data, const void *user_data)
+{
+	const struct jaylink_device *dev;
+	const uint32_t *ifaces;
+
+	dev = data;
+	ifaces = user_data;
+
+	return (dev->iface & *ifaces) != 0;
+}
+
+/**
+ * Find a device by its serial number.
+ *
+ * Only device instances which are known to the libjaylink context are taken
+ * into account, for example from a previous device discovery. The lookup does
+ * not depend on the number of known device instances.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] serial_number Serial number of the device.
+ * @param[in] ifaces Host interfaces of the device. Use bitwise OR to specify
+ *                   multiple interfaces, or 0 to use all interfaces. A device
+ *                   which is connected via multiple host interfaces has a
+ *                   device instance for each of them.
+ * @param[out] dev Device instance on success, and undefined on failure. The
+ *                 reference count of the device instance is increased and
+ *                 the caller must unreference it with jaylink_unref_device().
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_NOT_AVAILABLE No matching device instance available.
+ *
+ * @see jaylink_discovery_scan()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_find_device_by_serial(struct jaylink_context *ctx,
+		uint32_t serial_number, uint32_t ifaces,
+		struct jaylink_device **dev)
+{
+	struct jaylink_device *tmp;
+
+	if (!ctx || !dev)
+		return JAYLINK_ERR_ARG;
+
+	if (!ifaces)
+		ifaces = JAYLINK_HIF_USB | JAYLINK_HIF_TCP;
+
+	mutex_lock(&ctx->devs_mutex);
+	tmp = hash_table_find(&ctx->devs_by_serial, serial_number,
+		&compare_iface, &ifaces);
+	jaylink_ref_device(tmp);
+	mutex_unlock(&ctx->devs_mutex);
+
+	if (!tmp)
+		return JAYLINK_ERR_NOT_AVAILABLE;
+
+	*dev = tmp;
+
+	return JAYLINK_OK;
+}
+
 static struct jaylink_device **allocate_device_list(size_t length)
 {
 	struct jaylink_device **list;
@@ -145,10 +359,13 @@ JAYLINK_API int jaylink_get_devices(struct jaylink_context *ctx,
 	if (!ctx || !devs)
 		return JAYLINK_ERR_ARG;
 
-	num = list_length(ctx->discovered_devs);
+	mutex_lock(&ctx->discovery_mutex);
+
+	num = ctx->num_discovered_devs;
 	tmp = allocate_device_list(num);
 
 	if (!tmp) {
+		mutex_unlock(&ctx->discovery_mutex);
 		log_err(ctx, "Failed to allocate device list");
 		return JAYLINK_ERR_MALLOC;
 	}
@@ -161,6 +378,8 @@ JAYLINK_API int jaylink_get_devices(struct jaylink_context *ctx,
 		item = item->next;
 	}
 
+	mutex_unlock(&ctx->discovery_mutex);
+
 	if (count)
 		*count = num;
 
@@ -193,6 +412,174 @@ JAYLINK_API void jaylink_free_devices(struct jaylink_device **devs, bool unref)
 	free(devs);
 }
 
+/**
+ * Allocate a device snapshot.
+ *
+ * A device snapshot holds the available devices like jaylink_get_devices()
+ * but is owned by the caller and can be updated repeatedly. Its memory is only
+ * reallocated if more devices are available than ever before.
+ *
+ * @param[out] snapshot Newly allocated device snapshot without any devices on
+ *                      success, and undefined on failure. The snapshot must be
+ *                      free'd by the caller with jaylink_device_snapshot_free().
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_device_snapshot_update()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_device_snapshot_new(
+		struct jaylink_device_snapshot **snapshot)
+{
+	struct jaylink_device_snapshot *tmp;
+
+	if (!snapshot)
+		return JAYLINK_ERR_ARG;
+
+	tmp = malloc(sizeof(struct jaylink_device_snapshot));
+
+	if (!tmp)
+		return JAYLINK_ERR_MALLOC;
+
+	tmp->devs = NULL;
+	tmp->num_devs = 0;
+	tmp->capacity = 0;
+
+	*snapshot = tmp;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Free a device snapshot.
+ *
+ * The device instances of the snapshot are unreferenced.
+ *
+ * @param[in,out] snapshot Device snapshot. Can be NULL.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API void jaylink_device_snapshot_free(
+		struct jaylink_device_snapshot *snapshot)
+{
+	if (!snapshot)
+		return;
+
+	for (size_t i = 0; i < snapshot->num_devs; i++)
+		jaylink_unref_device(snapshot->devs[i]);
+
+	free(snapshot->devs);
+	free(snapshot);
+}
+
+/**
+ * Update a device snapshot.
+ *
+ * The snapshot is replaced with the currently available devices, see
+ * jaylink_get_devices(). The device instances which were previously held by
+ * the snapshot are unreferenced.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in,out] snapshot Device snapshot.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error. The snapshot is left
+ *                            unchanged.
+ *
+ * @see jaylink_discovery_scan()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_device_snapshot_update(struct jaylink_context *ctx,
+		struct jaylink_device_snapshot *snapshot)
+{
+	struct list *item;
+	struct jaylink_device **devs;
+	size_t num;
+	size_t num_old;
+
+	if (!ctx || !snapshot)
+		return JAYLINK_ERR_ARG;
+
+	mutex_lock(&ctx->discovery_mutex);
+
+	num = ctx->num_discovered_devs;
+	num_old = snapshot->num_devs;
+
+	/*
+	 * The previous device instances are kept behind the new ones until
+	 * they are unreferenced. This way, the device instances which are
+	 * still available never drop their last reference.
+	 */
+	if (num + num_old > snapshot->capacity) {
+		devs = realloc(snapshot->devs,
+			sizeof(struct jaylink_device *) * (num + num_old));
+
+		if (!devs) {
+			mutex_unlock(&ctx->discovery_mutex);
+			log_err(ctx, "Failed to allocate device snapshot");
+			return JAYLINK_ERR_MALLOC;
+		}
+
+		snapshot->devs = devs;
+		snapshot->capacity = num + num_old;
+	}
+
+	if (num_old > 0)
+		memmove(snapshot->devs + num, snapshot->devs,
+			sizeof(struct jaylink_device *) * num_old);
+
+	item = ctx->discovered_devs;
+
+	for (size_t i = 0; i < num; i++) {
+		snapshot->devs[i] = jaylink_ref_device(item->data);
+		item = item->next;
+	}
+
+	mutex_unlock(&ctx->discovery_mutex);
+
+	for (size_t i = 0; i < num_old; i++)
+		jaylink_unref_device(snapshot->devs[num + i]);
+
+	snapshot->num_devs = num;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get the devices of a device snapshot.
+ *
+ * @param[in] snapshot Device snapshot.
+ * @param[out] devs Array which contains the device instances of the snapshot
+ *                  on success, and undefined on failure. The array and the
+ *                  device instances are owned by the snapshot and valid until
+ *                  the snapshot is updated or free'd. Use jaylink_ref_device()
+ *                  to keep a device instance beyond that.
+ * @param[out] count Number of device instances on success, and undefined on
+ *                   failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_device_snapshot_get_devices(
+		const struct jaylink_device_snapshot *snapshot,
+		struct jaylink_device *const **devs, size_t *count)
+{
+	if (!snapshot || !devs || !count)
+		return JAYLINK_ERR_ARG;
+
+	*devs = snapshot->devs;
+	*count = snapshot->num_devs;
+
+	return JAYLINK_OK;
+}
+
 /**
  * Get the host interface of a device.
  *
@@ -521,11 +908,42 @@ JAYLINK_API struct jaylink_device *jaylink_ref_device(
 	if (!dev)
 		return NULL;
 
-	dev->ref_count++;
+	ATOMIC_ADD_FETCH(&dev->ref_count, 1);
 
 	return dev;
 }
 
+static bool release_reference(struct jaylink_device *dev)
+{
+	size_t ref_count;
+
+	ref_count = ATOMIC_LOAD(&dev->ref_count);
+
+	/*
+	 * Decrement the reference count without locking as long as it is not
+	 * the last reference. The last reference is released with the device
+	 * registry locked such that a device instance cannot be found and
+	 * referenced again while it is being destroyed.
+	 */
+	while (ref_count > 1) {
+		if (ATOMIC_COMPARE_EXCHANGE(&dev->ref_count, &ref_count,
+				ref_count - 1))
+			return false;
+	}
+
+	mutex_lock(&dev->ctx->devs_mutex);
+
+	if (ATOMIC_SUB_FETCH(&dev->ref_count, 1) > 0) {
+		mutex_unlock(&dev->ctx->devs_mutex);
+		return false;
+	}
+
+	device_unregister(dev);
+	mutex_unlock(&dev->ctx->devs_mutex);
+
+	return true;
+}
+
 /**
  * Decrement the reference count of a device.
  *
@@ -540,11 +958,8 @@ JAYLINK_API void jaylink_unref_device(struct jaylink_device *dev)
 	if (!dev)
 		return;
 
-	dev->ref_count--;
-
-	if (!dev->ref_count) {
+	if (release_reference(dev)) {
 		ctx = dev->ctx;
-		ctx->devs = list_remove(dev->ctx->devs, dev);
 
 		if (dev->iface == JAYLINK_HIF_USB) {
 #ifdef HAVE_LIBUSB
@@ -558,12 +973,20 @@ JAYLINK_API void jaylink_unref_device(struct jaylink_device *dev)
 		} else if (dev->iface == JAYLINK_HIF_TCP) {
 			log_dbg(ctx, "Device destroyed (IPv4 address = %s)",
 				dev->ipv4_address);
+		} else if (dev->iface == JAYLINK_HIF_REPLAY) {
+			log_dbg(ctx, "Device destroyed (file = %s)",
+				dev->filename);
+			free(dev->filename);
+		} else if (dev->iface == JAYLINK_HIF_EMULATOR) {
+			log_dbg(ctx, "Device destroyed (emulator)");
 		} else {
 			log_err(ctx, "BUG: Invalid host interface: %u",
 				dev->iface);
 		}
 
-		free(dev);
+		mutex_lock(&ctx->devs_mutex);
+		pool_release(&ctx->devs_pool, dev);
+		mutex_unlock(&ctx->devs_mutex);
 	}
 }
 
@@ -574,23 +997,404 @@ static struct jaylink_device_handle *allocate_device_handle(
 
 	devh = malloc(sizeof(struct jaylink_device_handle));
 
-	if (!devh)
-		return NULL;
+	if (!devh)
+		return NULL;
+
+	if (!mutex_init(&devh->stats_mutex)) {
+		free(devh);
+		return NULL;
+	}
+
+	if (!mutex_init_recursive(&devh->io_mutex)) {
+		mutex_destroy(&devh->stats_mutex);
+		free(devh);
+		return NULL;
+	}
+
+	devh->dev = jaylink_ref_device(dev);
+	devh->swo_stream = NULL;
+	devh->emucom_poller = NULL;
+	devh->monitor = NULL;
+
+	memset(&devh->io_stats, 0, sizeof(struct jaylink_io_stats));
+	devh->command_stats = NULL;
+	devh->cmd_active = false;
+	devh->capture = NULL;
+	devh->replay = NULL;
+	devh->emulator = NULL;
+	devh->info_cache = false;
+	memset(&devh->info, 0, sizeof(struct device_info));
+
+	return devh;
+}
+
+static void free_device_handle(struct jaylink_device_handle *devh)
+{
+	free(devh->info.firmware_version);
+	free(devh->command_stats);
+	mutex_destroy(&devh->stats_mutex);
+	mutex_destroy(&devh->io_mutex);
+	jaylink_unref_device(devh->dev);
+	free(devh);
+}
+
+static int send_info_commands(struct jaylink_device_handle *devh,
+		const uint8_t *commands, size_t num_commands)
+{
+	int ret;
+	struct jaylink_context *ctx;
+
+	ctx = devh->dev->ctx;
+	ret = transport_start_batch(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_batch() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	for (size_t i = 0; i < num_commands; i++) {
+		ret = transport_start_write(devh, 1, true);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_start_write() failed: %s",
+				jaylink_strerror(ret));
+			transport_cancel_batch(devh);
+			return ret;
+		}
+
+		ret = transport_write(devh, commands + i, 1);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_write() failed: %s",
+				jaylink_strerror(ret));
+			transport_cancel_batch(devh);
+			return ret;
+		}
+	}
+
+	ret = transport_end_batch(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_end_batch() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int read_firmware_version(struct jaylink_device_handle *devh,
+		size_t length, char **version)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	char *tmp;
+
+	ctx = devh->dev->ctx;
+	ret = transport_start_read(devh, length);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	tmp = malloc(length);
+
+	if (!tmp) {
+		log_err(ctx, "Firmware version string malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	ret = transport_read(devh, (uint8_t *)tmp, length);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_read() failed: %s",
+			jaylink_strerror(ret));
+		free(tmp);
+		return ret;
+	}
+
+	/* Last byte is reserved for null-terminator. */
+	tmp[length - 1] = 0;
+	*version = tmp;
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Retrieve all cached device information with two round trips. The first one
+ * retrieves the capabilities which determine the commands of the second one.
+ */
+static int fill_device_info(struct jaylink_device_handle *devh)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct device_info *info;
+	uint8_t commands[3];
+	uint8_t buf[JAYLINK_DEV_CAPS_SIZE + 2];
+	size_t num_commands;
+	size_t length;
+	uint32_t tmp;
+	uint16_t div;
+
+	ctx = devh->dev->ctx;
+	info = &devh->info;
+
+	commands[0] = CMD_GET_CAPS;
+	commands[1] = CMD_GET_VERSION;
+
+	ret = send_info_commands(devh, commands, 2);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = transport_start_read(devh, JAYLINK_DEV_CAPS_SIZE + 2);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	ret = transport_read(devh, buf, JAYLINK_DEV_CAPS_SIZE + 2);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	memcpy(info->caps, buf, JAYLINK_DEV_CAPS_SIZE);
+	info->has_caps = true;
+
+	info->firmware_version_length = buffer_get_u16(buf,
+		JAYLINK_DEV_CAPS_SIZE);
+
+	if (info->firmware_version_length > 0) {
+		ret = read_firmware_version(devh,
+			info->firmware_version_length,
+			&info->firmware_version);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	}
+
+	info->has_firmware_version = true;
+
+	num_commands = 0;
+	length = 0;
+
+	if (jaylink_has_cap(info->caps, JAYLINK_DEV_CAP_GET_EXT_CAPS)) {
+		commands[num_commands++] = CMD_GET_EXT_CAPS;
+		length += JAYLINK_DEV_EXT_CAPS_SIZE;
+	}
+
+	if (jaylink_has_cap(info->caps, JAYLINK_DEV_CAP_GET_HW_VERSION)) {
+		commands[num_commands++] = CMD_GET_HW_VERSION;
+		length += 4;
+	}
+
+	if (jaylink_has_cap(info->caps, JAYLINK_DEV_CAP_GET_SPEEDS)) {
+		commands[num_commands++] = CMD_GET_SPEEDS;
+		length += 6;
+	}
+
+	if (!num_commands)
+		return JAYLINK_OK;
+
+	ret = send_info_commands(devh, commands, num_commands);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = transport_start_read(devh, length);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	for (size_t i = 0; i < num_commands; i++) {
+		if (commands[i] == CMD_GET_EXT_CAPS) {
+			ret = transport_read(devh, info->ext_caps,
+				JAYLINK_DEV_EXT_CAPS_SIZE);
+		} else if (commands[i] == CMD_GET_HW_VERSION) {
+			ret = transport_read(devh, buf, 4);
+		} else {
+			ret = transport_read(devh, buf, 6);
+		}
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		if (commands[i] == CMD_GET_EXT_CAPS) {
+			info->has_ext_caps = true;
+		} else if (commands[i] == CMD_GET_HW_VERSION) {
+			tmp = buffer_get_u32(buf, 0);
+			info->hw_version.type = (tmp / 1000000) % 100;
+			info->hw_version.major = (tmp / 10000) % 100;
+			info->hw_version.minor = (tmp / 100) % 100;
+			info->hw_version.revision = tmp % 100;
+			info->has_hw_version = true;
+		} else {
+			div = buffer_get_u16(buf, 4);
+
+			/* Leave the speed information to jaylink_get_speeds(). */
+			if (!div)
+				continue;
+
+			info->speed.freq = buffer_get_u32(buf, 0);
+			info->speed.div = div;
+			info->has_speed = true;
+		}
+	}
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Enable or disable the caching of device information.
+ *
+ * If enabled, jaylink_open() retrieves the capabilities, the extended
+ * capabilities, the firmware version, the hardware version and the speed
+ * information of the device with as few round trips as possible. Afterwards,
+ * jaylink_get_caps(), jaylink_get_extended_caps(),
+ * jaylink_get_firmware_version(), jaylink_get_hardware_version() and
+ * jaylink_get_speeds() are served from the cache of the device handle without
+ * any I/O. The speed information is retrieved again after a target interface
+ * was selected.
+ *
+ * The setting applies to device handles which are opened afterwards. Device
+ * handles of replayed sessions never cache device information.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] enable Determines whether device information is cached.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @see jaylink_open()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_set_device_info_cache(struct jaylink_context *ctx,
+		bool enable)
+{
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+	ATOMIC_STORE(&ctx->info_cache, enable);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Set the TCP/IP connection pool.
+ *
+ * If enabled, jaylink_close() keeps the connection of a TCP/IP device open
+ * instead of closing it, and a subsequent jaylink_open() of a device with the
+ * same IPv4 address reuses it without connection establishment. This avoids
+ * the connection setup for applications which open and close the same
+ * devices repeatedly.
+ *
+ * Idle connections use TCP keepalive messages and are checked before they
+ * are reused. Connections which were closed by the device in the meantime or
+ * which exceeded the idle timeout are closed and a new connection is
+ * established instead. A connection is kept open only if no operation is
+ * pending when the device handle is closed. Its transport mode is set back to
+ * #JAYLINK_TCP_MODE_DEFAULT, see jaylink_tcp_set_mode().
+ *
+ * If the maximum number of idle connections is reached, the least recently
+ * used idle connection is closed. Reducing the maximum number closes idle
+ * connections accordingly, and a maximum number of 0 disables the pool and
+ * closes all idle connections. The pool is disabled by default.
+ *
+ * @note An idle connection occupies one of the connections of the device.
+ *       The state of the device, for example the selected target interface,
+ *       is not reset when a connection is reused.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] max_connections Maximum number of idle connections.
+ * @param[in] idle_timeout Time in milliseconds after which an idle connection
+ *                         is not reused anymore, or 0 for no limit.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_tcp_set_connect_retries()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_tcp_set_connection_pool(struct jaylink_context *ctx,
+		size_t max_connections, unsigned int idle_timeout)
+{
+	int ret;
+
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+	ret = transport_tcp_set_max_connections(ctx, max_connections);
+
+	if (ret != JAYLINK_OK)
+		return ret;
 
-	devh->dev = jaylink_ref_device(dev);
+	mutex_lock(&ctx->devs_mutex);
+	ctx->tcp_idle_timeout = idle_timeout;
+	mutex_unlock(&ctx->devs_mutex);
 
-	return devh;
+	return JAYLINK_OK;
 }
 
-static void free_device_handle(struct jaylink_device_handle *devh)
+/**
+ * Set the connection retries for TCP/IP devices.
+ *
+ * A TCP/IP device accepts only a limited number of simultaneous connections.
+ * By default, jaylink_open() fails immediately if the maximum number of
+ * connections on the device is reached. Otherwise, the connection is retried
+ * up to the specified number of times. The delay before the first retry is
+ * doubled for every following retry, up to a maximum of 10 seconds.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] retries Number of retries, or 0 to disable retries.
+ * @param[in] delay Delay before the first retry in milliseconds.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @see jaylink_tcp_set_connection_pool()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_tcp_set_connect_retries(struct jaylink_context *ctx,
+		unsigned int retries, unsigned int delay)
 {
-	jaylink_unref_device(devh->dev);
-	free(devh);
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+	mutex_lock(&ctx->devs_mutex);
+	ctx->tcp_connect_retries = retries;
+	ctx->tcp_connect_retry_delay = delay;
+	mutex_unlock(&ctx->devs_mutex);
+
+	return JAYLINK_OK;
 }
 
 /**
  * Open a device.
  *
+ * If caching of device information is enabled, the device information is
+ * retrieved as well, see jaylink_set_device_info_cache().
+ *
+ * A TCP/IP device reuses an idle connection if the connection pool is enabled,
+ * see jaylink_tcp_set_connection_pool().
+ *
  * @param[in,out] dev Device instance.
  * @param[out] devh Newly allocated handle for the opened device on success,
  *                  and undefined on failure.
@@ -627,11 +1431,79 @@ JAYLINK_API int jaylink_open(struct jaylink_device *dev,
 		return ret;
 	}
 
+	/* A replayed session contains only the commands of the capture. */
+	if (ATOMIC_LOAD(&dev->ctx->info_cache) &&
+			dev->iface != JAYLINK_HIF_REPLAY) {
+		handle->info_cache = true;
+		ret = fill_device_info(handle);
+
+		if (ret != JAYLINK_OK) {
+			log_err(dev->ctx, "Failed to retrieve device "
+				"information");
+			transport_close(handle);
+			free_device_handle(handle);
+			return ret;
+		}
+	}
+
 	*devh = handle;
 
 	return JAYLINK_OK;
 }
 
+/**
+ * Open an emulated device.
+ *
+ * The emulator answers the protocol in memory without any hardware and is
+ * intended for testing and benchmarking. JTAG and SWD I/O operations return
+ * the output data, SWO read operations return a counting pattern, file I/O
+ * operations access a single in-memory file and all EMUCOM channels share a
+ * loopback buffer. The hardware status reports a target voltage of 3.3 V. The
+ * device instance of the handle has the host interface #JAYLINK_HIF_EMULATOR.
+ *
+ * Use jaylink_close() to close the emulated device.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[out] devh Newly allocated device handle on success, and undefined on
+ *                  failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_emulator_open(struct jaylink_context *ctx,
+		struct jaylink_device_handle **devh)
+{
+	int ret;
+	struct jaylink_device *dev;
+
+	if (!ctx || !devh)
+		return JAYLINK_ERR_ARG;
+
+	dev = device_allocate(ctx);
+
+	if (!dev) {
+		log_err(ctx, "Device instance malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	dev->iface = JAYLINK_HIF_EMULATOR;
+	dev->has_serial_number = false;
+	dev->has_mac_address = false;
+	dev->has_product_name = false;
+	dev->has_nickname = false;
+	dev->has_hw_version = false;
+
+	/* The device handle holds its own reference to the device instance. */
+	ret = jaylink_open(dev, devh);
+	jaylink_unref_device(dev);
+
+	return ret;
+}
+
 /**
  * Close a device.
  *
@@ -650,6 +1522,18 @@ JAYLINK_API int jaylink_close(struct jaylink_device_handle *devh)
 	if (!devh)
 		return JAYLINK_ERR_ARG;
 
+	if (devh->swo_stream)
+		swo_stop_stream(devh);
+
+	if (devh->emucom_poller)
+		emucom_stop_polling(devh);
+
+	if (devh->monitor)
+		monitor_stop(devh);
+
+	if (devh->capture)
+		capture_stop(devh);
+
 	ret = transport_close(devh);
 	free_device_handle(devh);
 
@@ -703,6 +1587,7 @@ JAYLINK_API int jaylink_get_firmware_version(
 {
 	int ret;
 	struct jaylink_context *ctx;
+	struct device_info *info;
 	uint8_t buf[2];
 	uint16_t dummy;
 	char *tmp;
@@ -711,11 +1596,35 @@ JAYLINK_API int jaylink_get_firmware_version(
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	info = &devh->info;
+
+	if (info->has_firmware_version) {
+		*length = info->firmware_version_length;
+
+		if (!info->firmware_version_length)
+			return JAYLINK_OK;
+
+		tmp = malloc(info->firmware_version_length);
+
+		if (!tmp) {
+			log_err(ctx, "Firmware version string malloc failed");
+			return JAYLINK_ERR_MALLOC;
+		}
+
+		memcpy(tmp, info->firmware_version,
+			info->firmware_version_length);
+		*version = tmp;
+
+		return JAYLINK_OK;
+	}
+
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, 2, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -726,6 +1635,7 @@ JAYLINK_API int jaylink_get_firmware_version(
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -734,44 +1644,19 @@ JAYLINK_API int jaylink_get_firmware_version(
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	dummy = buffer_get_u16(buf, 0);
 	*length = dummy;
 
-	if (!dummy)
-		return JAYLINK_OK;
-
-	ret = transport_start_read(devh, dummy);
-
-	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_start_read() failed: %s",
-			jaylink_strerror(ret));
-		return ret;
-	}
-
-	tmp = malloc(dummy);
-
-	if (!tmp) {
-		log_err(ctx, "Firmware version string malloc failed");
-		return JAYLINK_ERR_MALLOC;
-	}
-
-	ret = transport_read(devh, (uint8_t *)tmp, dummy);
+	if (dummy > 0)
+		ret = read_firmware_version(devh, dummy, version);
 
-	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_read() failed: %s",
-			jaylink_strerror(ret));
-		free(tmp);
-		return ret;
-	}
-
-	/* Last byte is reserved for null-terminator. */
-	tmp[dummy - 1] = 0;
-	*version = tmp;
+	transport_unlock(devh);
 
-	return JAYLINK_OK;
+	return ret;
 }
 
 /**
@@ -820,11 +1705,13 @@ JAYLINK_API int jaylink_get_hardware_info(struct jaylink_device_handle *devh,
 
 	length = num * sizeof(uint32_t);
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 5, length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -836,10 +1723,12 @@ JAYLINK_API int jaylink_get_hardware_info(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, (uint8_t *)info, length);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -898,11 +1787,13 @@ JAYLINK_API int jaylink_get_counters(struct jaylink_device_handle *devh,
 	}
 
 	length = num * sizeof(uint32_t);
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 5, length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -914,10 +1805,12 @@ JAYLINK_API int jaylink_get_counters(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, (uint8_t *)values, length);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -965,12 +1858,19 @@ JAYLINK_API int jaylink_get_hardware_version(
 	if (!devh || !version)
 		return JAYLINK_ERR_ARG;
 
+	if (devh->info.has_hw_version) {
+		*version = devh->info.hw_version;
+		return JAYLINK_OK;
+	}
+
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -981,10 +1881,12 @@ JAYLINK_API int jaylink_get_hardware_version(
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -999,6 +1901,11 @@ JAYLINK_API int jaylink_get_hardware_version(
 	version->minor = (tmp / 100) % 100;
 	version->revision = tmp % 100;
 
+	if (devh->info_cache) {
+		devh->info.hw_version = *version;
+		devh->info.has_hw_version = true;
+	}
+
 	return JAYLINK_OK;
 }
 
@@ -1027,11 +1934,13 @@ JAYLINK_API int jaylink_get_hardware_status(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, 8, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1042,10 +1951,12 @@ JAYLINK_API int jaylink_get_hardware_status(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 8);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -1101,12 +2012,19 @@ JAYLINK_API int jaylink_get_caps(struct jaylink_device_handle *devh,
 	if (!devh || !caps)
 		return JAYLINK_ERR_ARG;
 
+	if (devh->info.has_caps) {
+		memcpy(caps, devh->info.caps, JAYLINK_DEV_CAPS_SIZE);
+		return JAYLINK_OK;
+	}
+
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, JAYLINK_DEV_CAPS_SIZE, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1117,10 +2035,12 @@ JAYLINK_API int jaylink_get_caps(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, caps, JAYLINK_DEV_CAPS_SIZE);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -1128,6 +2048,11 @@ JAYLINK_API int jaylink_get_caps(struct jaylink_device_handle *devh,
 		return ret;
 	}
 
+	if (devh->info_cache) {
+		memcpy(devh->info.caps, caps, JAYLINK_DEV_CAPS_SIZE);
+		devh->info.has_caps = true;
+	}
+
 	return JAYLINK_OK;
 }
 
@@ -1168,13 +2093,20 @@ JAYLINK_API int jaylink_get_extended_caps(struct jaylink_device_handle *devh,
 	if (!devh || !caps)
 		return JAYLINK_ERR_ARG;
 
+	if (devh->info.has_ext_caps) {
+		memcpy(caps, devh->info.ext_caps, JAYLINK_DEV_EXT_CAPS_SIZE);
+		return JAYLINK_OK;
+	}
+
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, JAYLINK_DEV_EXT_CAPS_SIZE,
 		true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1185,10 +2117,12 @@ JAYLINK_API int jaylink_get_extended_caps(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, caps, JAYLINK_DEV_EXT_CAPS_SIZE);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -1196,6 +2130,11 @@ JAYLINK_API int jaylink_get_extended_caps(struct jaylink_device_handle *devh,
 		return ret;
 	}
 
+	if (devh->info_cache) {
+		memcpy(devh->info.ext_caps, caps, JAYLINK_DEV_EXT_CAPS_SIZE);
+		devh->info.has_ext_caps = true;
+	}
+
 	return JAYLINK_OK;
 }
 
@@ -1228,11 +2167,13 @@ JAYLINK_API int jaylink_get_free_memory(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1243,10 +2184,12 @@ JAYLINK_API int jaylink_get_free_memory(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -1290,12 +2233,14 @@ JAYLINK_API int jaylink_read_raw_config(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 1, JAYLINK_DEV_CONFIG_SIZE,
 		true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1306,10 +2251,12 @@ JAYLINK_API int jaylink_read_raw_config(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, config, JAYLINK_DEV_CONFIG_SIZE);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -1350,11 +2297,13 @@ JAYLINK_API int jaylink_write_raw_config(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1 + JAYLINK_DEV_CONFIG_SIZE, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1365,10 +2314,12 @@ JAYLINK_API int jaylink_write_raw_config(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_write(devh, config, JAYLINK_DEV_CONFIG_SIZE);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -1545,11 +2496,13 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 	buf[11] = connection->cid;
 	buffer_set_u16(buf, connection->handle, 12);
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 14, REG_MIN_SIZE, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1558,6 +2511,7 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1566,6 +2520,7 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1577,12 +2532,14 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 	if (num > JAYLINK_MAX_CONNECTIONS) {
 		log_err(ctx, "Maximum number of device connections exceeded: "
 			"%u", num);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
 	if (entry_size != REG_CONN_INFO_SIZE) {
 		log_err(ctx, "Invalid connection entry size: %u bytes",
 			entry_size);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
@@ -1592,6 +2549,7 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 	if (size > REG_MAX_SIZE) {
 		log_err(ctx, "Maximum registration information size exceeded: "
 			"%u bytes", size);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
@@ -1601,6 +2559,7 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_start_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return JAYLINK_ERR;
 		}
 
@@ -1610,10 +2569,13 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return JAYLINK_ERR;
 		}
 	}
 
+	transport_unlock(devh);
+
 	if (!handle) {
 		log_err(ctx, "Obtained invalid connection handle");
 		return JAYLINK_ERR_PROTO;
@@ -1685,11 +2647,13 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 	buf[11] = connection->cid;
 	buffer_set_u16(buf, connection->handle, 12);
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 14, REG_MIN_SIZE, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1698,6 +2662,7 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1706,6 +2671,7 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -1716,12 +2682,14 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 	if (num > JAYLINK_MAX_CONNECTIONS) {
 		log_err(ctx, "Maximum number of device connections exceeded: "
 			"%u", num);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
 	if (entry_size != REG_CONN_INFO_SIZE) {
 		log_err(ctx, "Invalid connection entry size: %u bytes",
 			entry_size);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
@@ -1731,6 +2699,7 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 	if (size > REG_MAX_SIZE) {
 		log_err(ctx, "Maximum registration information size exceeded: "
 			"%u bytes", size);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
@@ -1740,6 +2709,7 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_start_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return JAYLINK_ERR;
 		}
 
@@ -1749,13 +2719,249 @@ JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return JAYLINK_ERR;
 		}
 	}
 
+	transport_unlock(devh);
+
 	parse_conn_table(connections, buf + REG_HEADER_SIZE, num, entry_size);
 
 	*count = num;
 
 	return JAYLINK_OK;
 }
+
+/**
+ * Set the number of concurrent USB transfers.
+ *
+ * By default, only a single bulk transfer is in flight at a time and the bus
+ * idles between consecutive transfers. With more than one transfer, large
+ * write and read operations are split into multiple transfers which are
+ * queued at once such that the data is transferred back-to-back.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] num_transfers Number of concurrent transfers. Use 1 to disable
+ *                          concurrent transfers. The number must not exceed
+ *                          #JAYLINK_USB_MAX_TRANSFERS.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Supported for devices with host interface
+ *                                   #JAYLINK_HIF_USB only.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_usb_set_transfers(struct jaylink_device_handle *devh,
+		size_t num_transfers)
+{
+	if (!devh)
+		return JAYLINK_ERR_ARG;
+
+	if (!num_transfers || num_transfers > JAYLINK_USB_MAX_TRANSFERS)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->dev->iface != JAYLINK_HIF_USB)
+		return JAYLINK_ERR_NOT_SUPPORTED;
+
+#ifdef HAVE_LIBUSB
+	devh->num_transfers = num_transfers;
+
+	return JAYLINK_OK;
+#else
+	return JAYLINK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Set the chunk size of USB transfers.
+ *
+ * Data is transferred in chunks of this size and every read request to the
+ * device covers a whole chunk. By default, the chunk size is derived from the
+ * speed of the USB connection: 2048 bytes at full-speed, 16 KiB at
+ * high-speed and 64 KiB at SuperSpeed. Larger chunks reduce the per-transfer
+ * overhead of bulk data transfers.
+ *
+ * @note The chunk size must not be changed during a write or read operation.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] size Chunk size in bytes, or 0 to restore the default chunk size.
+ *                 The chunk size must be a multiple of the maximum packet
+ *                 size of the USB interface endpoints and must not exceed
+ *                 #JAYLINK_USB_MAX_CHUNK_SIZE.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Supported for devices with host interface
+ *                                   #JAYLINK_HIF_USB only.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_usb_set_chunk_size(struct jaylink_device_handle *devh,
+		size_t size)
+{
+	if (!devh || size > JAYLINK_USB_MAX_CHUNK_SIZE)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->dev->iface != JAYLINK_HIF_USB)
+		return JAYLINK_ERR_NOT_SUPPORTED;
+
+#ifdef HAVE_LIBUSB
+	return transport_usb_set_chunk_size(devh, size);
+#else
+	return JAYLINK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Get the chunk size of USB transfers.
+ *
+ * @param[in] devh Device handle.
+ * @param[out] size Chunk size in bytes on success, and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Supported for devices with host interface
+ *                                   #JAYLINK_HIF_USB only.
+ *
+ * @see jaylink_usb_set_chunk_size()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_usb_get_chunk_size(struct jaylink_device_handle *devh,
+		size_t *size)
+{
+	if (!devh || !size)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->dev->iface != JAYLINK_HIF_USB)
+		return JAYLINK_ERR_NOT_SUPPORTED;
+
+#ifdef HAVE_LIBUSB
+	*size = devh->chunk_size;
+
+	return JAYLINK_OK;
+#else
+	return JAYLINK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Set the timeout of USB transfers.
+ *
+ * The timeout of each transfer is the base timeout plus the estimated time
+ * which is required to transfer the data at the speed of the USB connection.
+ * A transfer is treated as timed out after the given number of consecutive
+ * timeouts without any data being transferred. By default, the base timeout
+ * is 1000 ms and 2 consecutive timeouts are allowed.
+ *
+ * @note Some commands take a considerable time to be processed by the device.
+ *       A short timeout may cause such commands to fail.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] timeout Base timeout in milliseconds.
+ * @param[in] num_timeouts Number of consecutive timeouts before a transfer
+ *                         will be treated as timed out.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Supported for devices with host interface
+ *                                   #JAYLINK_HIF_USB only.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_usb_set_timeout(struct jaylink_device_handle *devh,
+		unsigned int timeout, unsigned int num_timeouts)
+{
+	if (!devh || !timeout || !num_timeouts)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->dev->iface != JAYLINK_HIF_USB)
+		return JAYLINK_ERR_NOT_SUPPORTED;
+
+#ifdef HAVE_LIBUSB
+	devh->timeout = timeout;
+	devh->num_timeouts = num_timeouts;
+
+	return JAYLINK_OK;
+#else
+	return JAYLINK_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Set the operation mode of the TCP/IP transport.
+ *
+ * Short commands which are sent in quick succession may be delayed by the
+ * TCP/IP stack of the operating system in the default mode. Use
+ * #JAYLINK_TCP_MODE_LOW_LATENCY to send data to the device without delay.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] mode Operation mode.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Supported for devices with host interface
+ *                                   #JAYLINK_HIF_TCP only.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_tcp_set_mode(struct jaylink_device_handle *devh,
+		enum jaylink_tcp_mode mode)
+{
+	if (!devh)
+		return JAYLINK_ERR_ARG;
+
+	if (mode != JAYLINK_TCP_MODE_DEFAULT &&
+			mode != JAYLINK_TCP_MODE_LOW_LATENCY)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->dev->iface != JAYLINK_HIF_TCP)
+		return JAYLINK_ERR_NOT_SUPPORTED;
+
+	return transport_tcp_set_mode(devh, mode);
+}
+
+/**
+ * Get the file descriptors to wait for responses of a device.
+ *
+ * The file descriptors are intended to be used with poll() or an event loop
+ * together with jaylink_queue_submit() and jaylink_queue_complete(). Whenever
+ * one of them is ready, jaylink_queue_complete() should be called.
+ *
+ * For devices with host interface #JAYLINK_HIF_USB, the file descriptors of
+ * the libusb context are returned which are shared by all USB devices of the
+ * libjaylink context. Devices with host interface #JAYLINK_HIF_REPLAY and
+ * #JAYLINK_HIF_EMULATOR have no file descriptors because their responses are
+ * available immediately.
+ *
+ * @note The file descriptors may change, for example when a device is opened
+ *       or closed. On platforms where libusb does not handle its timeouts with
+ *       file descriptors, jaylink_queue_complete() must additionally be
+ *       called periodically to detect timeouts.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] pollfds Array to store the file descriptors on success, or NULL
+ *                     to query the number of file descriptors only.
+ * @param[in,out] count Number of entries of the array. On success, the number
+ *                      of file descriptors.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the array is too small.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Operation not supported on this platform.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_get_pollfds(struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count)
+{
+	if (!devh || !count)
+		return JAYLINK_ERR_ARG;
+
+	return transport_get_pollfds(devh, pollfds, count);
+}
@@ -18,6 +18,8 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -41,19 +43,101 @@ static void clear_discovery_list(struct jaylink_context *ctx)
 
 	while (item) {
 		dev = (struct jaylink_device *)item->data;
+		dev->discovered = false;
 		jaylink_unref_device(dev);
 
 		tmp = item;
 		item = item->next;
-		free(tmp);
+		pool_release(&ctx->discovery_pool, tmp);
 	}
 
 	ctx->discovered_devs = NULL;
+	ctx->num_discovered_devs = 0;
+}
+
+/**
+ * Add a device instance to the list of discovered devices.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] dev Device instance. The caller passes its reference to the
+ *                list of discovered devices.
+ *
+ * @private
+ */
+JAYLINK_PRIV void discovery_add_device(struct jaylink_context *ctx,
+		struct jaylink_device *dev)
+{
+	struct list *item;
+
+	item = pool_alloc(&ctx->discovery_pool);
+
+	if (!item) {
+		log_err(ctx, "Failed to allocate list item");
+		jaylink_unref_device(dev);
+		return;
+	}
+
+	item->data = dev;
+	item->next = ctx->discovered_devs;
+	ctx->discovered_devs = item;
+	dev->discovered = true;
+	ctx->num_discovered_devs++;
+}
+
+static int scan(struct jaylink_context *ctx, uint32_t ifaces)
+{
+	int ret;
+	struct tcp_discovery disc;
+
+	clear_discovery_list(ctx);
+
+	/*
+	 * Start the TCP/IP discovery first such that the devices answer while
+	 * the USB devices are scanned.
+	 */
+	if (ifaces & JAYLINK_HIF_TCP) {
+		ret = discovery_tcp_start(ctx, &disc);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "TCP/IP device discovery failed");
+			return ret;
+		}
+	}
+
+#ifdef HAVE_LIBUSB
+	if (ifaces & JAYLINK_HIF_USB) {
+		ret = discovery_usb_scan(ctx);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "USB device discovery failed");
+
+			if (ifaces & JAYLINK_HIF_TCP)
+				discovery_tcp_cancel(&disc);
+
+			return ret;
+		}
+	}
+#endif
+
+	if (ifaces & JAYLINK_HIF_TCP) {
+		ret = discovery_tcp_finish(ctx, &disc);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "TCP/IP device discovery failed");
+			return ret;
+		}
+	}
+
+	return JAYLINK_OK;
 }
 
 /**
  * Scan for devices.
  *
+ * If the USB hotplug mode is enabled, USB devices are not scanned. Instead,
+ * pending hotplug events are handled and the devices tracked by the hotplug
+ * mode are used, see jaylink_discovery_enable_hotplug().
+ *
  * @param[in,out] ctx libjaylink context.
  * @param[in] ifaces Host interfaces to scan for devices. Use bitwise OR to
  *                   specify multiple interfaces, or 0 to use all available
@@ -80,27 +164,307 @@ JAYLINK_API int jaylink_discovery_scan(struct jaylink_context *ctx,
 	if (!ifaces)
 		ifaces = JAYLINK_HIF_USB | JAYLINK_HIF_TCP;
 
-	clear_discovery_list(ctx);
+	mutex_lock(&ctx->discovery_mutex);
+	ret = scan(ctx, ifaces);
+	mutex_unlock(&ctx->discovery_mutex);
+
+	return ret;
+}
+
+/**
+ * Add a unicast target for the TCP/IP device discovery.
+ *
+ * By default, the TCP/IP device discovery uses a broadcast message. If at
+ * least one target is added, a directed discovery message is sent to every
+ * target address instead. This allows to discover devices in other subnets
+ * and in networks where broadcast messages are not forwarded.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] address First IPv4 address of the target in dotted-decimal
+ *                    notation.
+ * @param[in] count Number of consecutive IPv4 addresses, starting at
+ *                  @p address, to which a discovery message is sent.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_discovery_clear_tcp_targets()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_discovery_add_tcp_target(struct jaylink_context *ctx,
+		const char *address, uint32_t count)
+{
+	struct tcp_target *targets;
+	struct in_addr in;
+	uint32_t tmp;
+
+	if (!ctx || !address || !count)
+		return JAYLINK_ERR_ARG;
+
+	in.s_addr = inet_addr(address);
+
+	if (in.s_addr == INADDR_NONE)
+		return JAYLINK_ERR_ARG;
+
+	tmp = ntohl(in.s_addr);
+
+	if (count - 1 > UINT32_MAX - tmp)
+		return JAYLINK_ERR_ARG;
+
+	mutex_lock(&ctx->discovery_mutex);
+
+	targets = realloc(ctx->tcp_targets,
+		(ctx->num_tcp_targets + 1) * sizeof(struct tcp_target));
+
+	if (!targets) {
+		mutex_unlock(&ctx->discovery_mutex);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	targets[ctx->num_tcp_targets].address = tmp;
+	targets[ctx->num_tcp_targets].count = count;
+
+	ctx->tcp_targets = targets;
+	ctx->num_tcp_targets++;
+
+	mutex_unlock(&ctx->discovery_mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Remove all unicast targets of the TCP/IP device discovery.
+ *
+ * Afterwards, the TCP/IP device discovery uses a broadcast message again.
+ *
+ * @param[in,out] ctx libjaylink context.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_discovery_clear_tcp_targets(
+		struct jaylink_context *ctx)
+{
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
 
+	mutex_lock(&ctx->discovery_mutex);
+	free(ctx->tcp_targets);
+	ctx->tcp_targets = NULL;
+	ctx->num_tcp_targets = 0;
+	mutex_unlock(&ctx->discovery_mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Set the stop condition of the TCP/IP device discovery.
+ *
+ * By default, the TCP/IP device discovery waits for advertisement messages
+ * until its timeout expires. With a stop condition, the discovery ends as
+ * soon as all given serial numbers or the given number of devices have been
+ * discovered, whichever comes first.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] serial_numbers Serial numbers of the devices to wait for. Can be
+ *                           NULL if @p num_serial_numbers is zero.
+ * @param[in] num_serial_numbers Number of serial numbers, or 0 to not wait
+ *                               for particular devices.
+ * @param[in] num_devices Number of devices to wait for, or 0 for no limit.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_discovery_set_tcp_stop_condition(
+		struct jaylink_context *ctx, const uint32_t *serial_numbers,
+		size_t num_serial_numbers, size_t num_devices)
+{
+	uint32_t *tmp;
+
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+	if (num_serial_numbers > 0 && !serial_numbers)
+		return JAYLINK_ERR_ARG;
+
+	tmp = NULL;
+
+	if (num_serial_numbers > 0) {
+		tmp = malloc(num_serial_numbers * sizeof(uint32_t));
+
+		if (!tmp)
+			return JAYLINK_ERR_MALLOC;
+
+		memcpy(tmp, serial_numbers,
+			num_serial_numbers * sizeof(uint32_t));
+	}
+
+	mutex_lock(&ctx->discovery_mutex);
+	free(ctx->tcp_stop_serial_numbers);
+	ctx->tcp_stop_serial_numbers = tmp;
+	ctx->num_tcp_stop_serial_numbers = num_serial_numbers;
+	ctx->tcp_stop_num_devices = num_devices;
+	mutex_unlock(&ctx->discovery_mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Enable the USB hotplug mode.
+ *
+ * In hotplug mode, the list of USB devices is maintained incrementally with
+ * libusb hotplug events instead of probing all USB devices of the system with
+ * every jaylink_discovery_scan(). Only devices which arrive are probed. The
+ * devices which are already connected are probed once when the hotplug mode is
+ * enabled.
+ *
+ * Hotplug events are handled by jaylink_discovery_scan() and
+ * jaylink_discovery_handle_events(). The optional callback function is called
+ * for each device which arrives or leaves during the handling of the events.
+ * The callback function must not call any of the device discovery functions or
+ * jaylink_get_devices().
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] callback Callback function to be called for hotplug events, or
+ *                     NULL.
+ * @param[in,out] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or hotplug mode is already
+ *                         enabled.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Hotplug events are not supported by
+ *                                   libusb on this platform, or libjaylink
+ *                                   was built without USB support.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_discovery_enable_hotplug(
+		struct jaylink_context *ctx, jaylink_hotplug_callback callback,
+		void *user_data)
+{
 #ifdef HAVE_LIBUSB
-	if (ifaces & JAYLINK_HIF_USB) {
-		ret = discovery_usb_scan(ctx);
+	int ret;
+#endif
 
-		if (ret != JAYLINK_OK) {
-			log_err(ctx, "USB device discovery failed");
-			return ret;
-		}
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+#ifdef HAVE_LIBUSB
+	mutex_lock(&ctx->discovery_mutex);
+
+	if (ctx->hotplug) {
+		mutex_unlock(&ctx->discovery_mutex);
+		return JAYLINK_ERR_ARG;
 	}
+
+	ctx->hotplug_callback = callback;
+	ctx->hotplug_callback_data = user_data;
+
+	ret = discovery_usb_enable_hotplug(ctx);
+	mutex_unlock(&ctx->discovery_mutex);
+
+	return ret;
+#else
+	(void)callback;
+	(void)user_data;
+
+	return JAYLINK_ERR_NOT_SUPPORTED;
 #endif
+}
 
-	if (ifaces & JAYLINK_HIF_TCP) {
-		ret = discovery_tcp_scan(ctx);
+/**
+ * Disable the USB hotplug mode.
+ *
+ * @param[in,out] ctx libjaylink context.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or hotplug mode is not enabled.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_discovery_disable_hotplug(
+		struct jaylink_context *ctx)
+{
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
 
-		if (ret != JAYLINK_OK) {
-			log_err(ctx, "TCP/IP device discovery failed");
-			return ret;
-		}
+#ifdef HAVE_LIBUSB
+	mutex_lock(&ctx->discovery_mutex);
+
+	if (!ctx->hotplug) {
+		mutex_unlock(&ctx->discovery_mutex);
+		return JAYLINK_ERR_ARG;
 	}
 
+	discovery_usb_disable_hotplug(ctx);
+	mutex_unlock(&ctx->discovery_mutex);
+
 	return JAYLINK_OK;
+#else
+	return JAYLINK_ERR_ARG;
+#endif
+}
+
+/**
+ * Handle pending USB hotplug events.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] timeout Maximum time in milliseconds to wait for hotplug events,
+ *                    or 0 to handle only events which are already pending.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or hotplug mode is not enabled.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_discovery_handle_events(struct jaylink_context *ctx,
+		uint32_t timeout)
+{
+#ifdef HAVE_LIBUSB
+	int ret;
+	bool hotplug;
+#endif
+
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+#ifdef HAVE_LIBUSB
+	mutex_lock(&ctx->discovery_mutex);
+	hotplug = ctx->hotplug;
+	mutex_unlock(&ctx->discovery_mutex);
+
+	if (!hotplug)
+		return JAYLINK_ERR_ARG;
+
+	/*
+	 * Wait for events without holding the discovery mutex such that other
+	 * threads are not blocked in the meantime.
+	 */
+	ret = discovery_usb_wait_events(ctx, timeout);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	mutex_lock(&ctx->discovery_mutex);
+
+	if (ctx->hotplug)
+		discovery_usb_process_events(ctx);
+
+	mutex_unlock(&ctx->discovery_mutex);
+
+	return JAYLINK_OK;
+#else
+	(void)timeout;
+
+	return JAYLINK_ERR_ARG;
+#endif
 }
@@ -97,19 +97,6 @@ static bool compare_devices(const void *a, const void *b)
 	return true;
 }
 
-static struct jaylink_device *find_device(struct list *list,
-		const struct jaylink_device *dev)
-{
-	struct list *item;
-
-	item = list_find_custom(list, &compare_devices, dev);
-
-	if (item)
-		return item->data;
-
-	return NULL;
-}
-
 static bool parse_adv_message(struct jaylink_device *dev,
 		const uint8_t *buffer)
 {
@@ -180,18 +167,17 @@ static struct jaylink_device *probe_device(struct jaylink_context *ctx,
 	if (tmp.has_nickname)
 		log_dbg(ctx, "Device: Nickname = %s", tmp.nickname);
 
-	dev = find_device(ctx->discovered_devs, &tmp);
+	dev = device_find_mac(ctx, tmp.mac_address, &compare_devices, &tmp);
 
-	if (dev) {
+	if (dev && dev->discovered) {
 		log_dbg(ctx, "Ignoring already discovered device");
+		jaylink_unref_device(dev);
 		return NULL;
 	}
 
-	dev = find_device(ctx->devs, &tmp);
-
 	if (dev) {
 		log_dbg(ctx, "Using existing device instance");
-		return jaylink_ref_device(dev);
+		return dev;
 	}
 
 	log_dbg(ctx, "Allocating new device instance");
@@ -222,23 +208,126 @@ static struct jaylink_device *probe_device(struct jaylink_context *ctx,
 	dev->hw_version = tmp.hw_version;
 	dev->has_hw_version = tmp.has_hw_version;
 
+	if (!device_register(dev)) {
+		log_warn(ctx, "Failed to register device instance");
+		jaylink_unref_device(dev);
+		return NULL;
+	}
+
 	return dev;
 }
 
-/** @private */
-JAYLINK_PRIV int discovery_tcp_scan(struct jaylink_context *ctx)
+static int send_discovery_message(struct jaylink_context *ctx, int sock,
+		uint32_t address)
+{
+	struct sockaddr_in addr;
+	uint8_t buf[DISC_MESSAGE_SIZE];
+	size_t length;
+
+	memset(&addr, 0, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(DISC_PORT);
+	addr.sin_addr.s_addr = htonl(address);
+
+	memset(buf, 0, DISC_MESSAGE_SIZE);
+	memcpy(buf, "Discover", 8);
+
+	length = DISC_MESSAGE_SIZE;
+
+	if (!socket_sendto(sock, (char *)buf, &length, 0,
+			(const struct sockaddr *)&addr, sizeof(addr))) {
+		log_err(ctx, "Failed to send discovery message (IPv4 address "
+			"= %s)", inet_ntoa(addr.sin_addr));
+		return JAYLINK_ERR_IO;
+	}
+
+	if (length < DISC_MESSAGE_SIZE) {
+		log_err(ctx, "Only sent %zu bytes of discovery message",
+			length);
+		return JAYLINK_ERR_IO;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int send_discovery_messages(struct jaylink_context *ctx, int sock)
+{
+	int ret;
+	const struct tcp_target *target;
+	size_t num_sent;
+
+	if (!ctx->num_tcp_targets) {
+		log_dbg(ctx, "Sending discovery message");
+		return send_discovery_message(ctx, sock, INADDR_BROADCAST);
+	}
+
+	/*
+	 * Send a directed discovery message to every target address instead
+	 * of a broadcast message. A single unreachable address must not
+	 * prevent the discovery of the remaining addresses.
+	 */
+	num_sent = 0;
+
+	for (size_t i = 0; i < ctx->num_tcp_targets; i++) {
+		target = &ctx->tcp_targets[i];
+
+		for (uint32_t j = 0; j < target->count; j++) {
+			ret = send_discovery_message(ctx, sock,
+				target->address + j);
+
+			if (ret == JAYLINK_OK)
+				num_sent++;
+		}
+	}
+
+	log_dbg(ctx, "Sent %zu discovery message(s)", num_sent);
+
+	if (!num_sent)
+		return JAYLINK_ERR_IO;
+
+	return JAYLINK_OK;
+}
+
+static bool check_stop_condition(const struct jaylink_context *ctx,
+		struct tcp_discovery *disc, const struct jaylink_device *dev)
+{
+	for (size_t i = 0; i < ctx->num_tcp_stop_serial_numbers; i++) {
+		if (disc->found[i])
+			continue;
+
+		if (ctx->tcp_stop_serial_numbers[i] == dev->serial_number) {
+			disc->found[i] = true;
+			disc->num_found++;
+		}
+	}
+
+	if (ctx->num_tcp_stop_serial_numbers > 0 &&
+			disc->num_found == ctx->num_tcp_stop_serial_numbers)
+		return true;
+
+	if (ctx->tcp_stop_num_devices > 0 &&
+			disc->num_devs >= ctx->tcp_stop_num_devices)
+		return true;
+
+	return false;
+}
+
+/**
+ * Start a TCP/IP device discovery.
+ *
+ * The discovery message is sent and the advertisement messages of the devices
+ * are received with discovery_tcp_finish(). In the meantime, other work like
+ * the USB device discovery can be done.
+ *
+ * @private
+ */
+JAYLINK_PRIV int discovery_tcp_start(struct jaylink_context *ctx,
+		struct tcp_discovery *disc)
 {
 	int ret;
 	int sock;
 	int opt_value;
-	fd_set rfds;
 	struct sockaddr_in addr;
-	size_t addr_length;
-	struct timeval timeout;
-	uint8_t buf[ADV_MESSAGE_SIZE];
-	struct jaylink_device *dev;
-	size_t length;
-	size_t num_devs;
 
 	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 
@@ -269,55 +358,109 @@ JAYLINK_PRIV int discovery_tcp_scan(struct jaylink_context *ctx)
 		return JAYLINK_ERR;
 	}
 
-	addr.sin_family = AF_INET;
-	addr.sin_port = htons(DISC_PORT);
-	addr.sin_addr.s_addr = INADDR_BROADCAST;
+	disc->found = NULL;
 
-	memset(buf, 0, DISC_MESSAGE_SIZE);
-	memcpy(buf, "Discover", 8);
+	if (ctx->num_tcp_stop_serial_numbers > 0) {
+		disc->found = calloc(ctx->num_tcp_stop_serial_numbers,
+			sizeof(bool));
 
-	log_dbg(ctx, "Sending discovery message");
+		if (!disc->found) {
+			log_err(ctx, "Discovery stop condition malloc failed");
+			socket_close(sock);
+			return JAYLINK_ERR_MALLOC;
+		}
+	}
 
-	length = DISC_MESSAGE_SIZE;
+	ret = send_discovery_messages(ctx, sock);
 
-	if (!socket_sendto(sock, (char *)buf, &length, 0,
-			(const struct sockaddr *)&addr, sizeof(addr))) {
-		log_err(ctx, "Failed to send discovery message");
+	if (ret != JAYLINK_OK) {
+		free(disc->found);
 		socket_close(sock);
-		return JAYLINK_ERR_IO;
+		return ret;
 	}
 
-	if (length < DISC_MESSAGE_SIZE) {
-		log_err(ctx, "Only sent %zu bytes of discovery message",
-			length);
-		socket_close(sock);
-		return JAYLINK_ERR_IO;
-	}
+	disc->sock = sock;
+	disc->deadline = util_get_timestamp() + DISC_TIMEOUT * 1000;
+	disc->num_devs = 0;
+	disc->num_found = 0;
 
-	timeout.tv_sec = DISC_TIMEOUT / 1000;
-	timeout.tv_usec = (DISC_TIMEOUT % 1000) * 1000;
+	return JAYLINK_OK;
+}
 
-	num_devs = 0;
+/**
+ * Cancel a TCP/IP device discovery started with discovery_tcp_start().
+ *
+ * @private
+ */
+JAYLINK_PRIV void discovery_tcp_cancel(struct tcp_discovery *disc)
+{
+	free(disc->found);
+	socket_close(disc->sock);
+}
+
+/**
+ * Finish a TCP/IP device discovery started with discovery_tcp_start().
+ *
+ * Advertisement messages are received until the discovery timeout expires
+ * or the stop condition of the context is met. The messages which are
+ * received before are always processed, even if the timeout already expired
+ * when this function is called.
+ *
+ * @private
+ */
+JAYLINK_PRIV int discovery_tcp_finish(struct jaylink_context *ctx,
+		struct tcp_discovery *disc)
+{
+	int ret;
+	fd_set rfds;
+	struct sockaddr_in addr;
+	size_t addr_length;
+	struct timeval timeout;
+	uint8_t buf[ADV_MESSAGE_SIZE];
+	struct jaylink_device *dev;
+	size_t length;
+	uint64_t now;
+
+	ret = 0;
 
 	while (true) {
+		now = util_get_timestamp();
+
+		/*
+		 * Other work done since the start of the discovery may have
+		 * used up the timeout. Once the timeout is expired, only the
+		 * messages which are already received are processed.
+		 */
+		if (now < disc->deadline) {
+			timeout.tv_sec = (disc->deadline - now) / 1000000;
+			timeout.tv_usec = (disc->deadline - now) % 1000000;
+		} else {
+			timeout.tv_sec = 0;
+			timeout.tv_usec = 0;
+		}
+
 		FD_ZERO(&rfds);
-		FD_SET(sock, &rfds);
+		FD_SET(disc->sock, &rfds);
 
-		ret = select(sock + 1, &rfds, NULL, NULL, &timeout);
+		ret = select(disc->sock + 1, &rfds, NULL, NULL, &timeout);
 
 		if (ret <= 0)
 			break;
 
-		if (!FD_ISSET(sock, &rfds))
+		if (!FD_ISSET(disc->sock, &rfds))
 			continue;
 
 		length = ADV_MESSAGE_SIZE;
 		addr_length = sizeof(struct sockaddr_in);
 
-		if (!socket_recvfrom(sock, buf, &length, 0,
+		if (!socket_recvfrom(disc->sock, buf, &length, 0,
 				(struct sockaddr *)&addr, &addr_length)) {
 			log_warn(ctx, "Failed to receive advertisement "
 				"message");
+
+			if (now >= disc->deadline)
+				break;
+
 			continue;
 		}
 
@@ -330,21 +473,26 @@ JAYLINK_PRIV int discovery_tcp_scan(struct jaylink_context *ctx)
 
 		dev = probe_device(ctx, &addr, buf);
 
-		if (dev) {
-			ctx->discovered_devs = list_prepend(
-				ctx->discovered_devs, dev);
-			num_devs++;
+		if (!dev)
+			continue;
+
+		discovery_add_device(ctx, dev);
+		disc->num_devs++;
+
+		if (check_stop_condition(ctx, disc, dev)) {
+			log_dbg(ctx, "Discovery stop condition met");
+			break;
 		}
 	}
 
-	socket_close(sock);
+	discovery_tcp_cancel(disc);
 
 	if (ret < 0) {
 		log_err(ctx, "select() failed");
 		return JAYLINK_ERR;
 	}
 
-	log_dbg(ctx, "Found %zu TCP/IP device(s)", num_devs);
+	log_dbg(ctx, "Found %zu TCP/IP device(s)", disc->num_devs);
 
 	return JAYLINK_OK;
 }
@@ -121,19 +121,6 @@ static bool compare_devices(const void *a, const void *b)
 	return false;
 }
 
-static struct jaylink_device *find_device(const struct jaylink_context *ctx,
-		const struct libusb_device *usb_dev)
-{
-	struct list *item;
-
-	item = list_find_custom(ctx->devs, &compare_devices, usb_dev);
-
-	if (item)
-		return item->data;
-
-	return NULL;
-}
-
 static struct jaylink_device *probe_device(struct jaylink_context *ctx,
 		struct libusb_device *usb_dev)
 {
@@ -180,7 +167,7 @@ static struct jaylink_device *probe_device(struct jaylink_context *ctx,
 	 * Search for an already allocated device instance for this device and
 	 * if found return a reference to it.
 	 */
-	dev = find_device(ctx, usb_dev);
+	dev = device_find_usb(ctx, usb_dev);
 
 	if (dev) {
 		log_dbg(ctx, "Device: USB address = %u", dev->usb_address);
@@ -192,7 +179,7 @@ static struct jaylink_device *probe_device(struct jaylink_context *ctx,
 			log_dbg(ctx, "Device: Serial number = N/A");
 
 		log_dbg(ctx, "Using existing device instance");
-		return jaylink_ref_device(dev);
+		return dev;
 	}
 
 	/* Open the device to be able to retrieve its serial number. */
@@ -247,9 +234,40 @@ static struct jaylink_device *probe_device(struct jaylink_context *ctx,
 	dev->serial_number = serial_number;
 	dev->has_serial_number = has_serial_number;
 
+	if (!device_register(dev)) {
+		log_warn(ctx, "Failed to register device instance");
+		jaylink_unref_device(dev);
+		return NULL;
+	}
+
 	return dev;
 }
 
+static int scan_hotplug_devices(struct jaylink_context *ctx)
+{
+	int ret;
+	struct list *item;
+	size_t num;
+
+	ret = discovery_usb_wait_events(ctx, 0);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	discovery_usb_process_events(ctx);
+
+	num = 0;
+
+	for (item = ctx->hotplug_devs; item; item = item->next) {
+		discovery_add_device(ctx, jaylink_ref_device(item->data));
+		num++;
+	}
+
+	log_dbg(ctx, "Found %zu USB device(s) in hotplug mode", num);
+
+	return JAYLINK_OK;
+}
+
 JAYLINK_PRIV int discovery_usb_scan(struct jaylink_context *ctx)
 {
 	ssize_t ret;
@@ -257,6 +275,9 @@ JAYLINK_PRIV int discovery_usb_scan(struct jaylink_context *ctx)
 	struct jaylink_device *dev;
 	size_t num;
 
+	if (ctx->hotplug)
+		return scan_hotplug_devices(ctx);
+
 	ret = libusb_get_device_list(ctx->usb_ctx, &devs);
 
 	if (ret == LIBUSB_ERROR_IO) {
@@ -277,7 +298,7 @@ JAYLINK_PRIV int discovery_usb_scan(struct jaylink_context *ctx)
 		if (!dev)
 			continue;
 
-		ctx->discovered_devs = list_prepend(ctx->discovered_devs, dev);
+		discovery_add_device(ctx, dev);
 		num++;
 	}
 
@@ -286,3 +307,240 @@ JAYLINK_PRIV int discovery_usb_scan(struct jaylink_context *ctx)
 
 	return JAYLINK_OK;
 }
+
+static int LIBUSB_CALL hotplug_callback(struct libusb_context *usb_ctx,
+		struct libusb_device *usb_dev, libusb_hotplug_event event,
+		void *user_data)
+{
+	struct jaylink_context *ctx;
+	struct hotplug_event *tmp;
+	struct list *list;
+
+	(void)usb_ctx;
+
+	ctx = user_data;
+	tmp = malloc(sizeof(struct hotplug_event));
+
+	if (!tmp) {
+		log_warn(ctx, "Hotplug event malloc failed");
+		return 0;
+	}
+
+	/*
+	 * Do not probe the device here because libusb does not allow to
+	 * perform I/O operations within a hotplug callback. The event is
+	 * processed after libusb returned from event handling.
+	 */
+	tmp->usb_dev = libusb_ref_device(usb_dev);
+	tmp->arrived = (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED);
+
+	mutex_lock(&ctx->hotplug_mutex);
+	list = list_prepend(ctx->hotplug_events, tmp);
+
+	if (list)
+		ctx->hotplug_events = list;
+
+	mutex_unlock(&ctx->hotplug_mutex);
+
+	/* Drop only the new event, the queued events are kept. */
+	if (!list) {
+		log_warn(ctx, "Hotplug event list malloc failed");
+		libusb_unref_device(tmp->usb_dev);
+		free(tmp);
+	}
+
+	return 0;
+}
+
+static void process_hotplug_event(struct jaylink_context *ctx,
+		const struct hotplug_event *event)
+{
+	struct list *item;
+	struct list *list;
+	struct jaylink_device *dev;
+
+	item = list_find_custom(ctx->hotplug_devs, &compare_devices,
+		event->usb_dev);
+
+	if (event->arrived) {
+		/* The device is already known, for example after enumeration. */
+		if (item)
+			return;
+
+		dev = probe_device(ctx, event->usb_dev);
+
+		if (!dev)
+			return;
+
+		list = list_prepend(ctx->hotplug_devs, dev);
+
+		if (!list) {
+			log_warn(ctx, "Hotplug device list malloc failed");
+			jaylink_unref_device(dev);
+			return;
+		}
+
+		ctx->hotplug_devs = list;
+
+		if (ctx->hotplug_callback)
+			ctx->hotplug_callback(ctx, dev,
+				JAYLINK_HOTPLUG_EVENT_ARRIVED,
+				ctx->hotplug_callback_data);
+	} else {
+		if (!item)
+			return;
+
+		dev = item->data;
+		ctx->hotplug_devs = list_remove(ctx->hotplug_devs, dev);
+
+		log_dbg(ctx, "Device left (bus:address = %03u:%03u)",
+			libusb_get_bus_number(event->usb_dev),
+			libusb_get_device_address(event->usb_dev));
+
+		if (ctx->hotplug_callback)
+			ctx->hotplug_callback(ctx, dev,
+				JAYLINK_HOTPLUG_EVENT_LEFT,
+				ctx->hotplug_callback_data);
+
+		jaylink_unref_device(dev);
+	}
+}
+
+JAYLINK_PRIV void discovery_usb_process_events(struct jaylink_context *ctx)
+{
+	struct list *events;
+	struct list *item;
+	struct list *tmp;
+	struct hotplug_event *event;
+
+	mutex_lock(&ctx->hotplug_mutex);
+	events = ctx->hotplug_events;
+	ctx->hotplug_events = NULL;
+	mutex_unlock(&ctx->hotplug_mutex);
+
+	/* Restore the order of the events, they were prepended to the list. */
+	item = NULL;
+
+	while (events) {
+		tmp = events->next;
+		events->next = item;
+		item = events;
+		events = tmp;
+	}
+
+	while (item) {
+		event = item->data;
+		process_hotplug_event(ctx, event);
+		libusb_unref_device(event->usb_dev);
+		free(event);
+
+		tmp = item;
+		item = item->next;
+		free(tmp);
+	}
+}
+
+JAYLINK_PRIV int discovery_usb_wait_events(struct jaylink_context *ctx,
+		uint32_t timeout)
+{
+	int ret;
+	struct timeval tv;
+
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+
+	ret = libusb_handle_events_timeout_completed(ctx->usb_ctx, &tv, NULL);
+
+	if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED) {
+		log_err(ctx, "Failed to handle USB events: %s",
+			libusb_error_name(ret));
+		return JAYLINK_ERR;
+	}
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int discovery_usb_enable_hotplug(struct jaylink_context *ctx)
+{
+	int ret;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		log_err(ctx, "USB hotplug events are not supported");
+		return JAYLINK_ERR_NOT_SUPPORTED;
+	}
+
+	/*
+	 * Discard events which a callback of a previous hotplug mode added
+	 * after the callback was deregistered.
+	 */
+	discovery_usb_free_hotplug_events(ctx);
+	ctx->hotplug_devs = NULL;
+
+	/*
+	 * The already connected devices are reported as arrived devices during
+	 * the registration of the callback.
+	 */
+	ret = libusb_hotplug_register_callback(ctx->usb_ctx,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+		LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_ENUMERATE,
+		USB_VENDOR_ID, LIBUSB_HOTPLUG_MATCH_ANY,
+		LIBUSB_HOTPLUG_MATCH_ANY, &hotplug_callback, ctx,
+		&ctx->hotplug_handle);
+
+	if (ret != LIBUSB_SUCCESS) {
+		log_err(ctx, "Failed to register hotplug callback: %s",
+			libusb_error_name(ret));
+		return JAYLINK_ERR;
+	}
+
+	ctx->hotplug = true;
+	discovery_usb_process_events(ctx);
+
+	log_dbg(ctx, "USB hotplug mode enabled");
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV void discovery_usb_free_hotplug_events(
+		struct jaylink_context *ctx)
+{
+	struct list *events;
+	struct list *item;
+	struct hotplug_event *event;
+
+	mutex_lock(&ctx->hotplug_mutex);
+	events = ctx->hotplug_events;
+	ctx->hotplug_events = NULL;
+	mutex_unlock(&ctx->hotplug_mutex);
+
+	for (item = events; item; item = item->next) {
+		event = item->data;
+		libusb_unref_device(event->usb_dev);
+		free(event);
+	}
+
+	list_free(events);
+}
+
+JAYLINK_PRIV void discovery_usb_disable_hotplug(struct jaylink_context *ctx)
+{
+	struct list *item;
+
+	/*
+	 * The callback may still be running in another thread which handles
+	 * libusb events. It only accesses the list of hotplug events, which
+	 * is protected by the hotplug mutex.
+	 */
+	libusb_hotplug_deregister_callback(ctx->usb_ctx, ctx->hotplug_handle);
+	ctx->hotplug = false;
+
+	discovery_usb_free_hotplug_events(ctx);
+
+	for (item = ctx->hotplug_devs; item; item = item->next)
+		jaylink_unref_device(item->data);
+
+	list_free(ctx->hotplug_devs);
+	ctx->hotplug_devs = NULL;
+
+	log_dbg(ctx, "USB hotplug mode disabled");
+}
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -57,8 +58,44 @@
  * status code.
  */
 #define EMUCOM_AVAILABLE_BYTES_MASK	0x00ffffff
+
+/** Maximum number of bytes requested from a channel at once by the poller. */
+#define POLL_MAX_READ_SIZE		0x4000
 /** @endcond */
 
+/*
+ * Interpret the status code of a read command. On success, the number of
+ * bytes to be received is stored into @p length.
+ */
+JAYLINK_PRIV int emucom_check_read_status(struct jaylink_context *ctx,
+		uint32_t channel, uint32_t status, uint32_t *length)
+{
+	if (status == EMUCOM_ERR_NOT_SUPPORTED)
+		return JAYLINK_ERR_DEV_NOT_SUPPORTED;
+
+	if ((status & ~EMUCOM_AVAILABLE_BYTES_MASK) ==
+			EMUCOM_ERR_NOT_AVAILABLE) {
+		*length = status & EMUCOM_AVAILABLE_BYTES_MASK;
+		return JAYLINK_ERR_DEV_NOT_AVAILABLE;
+	}
+
+	if (status & EMUCOM_ERR) {
+		log_err(ctx, "Failed to read from channel 0x%x: 0x%x",
+			channel, status);
+		return JAYLINK_ERR_DEV;
+	}
+
+	if (status > *length) {
+		log_err(ctx, "Requested at most %u bytes but device "
+			"returned %u bytes", *length, status);
+		return JAYLINK_ERR_PROTO;
+	}
+
+	*length = status;
+
+	return JAYLINK_OK;
+}
+
 /**
  * Read from an EMUCOM channel.
  *
@@ -102,11 +139,13 @@ JAYLINK_API int jaylink_emucom_read(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 10, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -121,6 +160,7 @@ JAYLINK_API int jaylink_emucom_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -129,45 +169,36 @@ JAYLINK_API int jaylink_emucom_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
-	tmp = buffer_get_u32(buf, 0);
-
-	if (tmp == EMUCOM_ERR_NOT_SUPPORTED)
-		return JAYLINK_ERR_DEV_NOT_SUPPORTED;
-
-	if ((tmp & ~EMUCOM_AVAILABLE_BYTES_MASK) == EMUCOM_ERR_NOT_AVAILABLE) {
-		*length = tmp & EMUCOM_AVAILABLE_BYTES_MASK;
-		return JAYLINK_ERR_DEV_NOT_AVAILABLE;
-	}
-
-	if (tmp & EMUCOM_ERR) {
-		log_err(ctx, "Failed to read from channel 0x%x: 0x%x",
-			channel, tmp);
-		return JAYLINK_ERR_DEV;
-	}
+	ret = emucom_check_read_status(ctx, channel, buffer_get_u32(buf, 0),
+		length);
 
-	if (tmp > *length) {
-		log_err(ctx, "Requested at most %u bytes but device "
-			"returned %u bytes", *length, tmp);
-		return JAYLINK_ERR_PROTO;
+	if (ret != JAYLINK_OK) {
+		transport_unlock(devh);
+		return ret;
 	}
 
-	*length = tmp;
+	tmp = *length;
 
-	if (!tmp)
+	if (!tmp) {
+		transport_unlock(devh);
 		return JAYLINK_OK;
+	}
 
 	ret = transport_start_read(devh, tmp);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buffer, tmp);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -178,6 +209,166 @@ JAYLINK_API int jaylink_emucom_read(struct jaylink_device_handle *devh,
 	return JAYLINK_OK;
 }
 
+/**
+ * Read from multiple EMUCOM channels with a single transfer.
+ *
+ * The read commands for all channels are sent to the device at once and the
+ * responses are received afterwards. Compared to jaylink_emucom_read(), this
+ * saves one round trip per channel.
+ *
+ * The result of each read is stored into the @a status field of its
+ * description:
+ *
+ *  - #JAYLINK_OK: @a length is updated with the number of bytes read.
+ *  - #JAYLINK_ERR_DEV_NOT_SUPPORTED: Channel is not supported by the device.
+ *  - #JAYLINK_ERR_DEV_NOT_AVAILABLE: Channel is not available for the
+ *    requested amount of data. @a length is updated with the number of bytes
+ *    available on this channel.
+ *  - #JAYLINK_ERR_DEV: Unspecified device error.
+ *
+ * @note This function must only be used if the device has the
+ *       #JAYLINK_DEV_CAP_EMUCOM capability.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in,out] reads Array of read descriptions.
+ * @param[in] count Number of read descriptions. The number must not exceed
+ *                  #JAYLINK_EMUCOM_MAX_BATCH.
+ *
+ * @retval JAYLINK_OK Success. The result of each read is stored in its
+ *                    description.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_PROTO Protocol violation.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @see jaylink_emucom_read()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_emucom_read_batch(struct jaylink_device_handle *devh,
+		struct jaylink_emucom_read *reads, size_t count)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[10];
+
+	if (!devh || !reads || !count || count > JAYLINK_EMUCOM_MAX_BATCH)
+		return JAYLINK_ERR_ARG;
+
+	for (size_t i = 0; i < count; i++) {
+		if (!reads[i].buffer)
+			return JAYLINK_ERR_ARG;
+	}
+
+	ctx = devh->dev->ctx;
+	transport_lock(devh);
+	ret = transport_start_batch(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_batch() failed: %s",
+			jaylink_strerror(ret));
+		transport_unlock(devh);
+		return ret;
+	}
+
+	buf[0] = CMD_EMUCOM;
+	buf[1] = EMUCOM_CMD_READ;
+
+	for (size_t i = 0; i < count; i++) {
+		ret = transport_start_write(devh, 10, true);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_start_write() failed: %s",
+				jaylink_strerror(ret));
+			transport_cancel_batch(devh);
+			transport_unlock(devh);
+			return ret;
+		}
+
+		buffer_set_u32(buf, reads[i].channel, 2);
+		buffer_set_u32(buf, reads[i].length, 6);
+
+		ret = transport_write(devh, buf, 10);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_write() failed: %s",
+				jaylink_strerror(ret));
+			transport_cancel_batch(devh);
+			transport_unlock(devh);
+			return ret;
+		}
+	}
+
+	ret = transport_end_batch(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_end_batch() failed: %s",
+			jaylink_strerror(ret));
+		transport_unlock(devh);
+		return ret;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		ret = transport_start_read(devh, 4);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_start_read() failed: %s",
+				jaylink_strerror(ret));
+			transport_unlock(devh);
+			return ret;
+		}
+
+		ret = transport_read(devh, buf, 4);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			transport_unlock(devh);
+			return ret;
+		}
+
+		ret = emucom_check_read_status(ctx, reads[i].channel,
+			buffer_get_u32(buf, 0), &reads[i].length);
+
+		/*
+		 * The responses of the remaining channels cannot be located
+		 * after a protocol violation.
+		 */
+		if (ret == JAYLINK_ERR_PROTO) {
+			transport_unlock(devh);
+			return ret;
+		}
+
+		reads[i].status = ret;
+
+		if (ret != JAYLINK_OK || !reads[i].length)
+			continue;
+
+		ret = transport_start_read(devh, reads[i].length);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_start_read() failed: %s",
+				jaylink_strerror(ret));
+			transport_unlock(devh);
+			return ret;
+		}
+
+		ret = transport_read(devh, reads[i].buffer, reads[i].length);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			transport_unlock(devh);
+			return ret;
+		}
+	}
+
+	transport_unlock(devh);
+
+	return JAYLINK_OK;
+}
+
 /**
  * Write to an EMUCOM channel.
  *
@@ -218,11 +409,13 @@ JAYLINK_API int jaylink_emucom_write(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 10, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -237,6 +430,7 @@ JAYLINK_API int jaylink_emucom_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -245,6 +439,7 @@ JAYLINK_API int jaylink_emucom_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -253,10 +448,12 @@ JAYLINK_API int jaylink_emucom_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -285,3 +482,385 @@ JAYLINK_API int jaylink_emucom_write(struct jaylink_device_handle *devh,
 
 	return JAYLINK_OK;
 }
+
+static void poll_thread(void *arg)
+{
+	int ret;
+	struct emucom_poller *poller;
+	struct jaylink_context *ctx;
+	struct emucom_channel *channel;
+	struct jaylink_emucom_read reads[JAYLINK_EMUCOM_MAX_BATCH];
+	size_t indices[JAYLINK_EMUCOM_MAX_BATCH];
+	size_t num_reads;
+	uint32_t interval;
+	uint8_t *data;
+	size_t size;
+	bool received;
+
+	poller = arg;
+	ctx = poller->devh->dev->ctx;
+	interval = poller->min_interval;
+
+	while (!ATOMIC_LOAD(&poller->stop)) {
+		num_reads = 0;
+
+		for (size_t i = 0; i < poller->num_channels; i++) {
+			channel = &poller->channels[i];
+
+			if (ATOMIC_LOAD(&channel->status) != JAYLINK_OK)
+				continue;
+
+			size = ringbuffer_get_write_area(&channel->ringbuffer,
+				&data);
+			size = MIN(size, channel->request);
+
+			/* Skip the channel until the consumer made room. */
+			if (!size)
+				continue;
+
+			reads[num_reads].channel = channel->number;
+			reads[num_reads].buffer = data;
+			reads[num_reads].length = size;
+			indices[num_reads] = i;
+			num_reads++;
+		}
+
+		received = false;
+
+		if (num_reads > 0) {
+			ret = jaylink_emucom_read_batch(poller->devh, reads,
+				num_reads);
+
+			if (ret != JAYLINK_OK) {
+				log_err(ctx, "EMUCOM poller: "
+					"jaylink_emucom_read_batch() failed: "
+					"%s", jaylink_strerror(ret));
+				ATOMIC_STORE(&poller->status, ret);
+				break;
+			}
+		}
+
+		for (size_t i = 0; i < num_reads; i++) {
+			channel = &poller->channels[indices[i]];
+
+			switch (reads[i].status) {
+			case JAYLINK_OK:
+				if (reads[i].length > 0) {
+					ringbuffer_commit(&channel->ringbuffer,
+						reads[i].length);
+					received = true;
+				}
+
+				channel->request = POLL_MAX_READ_SIZE;
+				break;
+			case JAYLINK_ERR_DEV_NOT_AVAILABLE:
+				/*
+				 * Request exactly the available data with the
+				 * next read.
+				 */
+				if (reads[i].length > 0) {
+					channel->request = reads[i].length;
+					received = true;
+				} else {
+					channel->request = POLL_MAX_READ_SIZE;
+				}
+				break;
+			case JAYLINK_ERR_DEV_NOT_SUPPORTED:
+				log_warn(ctx, "EMUCOM poller: channel 0x%x is "
+					"not supported", channel->number);
+				ATOMIC_STORE(&channel->status,
+					JAYLINK_ERR_DEV_NOT_SUPPORTED);
+				break;
+			default:
+				/* A device error is not fatal. */
+				log_warn(ctx, "EMUCOM poller: device error "
+					"occurred on channel 0x%x",
+					channel->number);
+				break;
+			}
+		}
+
+		/*
+		 * Poll again immediately as long as data is received and back
+		 * off exponentially while all channels are idle.
+		 */
+		if (received) {
+			interval = poller->min_interval;
+			continue;
+		}
+
+		thread_sleep(interval);
+
+		if (interval < poller->max_interval / 2)
+			interval = MAX(interval * 2, 1);
+		else
+			interval = poller->max_interval;
+	}
+}
+
+static void free_poller(struct emucom_poller *poller)
+{
+	for (size_t i = 0; i < poller->num_channels; i++)
+		ringbuffer_free(&poller->channels[i].ringbuffer);
+
+	free(poller);
+}
+
+static struct emucom_channel *find_channel(struct emucom_poller *poller,
+		uint32_t channel)
+{
+	for (size_t i = 0; i < poller->num_channels; i++) {
+		if (poller->channels[i].number == channel)
+			return &poller->channels[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Start polling of EMUCOM channels.
+ *
+ * A poller thread reads from all channels with a single transfer per poll,
+ * see jaylink_emucom_read_batch(), and stores the received data into a ring
+ * buffer per channel. The ring buffers can be drained with
+ * jaylink_emucom_poll_peek() and jaylink_emucom_poll_consume().
+ *
+ * The channels are polled again immediately as long as data is received.
+ * While all channels are idle, the polling interval is doubled after each
+ * poll, starting from @p min_interval up to @p max_interval.
+ *
+ * @note This function must only be used if the device has the
+ *       #JAYLINK_DEV_CAP_EMUCOM capability.
+ *
+ * @warning While polling is active, the device handle must not be used with
+ *          any function except jaylink_emucom_stop_polling(),
+ *          jaylink_emucom_poll_peek(), jaylink_emucom_poll_consume(), the
+ *          hardware status monitor functions and jaylink_close().
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] channels Array of channels to be polled. A channel must not be
+ *                     specified more than once.
+ * @param[in] num_channels Number of channels. The number must not exceed
+ *                         #JAYLINK_EMUCOM_MAX_BATCH.
+ * @param[in] buffer_size Size of the ring buffer of each channel in bytes.
+ *                        The size is rounded up to the next power of two.
+ * @param[in] min_interval Minimum polling interval in microseconds.
+ * @param[in] max_interval Maximum polling interval in microseconds.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, polling or SWO streaming is
+ *                         already active.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_emucom_start_polling(
+		struct jaylink_device_handle *devh, const uint32_t *channels,
+		size_t num_channels, size_t buffer_size, uint32_t min_interval,
+		uint32_t max_interval)
+{
+	struct jaylink_context *ctx;
+	struct emucom_poller *poller;
+	struct emucom_channel *channel;
+
+	if (!devh || !channels || !buffer_size)
+		return JAYLINK_ERR_ARG;
+
+	if (!num_channels || num_channels > JAYLINK_EMUCOM_MAX_BATCH)
+		return JAYLINK_ERR_ARG;
+
+	if (min_interval > max_interval)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->emucom_poller || devh->swo_stream)
+		return JAYLINK_ERR_ARG;
+
+	for (size_t i = 0; i < num_channels; i++) {
+		for (size_t j = i + 1; j < num_channels; j++) {
+			if (channels[i] == channels[j])
+				return JAYLINK_ERR_ARG;
+		}
+	}
+
+	ctx = devh->dev->ctx;
+	poller = malloc(sizeof(struct emucom_poller));
+
+	if (!poller) {
+		log_err(ctx, "EMUCOM poller malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	poller->devh = devh;
+	poller->num_channels = 0;
+	poller->min_interval = min_interval;
+	poller->max_interval = max_interval;
+	poller->stop = false;
+	poller->status = JAYLINK_OK;
+
+	for (size_t i = 0; i < num_channels; i++) {
+		channel = &poller->channels[i];
+
+		if (!ringbuffer_init(&channel->ringbuffer, buffer_size)) {
+			log_err(ctx, "EMUCOM poller ring buffer malloc failed");
+			free_poller(poller);
+			return JAYLINK_ERR_MALLOC;
+		}
+
+		channel->number = channels[i];
+		channel->request = POLL_MAX_READ_SIZE;
+		channel->status = JAYLINK_OK;
+		poller->num_channels++;
+	}
+
+	if (!thread_create(&poller->thread, &poll_thread, poller)) {
+		log_err(ctx, "Failed to create EMUCOM poller thread");
+		free_poller(poller);
+		return JAYLINK_ERR;
+	}
+
+	devh->emucom_poller = poller;
+
+	return JAYLINK_OK;
+}
+
+/** @private */
+JAYLINK_PRIV void emucom_stop_polling(struct jaylink_device_handle *devh)
+{
+	struct emucom_poller *poller;
+
+	poller = devh->emucom_poller;
+	ATOMIC_STORE(&poller->stop, true);
+
+	if (!thread_join(&poller->thread))
+		log_err(devh->dev->ctx, "Failed to join EMUCOM poller thread");
+
+	free_poller(poller);
+	devh->emucom_poller = NULL;
+}
+
+/**
+ * Stop polling of EMUCOM channels.
+ *
+ * Data which is not yet consumed from the ring buffers is discarded.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or polling is not active.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during polling.
+ * @retval JAYLINK_ERR_PROTO Protocol violation during polling.
+ * @retval JAYLINK_ERR_IO Input/output error during polling.
+ * @retval JAYLINK_ERR Other error conditions during polling.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_emucom_stop_polling(struct jaylink_device_handle *devh)
+{
+	int ret;
+
+	if (!devh || !devh->emucom_poller)
+		return JAYLINK_ERR_ARG;
+
+	ret = ATOMIC_LOAD(&devh->emucom_poller->status);
+	emucom_stop_polling(devh);
+
+	return ret;
+}
+
+/**
+ * Get received data of a polled EMUCOM channel.
+ *
+ * The data is not copied but remains in the ring buffer of the channel until
+ * it is released with jaylink_emucom_poll_consume(). Because the ring buffer
+ * wraps around, less data than available may be returned. In that case, the
+ * remaining data is returned after the returned data is consumed.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] channel Channel.
+ * @param[out] data Pointer to the received data on success, and undefined on
+ *                  failure.
+ * @param[out] length Number of bytes of received data on success, and
+ *                    undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, polling is not active or the
+ *                         channel is not polled.
+ * @retval JAYLINK_ERR_DEV_NOT_SUPPORTED Channel is not supported by the
+ *                                       device and no data is left.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during polling and no data
+ *                             is left.
+ * @retval JAYLINK_ERR_PROTO Protocol violation during polling and no data is
+ *                           left.
+ * @retval JAYLINK_ERR_IO Input/output error during polling and no data is
+ *                        left.
+ * @retval JAYLINK_ERR Other error conditions during polling and no data is
+ *                     left.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_emucom_poll_peek(struct jaylink_device_handle *devh,
+		uint32_t channel, const uint8_t **data, size_t *length)
+{
+	struct emucom_channel *tmp;
+	int status;
+
+	if (!devh || !data || !length || !devh->emucom_poller)
+		return JAYLINK_ERR_ARG;
+
+	tmp = find_channel(devh->emucom_poller, channel);
+
+	if (!tmp)
+		return JAYLINK_ERR_ARG;
+
+	/*
+	 * Load the status first to ensure that no data is missed when the
+	 * poller thread terminates in the meantime.
+	 */
+	status = ATOMIC_LOAD(&devh->emucom_poller->status);
+
+	if (status == JAYLINK_OK)
+		status = ATOMIC_LOAD(&tmp->status);
+
+	*length = ringbuffer_get_read_area(&tmp->ringbuffer, data);
+
+	if (!*length && status != JAYLINK_OK)
+		return status;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Release received data of a polled EMUCOM channel.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] channel Channel.
+ * @param[in] length Number of bytes to release. The number must not exceed the
+ *                   length returned by jaylink_emucom_poll_peek().
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, polling is not active or the
+ *                         channel is not polled.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_emucom_poll_consume(struct jaylink_device_handle *devh,
+		uint32_t channel, size_t length)
+{
+	struct emucom_channel *tmp;
+
+	if (!devh || !devh->emucom_poller)
+		return JAYLINK_ERR_ARG;
+
+	tmp = find_channel(devh->emucom_poller, channel);
+
+	if (!tmp)
+		return JAYLINK_ERR_ARG;
+
+	if (length > ringbuffer_get_length(&tmp->ringbuffer))
+		return JAYLINK_ERR_ARG;
+
+	ringbuffer_consume(&tmp->ringbuffer, length);
+
+	return JAYLINK_OK;
+}
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "libjaylink.h"
@@ -43,6 +44,14 @@
 #define FILE_IO_PARAM_LENGTH	0x03
 
 #define FILE_IO_ERR		0x80000000
+
+/**
+ * Size of the chunks of a file stream in bytes.
+ *
+ * The chunk size is a trade-off between the memory usage and the overhead of
+ * the individual file I/O commands.
+ */
+#define FILE_STREAM_CHUNK_SIZE	0x10000
 /** @endcond */
 
 /**
@@ -102,11 +111,13 @@ JAYLINK_API int jaylink_file_read(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 18 + filename_length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -133,6 +144,7 @@ JAYLINK_API int jaylink_file_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -141,6 +153,7 @@ JAYLINK_API int jaylink_file_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -149,6 +162,7 @@ JAYLINK_API int jaylink_file_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -157,10 +171,12 @@ JAYLINK_API int jaylink_file_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -237,11 +253,13 @@ JAYLINK_API int jaylink_file_write(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 18 + filename_length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -268,6 +286,7 @@ JAYLINK_API int jaylink_file_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -276,6 +295,7 @@ JAYLINK_API int jaylink_file_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -284,6 +304,7 @@ JAYLINK_API int jaylink_file_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -292,10 +313,12 @@ JAYLINK_API int jaylink_file_write(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -356,11 +379,13 @@ JAYLINK_API int jaylink_file_get_size(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 6 + length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -379,6 +404,7 @@ JAYLINK_API int jaylink_file_get_size(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -387,10 +413,12 @@ JAYLINK_API int jaylink_file_get_size(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -448,11 +476,13 @@ JAYLINK_API int jaylink_file_delete(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 6 + length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -471,6 +501,7 @@ JAYLINK_API int jaylink_file_delete(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -479,10 +510,12 @@ JAYLINK_API int jaylink_file_delete(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -497,3 +530,465 @@ JAYLINK_API int jaylink_file_delete(struct jaylink_device_handle *devh,
 
 	return JAYLINK_OK;
 }
+
+static int send_command(struct jaylink_device_handle *devh, uint8_t cmd,
+		const char *filename, size_t filename_length, uint32_t offset,
+		uint32_t length)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[18 + JAYLINK_FILE_NAME_MAX_LENGTH];
+
+	ctx = devh->dev->ctx;
+	ret = transport_start_write(devh, 18 + filename_length, true);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_write() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	buf[0] = CMD_FILE_IO;
+	buf[1] = cmd;
+	buf[2] = 0x00;
+
+	buf[3] = filename_length;
+	buf[4] = FILE_IO_PARAM_FILENAME;
+	memcpy(buf + 5, filename, filename_length);
+
+	buf[filename_length + 5] = 0x04;
+	buf[filename_length + 6] = FILE_IO_PARAM_OFFSET;
+	buffer_set_u32(buf, offset, filename_length + 7);
+
+	buf[filename_length + 11] = 0x04;
+	buf[filename_length + 12] = FILE_IO_PARAM_LENGTH;
+	buffer_set_u32(buf, length, filename_length + 13);
+
+	buf[filename_length + 17] = 0x00;
+
+	ret = transport_write(devh, buf, 18 + filename_length);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_write() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int send_read_request(struct jaylink_device_handle *devh,
+		const char *filename, size_t filename_length, uint32_t offset,
+		uint32_t length)
+{
+	return send_command(devh, FILE_IO_CMD_READ, filename, filename_length,
+		offset, length);
+}
+
+static int receive_read_response(struct jaylink_device_handle *devh,
+		uint8_t *buffer, uint32_t length, uint32_t *status)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct io_vector iov[2];
+	uint8_t buf[4];
+
+	ctx = devh->dev->ctx;
+	ret = transport_start_read(devh, length + 4);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	iov[0].buffer = buffer;
+	iov[0].length = length;
+	iov[1].buffer = buf;
+	iov[1].length = sizeof(buf);
+
+	ret = transport_readv(devh, iov, 2);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_readv() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	*status = buffer_get_u32(buf, 0);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Read a file as a stream.
+ *
+ * The file is read in chunks which are passed to a callback function. The
+ * request for the next chunk is sent to the device before the data of the
+ * current chunk is received. This way, the device can process the next request
+ * while the current chunk is consumed by the callback function.
+ *
+ * In contrast to jaylink_file_read(), the amount of data is not limited and
+ * the data does not need to be held in memory at once.
+ *
+ * @note This function must only be used if the device has the
+ *       #JAYLINK_DEV_CAP_FILE_IO capability.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] filename Name of the file to read from. The length of the name
+ *                     must not exceed #JAYLINK_FILE_NAME_MAX_LENGTH bytes.
+ * @param[in] offset Offset in bytes relative to the beginning of the file from
+ *                   where to start reading.
+ * @param[in,out] length Maximum number of bytes to read. The stream ends
+ *                       earlier if the end of the file is reached. On
+ *                       success, the value gets updated with the actual
+ *                       number of bytes read. The value is undefined on
+ *                       failure.
+ * @param[in] callback Callback function to be called for each chunk of data.
+ * @param[in,out] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_DEV Unspecified device error, or the file was not found.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @return Any other value is returned by the callback function and indicates
+ *         that the stream was aborted.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_file_read_stream(struct jaylink_device_handle *devh,
+		const char *filename, uint32_t offset, uint32_t *length,
+		jaylink_file_read_callback callback, void *user_data)
+{
+	int ret;
+	size_t filename_length;
+	uint8_t *buffer;
+	uint32_t remaining;
+	uint32_t pending;
+	uint32_t next;
+	uint32_t status;
+	uint32_t total;
+
+	if (!devh || !filename || !length || !callback)
+		return JAYLINK_ERR_ARG;
+
+	if (!*length)
+		return JAYLINK_ERR_ARG;
+
+	filename_length = strlen(filename);
+
+	if (!filename_length)
+		return JAYLINK_ERR_ARG;
+
+	if (filename_length > JAYLINK_FILE_NAME_MAX_LENGTH)
+		return JAYLINK_ERR_ARG;
+
+	if (*length > UINT32_MAX - offset)
+		return JAYLINK_ERR_ARG;
+
+	buffer = malloc(FILE_STREAM_CHUNK_SIZE);
+
+	if (!buffer) {
+		log_err(devh->dev->ctx, "File stream buffer malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	pending = MIN(*length, FILE_STREAM_CHUNK_SIZE);
+	transport_lock(devh);
+	ret = send_read_request(devh, filename, filename_length, offset,
+		pending);
+
+	if (ret != JAYLINK_OK) {
+		free(buffer);
+		transport_unlock(devh);
+		return ret;
+	}
+
+	offset += pending;
+	remaining = *length - pending;
+	total = 0;
+
+	while (pending > 0) {
+		next = MIN(remaining, FILE_STREAM_CHUNK_SIZE);
+
+		/*
+		 * Send the request for the next chunk before the current chunk
+		 * is received. The request is small enough to be buffered by
+		 * the device while it is still sending the current chunk.
+		 */
+		if (next > 0) {
+			ret = send_read_request(devh, filename,
+				filename_length, offset, next);
+
+			if (ret != JAYLINK_OK)
+				break;
+
+			offset += next;
+			remaining -= next;
+		}
+
+		ret = receive_read_response(devh, buffer, pending, &status);
+
+		if (ret != JAYLINK_OK)
+			break;
+
+		if (status & FILE_IO_ERR) {
+			ret = JAYLINK_ERR_DEV;
+		} else if (status > 0) {
+			total += MIN(status, pending);
+			ret = callback(devh, buffer, MIN(status, pending),
+				user_data);
+		}
+
+		/* The end of the file is reached. */
+		if (ret == JAYLINK_OK && status < pending)
+			remaining = 0;
+
+		if (ret != JAYLINK_OK || status < pending) {
+			/* Discard the response of the pending request. */
+			if (next > 0 && receive_read_response(devh, buffer,
+					next, &status) != JAYLINK_OK)
+				log_warn(devh->dev->ctx, "Failed to discard "
+					"file stream response");
+
+			break;
+		}
+
+		pending = next;
+	}
+
+	transport_unlock(devh);
+	free(buffer);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	*length = total;
+
+	return JAYLINK_OK;
+}
+
+static int send_write_request(struct jaylink_device_handle *devh,
+		const char *filename, size_t filename_length,
+		const uint8_t *buffer, uint32_t offset, uint32_t length)
+{
+	int ret;
+	struct jaylink_context *ctx;
+
+	ctx = devh->dev->ctx;
+	ret = send_command(devh, FILE_IO_CMD_WRITE, filename, filename_length,
+		offset, length);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = transport_start_write(devh, length, true);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_write() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	ret = transport_write(devh, buffer, length);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_write() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int receive_write_response(struct jaylink_device_handle *devh,
+		uint32_t *status)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[4];
+
+	ctx = devh->dev->ctx;
+	ret = transport_start_read(devh, 4);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	ret = transport_read(devh, buf, 4);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_read() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	*status = buffer_get_u32(buf, 0);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Write a file as a stream.
+ *
+ * If a file does not exist, a new file is created.
+ *
+ * The data to be written is requested in chunks from a callback function
+ * until the callback function provides no more data. The next chunk is
+ * requested and sent to the device before the status of the current chunk is
+ * received. This way, the data is provided by the callback function while the
+ * device writes the current chunk.
+ *
+ * In contrast to jaylink_file_write(), the amount of data is not limited and
+ * the data does not need to be held in memory at once.
+ *
+ * @note This function must only be used if the device has the
+ *       #JAYLINK_DEV_CAP_FILE_IO capability.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] filename Name of the file to write to. The length of the name
+ *                     must not exceed #JAYLINK_FILE_NAME_MAX_LENGTH bytes.
+ * @param[in] offset Offset in bytes relative to the beginning of the file from
+ *                   where to start writing.
+ * @param[out] length Number of bytes written on success, and undefined on
+ *                    failure.
+ * @param[in] callback Callback function to be called for each chunk of data.
+ * @param[in,out] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_DEV Unspecified device error, or not all data could be
+ *                         written.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @return Any other value is returned by the callback function and indicates
+ *         that the stream was aborted.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_file_write_stream(struct jaylink_device_handle *devh,
+		const char *filename, uint32_t offset, uint32_t *length,
+		jaylink_file_write_callback callback, void *user_data)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	size_t filename_length;
+	uint8_t *buffer;
+	uint32_t pending;
+	uint32_t next;
+	uint32_t status;
+	uint32_t total;
+	int callback_ret;
+
+	if (!devh || !filename || !length || !callback)
+		return JAYLINK_ERR_ARG;
+
+	filename_length = strlen(filename);
+
+	if (!filename_length)
+		return JAYLINK_ERR_ARG;
+
+	if (filename_length > JAYLINK_FILE_NAME_MAX_LENGTH)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+	buffer = malloc(FILE_STREAM_CHUNK_SIZE);
+
+	if (!buffer) {
+		log_err(ctx, "File stream buffer malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	pending = 0;
+	total = 0;
+	transport_lock(devh);
+
+	while (true) {
+		next = FILE_STREAM_CHUNK_SIZE;
+		callback_ret = callback(devh, buffer, &next, user_data);
+
+		if (callback_ret == JAYLINK_OK &&
+				next > FILE_STREAM_CHUNK_SIZE) {
+			log_err(ctx, "File stream callback provided more data "
+				"than requested");
+			callback_ret = JAYLINK_ERR_ARG;
+		}
+
+		if (callback_ret == JAYLINK_OK && next > UINT32_MAX - offset) {
+			log_err(ctx, "File stream exceeds the maximum file "
+				"size");
+			callback_ret = JAYLINK_ERR_ARG;
+		}
+
+		/* Complete the pending chunk before the stream is aborted. */
+		if (callback_ret != JAYLINK_OK)
+			next = 0;
+
+		ret = JAYLINK_OK;
+
+		/*
+		 * Send the next chunk before the status of the current chunk
+		 * is received. The status is small enough to be buffered by
+		 * the device while it is receiving the next chunk.
+		 */
+		if (next > 0) {
+			ret = send_write_request(devh, filename,
+				filename_length, buffer, offset, next);
+
+			if (ret != JAYLINK_OK)
+				break;
+
+			offset += next;
+		}
+
+		if (pending > 0) {
+			ret = receive_write_response(devh, &status);
+
+			if (ret != JAYLINK_OK)
+				break;
+
+			if ((status & FILE_IO_ERR) || status != pending) {
+				log_err(ctx, "Failed to write file stream "
+					"chunk: 0x%x", status);
+
+				/* Discard the status of the pending chunk. */
+				if (next > 0 && receive_write_response(devh,
+						&status) != JAYLINK_OK)
+					log_warn(ctx, "Failed to discard file "
+						"stream response");
+
+				ret = JAYLINK_ERR_DEV;
+				break;
+			}
+
+			total += status;
+		}
+
+		if (!next)
+			break;
+
+		pending = next;
+	}
+
+	transport_unlock(devh);
+	free(buffer);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (callback_ret != JAYLINK_OK)
+		return callback_ret;
+
+	*length = total;
+
+	return JAYLINK_OK;
+}
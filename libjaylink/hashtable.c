@@ -0,0 +1,225 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Hash table.
+ *
+ * The hash table maps 64-bit keys to data pointers and uses separate chaining.
+ * Multiple entries with the same key are allowed. The number of buckets is
+ * always a power of two and doubled whenever the number of entries exceeds
+ * the number of buckets.
+ */
+
+/** @cond PRIVATE */
+/** Initial number of buckets. */
+#define INITIAL_NUM_BUCKETS	16
+/** @endcond */
+
+static size_t get_bucket(uint64_t key, size_t num_buckets)
+{
+	/* Fibonacci hashing to spread sequential keys over all buckets. */
+	key *= UINT64_C(0x9e3779b97f4a7c15);
+
+	return (size_t)(key >> 32) & (num_buckets - 1);
+}
+
+static bool resize(struct hash_table *table, size_t num_buckets)
+{
+	struct hash_entry **buckets;
+	struct hash_entry *entry;
+	struct hash_entry *next;
+	size_t index;
+
+	buckets = calloc(num_buckets, sizeof(struct hash_entry *));
+
+	if (!buckets)
+		return false;
+
+	for (size_t i = 0; i < table->num_buckets; i++) {
+		entry = table->buckets[i];
+
+		while (entry) {
+			next = entry->next;
+			index = get_bucket(entry->key, num_buckets);
+			entry->next = buckets[index];
+			buckets[index] = entry;
+			entry = next;
+		}
+	}
+
+	free(table->buckets);
+	table->buckets = buckets;
+	table->num_buckets = num_buckets;
+
+	return true;
+}
+
+/**
+ * Initialize a hash table.
+ *
+ * No memory is allocated until the first entry is inserted.
+ *
+ * @param[out] table Hash table to be initialized.
+ */
+JAYLINK_PRIV void hash_table_init(struct hash_table *table)
+{
+	table->buckets = NULL;
+	table->num_buckets = 0;
+	table->num_entries = 0;
+}
+
+/**
+ * Free the memory of a hash table.
+ *
+ * The data of the entries is not free'd.
+ *
+ * @param[in,out] table Hash table.
+ */
+JAYLINK_PRIV void hash_table_free(struct hash_table *table)
+{
+	struct hash_entry *entry;
+	struct hash_entry *next;
+
+	for (size_t i = 0; i < table->num_buckets; i++) {
+		entry = table->buckets[i];
+
+		while (entry) {
+			next = entry->next;
+			free(entry);
+			entry = next;
+		}
+	}
+
+	free(table->buckets);
+	hash_table_init(table);
+}
+
+/**
+ * Insert an entry into a hash table.
+ *
+ * @param[in,out] table Hash table.
+ * @param[in] key Key of the entry.
+ * @param[in] data Data of the entry.
+ *
+ * @return Whether the entry was inserted successfully.
+ */
+JAYLINK_PRIV bool hash_table_insert(struct hash_table *table, uint64_t key,
+		void *data)
+{
+	struct hash_entry *entry;
+	size_t index;
+
+	if (!table->num_buckets) {
+		if (!resize(table, INITIAL_NUM_BUCKETS))
+			return false;
+	} else if (table->num_entries >= table->num_buckets) {
+		/* Keep the old buckets if the table cannot be enlarged. */
+		resize(table, table->num_buckets * 2);
+	}
+
+	entry = malloc(sizeof(struct hash_entry));
+
+	if (!entry)
+		return false;
+
+	index = get_bucket(key, table->num_buckets);
+
+	entry->key = key;
+	entry->data = data;
+	entry->next = table->buckets[index];
+
+	table->buckets[index] = entry;
+	table->num_entries++;
+
+	return true;
+}
+
+/**
+ * Remove an entry from a hash table.
+ *
+ * @param[in,out] table Hash table.
+ * @param[in] key Key of the entry.
+ * @param[in] data Data of the entry.
+ */
+JAYLINK_PRIV void hash_table_remove(struct hash_table *table, uint64_t key,
+		const void *data)
+{
+	struct hash_entry **entry;
+	struct hash_entry *tmp;
+
+	if (!table->num_buckets)
+		return;
+
+	entry = &table->buckets[get_bucket(key, table->num_buckets)];
+
+	while (*entry) {
+		if ((*entry)->key == key && (*entry)->data == data) {
+			tmp = *entry;
+			*entry = tmp->next;
+			free(tmp);
+			table->num_entries--;
+			return;
+		}
+
+		entry = &(*entry)->next;
+	}
+}
+
+/**
+ * Find an entry in a hash table.
+ *
+ * @param[in] table Hash table.
+ * @param[in] key Key of the entry.
+ * @param[in] callback Callback function to select one of the entries with the
+ *                     given key, or NULL to select any of them.
+ * @param[in] user_data User data to be passed to the callback function.
+ *
+ * @return The data of the entry on success, or NULL if no matching entry was
+ *         found.
+ */
+JAYLINK_PRIV void *hash_table_find(const struct hash_table *table,
+		uint64_t key, list_compare_callback callback,
+		const void *user_data)
+{
+	const struct hash_entry *entry;
+
+	if (!table->num_buckets)
+		return NULL;
+
+	entry = table->buckets[get_bucket(key, table->num_buckets)];
+
+	while (entry) {
+		if (entry->key == key && (!callback ||
+				callback(entry->data, user_data)))
+			return entry->data;
+
+		entry = entry->next;
+	}
+
+	return NULL;
+}
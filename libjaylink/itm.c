@@ -0,0 +1,469 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Instrumentation Trace Macrocell (ITM) packet decoder.
+ *
+ * The decoder converts the ITM and Data Watchpoint and Trace (DWT) packets
+ * of the SWO data of ARMv7-M and ARMv8-M targets into events. Packets can be
+ * split across multiple calls of the decoder.
+ */
+
+/** @cond PRIVATE */
+/** Number of zero bytes at the start of a synchronization packet. */
+#define SYNC_NUM_ZEROS	5
+
+/** Last byte of a synchronization packet. */
+#define HEADER_SYNC		0x80
+#define HEADER_OVERFLOW		0x70
+#define HEADER_GTS1		0x94
+#define HEADER_GTS2		0xb4
+
+/** Continuation bit of the header and payload bytes. */
+#define CONTINUATION_BIT	0x80
+
+/** DWT discriminator IDs of hardware source packets. */
+#define DWT_ID_EXCEPTION	1
+#define DWT_ID_PC_SAMPLE	2
+
+/** All event types. */
+#define ALL_EVENT_TYPES \
+	(JAYLINK_ITM_EVENT_STIMULUS | JAYLINK_ITM_EVENT_HARDWARE | \
+	JAYLINK_ITM_EVENT_PC_SAMPLE | JAYLINK_ITM_EVENT_EXCEPTION | \
+	JAYLINK_ITM_EVENT_LOCAL_TIMESTAMP | \
+	JAYLINK_ITM_EVENT_GLOBAL_TIMESTAMP | JAYLINK_ITM_EVENT_OVERFLOW)
+
+enum packet_status {
+	PACKET_COMPLETE,
+	PACKET_INCOMPLETE,
+	PACKET_INVALID
+};
+/** @endcond */
+
+/**
+ * Allocate an ITM packet decoder.
+ *
+ * The decoder assumes that the data starts at a packet boundary and decodes
+ * all event types of all stimulus ports.
+ *
+ * @param[out] decoder Newly allocated decoder on success, and undefined on
+ *                     failure. Use jaylink_itm_decoder_free() to free it.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_itm_decoder_new(struct jaylink_itm_decoder **decoder)
+{
+	struct jaylink_itm_decoder *tmp;
+
+	if (!decoder)
+		return JAYLINK_ERR_ARG;
+
+	tmp = malloc(sizeof(struct jaylink_itm_decoder));
+
+	if (!tmp)
+		return JAYLINK_ERR_MALLOC;
+
+	tmp->types = ALL_EVENT_TYPES;
+	tmp->ports = UINT32_MAX;
+	tmp->synced = true;
+	tmp->num_zeros = 0;
+	tmp->packet_length = 0;
+
+	*decoder = tmp;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Free an ITM packet decoder.
+ *
+ * @param[in,out] decoder Decoder, or NULL.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API void jaylink_itm_decoder_free(struct jaylink_itm_decoder *decoder)
+{
+	free(decoder);
+}
+
+/**
+ * Reset an ITM packet decoder.
+ *
+ * An incomplete packet is discarded and the decoder skips all data until the
+ * next synchronization packet. This is useful if the SWO data is not
+ * contiguous anymore, for example after a buffer overrun on the device.
+ *
+ * @param[in,out] decoder Decoder.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_itm_decoder_reset(struct jaylink_itm_decoder *decoder)
+{
+	if (!decoder)
+		return JAYLINK_ERR_ARG;
+
+	decoder->synced = false;
+	decoder->num_zeros = 0;
+	decoder->packet_length = 0;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Set the filter of an ITM packet decoder.
+ *
+ * Packets which do not pass the filter are skipped without generating an
+ * event.
+ *
+ * @param[in,out] decoder Decoder.
+ * @param[in] types Event types to decode. This value is a bitwise OR of
+ *                  #jaylink_itm_event_type.
+ * @param[in] ports Stimulus ports to decode. Each bit corresponds to the
+ *                  stimulus port with the same number. Only used for
+ *                  #JAYLINK_ITM_EVENT_STIMULUS.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_itm_decoder_set_filter(
+		struct jaylink_itm_decoder *decoder, uint32_t types,
+		uint32_t ports)
+{
+	if (!decoder)
+		return JAYLINK_ERR_ARG;
+
+	if (types & ~ALL_EVENT_TYPES)
+		return JAYLINK_ERR_ARG;
+
+	decoder->types = types;
+	decoder->ports = ports;
+
+	return JAYLINK_OK;
+}
+
+/** @cond PRIVATE */
+/*
+ * Count the zero bytes at the end of the data, up to the number required for
+ * a synchronization packet.
+ */
+static size_t count_zeros(const uint8_t *data, size_t length)
+{
+	size_t num;
+
+	num = 0;
+
+	while (num < length && num < SYNC_NUM_ZEROS && !data[length - num - 1])
+		num++;
+
+	return num;
+}
+
+/*
+ * Search for the end of a synchronization packet.
+ *
+ * Only the candidates for the last byte of a synchronization packet are
+ * checked for preceding zero bytes, which allows to skip data with memchr()
+ * instead of processing it byte by byte.
+ *
+ * Returns the number of bytes processed.
+ */
+static size_t find_sync(struct jaylink_itm_decoder *decoder,
+		const uint8_t *data, size_t length)
+{
+	const uint8_t *ptr;
+	size_t pos;
+	size_t num;
+	size_t tmp;
+
+	pos = 0;
+
+	while (pos < length) {
+		ptr = memchr(data + pos, HEADER_SYNC, length - pos);
+
+		if (!ptr) {
+			tmp = length - pos;
+			num = count_zeros(data + pos, tmp);
+
+			/* Keep track of zero bytes across multiple calls. */
+			if (num == tmp)
+				num += decoder->num_zeros;
+
+			decoder->num_zeros = MIN(num, SYNC_NUM_ZEROS);
+
+			return length;
+		}
+
+		tmp = ptr - (data + pos);
+		num = count_zeros(data + pos, tmp);
+
+		if (num == tmp)
+			num += decoder->num_zeros;
+
+		decoder->num_zeros = 0;
+		pos += tmp + 1;
+
+		if (num >= SYNC_NUM_ZEROS) {
+			decoder->synced = true;
+			break;
+		}
+	}
+
+	return pos;
+}
+
+static enum packet_status get_packet_length(const uint8_t *data,
+		size_t length, size_t *packet_length)
+{
+	uint8_t header;
+	size_t tmp;
+
+	header = data[0];
+
+	/* Source packet with a payload of 1, 2 or 4 bytes. */
+	if (header & 0x03) {
+		tmp = header & 0x03;
+		*packet_length = 1 + ((tmp == 3) ? 4 : tmp);
+
+		if (length < *packet_length)
+			return PACKET_INCOMPLETE;
+
+		return PACKET_COMPLETE;
+	}
+
+	/*
+	 * Packets without continuation bytes: zero bytes and the last byte of
+	 * a synchronization packet, overflow packets, local timestamp packets
+	 * of format 2 and extension packets without payload.
+	 */
+	if (!header || header == HEADER_SYNC || header == HEADER_OVERFLOW ||
+			(header & 0x8f) == 0x00 || (header & 0x8b) == 0x08) {
+		*packet_length = 1;
+		return PACKET_COMPLETE;
+	}
+
+	/*
+	 * Packets with continuation bytes: local timestamp packets of format
+	 * 1, global timestamp packets and extension packets with payload.
+	 */
+	if ((header & 0xcf) != 0xc0 && header != HEADER_GTS1 &&
+			header != HEADER_GTS2 && (header & 0x8b) != 0x88)
+		return PACKET_INVALID;
+
+	for (size_t i = 1; i < MIN(length, ITM_MAX_PACKET_SIZE); i++) {
+		if (!(data[i] & CONTINUATION_BIT)) {
+			*packet_length = i + 1;
+			return PACKET_COMPLETE;
+		}
+	}
+
+	if (length >= ITM_MAX_PACKET_SIZE)
+		return PACKET_INVALID;
+
+	return PACKET_INCOMPLETE;
+}
+
+static bool decode_packet(const struct jaylink_itm_decoder *decoder,
+		const uint8_t *data, size_t length,
+		struct jaylink_itm_event *event)
+{
+	uint8_t header;
+	uint32_t value;
+
+	header = data[0];
+	value = 0;
+
+	if (header & 0x03) {
+		for (size_t i = 1; i < length; i++)
+			value |= (uint32_t)data[i] << (8 * (i - 1));
+
+		event->id = header >> 3;
+		event->size = length - 1;
+
+		if (!(header & 0x04)) {
+			event->type = JAYLINK_ITM_EVENT_STIMULUS;
+
+			if (!(decoder->ports & (UINT32_C(1) << event->id)))
+				return false;
+		} else if (event->id == DWT_ID_EXCEPTION) {
+			event->type = JAYLINK_ITM_EVENT_EXCEPTION;
+			event->id = (value >> 12) & 0x03;
+			value &= 0x1ff;
+		} else if (event->id == DWT_ID_PC_SAMPLE) {
+			event->type = JAYLINK_ITM_EVENT_PC_SAMPLE;
+		} else {
+			event->type = JAYLINK_ITM_EVENT_HARDWARE;
+		}
+	} else if (header == HEADER_OVERFLOW) {
+		event->type = JAYLINK_ITM_EVENT_OVERFLOW;
+		event->id = 0;
+		event->size = 0;
+	} else if (header && header != HEADER_SYNC &&
+			!(header & 0x0f)) {
+		event->type = JAYLINK_ITM_EVENT_LOCAL_TIMESTAMP;
+
+		if (header & CONTINUATION_BIT) {
+			event->id = (header >> 4) & 0x03;
+			event->size = length - 1;
+
+			for (size_t i = 1; i < MIN(length, 6); i++)
+				value |= (uint32_t)(data[i] & 0x7f) <<
+					(7 * (i - 1));
+		} else {
+			event->id = 0;
+			event->size = 0;
+			value = (header >> 4) & 0x07;
+		}
+	} else if (header == HEADER_GTS1 || header == HEADER_GTS2) {
+		event->type = JAYLINK_ITM_EVENT_GLOBAL_TIMESTAMP;
+		event->id = (header == HEADER_GTS1) ? 1 : 2;
+		event->size = length - 1;
+
+		/* Payload bits beyond 32 bits are not used. */
+		for (size_t i = 1; i < MIN(length, 6); i++)
+			value |= (uint32_t)(data[i] & 0x7f) << (7 * (i - 1));
+	} else {
+		/* Synchronization and extension packets. */
+		return false;
+	}
+
+	if (!(decoder->types & event->type))
+		return false;
+
+	event->value = value;
+
+	return true;
+}
+/** @endcond */
+
+/**
+ * Decode ITM packets.
+ *
+ * The data is decoded until all data is processed or the event buffer is
+ * full. An incomplete packet at the end of the data is stored in the decoder
+ * and decoded together with the data of the next call. If an invalid packet
+ * is encountered, the decoder skips all data until the next synchronization
+ * packet.
+ *
+ * @param[in,out] decoder Decoder.
+ * @param[in] data SWO data to decode.
+ * @param[in,out] length Number of bytes of SWO data. On success, the value
+ *                       gets updated with the number of bytes processed,
+ *                       and undefined on failure.
+ * @param[out] events Buffer to store the decoded events.
+ * @param[in,out] count Maximum number of events to store. On success, the
+ *                      value gets updated with the number of decoded events,
+ *                      and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_itm_decode(struct jaylink_itm_decoder *decoder,
+		const uint8_t *data, size_t *length,
+		struct jaylink_itm_event *events, size_t *count)
+{
+	enum packet_status status;
+	size_t pos;
+	size_t num;
+	size_t tmp;
+
+	if (!decoder || !data || !length || !events || !count)
+		return JAYLINK_ERR_ARG;
+
+	pos = 0;
+	num = 0;
+
+	while (pos < *length && num < *count) {
+		if (!decoder->synced) {
+			pos += find_sync(decoder, data + pos, *length - pos);
+			continue;
+		}
+
+		/* Complete the packet of the previous call first. */
+		if (decoder->packet_length > 0) {
+			decoder->packet[decoder->packet_length++] = data[pos++];
+			status = get_packet_length(decoder->packet,
+				decoder->packet_length, &tmp);
+
+			if (status == PACKET_INCOMPLETE)
+				continue;
+
+			decoder->packet_length = 0;
+
+			if (status == PACKET_INVALID) {
+				decoder->synced = false;
+				continue;
+			}
+
+			if (decode_packet(decoder, decoder->packet, tmp,
+					events + num))
+				num++;
+
+			continue;
+		}
+
+		status = get_packet_length(data + pos, *length - pos, &tmp);
+
+		if (status == PACKET_INCOMPLETE) {
+			tmp = *length - pos;
+			memcpy(decoder->packet, data + pos, tmp);
+			decoder->packet_length = tmp;
+			pos += tmp;
+			break;
+		}
+
+		if (status == PACKET_INVALID) {
+			decoder->synced = false;
+			decoder->num_zeros = 0;
+			pos++;
+			continue;
+		}
+
+		if (decode_packet(decoder, data + pos, tmp, events + num))
+			num++;
+
+		pos += tmp;
+	}
+
+	*length = pos;
+	*count = num;
+
+	return JAYLINK_OK;
+}
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include "libjaylink.h"
 #include "libjaylink-internal.h"
@@ -44,6 +45,20 @@
  * perform the JTAG I/O operation.
  */
 #define JTAG_IO_ERR_NO_MEMORY	0x06
+
+/**
+ * Maximum size of a JTAG scan chunk in bytes.
+ *
+ * This is the largest number of whole bytes a single JTAG I/O operation is
+ * able to transfer.
+ */
+#define JTAG_SCAN_MAX_CHUNK_SIZE	(UINT16_MAX / 8)
+
+/**
+ * Size of a JTAG scan chunk in bytes for devices which are not able to report
+ * their free memory.
+ */
+#define JTAG_SCAN_DEFAULT_CHUNK_SIZE	2048
 /** @endcond */
 
 /**
@@ -83,6 +98,7 @@ JAYLINK_API int jaylink_jtag_io(struct jaylink_device_handle *devh,
 	int ret;
 	struct jaylink_context *ctx;
 	uint8_t buf[4];
+	struct io_vector iov[3];
 	uint16_t num_bytes;
 	uint16_t read_length;
 	uint8_t status;
@@ -108,12 +124,14 @@ JAYLINK_API int jaylink_jtag_io(struct jaylink_device_handle *devh,
 	}
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 4 + 2 * num_bytes,
 		read_length, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -121,59 +139,319 @@ JAYLINK_API int jaylink_jtag_io(struct jaylink_device_handle *devh,
 	buf[1] = 0x00;
 	buffer_set_u16(buf, length, 2);
 
-	ret = transport_write(devh, buf, 4);
+	iov[0].buffer = buf;
+	iov[0].length = 4;
+	iov[1].buffer = (uint8_t *)tms;
+	iov[1].length = num_bytes;
+	iov[2].buffer = (uint8_t *)tdi;
+	iov[2].length = num_bytes;
+
+	ret = transport_writev(devh, iov, 3);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_write() failed: %s",
+		log_err(ctx, "transport_writev() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
-	ret = transport_write(devh, tms, num_bytes);
+	iov[0].buffer = tdo;
+	iov[0].length = num_bytes;
+	iov[1].buffer = &status;
+	iov[1].length = 1;
+
+	/* The status byte is only available in version 3. */
+	ret = transport_readv(devh, iov,
+		(version == JAYLINK_JTAG_VERSION_2) ? 1 : 2);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_write() failed: %s",
+		log_err(ctx, "transport_readv() failed: %s",
 			jaylink_strerror(ret));
 		return ret;
 	}
 
-	ret = transport_write(devh, tdi, num_bytes);
+	if (version == JAYLINK_JTAG_VERSION_2)
+		return JAYLINK_OK;
+
+	if (status == JTAG_IO_ERR_NO_MEMORY) {
+		return JAYLINK_ERR_DEV_NO_MEMORY;
+	} else if (status > 0) {
+		log_err(ctx, "JTAG I/O operation failed: 0x%x", status);
+		return JAYLINK_ERR_DEV;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int send_scan_request(struct jaylink_device_handle *devh, uint8_t cmd,
+		const uint8_t *tms, const uint8_t *tdi, uint16_t length)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[4];
+	struct io_vector iov[3];
+	uint16_t num_bytes;
+
+	ctx = devh->dev->ctx;
+	num_bytes = (length + 7) / 8;
+	ret = transport_start_write(devh, 4 + 2 * num_bytes, true);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_write() failed: %s",
+		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
 		return ret;
 	}
 
-	ret = transport_read(devh, tdo, num_bytes);
+	buf[0] = cmd;
+	buf[1] = 0x00;
+	buffer_set_u16(buf, length, 2);
+
+	iov[0].buffer = buf;
+	iov[0].length = 4;
+	iov[1].buffer = (uint8_t *)tms;
+	iov[1].length = num_bytes;
+	iov[2].buffer = (uint8_t *)tdi;
+	iov[2].length = num_bytes;
+
+	ret = transport_writev(devh, iov, 3);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_read() failed: %s",
+		log_err(ctx, "transport_writev() failed: %s",
 			jaylink_strerror(ret));
 		return ret;
 	}
 
-	if (version == JAYLINK_JTAG_VERSION_2)
-		return JAYLINK_OK;
+	return JAYLINK_OK;
+}
 
-	ret = transport_read(devh, &status, 1);
+static int receive_scan_response(struct jaylink_device_handle *devh,
+		uint8_t *tdo, uint16_t length, enum jaylink_jtag_version version,
+		uint8_t *status)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct io_vector iov[2];
+	uint16_t num_bytes;
+	size_t num_iov;
+
+	ctx = devh->dev->ctx;
+	num_bytes = (length + 7) / 8;
+
+	iov[0].buffer = tdo;
+	iov[0].length = num_bytes;
+	iov[1].buffer = status;
+	iov[1].length = 1;
+
+	/* The status byte is only available in version 3. */
+	num_iov = (version == JAYLINK_JTAG_VERSION_2) ? 1 : 2;
+	*status = 0x00;
+
+	ret = transport_start_read(devh, num_bytes + num_iov - 1);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_read() failed: %s",
+		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
 		return ret;
 	}
 
-	if (status == JTAG_IO_ERR_NO_MEMORY) {
-		return JAYLINK_ERR_DEV_NO_MEMORY;
-	} else if (status > 0) {
-		log_err(ctx, "JTAG I/O operation failed: 0x%x", status);
-		return JAYLINK_ERR_DEV;
+	ret = transport_readv(devh, iov, num_iov);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_readv() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
 	}
 
 	return JAYLINK_OK;
 }
 
+static int get_scan_chunk_size(struct jaylink_device_handle *devh,
+		size_t *size)
+{
+	int ret;
+	uint8_t caps[JAYLINK_DEV_CAPS_SIZE];
+	uint32_t free_memory;
+
+	ret = jaylink_get_caps(devh, caps);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (!jaylink_has_cap(caps, JAYLINK_DEV_CAP_GET_FREE_MEMORY)) {
+		*size = JTAG_SCAN_DEFAULT_CHUNK_SIZE;
+		return JAYLINK_OK;
+	}
+
+	ret = jaylink_get_free_memory(devh, &free_memory);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	/*
+	 * Two chunks are in flight at the same time. For each of them, the
+	 * device holds the TMS, TDI and TDO data.
+	 */
+	*size = MIN(free_memory / (2 * 3), JTAG_SCAN_MAX_CHUNK_SIZE);
+
+	if (!*size)
+		return JAYLINK_ERR_DEV_NO_MEMORY;
+
+	log_dbg(devh->dev->ctx, "Using JTAG scan chunk size of %zu bytes",
+		*size);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Perform a JTAG I/O operation of arbitrary length.
+ *
+ * In contrast to jaylink_jtag_io(), the number of bits to transfer is not
+ * limited. The operation is split into chunks whose size is derived from the
+ * free memory of the device, see jaylink_get_free_memory(). The request for
+ * the next chunk is sent to the device before the TDO data of the current
+ * chunk is received. This way, the device can shift the next chunk while the
+ * host is still receiving the current one.
+ *
+ * @note This function must only be used if the #JAYLINK_TIF_JTAG interface is
+ *       available and selected. Nevertheless, this function can be used if the
+ *       device doesn't have the #JAYLINK_DEV_CAP_SELECT_TIF capability.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] tms Buffer to read TMS data from.
+ * @param[in] tdi Buffer to read TDI data from.
+ * @param[out] tdo Buffer to store TDO data on success, or NULL to discard the
+ *                 TDO data. Its content is undefined on failure. The buffer
+ *                 must be large enough to contain at least the specified
+ *                 number of bits to transfer.
+ * @param[in] length Number of bits to transfer.
+ * @param[in] version Version of the JTAG command to use.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_DEV_NO_MEMORY Not enough memory on the device to perform
+ *                                   the operation.
+ * @retval JAYLINK_ERR_DEV Unspecified device error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @see jaylink_jtag_io()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_jtag_scan(struct jaylink_device_handle *devh,
+		const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		size_t length, enum jaylink_jtag_version version)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t *discard;
+	uint8_t cmd;
+	uint8_t status;
+	size_t chunk_size;
+	size_t offset;
+	size_t remaining;
+	uint16_t pending;
+	uint16_t next;
+
+	if (!devh || !tms || !tdi || !length)
+		return JAYLINK_ERR_ARG;
+
+	switch (version) {
+	case JAYLINK_JTAG_VERSION_2:
+		cmd = CMD_JTAG_IO_V2;
+		break;
+	case JAYLINK_JTAG_VERSION_3:
+		cmd = CMD_JTAG_IO_V3;
+		break;
+	default:
+		return JAYLINK_ERR_ARG;
+	}
+
+	ctx = devh->dev->ctx;
+	ret = get_scan_chunk_size(devh, &chunk_size);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	discard = NULL;
+
+	if (!tdo) {
+		discard = malloc(chunk_size);
+
+		if (!discard) {
+			log_err(ctx, "JTAG scan buffer malloc failed");
+			return JAYLINK_ERR_MALLOC;
+		}
+	}
+
+	/* All chunks except the last one consist of whole bytes. */
+	pending = MIN(length, chunk_size * 8);
+	transport_lock(devh);
+	ret = send_scan_request(devh, cmd, tms, tdi, pending);
+
+	if (ret != JAYLINK_OK) {
+		free(discard);
+		transport_unlock(devh);
+		return ret;
+	}
+
+	offset = 0;
+	remaining = length - pending;
+
+	while (pending > 0) {
+		next = MIN(remaining, chunk_size * 8);
+
+		/*
+		 * Send the request for the next chunk before the TDO data of
+		 * the current chunk is received. The free memory of the device
+		 * is large enough to hold both chunks.
+		 */
+		if (next > 0) {
+			ret = send_scan_request(devh, cmd,
+				tms + offset + pending / 8,
+				tdi + offset + pending / 8, next);
+
+			if (ret != JAYLINK_OK)
+				break;
+
+			remaining -= next;
+		}
+
+		ret = receive_scan_response(devh,
+			tdo ? tdo + offset : discard, pending, version, &status);
+
+		if (ret == JAYLINK_OK && status == JTAG_IO_ERR_NO_MEMORY) {
+			ret = JAYLINK_ERR_DEV_NO_MEMORY;
+		} else if (ret == JAYLINK_OK && status > 0) {
+			log_err(ctx, "JTAG I/O operation failed: 0x%x", status);
+			ret = JAYLINK_ERR_DEV;
+		}
+
+		offset += pending / 8;
+
+		if (ret != JAYLINK_OK) {
+			/* Discard the response of the pending request. */
+			if (next > 0 && receive_scan_response(devh,
+					tdo ? tdo + offset : discard, next,
+					version, &status) != JAYLINK_OK)
+				log_warn(ctx, "Failed to discard JTAG scan "
+					"response");
+
+			break;
+		}
+
+		pending = next;
+	}
+
+	transport_unlock(devh);
+	free(discard);
+
+	return ret;
+}
+
 /**
  * Clear the JTAG test reset (TRST) signal.
  *
@@ -197,17 +475,20 @@ JAYLINK_API int jaylink_jtag_clear_trst(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_JTAG_CLEAR_TRST;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -241,17 +522,20 @@ JAYLINK_API int jaylink_jtag_set_trst(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_JTAG_SET_TRST;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -285,17 +569,20 @@ JAYLINK_API int jaylink_jtag_clear_tms(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_JTAG_CLEAR_TMS;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -329,17 +616,20 @@ JAYLINK_API int jaylink_jtag_set_tms(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_JTAG_SET_TMS;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -373,17 +663,20 @@ JAYLINK_API int jaylink_jtag_clear_tck(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_JTAG_CLEAR_TCK;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -417,17 +710,20 @@ JAYLINK_API int jaylink_jtag_set_tck(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_JTAG_SET_TCK;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -24,12 +24,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <sys/types.h>
 #ifdef _WIN32
 #include <ws2tcpip.h>
+#include <windows.h>
 #else
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <pthread.h>
 #endif
 
 #ifdef HAVE_CONFIG_H
@@ -58,27 +61,299 @@
 /** Calculate the minimum of two numeric values. */
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 
+/** Calculate the maximum of two numeric values. */
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+/** Maximum number of I/O vectors of a single vectored I/O operation. */
+#define MAX_IO_VECTORS	8
+
+/** Atomically load a value with acquire semantics. */
+#define ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+
+/** Atomically store a value with release semantics. */
+#define ATOMIC_STORE(ptr, value) \
+	__atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+/** Atomically add to a value and return the new value. */
+#define ATOMIC_ADD_FETCH(ptr, value) \
+	__atomic_add_fetch((ptr), (value), __ATOMIC_ACQ_REL)
+
+/** Atomically subtract from a value and return the new value. */
+#define ATOMIC_SUB_FETCH(ptr, value) \
+	__atomic_sub_fetch((ptr), (value), __ATOMIC_ACQ_REL)
+
+/**
+ * Atomically replace a value if it is equal to an expected value.
+ *
+ * On failure, the current value is stored in the expected value.
+ */
+#define ATOMIC_COMPARE_EXCHANGE(ptr, expected, desired) \
+	__atomic_compare_exchange_n((ptr), (expected), (desired), false, \
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/**
+ * Check whether messages of a log level are emitted.
+ *
+ * The check is cheap enough to be done in front of every log message such that
+ * suppressed messages do not cause any overhead for the formatting of their
+ * arguments.
+ */
+#define log_is_enabled(ctx, level) \
+	((ctx) && (level) <= ATOMIC_LOAD(&(ctx)->log_level))
+
+/** Emit a log message if its log level is enabled. */
+#define LOG_MESSAGE(ctx, level, ...) \
+	do { \
+		if (log_is_enabled(ctx, level)) \
+			log_message(ctx, level, __func__, __VA_ARGS__); \
+	} while (0)
+
+/**
+ * Indicates whether messages with log level #JAYLINK_LOG_LEVEL_DEBUG_IO are
+ * compiled in.
+ */
+#ifdef DISABLE_LOG_DEBUG_IO
+#define LOG_DEBUG_IO_ENABLED	0
+#else
+#define LOG_DEBUG_IO_ENABLED	1
+#endif
+
+/** Log an error message. */
+#define log_err(ctx, ...) \
+	LOG_MESSAGE(ctx, JAYLINK_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+/** Log a warning message. */
+#define log_warn(ctx, ...) \
+	LOG_MESSAGE(ctx, JAYLINK_LOG_LEVEL_WARNING, __VA_ARGS__)
+
+/** Log an informational message. */
+#define log_info(ctx, ...) \
+	LOG_MESSAGE(ctx, JAYLINK_LOG_LEVEL_INFO, __VA_ARGS__)
+
+/** Log a debug message. */
+#define log_dbg(ctx, ...) \
+	LOG_MESSAGE(ctx, JAYLINK_LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/**
+ * Log a debug message about an I/O operation.
+ *
+ * If these messages are disabled at compile-time, the message is removed
+ * completely by the compiler.
+ */
+#define log_dbgio(ctx, ...) \
+	do { \
+		if (LOG_DEBUG_IO_ENABLED) \
+			LOG_MESSAGE(ctx, JAYLINK_LOG_LEVEL_DEBUG_IO, \
+				__VA_ARGS__); \
+	} while (0)
+
+typedef void (*thread_function)(void *arg);
+
+struct thread {
+#ifdef _WIN32
+	/** Thread handle. */
+	HANDLE handle;
+#else
+	/** Thread handle. */
+	pthread_t handle;
+#endif
+	/** Function to be executed by the thread. */
+	thread_function function;
+	/** Argument to be passed to the function. */
+	void *arg;
+};
+
+struct mutex {
+#ifdef _WIN32
+	/** Critical section object. */
+	CRITICAL_SECTION handle;
+#else
+	/** Mutex handle. */
+	pthread_mutex_t handle;
+#endif
+};
+
+struct hash_entry {
+	/** Key of the entry. */
+	uint64_t key;
+	/** Data of the entry. */
+	void *data;
+	/** Next entry of the same bucket. */
+	struct hash_entry *next;
+};
+
+struct hash_table {
+	/** Buckets, or NULL if no entry was inserted yet. */
+	struct hash_entry **buckets;
+	/** Number of buckets, always a power of two. */
+	size_t num_buckets;
+	/** Number of entries. */
+	size_t num_entries;
+};
+
+struct pool_object {
+	/** Next free object, or NULL if this is the last one. */
+	struct pool_object *next;
+};
+
+struct pool {
+	/** Size of an object in bytes. */
+	size_t object_size;
+	/** Free objects, or NULL if there are none. */
+	struct pool_object *objects;
+	/** Number of free objects. */
+	size_t num_objects;
+	/** Maximum number of free objects kept in the pool. */
+	size_t max_objects;
+};
+
+struct tcp_target {
+	/** First IPv4 address in host byte order. */
+	uint32_t address;
+	/** Number of consecutive IPv4 addresses. */
+	uint32_t count;
+};
+
+struct tcp_connection {
+	/** IPv4 address of the device in dotted-decimal notation. */
+	char ipv4_address[INET_ADDRSTRLEN];
+	/** Socket of the connection. */
+	int sock;
+	/** Timestamp in microseconds when the connection was released. */
+	uint64_t timestamp;
+};
+
 struct jaylink_context {
 #ifdef HAVE_LIBUSB
 	/** libusb context. */
 	struct libusb_context *usb_ctx;
+	/** Indicates whether the USB hotplug mode is enabled. */
+	bool hotplug;
+	/** Handle of the libusb hotplug callback. */
+	libusb_hotplug_callback_handle hotplug_handle;
+	/** USB devices tracked in hotplug mode. */
+	struct list *hotplug_devs;
+	/** Hotplug events which are not processed yet. */
+	struct list *hotplug_events;
+	/**
+	 * Mutex to protect the list of hotplug events.
+	 *
+	 * The libusb hotplug callback can be called by any thread that
+	 * handles libusb events, for example a thread which waits for the
+	 * completion of a USB transfer. The mutex remains valid for the
+	 * lifetime of the context because the callback may still be running
+	 * after it was deregistered.
+	 */
+	struct mutex hotplug_mutex;
+	/** Hotplug callback function. */
+	jaylink_hotplug_callback hotplug_callback;
+	/** User data to be passed to the hotplug callback function. */
+	void *hotplug_callback_data;
 #endif
 	/**
-	 * List of allocated device instances.
+	 * Mutex to protect the device registry and the reference counts of
+	 * registered device instances which drop to zero.
+	 *
+	 * Device instances can be unreferenced by any thread, for example
+	 * when a device handle is closed.
+	 */
+	struct mutex devs_mutex;
+	/**
+	 * Mutex to serialize device discovery and to protect the list of
+	 * discovered devices.
+	 *
+	 * The mutex must be locked before the device registry mutex if both
+	 * are required.
+	 */
+	struct mutex discovery_mutex;
+	/**
+	 * Registered USB device instances indexed by their libusb device
+	 * instance.
+	 *
+	 * The registry is used to prevent multiple device instances for the
+	 * same device.
+	 */
+	struct hash_table devs_by_usb;
+	/** Registered device instances indexed by their serial number. */
+	struct hash_table devs_by_serial;
+	/** Registered TCP/IP device instances indexed by their MAC address. */
+	struct hash_table devs_by_mac;
+	/**
+	 * Pool of device instances.
 	 *
-	 * Used to prevent multiple device instances for the same device.
+	 * The pool is protected by the device registry mutex.
 	 */
-	struct list *devs;
+	struct pool devs_pool;
 	/** List of recently discovered devices. */
 	struct list *discovered_devs;
+	/** Number of recently discovered devices. */
+	size_t num_discovered_devs;
+	/**
+	 * Pool of list items for the list of discovered devices.
+	 *
+	 * The pool is protected by the discovery mutex.
+	 */
+	struct pool discovery_pool;
 	/** Current log level. */
 	enum jaylink_log_level log_level;
 	/** Log callback function. */
 	jaylink_log_callback log_callback;
 	/** User data to be passed to the log callback function. */
 	void *log_callback_data;
+	/** Structured log callback function, or NULL if not used. */
+	jaylink_log_message_callback log_message_callback;
+	/** User data to be passed to the structured log callback function. */
+	void *log_message_callback_data;
 	/** Log domain. */
 	char log_domain[JAYLINK_LOG_DOMAIN_MAX_LENGTH + 1];
+	/** Indicates whether device handles cache device information. */
+	bool info_cache;
+	/**
+	 * Unicast targets of the TCP/IP device discovery.
+	 *
+	 * If no targets are set, a broadcast discovery message is used.
+	 */
+	struct tcp_target *tcp_targets;
+	/** Number of unicast targets of the TCP/IP device discovery. */
+	size_t num_tcp_targets;
+	/**
+	 * Serial numbers which stop the TCP/IP device discovery once all of
+	 * them have been discovered.
+	 */
+	uint32_t *tcp_stop_serial_numbers;
+	/** Number of serial numbers which stop the TCP/IP device discovery. */
+	size_t num_tcp_stop_serial_numbers;
+	/**
+	 * Number of devices which stop the TCP/IP device discovery once they
+	 * have been discovered, or 0 for no limit.
+	 */
+	size_t tcp_stop_num_devices;
+	/**
+	 * Idle TCP/IP connections which are kept open for reuse, ordered from
+	 * the least to the most recently released connection.
+	 *
+	 * The connections are protected by the device registry mutex.
+	 */
+	struct tcp_connection *tcp_connections;
+	/** Number of idle TCP/IP connections. */
+	size_t num_tcp_connections;
+	/**
+	 * Maximum number of idle TCP/IP connections, or 0 if connections are
+	 * not kept open.
+	 */
+	size_t max_tcp_connections;
+	/**
+	 * Time in milliseconds after which an idle TCP/IP connection is not
+	 * reused anymore, or 0 for no limit.
+	 */
+	unsigned int tcp_idle_timeout;
+	/**
+	 * Number of connection retries if the maximum number of connections
+	 * on a TCP/IP device is reached.
+	 */
+	unsigned int tcp_connect_retries;
+	/** Delay before the first connection retry in milliseconds. */
+	unsigned int tcp_connect_retry_delay;
 };
 
 struct jaylink_device {
@@ -148,6 +423,49 @@ struct jaylink_device {
 	struct jaylink_hardware_version hw_version;
 	/** Indicates whether the hardware version is available. */
 	bool has_hw_version;
+	/** Indicates whether the device instance is in the registry. */
+	bool registered;
+	/** Indicates whether the device is in the list of discovered devices. */
+	bool discovered;
+	/**
+	 * Name of the capture file.
+	 *
+	 * This field is used for devices with host interface
+	 * #JAYLINK_HIF_REPLAY only.
+	 */
+	char *filename;
+};
+
+struct device_info {
+	/** Indicates whether the capabilities are available. */
+	bool has_caps;
+	/** Capabilities. */
+	uint8_t caps[JAYLINK_DEV_CAPS_SIZE];
+	/** Indicates whether the extended capabilities are available. */
+	bool has_ext_caps;
+	/** Extended capabilities. */
+	uint8_t ext_caps[JAYLINK_DEV_EXT_CAPS_SIZE];
+	/** Indicates whether the firmware version is available. */
+	bool has_firmware_version;
+	/**
+	 * Firmware version string including trailing null-terminator, or NULL
+	 * if the device has no firmware version string.
+	 */
+	char *firmware_version;
+	/** Length of the firmware version string. */
+	size_t firmware_version_length;
+	/** Indicates whether the hardware version is available. */
+	bool has_hw_version;
+	/** Hardware version. */
+	struct jaylink_hardware_version hw_version;
+	/** Indicates whether the speed information is available. */
+	bool has_speed;
+	/**
+	 * Speed information.
+	 *
+	 * The speed information depends on the selected target interface.
+	 */
+	struct jaylink_speed speed;
 };
 
 struct jaylink_device_handle {
@@ -180,6 +498,13 @@ struct jaylink_device_handle {
 	 * write operations only.
 	 */
 	size_t write_pos;
+	/**
+	 * Indicates whether a batch of write operations is active.
+	 *
+	 * During a batch, the data of write operations is collected in the
+	 * buffer and sent to the device at the end of the batch only.
+	 */
+	bool batch;
 #ifdef HAVE_LIBUSB
 	/** libusb device handle. */
 	struct libusb_device_handle *usb_devh;
@@ -189,7 +514,99 @@ struct jaylink_device_handle {
 	uint8_t endpoint_in;
 	/** USB interface OUT endpoint of the device. */
 	uint8_t endpoint_out;
+	/** Maximum number of concurrent USB transfers. */
+	size_t num_transfers;
+	/** Maximum packet size of the USB interface endpoints in bytes. */
+	uint16_t max_packet_size;
+	/**
+	 * Chunk size in bytes in which data is transferred.
+	 *
+	 * The chunk size is always a multiple of the maximum packet size.
+	 */
+	size_t chunk_size;
+	/** Chunk size in bytes for the speed of the USB connection. */
+	size_t default_chunk_size;
+	/**
+	 * Estimated throughput of the USB connection in bytes per millisecond.
+	 */
+	size_t throughput;
+	/** Base timeout of an USB transfer in milliseconds. */
+	unsigned int timeout;
+	/**
+	 * Number of consecutive timeouts before an USB transfer will be
+	 * treated as timed out.
+	 */
+	unsigned int num_timeouts;
+	/** USB transfers for asynchronous data transfers. */
+	struct libusb_transfer *transfers[JAYLINK_USB_MAX_TRANSFERS];
+	/**
+	 * USB transfer to receive data without blocking, see
+	 * transport_poll_read().
+	 */
+	struct libusb_transfer *poll_transfer;
+	/** Indicates whether the poll transfer is submitted. */
+	bool poll_pending;
+	/** Indicates whether the poll transfer is completed. */
+	int poll_completed;
 #endif
+	/** SWO stream, or NULL if no stream is active. */
+	struct swo_stream *swo_stream;
+	/** EMUCOM poller, or NULL if no poller is active. */
+	struct emucom_poller *emucom_poller;
+	/** Hardware status monitor, or NULL if no monitor is active. */
+	struct monitor *monitor;
+	/**
+	 * Recursive mutex to serialize the commands of the device handle.
+	 *
+	 * The mutex is locked for the entire duration of a command such that
+	 * background threads, for example the hardware status monitor, can
+	 * use the device handle between the commands of the application.
+	 */
+	struct mutex io_mutex;
+	/**
+	 * Input / output statistics.
+	 *
+	 * The counters are accessed atomically because they are updated by
+	 * background threads as well.
+	 */
+	struct jaylink_io_stats io_stats;
+	/**
+	 * Statistics of the protocol commands, indexed by the command opcode,
+	 * or NULL if they are not enabled.
+	 */
+	struct jaylink_command_stats *command_stats;
+	/** Mutex to protect the statistics of the protocol commands. */
+	struct mutex stats_mutex;
+	/** Indicates whether the latency of a command is being measured. */
+	bool cmd_active;
+	/** Indicates whether the opcode of the measured command is known. */
+	bool cmd_has_opcode;
+	/** Opcode of the measured command. */
+	uint8_t cmd_opcode;
+	/** Start time of the measured command in microseconds. */
+	uint64_t cmd_start;
+	/** Time of the last completed input / output operation. */
+	uint64_t last_io;
+	/** Active capture, or NULL if no capture is active. */
+	struct capture *capture;
+	/** Indicates whether device information is cached. */
+	bool info_cache;
+	/** Cached device information. */
+	struct device_info info;
+	/**
+	 * Replay data.
+	 *
+	 * This field is used for devices with host interface
+	 * #JAYLINK_HIF_REPLAY only.
+	 */
+	struct replay_data *replay;
+	/**
+	 * Emulator data.
+	 *
+	 * This field is used for devices with host interface
+	 * #JAYLINK_HIF_EMULATOR only.
+	 */
+	struct emulator_data *emulator;
 	/**
 	 * Socket descriptor.
 	 *
@@ -197,6 +614,384 @@ struct jaylink_device_handle {
 	 * only.
 	 */
 	int sock;
+	/**
+	 * Operation mode of the TCP/IP transport.
+	 *
+	 * This field is used for devices with host interface #JAYLINK_HIF_TCP
+	 * only.
+	 */
+	enum jaylink_tcp_mode tcp_mode;
+	/**
+	 * Original size of the socket send buffer in bytes, or 0 if unknown.
+	 *
+	 * This field is used for devices with host interface #JAYLINK_HIF_TCP
+	 * only.
+	 */
+	int tcp_send_buffer_size;
+	/**
+	 * Original size of the socket receive buffer in bytes, or 0 if
+	 * unknown.
+	 *
+	 * This field is used for devices with host interface #JAYLINK_HIF_TCP
+	 * only.
+	 */
+	int tcp_recv_buffer_size;
+};
+
+struct ringbuffer {
+	/** Buffer. */
+	uint8_t *buffer;
+	/** Buffer size in bytes, always a power of two. */
+	size_t size;
+	/** Read position, modified by the consumer only. */
+	size_t read_pos;
+	/** Write position, modified by the producer only. */
+	size_t write_pos;
+};
+
+struct swo_stream {
+	/** Device handle. */
+	struct jaylink_device_handle *devh;
+	/** Capture thread. */
+	struct thread thread;
+	/** Ring buffer for the captured data if no callback is used. */
+	struct ringbuffer ringbuffer;
+	/** Buffer for the captured data if a callback is used. */
+	uint8_t *buffer;
+	/** Size of the buffer in bytes. */
+	size_t buffer_size;
+	/** Callback function for captured data, or NULL. */
+	jaylink_swo_stream_callback callback;
+	/** User data to be passed to the callback function. */
+	void *user_data;
+	/** Polling interval in microseconds. */
+	uint32_t interval;
+	/** Indicates whether the capture thread should terminate. */
+	bool stop;
+	/** Status of the capture thread. */
+	int status;
+};
+
+/** Polled EMUCOM channel. */
+struct emucom_channel {
+	/** Channel number. */
+	uint32_t number;
+	/** Ring buffer for the received data. */
+	struct ringbuffer ringbuffer;
+	/** Number of bytes to be requested with the next read. */
+	uint32_t request;
+	/** Status of the channel. */
+	int status;
+};
+
+struct emucom_poller {
+	/** Device handle. */
+	struct jaylink_device_handle *devh;
+	/** Poller thread. */
+	struct thread thread;
+	/** Polled channels. */
+	struct emucom_channel channels[JAYLINK_EMUCOM_MAX_BATCH];
+	/** Number of polled channels. */
+	size_t num_channels;
+	/** Minimum polling interval in microseconds. */
+	uint32_t min_interval;
+	/** Maximum polling interval in microseconds. */
+	uint32_t max_interval;
+	/** Indicates whether the poller thread should terminate. */
+	bool stop;
+	/** Status of the poller thread. */
+	int status;
+};
+
+struct monitor {
+	/** Device handle. */
+	struct jaylink_device_handle *devh;
+	/** Sampling thread. */
+	struct thread thread;
+	/**
+	 * Mutex which protects the samples, the aggregates and the thresholds.
+	 */
+	struct mutex mutex;
+	/** Ring buffer of samples. */
+	struct jaylink_monitor_sample *samples;
+	/** Maximum number of samples in the ring buffer. */
+	size_t max_samples;
+	/** Number of samples in the ring buffer. */
+	size_t num_samples;
+	/** Position of the next sample in the ring buffer. */
+	size_t pos;
+	/** Sum of the target voltages of all aggregated samples in mV. */
+	uint64_t voltage_sum;
+	/** Aggregates of the target voltage. */
+	struct jaylink_monitor_stats stats;
+	/** Lower threshold of the target voltage in mV. */
+	uint16_t lower_threshold;
+	/** Upper threshold of the target voltage in mV. */
+	uint16_t upper_threshold;
+	/**
+	 * Indicates whether the target voltage dropped below the lower
+	 * threshold and did not recover to the upper threshold yet.
+	 */
+	bool below;
+	/** Callback function for threshold crossings, or NULL. */
+	jaylink_monitor_callback callback;
+	/** User data to be passed to the callback function. */
+	void *user_data;
+	/** Sampling interval in microseconds. */
+	uint32_t interval;
+	/** Start time of the monitor, see util_get_timestamp(). */
+	uint64_t start;
+	/** Indicates whether the sampling thread should terminate. */
+	bool stop;
+	/** Status of the sampling thread. */
+	int status;
+};
+
+/** Capture event types. */
+enum capture_event_type {
+	/** Start of a write operation. */
+	CAPTURE_EVENT_START_WRITE = 0x01,
+	/** Start of a read operation. */
+	CAPTURE_EVENT_START_READ = 0x02,
+	/** Start of a write and read operation. */
+	CAPTURE_EVENT_START_WRITE_READ = 0x03,
+	/** Written data. */
+	CAPTURE_EVENT_WRITE = 0x04,
+	/** Read data. */
+	CAPTURE_EVENT_READ = 0x05,
+	/** Events were dropped and the capture is incomplete. */
+	CAPTURE_EVENT_DROPPED = 0x06
+};
+
+struct capture {
+	/** Capture file. */
+	FILE *file;
+	/** Buffer for the events to be written into the capture file. */
+	struct ringbuffer ringbuffer;
+	/** Thread which writes the events into the capture file. */
+	struct thread thread;
+	/** Start time of the capture in microseconds. */
+	uint64_t start;
+	/** Opcode of the current command. */
+	uint8_t opcode;
+	/** Indicates whether the opcode is taken from the next written data. */
+	bool opcode_pending;
+	/** Number of dropped events. */
+	size_t num_dropped;
+	/** Indicates whether the thread should terminate. */
+	bool stop;
+	/** Indicates whether writing into the capture file failed. */
+	bool error;
+};
+
+struct tcp_discovery {
+	/** Socket descriptor of the discovery. */
+	int sock;
+	/** Timestamp at which the discovery ends, see util_get_timestamp(). */
+	uint64_t deadline;
+	/** Number of discovered devices. */
+	size_t num_devs;
+	/** Indicates which serial numbers of the stop condition were found. */
+	bool *found;
+	/** Number of serial numbers of the stop condition which were found. */
+	size_t num_found;
+};
+
+#ifdef HAVE_LIBUSB
+struct hotplug_event {
+	/** libusb device instance. */
+	struct libusb_device *usb_dev;
+	/** Indicates whether the device arrived or left. */
+	bool arrived;
+};
+#endif
+
+struct replay_data {
+	/** Captured data written to the device. */
+	uint8_t *write_data;
+	/** Length of the captured data written to the device. */
+	size_t write_length;
+	/** Current position in the captured data written to the device. */
+	size_t write_pos;
+	/** Captured data read from the device. */
+	uint8_t *read_data;
+	/** Length of the captured data read from the device. */
+	size_t read_length;
+	/** Current position in the captured data read from the device. */
+	size_t read_pos;
+};
+
+enum emulator_state {
+	/** Next write operation contains a command. */
+	EMULATOR_STATE_COMMAND,
+	/** Next write operation contains data to be written into the file. */
+	EMULATOR_STATE_FILE_WRITE,
+	/** Next write operation contains data to be written via EMUCOM. */
+	EMULATOR_STATE_EMUCOM_WRITE
+};
+
+struct emulator_data {
+	/** Response data not read yet. */
+	uint8_t *response;
+	/** Size of the response buffer. */
+	size_t response_size;
+	/** Length of the response data. */
+	size_t response_length;
+	/** Current position in the response data. */
+	size_t response_pos;
+	/** Interpretation of the next write operation. */
+	enum emulator_state state;
+	/** Device capabilities. */
+	uint8_t caps[JAYLINK_DEV_EXT_CAPS_SIZE];
+	/** Selected target interface. */
+	uint32_t tif;
+	/** Content of the file. */
+	uint8_t *file;
+	/** Size of the file buffer. */
+	size_t file_size;
+	/** Length of the file. */
+	size_t file_length;
+	/** Offset of the current file write operation. */
+	size_t file_offset;
+	/** EMUCOM data written but not read yet. */
+	uint8_t *emucom;
+	/** Size of the EMUCOM buffer. */
+	size_t emucom_size;
+	/** Length of the EMUCOM data. */
+	size_t emucom_length;
+	/** Value of the next SWO data byte. */
+	uint8_t swo_counter;
+};
+
+/** Trailer of a command response after the response data. */
+enum queue_trailer {
+	/** No trailer. */
+	QUEUE_TRAILER_NONE,
+	/** Status byte of an I/O operation. */
+	QUEUE_TRAILER_STATUS,
+	/** Number of transferred bytes encoded in 4 bytes. */
+	QUEUE_TRAILER_COUNT,
+	/** Error code encoded in 4 bytes, zero on success. */
+	QUEUE_TRAILER_ERROR
+};
+
+/** Status of a command response in front of data with a variable length. */
+enum queue_status {
+	/** No status, the length of the response data is fixed. */
+	QUEUE_STATUS_NONE,
+	/** SWO status and number of data bytes, each encoded in 4 bytes. */
+	QUEUE_STATUS_SWO,
+	/** EMUCOM status or number of data bytes, encoded in 4 bytes. */
+	QUEUE_STATUS_EMUCOM
+};
+
+struct queue_command {
+	/** Command header. */
+	uint8_t header[20];
+	/** Length of the command header in bytes. */
+	size_t header_length;
+	/** Buffers to read the command data from. */
+	const uint8_t *data[2];
+	/** Number of data buffers. */
+	size_t num_data;
+	/** Length of each data buffer in bytes. */
+	size_t data_length;
+	/** Buffer to store the response data. */
+	uint8_t *response;
+	/**
+	 * Length of the response data in bytes, excluding the trailer.
+	 */
+	size_t response_length;
+	/** Trailer of the response. */
+	enum queue_trailer trailer;
+	/**
+	 * Status of the response. If set, @a response_length is the maximum
+	 * length of the response data.
+	 */
+	enum queue_status status;
+	/** Number of received response data bytes of a status response. */
+	uint32_t *length;
+	/** EMUCOM channel of the command. */
+	uint32_t channel;
+	/** Expected number of transferred bytes of a count trailer. */
+	uint32_t count;
+	/**
+	 * Indicates whether the single response byte is stored into @a value
+	 * instead of the response buffer.
+	 */
+	bool has_value;
+	/** Response byte if @a has_value is set. */
+	uint8_t value;
+	/** Indicates whether the response byte is a polled status. */
+	bool poll;
+	/** Bitmask of the polled status bits. */
+	uint8_t poll_mask;
+	/** Expected value of the polled status bits. */
+	uint8_t poll_value;
+	/** Result of the command. */
+	int result;
+};
+
+struct jaylink_device_snapshot {
+	/** Device instances, each of them referenced by the snapshot. */
+	struct jaylink_device **devs;
+	/** Number of device instances. */
+	size_t num_devs;
+	/** Number of device instances the snapshot can hold. */
+	size_t capacity;
+};
+
+/** Maximum size of an ITM packet in bytes. */
+#define ITM_MAX_PACKET_SIZE	7
+
+struct jaylink_itm_decoder {
+	/** Event types which are decoded. */
+	uint32_t types;
+	/** Stimulus ports which are decoded. */
+	uint32_t ports;
+	/** Indicates whether the decoder is synchronized to the packets. */
+	bool synced;
+	/**
+	 * Number of zero bytes at the end of the previously processed data
+	 * while the decoder searches for a synchronization packet.
+	 */
+	size_t num_zeros;
+	/** Incomplete packet at the end of the previously processed data. */
+	uint8_t packet[ITM_MAX_PACKET_SIZE];
+	/** Length of the incomplete packet in bytes. */
+	size_t packet_length;
+};
+
+struct jaylink_queue {
+	/** Device handle. */
+	struct jaylink_device_handle *devh;
+	/** Commands. */
+	struct queue_command *commands;
+	/** Number of commands. */
+	size_t num_commands;
+	/** Number of commands the queue can hold without reallocation. */
+	size_t capacity;
+	/** Indicates whether the queue is submitted and not completed yet. */
+	bool submitted;
+	/** Index of the first command whose response is not processed yet. */
+	size_t first;
+	/** Number of commands sent to the device with pending responses. */
+	size_t num_pending;
+	/** Length of the pending responses in bytes. */
+	size_t pending_length;
+};
+
+/**
+ * I/O vector.
+ *
+ * Describes a memory segment of a vectored I/O operation. For write operations,
+ * the data of the segment is not modified.
+ */
+struct io_vector {
+	/** Start of the segment. */
+	void *buffer;
+	/** Length of the segment in bytes. */
+	size_t length;
 };
 
 struct list {
@@ -214,19 +1009,78 @@ JAYLINK_PRIV uint16_t buffer_get_u16(const uint8_t *buffer, size_t offset);
 JAYLINK_PRIV void buffer_set_u32(uint8_t *buffer, uint32_t value,
 		size_t offset);
 JAYLINK_PRIV uint32_t buffer_get_u32(const uint8_t *buffer, size_t offset);
+JAYLINK_PRIV void buffer_set_u64(uint8_t *buffer, uint64_t value,
+		size_t offset);
+JAYLINK_PRIV uint64_t buffer_get_u64(const uint8_t *buffer, size_t offset);
+
+/*--- capture.c -------------------------------------------------------------*/
+
+JAYLINK_PRIV void capture_start_write(struct jaylink_device_handle *devh,
+		size_t length, bool has_command);
+JAYLINK_PRIV void capture_start_read(struct jaylink_device_handle *devh,
+		size_t length);
+JAYLINK_PRIV void capture_start_write_read(struct jaylink_device_handle *devh,
+		size_t write_length, size_t read_length, bool has_command);
+JAYLINK_PRIV void capture_write(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV void capture_read(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int capture_stop(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int capture_load(struct jaylink_context *ctx,
+		const char *filename, struct replay_data *replay);
 
 /*--- device.c --------------------------------------------------------------*/
 
 JAYLINK_PRIV struct jaylink_device *device_allocate(
 		struct jaylink_context *ctx);
+JAYLINK_PRIV bool device_register(struct jaylink_device *dev);
+JAYLINK_PRIV struct jaylink_device *device_find_usb(
+		struct jaylink_context *ctx, const void *usb_dev);
+JAYLINK_PRIV struct jaylink_device *device_find_mac(
+		struct jaylink_context *ctx, const uint8_t *mac_address,
+		list_compare_callback callback, const void *user_data);
+
+/*--- discovery.c -----------------------------------------------------------*/
+
+JAYLINK_PRIV void discovery_add_device(struct jaylink_context *ctx,
+		struct jaylink_device *dev);
 
 /*--- discovery_tcp.c -------------------------------------------------------*/
 
-JAYLINK_PRIV int discovery_tcp_scan(struct jaylink_context *ctx);
+JAYLINK_PRIV int discovery_tcp_start(struct jaylink_context *ctx,
+		struct tcp_discovery *disc);
+JAYLINK_PRIV int discovery_tcp_finish(struct jaylink_context *ctx,
+		struct tcp_discovery *disc);
+JAYLINK_PRIV void discovery_tcp_cancel(struct tcp_discovery *disc);
 
 /*--- discovery_usb.c -------------------------------------------------------*/
 
 JAYLINK_PRIV int discovery_usb_scan(struct jaylink_context *ctx);
+JAYLINK_PRIV int discovery_usb_enable_hotplug(struct jaylink_context *ctx);
+JAYLINK_PRIV void discovery_usb_disable_hotplug(struct jaylink_context *ctx);
+JAYLINK_PRIV void discovery_usb_free_hotplug_events(
+		struct jaylink_context *ctx);
+JAYLINK_PRIV int discovery_usb_wait_events(struct jaylink_context *ctx,
+		uint32_t timeout);
+JAYLINK_PRIV void discovery_usb_process_events(struct jaylink_context *ctx);
+
+/*--- emucom.c --------------------------------------------------------------*/
+
+JAYLINK_PRIV int emucom_check_read_status(struct jaylink_context *ctx,
+		uint32_t channel, uint32_t status, uint32_t *length);
+JAYLINK_PRIV void emucom_stop_polling(struct jaylink_device_handle *devh);
+
+/*--- hashtable.c -----------------------------------------------------------*/
+
+JAYLINK_PRIV void hash_table_init(struct hash_table *table);
+JAYLINK_PRIV void hash_table_free(struct hash_table *table);
+JAYLINK_PRIV bool hash_table_insert(struct hash_table *table, uint64_t key,
+		void *data);
+JAYLINK_PRIV void hash_table_remove(struct hash_table *table, uint64_t key,
+		const void *data);
+JAYLINK_PRIV void *hash_table_find(const struct hash_table *table,
+		uint64_t key, list_compare_callback callback,
+		const void *user_data);
 
 /*--- list.c ----------------------------------------------------------------*/
 
@@ -242,17 +1096,38 @@ JAYLINK_PRIV void list_free(struct list *list);
 JAYLINK_PRIV int log_vprintf(const struct jaylink_context *ctx,
 		enum jaylink_log_level level, const char *format, va_list args,
 		void *user_data);
-JAYLINK_PRIV void log_err(const struct jaylink_context *ctx,
-		const char *format, ...);
-JAYLINK_PRIV void log_warn(const struct jaylink_context *ctx,
-		const char *format, ...);
-JAYLINK_PRIV void log_info(const struct jaylink_context *ctx,
-		const char *format, ...);
-JAYLINK_PRIV void log_dbg(const struct jaylink_context *ctx,
-		const char *format, ...);
-JAYLINK_PRIV void log_dbgio(const struct jaylink_context *ctx,
+JAYLINK_PRIV void log_message(const struct jaylink_context *ctx,
+		enum jaylink_log_level level, const char *function,
 		const char *format, ...);
 
+/*--- monitor.c -------------------------------------------------------------*/
+
+JAYLINK_PRIV void monitor_stop(struct jaylink_device_handle *devh);
+
+/*--- pool.c ----------------------------------------------------------------*/
+
+JAYLINK_PRIV void pool_init(struct pool *pool, size_t object_size,
+		size_t max_objects);
+JAYLINK_PRIV void *pool_alloc(struct pool *pool);
+JAYLINK_PRIV void pool_release(struct pool *pool, void *object);
+JAYLINK_PRIV void pool_free(struct pool *pool);
+
+/*--- ringbuffer.c ----------------------------------------------------------*/
+
+JAYLINK_PRIV bool ringbuffer_init(struct ringbuffer *rb, size_t size);
+JAYLINK_PRIV void ringbuffer_free(struct ringbuffer *rb);
+JAYLINK_PRIV size_t ringbuffer_get_length(const struct ringbuffer *rb);
+JAYLINK_PRIV size_t ringbuffer_get_write_area(const struct ringbuffer *rb,
+		uint8_t **data);
+JAYLINK_PRIV void ringbuffer_commit(struct ringbuffer *rb, size_t length);
+JAYLINK_PRIV size_t ringbuffer_write(struct ringbuffer *rb,
+		const uint8_t *data, size_t length);
+JAYLINK_PRIV size_t ringbuffer_get_read_area(const struct ringbuffer *rb,
+		const uint8_t **data);
+JAYLINK_PRIV void ringbuffer_consume(struct ringbuffer *rb, size_t length);
+JAYLINK_PRIV size_t ringbuffer_read(struct ringbuffer *rb, uint8_t *data,
+		size_t length);
+
 /*--- socket.c --------------------------------------------------------------*/
 
 JAYLINK_PRIV int socket_connect(int sock, const struct sockaddr *address,
@@ -264,6 +1139,10 @@ JAYLINK_PRIV bool socket_send(int sock, const void *buffer, size_t *length,
 		int flags);
 JAYLINK_PRIV bool socket_recv(int sock, void *buffer, size_t *length,
 		int flags);
+JAYLINK_PRIV bool socket_sendv(int sock, const struct io_vector *iov,
+		size_t count, size_t *length, int flags);
+JAYLINK_PRIV bool socket_recvv(int sock, const struct io_vector *iov,
+		size_t count, size_t *length, int flags);
 JAYLINK_PRIV bool socket_sendto(int sock, const void *buffer, size_t *length,
 		int flags, const struct sockaddr *address,
 		size_t address_length);
@@ -274,11 +1153,37 @@ JAYLINK_PRIV bool socket_get_option(int sock, int level, int option,
 JAYLINK_PRIV bool socket_set_option(int sock, int level, int option,
 		const void *value, size_t length);
 JAYLINK_PRIV bool socket_set_blocking(int sock, bool blocking);
+JAYLINK_PRIV bool socket_is_readable(int sock, bool *readable);
+
+/*--- stats.c ---------------------------------------------------------------*/
+
+JAYLINK_PRIV void stats_start_command(struct jaylink_device_handle *devh);
+JAYLINK_PRIV void stats_set_opcode(struct jaylink_device_handle *devh,
+		uint8_t opcode);
+JAYLINK_PRIV void stats_finish_command(struct jaylink_device_handle *devh);
+
+/*--- swo.c -----------------------------------------------------------------*/
+
+JAYLINK_PRIV void swo_stop_stream(struct jaylink_device_handle *devh);
+
+/*--- thread.c --------------------------------------------------------------*/
+
+JAYLINK_PRIV bool thread_create(struct thread *thread,
+		thread_function function, void *arg);
+JAYLINK_PRIV bool thread_join(struct thread *thread);
+JAYLINK_PRIV void thread_sleep(uint32_t usecs);
+JAYLINK_PRIV bool mutex_init(struct mutex *mutex);
+JAYLINK_PRIV bool mutex_init_recursive(struct mutex *mutex);
+JAYLINK_PRIV void mutex_destroy(struct mutex *mutex);
+JAYLINK_PRIV void mutex_lock(struct mutex *mutex);
+JAYLINK_PRIV void mutex_unlock(struct mutex *mutex);
 
 /*--- transport.c -----------------------------------------------------------*/
 
 JAYLINK_PRIV int transport_open(struct jaylink_device_handle *devh);
 JAYLINK_PRIV int transport_close(struct jaylink_device_handle *devh);
+JAYLINK_PRIV void transport_lock(struct jaylink_device_handle *devh);
+JAYLINK_PRIV void transport_unlock(struct jaylink_device_handle *devh);
 JAYLINK_PRIV int transport_start_write_read(struct jaylink_device_handle *devh,
 		size_t write_length, size_t read_length, bool has_command);
 JAYLINK_PRIV int transport_start_write(struct jaylink_device_handle *devh,
@@ -289,6 +1194,17 @@ JAYLINK_PRIV int transport_write(struct jaylink_device_handle *devh,
 		const uint8_t *buffer, size_t length);
 JAYLINK_PRIV int transport_read(struct jaylink_device_handle *devh,
 		uint8_t *buffer, size_t length);
+JAYLINK_PRIV int transport_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_start_batch(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_end_batch(struct jaylink_device_handle *devh);
+JAYLINK_PRIV void transport_cancel_batch(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_poll_read(struct jaylink_device_handle *devh,
+		bool *ready);
+JAYLINK_PRIV int transport_get_pollfds(struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count);
 
 /*--- transport_usb.c -------------------------------------------------------*/
 
@@ -305,6 +1221,18 @@ JAYLINK_PRIV int transport_usb_write(struct jaylink_device_handle *devh,
 		const uint8_t *buffer, size_t length);
 JAYLINK_PRIV int transport_usb_read(struct jaylink_device_handle *devh,
 		uint8_t *buffer, size_t length);
+JAYLINK_PRIV int transport_usb_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_usb_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_usb_flush(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_usb_set_chunk_size(
+		struct jaylink_device_handle *devh, size_t size);
+JAYLINK_PRIV int transport_usb_poll_read(struct jaylink_device_handle *devh,
+		bool *ready);
+JAYLINK_PRIV int transport_usb_get_pollfds(
+		struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count);
 
 /*--- transport_tcp.c -------------------------------------------------------*/
 
@@ -321,5 +1249,57 @@ JAYLINK_PRIV int transport_tcp_write(struct jaylink_device_handle *devh,
 		const uint8_t *buffer, size_t length);
 JAYLINK_PRIV int transport_tcp_read(struct jaylink_device_handle *devh,
 		uint8_t *buffer, size_t length);
+JAYLINK_PRIV int transport_tcp_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_tcp_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_tcp_flush(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_tcp_set_mode(struct jaylink_device_handle *devh,
+		enum jaylink_tcp_mode mode);
+JAYLINK_PRIV int transport_tcp_poll_read(struct jaylink_device_handle *devh,
+		bool *ready);
+JAYLINK_PRIV int transport_tcp_get_pollfds(
+		struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count);
+JAYLINK_PRIV int transport_tcp_set_max_connections(
+		struct jaylink_context *ctx, size_t max_connections);
+
+/*--- transport_replay.c ----------------------------------------------------*/
+
+JAYLINK_PRIV int transport_replay_open(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_replay_close(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_replay_start_write_read(
+		struct jaylink_device_handle *devh, size_t write_length,
+		size_t read_length, bool has_command);
+JAYLINK_PRIV int transport_replay_start_write(
+		struct jaylink_device_handle *devh, size_t length,
+		bool has_command);
+JAYLINK_PRIV int transport_replay_start_read(
+		struct jaylink_device_handle *devh, size_t length);
+JAYLINK_PRIV int transport_replay_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_replay_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+
+/*--- transport_emulator.c --------------------------------------------------*/
+
+JAYLINK_PRIV int transport_emulator_open(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_emulator_close(struct jaylink_device_handle *devh);
+JAYLINK_PRIV int transport_emulator_start_write_read(
+		struct jaylink_device_handle *devh, size_t write_length,
+		size_t read_length, bool has_command);
+JAYLINK_PRIV int transport_emulator_start_write(
+		struct jaylink_device_handle *devh, size_t length,
+		bool has_command);
+JAYLINK_PRIV int transport_emulator_start_read(
+		struct jaylink_device_handle *devh, size_t length);
+JAYLINK_PRIV int transport_emulator_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+JAYLINK_PRIV int transport_emulator_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count);
+
+/*--- util.c ----------------------------------------------------------------*/
+
+JAYLINK_PRIV uint64_t util_get_timestamp(void);
 
 #endif /* LIBJAYLINK_LIBJAYLINK_INTERNAL_H */
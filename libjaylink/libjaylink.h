@@ -103,7 +103,42 @@ enum jaylink_host_interface {
 	/** Universal Serial Bus (USB). */
 	JAYLINK_HIF_USB = (1 << 0),
 	/** Transmission Control Protocol (TCP). */
-	JAYLINK_HIF_TCP = (1 << 1)
+	JAYLINK_HIF_TCP = (1 << 1),
+	/**
+	 * Replay of a capture file.
+	 *
+	 * Devices with this virtual host interface are never discovered and
+	 * can be opened with jaylink_replay_open() only.
+	 */
+	JAYLINK_HIF_REPLAY = (1 << 2),
+	/**
+	 * In-memory emulator.
+	 *
+	 * Devices with this virtual host interface are never discovered and
+	 * can be opened with jaylink_emulator_open() only.
+	 */
+	JAYLINK_HIF_EMULATOR = (1 << 3)
+};
+
+/** Hotplug events. */
+enum jaylink_hotplug_event {
+	/** Device arrived. */
+	JAYLINK_HOTPLUG_EVENT_ARRIVED = 0,
+	/** Device left. */
+	JAYLINK_HOTPLUG_EVENT_LEFT = 1
+};
+
+/** Operation modes of the TCP/IP transport. */
+enum jaylink_tcp_mode {
+	/** Default mode using the socket settings of the operating system. */
+	JAYLINK_TCP_MODE_DEFAULT = 0,
+	/**
+	 * Latency-optimized mode.
+	 *
+	 * Data is sent to the device without delay (Nagle's algorithm is
+	 * disabled) and larger socket buffers are used.
+	 */
+	JAYLINK_TCP_MODE_LOW_LATENCY = 1
 };
 
 /**
@@ -270,12 +305,48 @@ enum jaylink_jtag_version {
 	JAYLINK_JTAG_VERSION_3 = 2
 };
 
+/** Serial Wire Debug (SWD) acknowledge responses. */
+enum jaylink_swd_ack {
+	/** Transaction was accepted. */
+	JAYLINK_SWD_ACK_OK = 0x01,
+	/** Target is busy and the transaction must be repeated. */
+	JAYLINK_SWD_ACK_WAIT = 0x02,
+	/** Target reported an error condition. */
+	JAYLINK_SWD_ACK_FAULT = 0x04
+};
+
 /** Serial Wire Output (SWO) capture modes. */
 enum jaylink_swo_mode {
 	/** Universal Asynchronous Receiver Transmitter (UART). */
 	JAYLINK_SWO_MODE_UART = 0
 };
 
+/** Instrumentation Trace Macrocell (ITM) event types. */
+enum jaylink_itm_event_type {
+	/** Write to a stimulus port by software. */
+	JAYLINK_ITM_EVENT_STIMULUS = (1 << 0),
+	/** Hardware source packet which is not decoded otherwise. */
+	JAYLINK_ITM_EVENT_HARDWARE = (1 << 1),
+	/** Periodic program counter (PC) sample. */
+	JAYLINK_ITM_EVENT_PC_SAMPLE = (1 << 2),
+	/** Exception trace. */
+	JAYLINK_ITM_EVENT_EXCEPTION = (1 << 3),
+	/** Local timestamp. */
+	JAYLINK_ITM_EVENT_LOCAL_TIMESTAMP = (1 << 4),
+	/** Global timestamp. */
+	JAYLINK_ITM_EVENT_GLOBAL_TIMESTAMP = (1 << 5),
+	/** Overflow of the trace FIFO on the target. */
+	JAYLINK_ITM_EVENT_OVERFLOW = (1 << 6)
+};
+
+/** Hardware status monitor events. */
+enum jaylink_monitor_event {
+	/** Target voltage dropped below the lower threshold. */
+	JAYLINK_MONITOR_EVENT_BELOW = 0,
+	/** Target voltage recovered to or above the upper threshold. */
+	JAYLINK_MONITOR_EVENT_ABOVE = 1
+};
+
 /** Serial Peripheral Interface (SPI) flags. */
 enum jaylink_spi_flag {
 	/** Do not drive chip select (CS) before the transfer begins. */
@@ -292,6 +363,108 @@ enum jaylink_spi_flag {
 	JAYLINK_SPI_FLAG_CS_END_1 = 0x0c,
 };
 
+/** Serial Peripheral Interface (SPI) flash information. */
+struct jaylink_spi_flash {
+	/** JEDEC manufacturer and device ID. */
+	uint8_t jedec_id[3];
+	/** Size in bytes. */
+	uint64_t size;
+	/** Page size in bytes. */
+	uint32_t page_size;
+	/** Smallest erase size in bytes, or 0 if erase is not supported. */
+	uint32_t erase_size;
+	/** Opcode of the erase operation for the smallest erase size. */
+	uint8_t erase_opcode;
+	/** Number of address bytes, either 3 or 4. */
+	uint8_t address_length;
+};
+
+/** Serial Wire Debug (SWD) transaction. */
+struct jaylink_swd_transaction {
+	/**
+	 * Determines whether the transaction accesses an access port (AP)
+	 * register instead of a debug port (DP) register.
+	 */
+	bool ap;
+	/** Determines whether the transaction is a read access. */
+	bool read;
+	/**
+	 * Register address.
+	 *
+	 * Only the address bits A[3:2] are used, all other bits are ignored.
+	 */
+	uint8_t address;
+	/** Data to be written, or the read data after the transaction. */
+	uint32_t data;
+	/**
+	 * Acknowledge response of the target after the transaction.
+	 *
+	 * The value is one of #jaylink_swd_ack. Other values indicate a
+	 * protocol error, for example if the target does not respond at all.
+	 */
+	uint8_t ack;
+	/**
+	 * Indicates whether the parity of the read data is invalid after the
+	 * transaction.
+	 */
+	bool parity_error;
+};
+
+/** File descriptor to wait for, see jaylink_get_pollfds(). */
+struct jaylink_pollfd {
+	/** File descriptor. */
+	int fd;
+	/** Events to wait for, using the event flags of poll(). */
+	short events;
+};
+
+/** Instrumentation Trace Macrocell (ITM) event. */
+struct jaylink_itm_event {
+	/** Event type. */
+	enum jaylink_itm_event_type type;
+	/**
+	 * Event identifier.
+	 *
+	 * The stimulus port for #JAYLINK_ITM_EVENT_STIMULUS, the discriminator
+	 * ID for #JAYLINK_ITM_EVENT_HARDWARE, the function for
+	 * #JAYLINK_ITM_EVENT_EXCEPTION (1 = entry, 2 = exit, 3 = return), the
+	 * timestamp control (TC) for #JAYLINK_ITM_EVENT_LOCAL_TIMESTAMP and the
+	 * format (1 or 2) for #JAYLINK_ITM_EVENT_GLOBAL_TIMESTAMP.
+	 */
+	uint8_t id;
+	/** Size of the packet payload in bytes. */
+	uint8_t size;
+	/**
+	 * Event value.
+	 *
+	 * The payload for #JAYLINK_ITM_EVENT_STIMULUS and
+	 * #JAYLINK_ITM_EVENT_HARDWARE, the program counter for
+	 * #JAYLINK_ITM_EVENT_PC_SAMPLE or 0 if the target was sleeping, the
+	 * exception number for #JAYLINK_ITM_EVENT_EXCEPTION, the timestamp
+	 * delta for #JAYLINK_ITM_EVENT_LOCAL_TIMESTAMP and the timestamp bits
+	 * of the packet for #JAYLINK_ITM_EVENT_GLOBAL_TIMESTAMP.
+	 */
+	uint32_t value;
+};
+
+/** EMUCOM read of a batch. */
+struct jaylink_emucom_read {
+	/** Channel to read data from. */
+	uint32_t channel;
+	/** Buffer to store read data. */
+	uint8_t *buffer;
+	/**
+	 * Number of bytes to read.
+	 *
+	 * After the read, the number of bytes read, or the number of bytes
+	 * available on the channel if the channel is not available for the
+	 * requested amount of data.
+	 */
+	uint32_t length;
+	/** Status of the read after the batch. */
+	int status;
+};
+
 /** Target interface speed information. */
 struct jaylink_speed {
 	/** Base frequency in Hz. */
@@ -300,6 +473,34 @@ struct jaylink_speed {
 	uint16_t div;
 };
 
+/** Target interface speed calibration parameters. */
+struct jaylink_speed_calibration {
+	/**
+	 * Target interface to calibrate.
+	 *
+	 * Only #JAYLINK_TIF_JTAG and #JAYLINK_TIF_SWD are supported.
+	 */
+	enum jaylink_target_interface iface;
+	/**
+	 * Version of the JTAG command to use.
+	 *
+	 * This field is used for #JAYLINK_TIF_JTAG only.
+	 */
+	enum jaylink_jtag_version jtag_version;
+	/**
+	 * Speed in kHz which is known to work reliably.
+	 *
+	 * The reference for the test patterns is recorded at this speed.
+	 */
+	uint16_t start_speed;
+	/** Maximum speed in kHz to test, or 0 to test up to the maximum speed. */
+	uint16_t max_speed;
+	/** Safety margin in percent, must be less than 100. */
+	uint8_t margin;
+	/** Number of test iterations for each speed, must not be 0. */
+	uint32_t iterations;
+};
+
 /** Serial Wire Output (SWO) speed information. */
 struct jaylink_swo_speed {
 	/** Base frequency in Hz. */
@@ -344,6 +545,26 @@ struct jaylink_hardware_status {
 	bool trst;
 };
 
+/** Hardware status sample of the hardware status monitor. */
+struct jaylink_monitor_sample {
+	/** Time of the sample in microseconds since the monitor was started. */
+	uint64_t timestamp;
+	/** Hardware status. */
+	struct jaylink_hardware_status status;
+};
+
+/** Target voltage aggregates of the hardware status monitor. */
+struct jaylink_monitor_stats {
+	/** Number of samples. */
+	uint64_t count;
+	/** Minimum target voltage in mV. */
+	uint16_t min_voltage;
+	/** Maximum target voltage in mV. */
+	uint16_t max_voltage;
+	/** Mean target voltage in mV. */
+	uint16_t mean_voltage;
+};
+
 /** Device connection. */
 struct jaylink_connection {
 	/** Handle. */
@@ -427,9 +648,70 @@ struct jaylink_connection {
  */
 #define JAYLINK_EMUCOM_CHANNEL_USER	0x10000
 
+/** Maximum number of EMUCOM reads of a batch. */
+#define JAYLINK_EMUCOM_MAX_BATCH	32
+
 /** Maximum length of a 2-wire (C2) interface data transfer. */
 #define JAYLINK_C2_MAX_LENGTH		64
 
+/** Maximum number of concurrent USB transfers of a device handle. */
+#define JAYLINK_USB_MAX_TRANSFERS	16
+
+/** Maximum chunk size in bytes of USB transfers. */
+#define JAYLINK_USB_MAX_CHUNK_SIZE	0x40000
+
+/** Number of buckets of a command latency histogram. */
+#define JAYLINK_LATENCY_BUCKETS		20
+
+/** Number of protocol command opcodes. */
+#define JAYLINK_NUM_COMMANDS		256
+
+/**
+ * Statistics of a protocol command.
+ *
+ * The latency of a command is measured from the start of the command until its
+ * last data is sent to or received from the device. Commands which are
+ * executed with a command queue, see #jaylink_queue, are not included.
+ */
+struct jaylink_command_stats {
+	/** Number of executed commands. */
+	uint64_t count;
+	/** Accumulated latency of all executed commands in microseconds. */
+	uint64_t total_latency;
+	/** Maximum latency of a command in microseconds. */
+	uint64_t max_latency;
+	/**
+	 * Latency histogram.
+	 *
+	 * The first bucket counts commands with a latency of less than 2
+	 * microseconds. Each following bucket n counts commands with a latency
+	 * of at least 2^n microseconds and less than 2^(n+1) microseconds. The
+	 * last bucket also counts all commands with a larger latency.
+	 */
+	uint64_t histogram[JAYLINK_LATENCY_BUCKETS];
+};
+
+/**
+ * Input / output statistics of a device handle.
+ *
+ * Transfers are USB bulk transfers or socket operations, depending on the host
+ * interface of the device.
+ */
+struct jaylink_io_stats {
+	/** Number of bytes sent to the device. */
+	uint64_t bytes_written;
+	/** Number of bytes received from the device. */
+	uint64_t bytes_read;
+	/** Number of transfers to the device. */
+	uint64_t num_writes;
+	/** Number of transfers from the device. */
+	uint64_t num_reads;
+	/** Number of timed out transfers. */
+	uint64_t num_timeouts;
+	/** Number of transfers repeated after a timeout. */
+	uint64_t num_retries;
+};
+
 /**
  * @struct jaylink_context
  *
@@ -451,6 +733,27 @@ struct jaylink_device;
  */
 struct jaylink_device_handle;
 
+/**
+ * @struct jaylink_device_snapshot
+ *
+ * Opaque structure representing a snapshot of available devices.
+ */
+struct jaylink_device_snapshot;
+
+/**
+ * @struct jaylink_queue
+ *
+ * Opaque structure representing a command queue.
+ */
+struct jaylink_queue;
+
+/**
+ * @struct jaylink_itm_decoder
+ *
+ * Opaque structure representing an ITM packet decoder.
+ */
+struct jaylink_itm_decoder;
+
 /** Macro to mark public libjaylink API symbol. */
 #ifdef _WIN32
 #define JAYLINK_API
@@ -474,6 +777,147 @@ typedef int (*jaylink_log_callback)(const struct jaylink_context *ctx,
 		enum jaylink_log_level level, const char *format, va_list args,
 		void *user_data);
 
+/** Log message. */
+struct jaylink_log_message {
+	/** Log level of the message. */
+	enum jaylink_log_level level;
+	/** Log domain, see jaylink_log_set_domain(). */
+	const char *domain;
+	/** Name of the function which emitted the message. */
+	const char *function;
+	/** Message format in printf()-style. */
+	const char *format;
+};
+
+/**
+ * Structured log callback function type.
+ *
+ * In contrast to #jaylink_log_callback, the message is passed with its
+ * individual fields. The message is neither formatted nor prefixed with the
+ * log domain by libjaylink, this is left to the callback function.
+ *
+ * @param[in] ctx libjaylink context.
+ * @param[in] message Log message.
+ * @param[in] args Message arguments.
+ * @param[in,out] user_data User data passed to the callback function.
+ */
+typedef void (*jaylink_log_message_callback)(
+		const struct jaylink_context *ctx,
+		const struct jaylink_log_message *message, va_list args,
+		void *user_data);
+
+/**
+ * Serial Wire Output (SWO) stream callback function type.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] data Captured data.
+ * @param[in] length Number of bytes of captured data.
+ * @param[in,out] user_data User data passed to the callback function.
+ */
+typedef void (*jaylink_swo_stream_callback)(
+		struct jaylink_device_handle *devh, const uint8_t *data,
+		size_t length, void *user_data);
+
+/**
+ * Hardware status monitor callback function type.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] event Threshold crossing of the target voltage.
+ * @param[in] sample Sample which crossed the threshold.
+ * @param[in,out] user_data User data passed to the callback function.
+ */
+typedef void (*jaylink_monitor_callback)(struct jaylink_device_handle *devh,
+		enum jaylink_monitor_event event,
+		const struct jaylink_monitor_sample *sample, void *user_data);
+
+/**
+ * Hotplug callback function type.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] dev Device instance which arrived or left. The reference count
+ *                of the device instance is not increased, use
+ *                jaylink_ref_device() to keep the device instance beyond
+ *                the callback function.
+ * @param[in] event Hotplug event.
+ * @param[in,out] user_data User data passed to the callback function.
+ */
+typedef void (*jaylink_hotplug_callback)(struct jaylink_context *ctx,
+		struct jaylink_device *dev, enum jaylink_hotplug_event event,
+		void *user_data);
+
+/**
+ * SPI flash read callback function type.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] data Data read from the flash.
+ * @param[in] length Number of bytes read from the flash.
+ * @param[in,out] user_data User data passed to the callback function.
+ *
+ * @return #JAYLINK_OK to continue the read. Any other value aborts the read
+ *         and is returned by jaylink_spi_flash_read().
+ */
+typedef int (*jaylink_spi_flash_read_callback)(
+		struct jaylink_device_handle *devh, const uint8_t *data,
+		uint32_t length, void *user_data);
+
+/**
+ * File read stream callback function type.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] data Data read from the file.
+ * @param[in] length Number of bytes read from the file.
+ * @param[in,out] user_data User data passed to the callback function.
+ *
+ * @return #JAYLINK_OK to continue the stream. Any other value aborts the stream
+ *         and is returned by jaylink_file_read_stream().
+ */
+typedef int (*jaylink_file_read_callback)(struct jaylink_device_handle *devh,
+		const uint8_t *data, uint32_t length, void *user_data);
+
+/**
+ * File write stream callback function type.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] buffer Buffer to store the data to be written to the file.
+ * @param[in,out] length Size of the buffer in bytes. The value must be updated
+ *                       with the number of bytes stored in the buffer. A
+ *                       value of zero terminates the stream.
+ * @param[in,out] user_data User data passed to the callback function.
+ *
+ * @return #JAYLINK_OK to continue the stream. Any other value aborts the stream
+ *         and is returned by jaylink_file_write_stream().
+ */
+typedef int (*jaylink_file_write_callback)(struct jaylink_device_handle *devh,
+		uint8_t *buffer, uint32_t *length, void *user_data);
+
+/*--- bits.c ----------------------------------------------------------------*/
+
+JAYLINK_API uint64_t jaylink_bits_get(const uint8_t *buffer, size_t offset,
+		size_t length);
+JAYLINK_API void jaylink_bits_set(uint8_t *buffer, size_t offset,
+		uint64_t value, size_t length);
+JAYLINK_API void jaylink_bits_copy(uint8_t *dst, size_t dst_offset,
+		const uint8_t *src, size_t src_offset, size_t length);
+JAYLINK_API void jaylink_bits_fill(uint8_t *buffer, size_t offset,
+		size_t length, uint64_t pattern, size_t pattern_length);
+JAYLINK_API bool jaylink_bits_compare(const uint8_t *a, size_t a_offset,
+		const uint8_t *b, size_t b_offset, const uint8_t *mask,
+		size_t mask_offset, size_t length);
+
+/*--- calibration.c ---------------------------------------------------------*/
+
+JAYLINK_API int jaylink_calibrate_speed(struct jaylink_device_handle *devh,
+		const struct jaylink_speed_calibration *params, bool apply,
+		uint16_t *speed);
+
+/*--- capture.c -------------------------------------------------------------*/
+
+JAYLINK_API int jaylink_capture_start(struct jaylink_device_handle *devh,
+		const char *filename);
+JAYLINK_API int jaylink_capture_stop(struct jaylink_device_handle *devh);
+JAYLINK_API int jaylink_replay_open(struct jaylink_context *ctx,
+		const char *filename, struct jaylink_device_handle **devh);
+
 /*--- core.c ----------------------------------------------------------------*/
 
 JAYLINK_API int jaylink_init(struct jaylink_context **ctx);
@@ -490,13 +934,28 @@ JAYLINK_API int jaylink_c2_read_data(struct jaylink_device_handle *devh,
 		uint8_t *data, uint8_t length);
 JAYLINK_API int jaylink_c2_write_data(struct jaylink_device_handle *devh,
 		const uint8_t *data, uint8_t length);
+JAYLINK_API int jaylink_c2_flash_write(struct jaylink_device_handle *devh,
+		uint8_t fpdat, uint16_t address, const uint8_t *data,
+		size_t length);
 
 /*--- device.c --------------------------------------------------------------*/
 
 JAYLINK_API int jaylink_get_devices(struct jaylink_context *ctx,
 		struct jaylink_device ***devs, size_t *count);
+JAYLINK_API int jaylink_find_device_by_serial(struct jaylink_context *ctx,
+		uint32_t serial_number, uint32_t ifaces,
+		struct jaylink_device **dev);
 JAYLINK_API void jaylink_free_devices(struct jaylink_device **devs,
 		bool unref);
+JAYLINK_API int jaylink_device_snapshot_new(
+		struct jaylink_device_snapshot **snapshot);
+JAYLINK_API void jaylink_device_snapshot_free(
+		struct jaylink_device_snapshot *snapshot);
+JAYLINK_API int jaylink_device_snapshot_update(struct jaylink_context *ctx,
+		struct jaylink_device_snapshot *snapshot);
+JAYLINK_API int jaylink_device_snapshot_get_devices(
+		const struct jaylink_device_snapshot *snapshot,
+		struct jaylink_device *const **devs, size_t *count);
 JAYLINK_API int jaylink_device_get_host_interface(
 		const struct jaylink_device *dev,
 		enum jaylink_host_interface *iface);
@@ -522,8 +981,16 @@ JAYLINK_API int jaylink_device_get_nickname(const struct jaylink_device *dev,
 JAYLINK_API struct jaylink_device *jaylink_ref_device(
 		struct jaylink_device *dev);
 JAYLINK_API void jaylink_unref_device(struct jaylink_device *dev);
+JAYLINK_API int jaylink_set_device_info_cache(struct jaylink_context *ctx,
+		bool enable);
+JAYLINK_API int jaylink_tcp_set_connection_pool(struct jaylink_context *ctx,
+		size_t max_connections, unsigned int idle_timeout);
+JAYLINK_API int jaylink_tcp_set_connect_retries(struct jaylink_context *ctx,
+		unsigned int retries, unsigned int delay);
 JAYLINK_API int jaylink_open(struct jaylink_device *dev,
 		struct jaylink_device_handle **devh);
+JAYLINK_API int jaylink_emulator_open(struct jaylink_context *ctx,
+		struct jaylink_device_handle **devh);
 JAYLINK_API int jaylink_close(struct jaylink_device_handle *devh);
 JAYLINK_API struct jaylink_device *jaylink_get_device(
 		struct jaylink_device_handle *devh);
@@ -555,18 +1022,55 @@ JAYLINK_API int jaylink_register(struct jaylink_device_handle *devh,
 JAYLINK_API int jaylink_unregister(struct jaylink_device_handle *devh,
 		const struct jaylink_connection *connection,
 		struct jaylink_connection *connections, size_t *count);
+JAYLINK_API int jaylink_usb_set_transfers(struct jaylink_device_handle *devh,
+		size_t num_transfers);
+JAYLINK_API int jaylink_usb_set_chunk_size(struct jaylink_device_handle *devh,
+		size_t size);
+JAYLINK_API int jaylink_usb_get_chunk_size(struct jaylink_device_handle *devh,
+		size_t *size);
+JAYLINK_API int jaylink_usb_set_timeout(struct jaylink_device_handle *devh,
+		unsigned int timeout, unsigned int num_timeouts);
+JAYLINK_API int jaylink_tcp_set_mode(struct jaylink_device_handle *devh,
+		enum jaylink_tcp_mode mode);
+JAYLINK_API int jaylink_get_pollfds(struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count);
 
 /*--- discovery.c -----------------------------------------------------------*/
 
 JAYLINK_API int jaylink_discovery_scan(struct jaylink_context *ctx,
 		uint32_t ifaces);
+JAYLINK_API int jaylink_discovery_add_tcp_target(struct jaylink_context *ctx,
+		const char *address, uint32_t count);
+JAYLINK_API int jaylink_discovery_clear_tcp_targets(
+		struct jaylink_context *ctx);
+JAYLINK_API int jaylink_discovery_set_tcp_stop_condition(
+		struct jaylink_context *ctx, const uint32_t *serial_numbers,
+		size_t num_serial_numbers, size_t num_devices);
+JAYLINK_API int jaylink_discovery_enable_hotplug(
+		struct jaylink_context *ctx, jaylink_hotplug_callback callback,
+		void *user_data);
+JAYLINK_API int jaylink_discovery_disable_hotplug(
+		struct jaylink_context *ctx);
+JAYLINK_API int jaylink_discovery_handle_events(struct jaylink_context *ctx,
+		uint32_t timeout);
 
 /*--- emucom.c --------------------------------------------------------------*/
 
 JAYLINK_API int jaylink_emucom_read(struct jaylink_device_handle *devh,
 		uint32_t channel, uint8_t *buffer, uint32_t *length);
+JAYLINK_API int jaylink_emucom_read_batch(struct jaylink_device_handle *devh,
+		struct jaylink_emucom_read *reads, size_t count);
 JAYLINK_API int jaylink_emucom_write(struct jaylink_device_handle *devh,
 		uint32_t channel, const uint8_t *buffer, uint32_t *length);
+JAYLINK_API int jaylink_emucom_start_polling(
+		struct jaylink_device_handle *devh, const uint32_t *channels,
+		size_t num_channels, size_t buffer_size, uint32_t min_interval,
+		uint32_t max_interval);
+JAYLINK_API int jaylink_emucom_stop_polling(struct jaylink_device_handle *devh);
+JAYLINK_API int jaylink_emucom_poll_peek(struct jaylink_device_handle *devh,
+		uint32_t channel, const uint8_t **data, size_t *length);
+JAYLINK_API int jaylink_emucom_poll_consume(struct jaylink_device_handle *devh,
+		uint32_t channel, size_t length);
 
 /*--- error.c ---------------------------------------------------------------*/
 
@@ -585,12 +1089,33 @@ JAYLINK_API int jaylink_file_get_size(struct jaylink_device_handle *devh,
 		const char *filename, uint32_t *size);
 JAYLINK_API int jaylink_file_delete(struct jaylink_device_handle *devh,
 		const char *filename);
+JAYLINK_API int jaylink_file_read_stream(struct jaylink_device_handle *devh,
+		const char *filename, uint32_t offset, uint32_t *length,
+		jaylink_file_read_callback callback, void *user_data);
+JAYLINK_API int jaylink_file_write_stream(struct jaylink_device_handle *devh,
+		const char *filename, uint32_t offset, uint32_t *length,
+		jaylink_file_write_callback callback, void *user_data);
+
+/*--- itm.c -----------------------------------------------------------------*/
+
+JAYLINK_API int jaylink_itm_decoder_new(struct jaylink_itm_decoder **decoder);
+JAYLINK_API void jaylink_itm_decoder_free(struct jaylink_itm_decoder *decoder);
+JAYLINK_API int jaylink_itm_decoder_reset(struct jaylink_itm_decoder *decoder);
+JAYLINK_API int jaylink_itm_decoder_set_filter(
+		struct jaylink_itm_decoder *decoder, uint32_t types,
+		uint32_t ports);
+JAYLINK_API int jaylink_itm_decode(struct jaylink_itm_decoder *decoder,
+		const uint8_t *data, size_t *length,
+		struct jaylink_itm_event *events, size_t *count);
 
 /*--- jtag.c ----------------------------------------------------------------*/
 
 JAYLINK_API int jaylink_jtag_io(struct jaylink_device_handle *devh,
 		const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
 		uint16_t length, enum jaylink_jtag_version version);
+JAYLINK_API int jaylink_jtag_scan(struct jaylink_device_handle *devh,
+		const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		size_t length, enum jaylink_jtag_version version);
 JAYLINK_API int jaylink_jtag_clear_trst(struct jaylink_device_handle *devh);
 JAYLINK_API int jaylink_jtag_set_trst(struct jaylink_device_handle *devh);
 JAYLINK_API int jaylink_jtag_clear_tms(struct jaylink_device_handle *devh);
@@ -606,17 +1131,103 @@ JAYLINK_API int jaylink_log_get_level(const struct jaylink_context *ctx,
 		enum jaylink_log_level *level);
 JAYLINK_API int jaylink_log_set_callback(struct jaylink_context *ctx,
 		jaylink_log_callback callback, void *user_data);
+JAYLINK_API int jaylink_log_set_message_callback(struct jaylink_context *ctx,
+		jaylink_log_message_callback callback, void *user_data);
 JAYLINK_API int jaylink_log_set_domain(struct jaylink_context *ctx,
 		const char *domain);
 JAYLINK_API const char *jaylink_log_get_domain(
 		const struct jaylink_context *ctx);
 
+/*--- monitor.c -------------------------------------------------------------*/
+
+JAYLINK_API int jaylink_monitor_start(struct jaylink_device_handle *devh,
+		size_t num_samples, uint32_t interval,
+		jaylink_monitor_callback callback, void *user_data);
+JAYLINK_API int jaylink_monitor_stop(struct jaylink_device_handle *devh);
+JAYLINK_API int jaylink_monitor_set_thresholds(
+		struct jaylink_device_handle *devh, uint16_t lower,
+		uint16_t upper);
+JAYLINK_API int jaylink_monitor_get_latest(struct jaylink_device_handle *devh,
+		struct jaylink_monitor_sample *sample);
+JAYLINK_API int jaylink_monitor_get_samples(
+		struct jaylink_device_handle *devh, uint64_t since,
+		struct jaylink_monitor_sample *samples, size_t *count);
+JAYLINK_API int jaylink_monitor_get_stats(struct jaylink_device_handle *devh,
+		struct jaylink_monitor_stats *stats);
+JAYLINK_API int jaylink_monitor_reset_stats(
+		struct jaylink_device_handle *devh);
+
+/*--- queue.c ---------------------------------------------------------------*/
+
+JAYLINK_API int jaylink_queue_new(struct jaylink_device_handle *devh,
+		struct jaylink_queue **queue);
+JAYLINK_API void jaylink_queue_free(struct jaylink_queue *queue);
+JAYLINK_API int jaylink_queue_clear(struct jaylink_queue *queue);
+JAYLINK_API int jaylink_queue_get_length(const struct jaylink_queue *queue,
+		size_t *length);
+JAYLINK_API int jaylink_queue_jtag_io(struct jaylink_queue *queue,
+		const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		uint16_t length, enum jaylink_jtag_version version);
+JAYLINK_API int jaylink_queue_swd_io(struct jaylink_queue *queue,
+		const uint8_t *direction, const uint8_t *out, uint8_t *in,
+		uint16_t length);
+JAYLINK_API int jaylink_queue_spi_io(struct jaylink_queue *queue,
+		const uint8_t *mosi, uint8_t *miso, uint32_t length,
+		uint32_t flags);
+JAYLINK_API int jaylink_queue_c2_read_address(struct jaylink_queue *queue,
+		uint8_t *address);
+JAYLINK_API int jaylink_queue_c2_write_address(struct jaylink_queue *queue,
+		uint8_t address);
+JAYLINK_API int jaylink_queue_c2_read_data(struct jaylink_queue *queue,
+		uint8_t *data, uint8_t length);
+JAYLINK_API int jaylink_queue_c2_write_data(struct jaylink_queue *queue,
+		const uint8_t *data, uint8_t length);
+JAYLINK_API int jaylink_queue_c2_poll(struct jaylink_queue *queue,
+		uint8_t mask, uint8_t value, uint8_t count);
+JAYLINK_API int jaylink_queue_clear_reset(struct jaylink_queue *queue);
+JAYLINK_API int jaylink_queue_set_reset(struct jaylink_queue *queue);
+JAYLINK_API int jaylink_queue_swo_read(struct jaylink_queue *queue,
+		uint8_t *buffer, uint32_t *length);
+JAYLINK_API int jaylink_queue_emucom_read(struct jaylink_queue *queue,
+		uint32_t channel, uint8_t *buffer, uint32_t *length);
+JAYLINK_API int jaylink_queue_execute(struct jaylink_queue *queue);
+JAYLINK_API int jaylink_queue_submit(struct jaylink_queue *queue);
+JAYLINK_API int jaylink_queue_complete(struct jaylink_queue *queue,
+		bool *completed);
+JAYLINK_API int jaylink_queue_get_result(const struct jaylink_queue *queue,
+		size_t index, int *result);
+
 /*--- spi.c -----------------------------------------------------------------*/
 
 JAYLINK_API int jaylink_spi_io(struct jaylink_device_handle *devh,
 		const uint8_t *mosi, uint8_t *miso, uint32_t length,
 		uint32_t flags);
 
+/*--- spi_flash.c -----------------------------------------------------------*/
+
+JAYLINK_API int jaylink_spi_flash_probe(struct jaylink_device_handle *devh,
+		struct jaylink_spi_flash *flash);
+JAYLINK_API int jaylink_spi_flash_read(struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash, uint32_t address,
+		uint32_t length, jaylink_spi_flash_read_callback callback,
+		void *user_data);
+JAYLINK_API int jaylink_spi_flash_erase(struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash, uint32_t address,
+		uint32_t length);
+JAYLINK_API int jaylink_spi_flash_program(struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash, uint32_t address,
+		const uint8_t *buffer, uint32_t length);
+
+/*--- stats.c ---------------------------------------------------------------*/
+
+JAYLINK_API int jaylink_get_io_stats(struct jaylink_device_handle *devh,
+		struct jaylink_io_stats *stats);
+JAYLINK_API int jaylink_reset_io_stats(struct jaylink_device_handle *devh);
+JAYLINK_API int jaylink_enable_command_stats(
+		struct jaylink_device_handle *devh, bool enable);
+JAYLINK_API int jaylink_get_command_stats(struct jaylink_device_handle *devh,
+		uint8_t opcode, struct jaylink_command_stats *stats);
+
 /*--- strutil.c -------------------------------------------------------------*/
 
 JAYLINK_API int jaylink_parse_serial_number(const char *str,
@@ -631,6 +1242,9 @@ JAYLINK_API const char *jaylink_target_interface_string(
 JAYLINK_API int jaylink_swd_io(struct jaylink_device_handle *devh,
 		const uint8_t *direction, const uint8_t *out, uint8_t *in,
 		uint16_t length);
+JAYLINK_API int jaylink_swd_transfer(struct jaylink_device_handle *devh,
+		struct jaylink_swd_transaction *transactions, size_t count,
+		uint8_t idle_cycles);
 
 /*--- swo.c -----------------------------------------------------------------*/
 
@@ -641,6 +1255,19 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 		uint8_t *buffer, uint32_t *length);
 JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 		enum jaylink_swo_mode mode, struct jaylink_swo_speed *speed);
+JAYLINK_API int jaylink_swo_start_streaming(struct jaylink_device_handle *devh,
+		size_t buffer_size, uint32_t interval,
+		jaylink_swo_stream_callback callback, void *user_data);
+JAYLINK_API int jaylink_swo_stop_streaming(struct jaylink_device_handle *devh);
+JAYLINK_API int jaylink_swo_stream_set_interval(
+		struct jaylink_device_handle *devh, uint32_t interval);
+JAYLINK_API int jaylink_swo_stream_peek(struct jaylink_device_handle *devh,
+		const uint8_t **data, size_t *length);
+JAYLINK_API int jaylink_swo_stream_consume(struct jaylink_device_handle *devh,
+		size_t length);
+JAYLINK_API int jaylink_swo_stream_decode(struct jaylink_device_handle *devh,
+		struct jaylink_itm_decoder *decoder,
+		struct jaylink_itm_event *events, size_t *count);
 
 /*--- target.c --------------------------------------------------------------*/
 
@@ -36,6 +36,9 @@
 /**
  * Set the libjaylink log level.
  *
+ * The log level can be changed while other threads use the libjaylink
+ * context.
+ *
  * @param[in,out] ctx libjaylink context.
  * @param[in] level Log level to set.
  *
@@ -53,7 +56,7 @@ JAYLINK_API int jaylink_log_set_level(struct jaylink_context *ctx,
 	if (level > JAYLINK_LOG_LEVEL_DEBUG_IO)
 		return JAYLINK_ERR_ARG;
 
-	ctx->log_level = level;
+	ATOMIC_STORE(&ctx->log_level, level);
 
 	return JAYLINK_OK;
 }
@@ -75,7 +78,7 @@ JAYLINK_API int jaylink_log_get_level(const struct jaylink_context *ctx,
 	if (!ctx || !level)
 		return JAYLINK_ERR_ARG;
 
-	*level = ctx->log_level;
+	*level = ATOMIC_LOAD(&ctx->log_level);
 
 	return JAYLINK_OK;
 }
@@ -83,6 +86,10 @@ JAYLINK_API int jaylink_log_get_level(const struct jaylink_context *ctx,
 /**
  * Set the libjaylink log callback function.
  *
+ * Only messages with a verbosity up to the current log level are passed to the
+ * callback function. The callback function is not used while a structured log
+ * callback function is set with jaylink_log_set_message_callback().
+ *
  * @param[in,out] ctx libjaylink context.
  * @param[in] callback Callback function to use, or NULL to use the default log
  *                     function.
@@ -110,6 +117,35 @@ JAYLINK_API int jaylink_log_set_callback(struct jaylink_context *ctx,
 	return JAYLINK_OK;
 }
 
+/**
+ * Set the libjaylink structured log callback function.
+ *
+ * The structured log callback function takes precedence over the callback
+ * function set with jaylink_log_set_callback(). Only messages with a verbosity
+ * up to the current log level are passed to the callback function.
+ *
+ * @param[in,out] ctx libjaylink context.
+ * @param[in] callback Callback function to use, or NULL to use the log
+ *                     callback function set with jaylink_log_set_callback().
+ * @param[in] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_log_set_message_callback(struct jaylink_context *ctx,
+		jaylink_log_message_callback callback, void *user_data)
+{
+	if (!ctx)
+		return JAYLINK_ERR_ARG;
+
+	ctx->log_message_callback = callback;
+	ctx->log_message_callback_data = callback ? user_data : NULL;
+
+	return JAYLINK_OK;
+}
+
 /**
  * Set the libjaylink log domain.
  *
@@ -178,7 +214,7 @@ JAYLINK_PRIV int log_vprintf(const struct jaylink_context *ctx,
 	 * Filter out messages with higher verbosity than the verbosity of the
 	 * current log level.
 	 */
-	if (level > ctx->log_level)
+	if (level > ATOMIC_LOAD(&ctx->log_level))
 		return 0;
 
 	if (ctx->log_domain[0] != '\0')
@@ -191,76 +227,27 @@ JAYLINK_PRIV int log_vprintf(const struct jaylink_context *ctx,
 }
 
 /** @private */
-JAYLINK_PRIV void log_err(const struct jaylink_context *ctx,
+JAYLINK_PRIV void log_message(const struct jaylink_context *ctx,
+		enum jaylink_log_level level, const char *function,
 		const char *format, ...)
 {
 	va_list args;
-
-	if (!ctx)
-		return;
+	struct jaylink_log_message message;
 
 	va_start(args, format);
-	ctx->log_callback(ctx, JAYLINK_LOG_LEVEL_ERROR, format, args,
-		ctx->log_callback_data);
-	va_end(args);
-}
-
-/** @private */
-JAYLINK_PRIV void log_warn(const struct jaylink_context *ctx,
-		const char *format, ...)
-{
-	va_list args;
 
-	if (!ctx)
-		return;
+	if (ctx->log_message_callback) {
+		message.level = level;
+		message.domain = ctx->log_domain;
+		message.function = function;
+		message.format = format;
 
-	va_start(args, format);
-	ctx->log_callback(ctx, JAYLINK_LOG_LEVEL_WARNING, format, args,
-		ctx->log_callback_data);
-	va_end(args);
-}
-
-/** @private */
-JAYLINK_PRIV void log_info(const struct jaylink_context *ctx,
-		const char *format, ...)
-{
-	va_list args;
-
-	if (!ctx)
-		return;
-
-	va_start(args, format);
-	ctx->log_callback(ctx, JAYLINK_LOG_LEVEL_INFO, format, args,
-		ctx->log_callback_data);
-	va_end(args);
-}
-
-/** @private */
-JAYLINK_PRIV void log_dbg(const struct jaylink_context *ctx,
-		const char *format, ...)
-{
-	va_list args;
-
-	if (!ctx)
-		return;
-
-	va_start(args, format);
-	ctx->log_callback(ctx, JAYLINK_LOG_LEVEL_DEBUG, format, args,
-		ctx->log_callback_data);
-	va_end(args);
-}
-
-/** @private */
-JAYLINK_PRIV void log_dbgio(const struct jaylink_context *ctx,
-		const char *format, ...)
-{
-	va_list args;
-
-	if (!ctx)
-		return;
+		ctx->log_message_callback(ctx, &message, args,
+			ctx->log_message_callback_data);
+	} else {
+		ctx->log_callback(ctx, level, format, args,
+			ctx->log_callback_data);
+	}
 
-	va_start(args, format);
-	ctx->log_callback(ctx, JAYLINK_LOG_LEVEL_DEBUG_IO, format, args,
-		ctx->log_callback_data);
 	va_end(args);
 }
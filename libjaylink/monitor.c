@@ -0,0 +1,534 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Hardware status monitor.
+ */
+
+/** @cond PRIVATE */
+/**
+ * Maximum time in microseconds the sampling thread sleeps at once.
+ *
+ * This limits the time it takes to stop the monitor with long sampling
+ * intervals.
+ */
+#define MAX_SLEEP_TIME	10000
+/** @endcond */
+
+static bool add_sample(struct monitor *monitor,
+		const struct jaylink_monitor_sample *sample,
+		enum jaylink_monitor_event *event)
+{
+	struct jaylink_monitor_stats *stats;
+	uint16_t voltage;
+	bool crossed;
+
+	stats = &monitor->stats;
+	voltage = sample->status.target_voltage;
+	crossed = false;
+
+	mutex_lock(&monitor->mutex);
+
+	monitor->samples[monitor->pos] = *sample;
+	monitor->pos = (monitor->pos + 1) % monitor->max_samples;
+
+	if (monitor->num_samples < monitor->max_samples)
+		monitor->num_samples++;
+
+	if (!stats->count) {
+		stats->min_voltage = voltage;
+		stats->max_voltage = voltage;
+	} else {
+		stats->min_voltage = MIN(stats->min_voltage, voltage);
+		stats->max_voltage = MAX(stats->max_voltage, voltage);
+	}
+
+	monitor->voltage_sum += voltage;
+	stats->count++;
+	stats->mean_voltage = monitor->voltage_sum / stats->count;
+
+	/*
+	 * Use the lower threshold to detect a drop and the upper threshold to
+	 * detect a recovery of the target voltage. The hysteresis prevents a
+	 * flood of events if the voltage fluctuates around a single threshold.
+	 */
+	if (!monitor->below && voltage < monitor->lower_threshold) {
+		monitor->below = true;
+		*event = JAYLINK_MONITOR_EVENT_BELOW;
+		crossed = true;
+	} else if (monitor->below && voltage >= monitor->upper_threshold) {
+		monitor->below = false;
+		*event = JAYLINK_MONITOR_EVENT_ABOVE;
+		crossed = true;
+	}
+
+	mutex_unlock(&monitor->mutex);
+
+	return crossed;
+}
+
+static void wait_interval(struct monitor *monitor, uint32_t usecs)
+{
+	uint32_t tmp;
+
+	while (usecs > 0 && !ATOMIC_LOAD(&monitor->stop)) {
+		tmp = MIN(usecs, MAX_SLEEP_TIME);
+		thread_sleep(tmp);
+		usecs -= tmp;
+	}
+}
+
+static void sample_thread(void *arg)
+{
+	int ret;
+	struct monitor *monitor;
+	struct jaylink_context *ctx;
+	struct jaylink_monitor_sample sample;
+	enum jaylink_monitor_event event;
+	uint64_t start;
+	uint64_t elapsed;
+
+	monitor = arg;
+	ctx = monitor->devh->dev->ctx;
+
+	while (!ATOMIC_LOAD(&monitor->stop)) {
+		start = util_get_timestamp();
+		ret = jaylink_get_hardware_status(monitor->devh,
+			&sample.status);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "Hardware status monitor: "
+				"jaylink_get_hardware_status() failed: %s",
+				jaylink_strerror(ret));
+			ATOMIC_STORE(&monitor->status, ret);
+			break;
+		}
+
+		sample.timestamp = util_get_timestamp() - monitor->start;
+
+		if (add_sample(monitor, &sample, &event) && monitor->callback)
+			monitor->callback(monitor->devh, event, &sample,
+				monitor->user_data);
+
+		/* Keep the sampling rate independent of the transfer time. */
+		elapsed = util_get_timestamp() - start;
+
+		if (elapsed < monitor->interval)
+			wait_interval(monitor, monitor->interval - elapsed);
+	}
+}
+
+static void free_monitor(struct monitor *monitor)
+{
+	mutex_destroy(&monitor->mutex);
+	free(monitor->samples);
+	free(monitor);
+}
+
+/**
+ * Start the hardware status monitor.
+ *
+ * A sampling thread retrieves the hardware status of the device with the
+ * specified interval, see jaylink_get_hardware_status(), and stores the
+ * timestamped samples into a ring buffer. If the ring buffer is full, the
+ * oldest sample is overwritten.
+ *
+ * The latest sample, the buffered samples and aggregates of the target
+ * voltage can be retrieved without any communication with the device, see
+ * jaylink_monitor_get_latest(), jaylink_monitor_get_samples() and
+ * jaylink_monitor_get_stats().
+ *
+ * The callback function is called whenever the target voltage crosses one of
+ * the thresholds, see jaylink_monitor_set_thresholds(). Initially, both
+ * thresholds are 0 mV and no callback occurs.
+ *
+ * The device handle can still be used while the monitor is active. The
+ * samples are retrieved between the commands of the application, which may
+ * delay a sample by the duration of a long command.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] num_samples Number of samples of the ring buffer.
+ * @param[in] interval Sampling interval in microseconds.
+ * @param[in] callback Callback function to be called from the sampling thread
+ *                     for threshold crossings, or NULL.
+ * @param[in,out] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is already active.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_start(struct jaylink_device_handle *devh,
+		size_t num_samples, uint32_t interval,
+		jaylink_monitor_callback callback, void *user_data)
+{
+	struct jaylink_context *ctx;
+	struct monitor *monitor;
+
+	if (!devh || !num_samples)
+		return JAYLINK_ERR_ARG;
+
+	if (num_samples > SIZE_MAX / sizeof(struct jaylink_monitor_sample))
+		return JAYLINK_ERR_ARG;
+
+	if (devh->monitor)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+	monitor = malloc(sizeof(struct monitor));
+
+	if (!monitor) {
+		log_err(ctx, "Hardware status monitor malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	monitor->samples = malloc(num_samples *
+		sizeof(struct jaylink_monitor_sample));
+
+	if (!monitor->samples) {
+		log_err(ctx, "Hardware status monitor samples malloc failed");
+		free(monitor);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	if (!mutex_init(&monitor->mutex)) {
+		log_err(ctx, "Failed to initialize hardware status monitor "
+			"mutex");
+		free(monitor->samples);
+		free(monitor);
+		return JAYLINK_ERR;
+	}
+
+	monitor->devh = devh;
+	monitor->max_samples = num_samples;
+	monitor->num_samples = 0;
+	monitor->pos = 0;
+	monitor->voltage_sum = 0;
+	monitor->stats.count = 0;
+	monitor->stats.min_voltage = 0;
+	monitor->stats.max_voltage = 0;
+	monitor->stats.mean_voltage = 0;
+	monitor->lower_threshold = 0;
+	monitor->upper_threshold = 0;
+	monitor->below = false;
+	monitor->callback = callback;
+	monitor->user_data = user_data;
+	monitor->interval = interval;
+	monitor->start = util_get_timestamp();
+	monitor->stop = false;
+	monitor->status = JAYLINK_OK;
+
+	if (!thread_create(&monitor->thread, &sample_thread, monitor)) {
+		log_err(ctx, "Failed to create hardware status monitor thread");
+		free_monitor(monitor);
+		return JAYLINK_ERR;
+	}
+
+	devh->monitor = monitor;
+
+	return JAYLINK_OK;
+}
+
+/** @private */
+JAYLINK_PRIV void monitor_stop(struct jaylink_device_handle *devh)
+{
+	struct monitor *monitor;
+
+	monitor = devh->monitor;
+	ATOMIC_STORE(&monitor->stop, true);
+
+	if (!thread_join(&monitor->thread))
+		log_err(devh->dev->ctx,
+			"Failed to join hardware status monitor thread");
+
+	free_monitor(monitor);
+	devh->monitor = NULL;
+}
+
+/**
+ * Stop the hardware status monitor.
+ *
+ * The buffered samples and the aggregates are discarded.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is not active.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during sampling.
+ * @retval JAYLINK_ERR_IO Input/output error during sampling.
+ * @retval JAYLINK_ERR Other error conditions during sampling.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_stop(struct jaylink_device_handle *devh)
+{
+	int ret;
+
+	if (!devh || !devh->monitor)
+		return JAYLINK_ERR_ARG;
+
+	ret = ATOMIC_LOAD(&devh->monitor->status);
+	monitor_stop(devh);
+
+	return ret;
+}
+
+/**
+ * Set the target voltage thresholds of the hardware status monitor.
+ *
+ * The #JAYLINK_MONITOR_EVENT_BELOW event occurs when the target voltage drops
+ * below the lower threshold, for example due to a brown-out of the target.
+ * Afterwards, the #JAYLINK_MONITOR_EVENT_ABOVE event occurs as soon as the
+ * target voltage recovers to or above the upper threshold.
+ *
+ * @note This function can be called from any thread, including the callback
+ *       function of the monitor.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] lower Lower threshold in mV, or 0 to disable threshold crossing
+ *                  detection.
+ * @param[in] upper Upper threshold in mV. The upper threshold must not be
+ *                  less than the lower threshold.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is not active.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_set_thresholds(
+		struct jaylink_device_handle *devh, uint16_t lower,
+		uint16_t upper)
+{
+	struct monitor *monitor;
+
+	if (!devh || !devh->monitor || lower > upper)
+		return JAYLINK_ERR_ARG;
+
+	monitor = devh->monitor;
+
+	mutex_lock(&monitor->mutex);
+	monitor->lower_threshold = lower;
+	monitor->upper_threshold = upper;
+	mutex_unlock(&monitor->mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get the latest sample of the hardware status monitor.
+ *
+ * @note This function can be called from any thread, including the callback
+ *       function of the monitor.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] sample Latest sample on success, and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is not active.
+ * @retval JAYLINK_ERR_NOT_AVAILABLE No sample is available yet.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during sampling.
+ * @retval JAYLINK_ERR_IO Input/output error during sampling.
+ * @retval JAYLINK_ERR Other error conditions during sampling.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_get_latest(struct jaylink_device_handle *devh,
+		struct jaylink_monitor_sample *sample)
+{
+	struct monitor *monitor;
+	size_t pos;
+	int ret;
+
+	if (!devh || !sample || !devh->monitor)
+		return JAYLINK_ERR_ARG;
+
+	monitor = devh->monitor;
+
+	/*
+	 * Report a failure of the sampling thread rather than a stale sample,
+	 * the buffered samples are still available with
+	 * jaylink_monitor_get_samples().
+	 */
+	ret = ATOMIC_LOAD(&monitor->status);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	mutex_lock(&monitor->mutex);
+
+	if (!monitor->num_samples) {
+		mutex_unlock(&monitor->mutex);
+		return JAYLINK_ERR_NOT_AVAILABLE;
+	}
+
+	pos = (monitor->pos + monitor->max_samples - 1) % monitor->max_samples;
+	*sample = monitor->samples[pos];
+
+	mutex_unlock(&monitor->mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get the buffered samples of the hardware status monitor.
+ *
+ * The samples are returned in chronological order and remain in the ring
+ * buffer. In order to retrieve only new samples, use the timestamp of the
+ * last retrieved sample plus one for @p since.
+ *
+ * @note This function can be called from any thread, including the callback
+ *       function of the monitor.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] since Time in microseconds since the monitor was started. Only
+ *                  samples taken at or after this time are returned.
+ * @param[out] samples Array to store the samples into on success. Its
+ *                     content is undefined on failure.
+ * @param[in,out] count Maximum number of samples to store. On success, the
+ *                      number of stored samples, and undefined on failure.
+ *                      If more samples are available, the oldest ones are
+ *                      stored.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is not active.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_get_samples(
+		struct jaylink_device_handle *devh, uint64_t since,
+		struct jaylink_monitor_sample *samples, size_t *count)
+{
+	struct monitor *monitor;
+	size_t pos;
+	size_t num;
+
+	if (!devh || !samples || !count || !devh->monitor)
+		return JAYLINK_ERR_ARG;
+
+	monitor = devh->monitor;
+	num = 0;
+
+	mutex_lock(&monitor->mutex);
+
+	pos = (monitor->pos + monitor->max_samples - monitor->num_samples) %
+		monitor->max_samples;
+
+	for (size_t i = 0; i < monitor->num_samples && num < *count; i++) {
+		if (monitor->samples[pos].timestamp >= since)
+			samples[num++] = monitor->samples[pos];
+
+		pos = (pos + 1) % monitor->max_samples;
+	}
+
+	mutex_unlock(&monitor->mutex);
+
+	*count = num;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get the target voltage aggregates of the hardware status monitor.
+ *
+ * The aggregates cover all samples since the monitor was started or since
+ * the last call of jaylink_monitor_reset_stats(), regardless of the size of
+ * the ring buffer.
+ *
+ * @note This function can be called from any thread, including the callback
+ *       function of the monitor.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] stats Aggregates on success, and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is not active.
+ * @retval JAYLINK_ERR_NOT_AVAILABLE No sample is aggregated yet.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_get_stats(struct jaylink_device_handle *devh,
+		struct jaylink_monitor_stats *stats)
+{
+	struct monitor *monitor;
+
+	if (!devh || !stats || !devh->monitor)
+		return JAYLINK_ERR_ARG;
+
+	monitor = devh->monitor;
+
+	mutex_lock(&monitor->mutex);
+
+	if (!monitor->stats.count) {
+		mutex_unlock(&monitor->mutex);
+		return JAYLINK_ERR_NOT_AVAILABLE;
+	}
+
+	*stats = monitor->stats;
+
+	mutex_unlock(&monitor->mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Reset the target voltage aggregates of the hardware status monitor.
+ *
+ * The buffered samples are not affected.
+ *
+ * @note This function can be called from any thread, including the callback
+ *       function of the monitor.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the monitor is not active.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_monitor_reset_stats(struct jaylink_device_handle *devh)
+{
+	struct monitor *monitor;
+
+	if (!devh || !devh->monitor)
+		return JAYLINK_ERR_ARG;
+
+	monitor = devh->monitor;
+
+	mutex_lock(&monitor->mutex);
+	monitor->voltage_sum = 0;
+	monitor->stats.count = 0;
+	monitor->stats.min_voltage = 0;
+	monitor->stats.max_voltage = 0;
+	monitor->stats.mean_voltage = 0;
+	mutex_unlock(&monitor->mutex);
+
+	return JAYLINK_OK;
+}
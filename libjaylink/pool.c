@@ -0,0 +1,95 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Object pool.
+ *
+ * The pool keeps released objects of a fixed size in a free list and hands
+ * them out again instead of allocating new ones. The number of objects kept
+ * in the pool is limited, objects beyond this limit are free'd immediately.
+ *
+ * The pool is not thread-safe, the caller is responsible for locking.
+ */
+
+/** @private */
+JAYLINK_PRIV void pool_init(struct pool *pool, size_t object_size,
+		size_t max_objects)
+{
+	/* Released objects hold the link to the next free object. */
+	pool->object_size = MAX(object_size, sizeof(struct pool_object));
+	pool->objects = NULL;
+	pool->num_objects = 0;
+	pool->max_objects = max_objects;
+}
+
+/** @private */
+JAYLINK_PRIV void *pool_alloc(struct pool *pool)
+{
+	struct pool_object *object;
+
+	object = pool->objects;
+
+	if (!object)
+		return malloc(pool->object_size);
+
+	pool->objects = object->next;
+	pool->num_objects--;
+
+	return object;
+}
+
+/** @private */
+JAYLINK_PRIV void pool_release(struct pool *pool, void *object)
+{
+	struct pool_object *tmp;
+
+	if (!object)
+		return;
+
+	if (pool->num_objects >= pool->max_objects) {
+		free(object);
+		return;
+	}
+
+	tmp = object;
+	tmp->next = pool->objects;
+	pool->objects = tmp;
+	pool->num_objects++;
+}
+
+/** @private */
+JAYLINK_PRIV void pool_free(struct pool *pool)
+{
+	struct pool_object *object;
+
+	while (pool->objects) {
+		object = pool->objects;
+		pool->objects = object->next;
+		free(object);
+	}
+
+	pool->num_objects = 0;
+}
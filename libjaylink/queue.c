@@ -0,0 +1,1481 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Command queue functions.
+ */
+
+/** @cond PRIVATE */
+#define CMD_JTAG_IO_V2		0xce
+#define CMD_JTAG_IO_V3		0xcf
+#define CMD_SWD_IO		0xcf
+#define CMD_CLEAR_RESET		0xdc
+#define CMD_SET_RESET		0xdd
+#define CMD_SPI			0x15
+#define CMD_C2_IO		0x17
+#define CMD_SWO			0xeb
+#define CMD_EMUCOM		0xee
+
+#define SPI_CMD_IO		0x01
+
+#define C2_CMD_DATA_READ	0x00
+#define C2_CMD_DATA_WRITE	0x01
+#define C2_CMD_ADDR_READ	0x02
+#define C2_CMD_ADDR_WRITE	0x03
+
+#define SWO_CMD_READ		0x66
+#define SWO_PARAM_READ_SIZE	0x03
+
+#define EMUCOM_CMD_READ		0x00
+
+/**
+ * Error code indicating that there is not enough free memory on the device to
+ * perform the JTAG or SWD I/O operation.
+ */
+#define IO_ERR_NO_MEMORY	0x06
+
+/** Initial number of commands a queue can hold. */
+#define INITIAL_CAPACITY	16
+
+/**
+ * Maximum number of response bytes of the commands sent to the device with a
+ * single transfer.
+ *
+ * The device stops to process further commands when the host does not read
+ * the responses. For that reason, the commands of a queue are split into
+ * multiple transfers if their responses exceed this limit. The value
+ * corresponds to the largest response of a single JTAG I/O operation.
+ */
+#define MAX_RESPONSE_LENGTH	(((UINT16_MAX + 7) / 8) + 1)
+
+/**
+ * Interval in microseconds to check for the pending responses when a
+ * submitted queue is aborted.
+ */
+#define ABORT_INTERVAL		1000
+/** @endcond */
+
+static void abort_queue(struct jaylink_queue *queue);
+
+/**
+ * Allocate a command queue.
+ *
+ * A command queue collects commands and sends them to the device with as few
+ * transfers as possible. This avoids a full round trip for each command.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] queue Newly allocated command queue on success, and undefined
+ *                   on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_new(struct jaylink_device_handle *devh,
+		struct jaylink_queue **queue)
+{
+	struct jaylink_queue *tmp;
+
+	if (!devh || !queue)
+		return JAYLINK_ERR_ARG;
+
+	tmp = malloc(sizeof(struct jaylink_queue));
+
+	if (!tmp) {
+		log_err(devh->dev->ctx, "Command queue malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	tmp->commands = malloc(INITIAL_CAPACITY *
+		sizeof(struct queue_command));
+
+	if (!tmp->commands) {
+		log_err(devh->dev->ctx, "Command queue malloc failed");
+		free(tmp);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	tmp->devh = devh;
+	tmp->num_commands = 0;
+	tmp->capacity = INITIAL_CAPACITY;
+	tmp->submitted = false;
+	tmp->first = 0;
+	tmp->num_pending = 0;
+	tmp->pending_length = 0;
+
+	*queue = tmp;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Free a command queue.
+ *
+ * If the queue is submitted and not completed yet, it is aborted first. The
+ * responses of the commands already sent to the device are waited for and
+ * the remaining commands are not sent anymore. Afterwards, the device handle
+ * can be used for further operations again.
+ *
+ * @note The buffers of the commands of a submitted queue are accessed while
+ *       the queue is aborted and must therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API void jaylink_queue_free(struct jaylink_queue *queue)
+{
+	if (!queue)
+		return;
+
+	if (queue->submitted)
+		abort_queue(queue);
+
+	free(queue->commands);
+	free(queue);
+}
+
+/**
+ * Remove all commands from a command queue.
+ *
+ * @param[in,out] queue Command queue.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_clear(struct jaylink_queue *queue)
+{
+	if (!queue)
+		return JAYLINK_ERR_ARG;
+
+	if (queue->submitted)
+		return JAYLINK_ERR_ARG;
+
+	queue->num_commands = 0;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get the number of commands in a command queue.
+ *
+ * @param[in] queue Command queue.
+ * @param[out] length Number of commands on success, and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_get_length(const struct jaylink_queue *queue,
+		size_t *length)
+{
+	if (!queue || !length)
+		return JAYLINK_ERR_ARG;
+
+	*length = queue->num_commands;
+
+	return JAYLINK_OK;
+}
+
+static struct queue_command *append_command(struct jaylink_queue *queue)
+{
+	struct queue_command *commands;
+	struct queue_command *cmd;
+	size_t capacity;
+
+	if (queue->num_commands == queue->capacity) {
+		capacity = queue->capacity * 2;
+		commands = realloc(queue->commands,
+			capacity * sizeof(struct queue_command));
+
+		if (!commands) {
+			log_err(queue->devh->dev->ctx, "Failed to adjust "
+				"command queue size to %zu commands", capacity);
+			return NULL;
+		}
+
+		queue->commands = commands;
+		queue->capacity = capacity;
+	}
+
+	cmd = &queue->commands[queue->num_commands];
+
+	cmd->header_length = 0;
+	cmd->data[0] = NULL;
+	cmd->data[1] = NULL;
+	cmd->num_data = 0;
+	cmd->data_length = 0;
+	cmd->response = NULL;
+	cmd->response_length = 0;
+	cmd->trailer = QUEUE_TRAILER_NONE;
+	cmd->status = QUEUE_STATUS_NONE;
+	cmd->length = NULL;
+	cmd->channel = 0;
+	cmd->count = 0;
+	cmd->has_value = false;
+	cmd->poll = false;
+	cmd->result = JAYLINK_ERR;
+
+	queue->num_commands++;
+
+	return cmd;
+}
+
+/**
+ * Append a JTAG I/O operation to a command queue.
+ *
+ * The operation is equivalent to jaylink_jtag_io() but is not performed
+ * before jaylink_queue_execute() is called.
+ *
+ * @note The buffers are accessed during jaylink_queue_execute() only and must
+ *       therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] tms Buffer to read TMS data from.
+ * @param[in] tdi Buffer to read TDI data from.
+ * @param[out] tdo Buffer to store TDO data during the execution of the queue.
+ *                 The buffer must be large enough to contain at least the
+ *                 specified number of bits to transfer.
+ * @param[in] length Number of bits to transfer.
+ * @param[in] version Version of the JTAG command.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_jtag_io()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_jtag_io(struct jaylink_queue *queue,
+		const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		uint16_t length, enum jaylink_jtag_version version)
+{
+	struct queue_command *cmd;
+	uint8_t opcode;
+	enum queue_trailer trailer;
+
+	if (!queue || !tms || !tdi || !tdo || !length)
+		return JAYLINK_ERR_ARG;
+
+	switch (version) {
+	case JAYLINK_JTAG_VERSION_2:
+		opcode = CMD_JTAG_IO_V2;
+		trailer = QUEUE_TRAILER_NONE;
+		break;
+	case JAYLINK_JTAG_VERSION_3:
+		opcode = CMD_JTAG_IO_V3;
+		trailer = QUEUE_TRAILER_STATUS;
+		break;
+	default:
+		return JAYLINK_ERR_ARG;
+	}
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->header[0] = opcode;
+	cmd->header[1] = 0x00;
+	buffer_set_u16(cmd->header, length, 2);
+	cmd->header_length = 4;
+
+	cmd->data[0] = tms;
+	cmd->data[1] = tdi;
+	cmd->num_data = 2;
+	cmd->data_length = (length + 7) / 8;
+
+	cmd->response = tdo;
+	cmd->response_length = cmd->data_length;
+	cmd->trailer = trailer;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a SWD I/O operation to a command queue.
+ *
+ * The operation is equivalent to jaylink_swd_io() but is not performed before
+ * jaylink_queue_execute() is called.
+ *
+ * @note The buffers are accessed during jaylink_queue_execute() only and must
+ *       therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] direction Buffer to read the transfer direction from.
+ * @param[in] out Buffer to read host-to-target data from.
+ * @param[out] in Buffer to store target-to-host data during the execution of
+ *                the queue. The buffer must be large enough to contain at
+ *                least the specified number of bits to transfer.
+ * @param[in] length Total number of bits to transfer from host to target and
+ *                   vice versa.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_swd_io()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_swd_io(struct jaylink_queue *queue,
+		const uint8_t *direction, const uint8_t *out, uint8_t *in,
+		uint16_t length)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !direction || !out || !in || !length)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->header[0] = CMD_SWD_IO;
+	cmd->header[1] = 0x00;
+	buffer_set_u16(cmd->header, length, 2);
+	cmd->header_length = 4;
+
+	cmd->data[0] = direction;
+	cmd->data[1] = out;
+	cmd->num_data = 2;
+	cmd->data_length = (length + 7) / 8;
+
+	cmd->response = in;
+	cmd->response_length = cmd->data_length;
+	cmd->trailer = QUEUE_TRAILER_STATUS;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a SPI I/O operation to a command queue.
+ *
+ * The operation is equivalent to jaylink_spi_io() but is not performed before
+ * jaylink_queue_execute() is called.
+ *
+ * @note The buffers are accessed during jaylink_queue_execute() only and must
+ *       therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] mosi Buffer to read MOSI data from. Can be NULL.
+ * @param[out] miso Buffer to store MISO data during the execution of the
+ *                  queue. The buffer must be large enough to contain at least
+ *                  the specified number of bytes to transfer. Can be NULL.
+ * @param[in] length Number of bytes to transfer.
+ * @param[in] flags Flags, see #jaylink_spi_flag for more details.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_spi_io()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_spi_io(struct jaylink_queue *queue,
+		const uint8_t *mosi, uint8_t *miso, uint32_t length,
+		uint32_t flags)
+{
+	struct queue_command *cmd;
+	uint32_t mosi_length;
+	uint32_t miso_length;
+
+	if (!queue || !length)
+		return JAYLINK_ERR_ARG;
+
+	if (!mosi && !miso)
+		return JAYLINK_ERR_ARG;
+
+	mosi_length = (mosi) ? length : 0;
+	miso_length = (miso) ? length : 0;
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->header[0] = CMD_SPI;
+	cmd->header[1] = SPI_CMD_IO;
+	cmd->header[2] = 0x00;
+	cmd->header[3] = 0x00;
+	buffer_set_u32(cmd->header, mosi_length + 8, 4);
+	buffer_set_u32(cmd->header, miso_length + 4, 8);
+	buffer_set_u32(cmd->header, length * 8, 12);
+	buffer_set_u32(cmd->header, flags, 16);
+	cmd->header_length = 20;
+
+	cmd->data[0] = mosi;
+	cmd->num_data = (mosi) ? 1 : 0;
+	cmd->data_length = mosi_length;
+
+	cmd->response = miso;
+	cmd->response_length = miso_length;
+	cmd->trailer = QUEUE_TRAILER_COUNT;
+	cmd->count = length;
+
+	return JAYLINK_OK;
+}
+
+static struct queue_command *append_c2(struct jaylink_queue *queue,
+		uint8_t opcode, uint8_t length, bool write)
+{
+	struct queue_command *cmd;
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return NULL;
+
+	cmd->header[0] = CMD_C2_IO;
+	cmd->header[1] = opcode;
+
+	/* The position of the length field depends on the direction. */
+	if (write) {
+		buffer_set_u16(cmd->header, length, 2);
+		cmd->header[4] = 0x00;
+	} else {
+		cmd->header[2] = 0x00;
+		buffer_set_u16(cmd->header, length, 3);
+	}
+
+	cmd->header_length = 5;
+	cmd->trailer = QUEUE_TRAILER_ERROR;
+
+	return cmd;
+}
+
+/**
+ * Append a C2 address register read operation to a command queue.
+ *
+ * @note The buffer is accessed during jaylink_queue_execute() only and must
+ *       therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[out] address Buffer to store the value of the address register during
+ *                     the execution of the queue.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_c2_read_address()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_c2_read_address(struct jaylink_queue *queue,
+		uint8_t *address)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !address)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_c2(queue, C2_CMD_ADDR_READ, 1, false);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->response = address;
+	cmd->response_length = 1;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a C2 address register write operation to a command queue.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] address Value to write into the address register.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_c2_write_address()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_c2_write_address(struct jaylink_queue *queue,
+		uint8_t address)
+{
+	struct queue_command *cmd;
+
+	if (!queue)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_c2(queue, C2_CMD_ADDR_WRITE, 1, true);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	/* The value is sent as part of the header. */
+	cmd->header[5] = address;
+	cmd->header_length = 6;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a C2 data register read operation to a command queue.
+ *
+ * @note The buffer is accessed during jaylink_queue_execute() only and must
+ *       therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[out] data Buffer to store the read data during the execution of the
+ *                  queue.
+ * @param[in] length Number of bytes to read, but not more than
+ *                   #JAYLINK_C2_MAX_LENGTH.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_c2_read_data()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_c2_read_data(struct jaylink_queue *queue,
+		uint8_t *data, uint8_t length)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !data || !length || length > JAYLINK_C2_MAX_LENGTH)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_c2(queue, C2_CMD_DATA_READ, length, false);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->response = data;
+	cmd->response_length = length;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a C2 data register write operation to a command queue.
+ *
+ * @note The buffer is accessed during jaylink_queue_execute() only and must
+ *       therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] data Buffer to be written into the data register.
+ * @param[in] length Number of bytes to write, but not more than
+ *                   #JAYLINK_C2_MAX_LENGTH.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_c2_write_data()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_c2_write_data(struct jaylink_queue *queue,
+		const uint8_t *data, uint8_t length)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !data || !length || length > JAYLINK_C2_MAX_LENGTH)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_c2(queue, C2_CMD_DATA_WRITE, length, true);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->data[0] = data;
+	cmd->num_data = 1;
+	cmd->data_length = length;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a C2 status poll to a command queue.
+ *
+ * The status is polled by reading the C2 address register multiple times in
+ * a row. Because the queue is executed without interruption, the poll cannot
+ * wait for the target. Instead, the result of the poll indicates whether the
+ * status bits had the expected value at the last read. The commands appended
+ * after the poll are sent to the target regardless of the result.
+ *
+ * @note Each read of the address register is appended as an individual
+ *       command. Only the result of the last command reflects the result of
+ *       the poll.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] mask Bitmask of the polled status bits.
+ * @param[in] value Expected value of the polled status bits.
+ * @param[in] count Number of reads of the address register.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_c2_poll(struct jaylink_queue *queue,
+		uint8_t mask, uint8_t value, uint8_t count)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !count || (value & ~mask))
+		return JAYLINK_ERR_ARG;
+
+	cmd = NULL;
+
+	for (uint8_t i = 0; i < count; i++) {
+		cmd = append_c2(queue, C2_CMD_ADDR_READ, 1, false);
+
+		if (!cmd)
+			return JAYLINK_ERR_MALLOC;
+
+		cmd->response_length = 1;
+		cmd->has_value = true;
+	}
+
+	cmd->poll = true;
+	cmd->poll_mask = mask;
+	cmd->poll_value = value;
+
+	return JAYLINK_OK;
+}
+
+static int append_reset(struct jaylink_queue *queue, uint8_t opcode)
+{
+	struct queue_command *cmd;
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->header[0] = opcode;
+	cmd->header_length = 1;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append a target reset clear operation to a command queue.
+ *
+ * @param[in,out] queue Command queue.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_clear_reset()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_clear_reset(struct jaylink_queue *queue)
+{
+	if (!queue)
+		return JAYLINK_ERR_ARG;
+
+	return append_reset(queue, CMD_CLEAR_RESET);
+}
+
+/**
+ * Append a target reset set operation to a command queue.
+ *
+ * @param[in,out] queue Command queue.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_set_reset()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_set_reset(struct jaylink_queue *queue)
+{
+	if (!queue)
+		return JAYLINK_ERR_ARG;
+
+	return append_reset(queue, CMD_SET_RESET);
+}
+
+/**
+ * Append a SWO read operation to a command queue.
+ *
+ * The operation is equivalent to jaylink_swo_read() but is not performed
+ * before jaylink_queue_execute() is called.
+ *
+ * The number of bytes received is only known once the operation is performed.
+ * For that reason, the commands appended after the operation are sent to the
+ * device with a separate transfer.
+ *
+ * @note The buffer and the length are accessed during jaylink_queue_execute()
+ *       only and must therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[out] buffer Buffer to store the captured data during the execution
+ *                    of the queue.
+ * @param[in,out] length Maximum number of bytes to read. If the operation is
+ *                       performed successfully, the value gets updated with
+ *                       the actual number of bytes read.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_swo_read()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_swo_read(struct jaylink_queue *queue,
+		uint8_t *buffer, uint32_t *length)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !buffer || !length)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->header[0] = CMD_SWO;
+	cmd->header[1] = SWO_CMD_READ;
+	cmd->header[2] = 0x04;
+	cmd->header[3] = SWO_PARAM_READ_SIZE;
+	buffer_set_u32(cmd->header, *length, 4);
+	cmd->header[8] = 0x00;
+	cmd->header_length = 9;
+
+	cmd->response = buffer;
+	cmd->response_length = *length;
+	cmd->status = QUEUE_STATUS_SWO;
+	cmd->length = length;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Append an EMUCOM read operation to a command queue.
+ *
+ * The operation is equivalent to jaylink_emucom_read() but is not performed
+ * before jaylink_queue_execute() is called.
+ *
+ * The number of bytes received is only known once the operation is performed.
+ * For that reason, the commands appended after the operation are sent to the
+ * device with a separate transfer.
+ *
+ * @note The buffer and the length are accessed during jaylink_queue_execute()
+ *       only and must therefore remain valid until then.
+ *
+ * @param[in,out] queue Command queue.
+ * @param[in] channel Channel to read data from.
+ * @param[out] buffer Buffer to store the read data during the execution of
+ *                    the queue.
+ * @param[in,out] length Number of bytes to read. If the operation is performed
+ *                       successfully, the value gets updated with the actual
+ *                       number of bytes read. If the result of the operation
+ *                       is #JAYLINK_ERR_DEV_NOT_AVAILABLE, the value gets
+ *                       updated with the number of bytes available on the
+ *                       channel.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_emucom_read()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_emucom_read(struct jaylink_queue *queue,
+		uint32_t channel, uint8_t *buffer, uint32_t *length)
+{
+	struct queue_command *cmd;
+
+	if (!queue || !buffer || !length)
+		return JAYLINK_ERR_ARG;
+
+	cmd = append_command(queue);
+
+	if (!cmd)
+		return JAYLINK_ERR_MALLOC;
+
+	cmd->header[0] = CMD_EMUCOM;
+	cmd->header[1] = EMUCOM_CMD_READ;
+	buffer_set_u32(cmd->header, channel, 2);
+	buffer_set_u32(cmd->header, *length, 6);
+	cmd->header_length = 10;
+
+	cmd->response = buffer;
+	cmd->response_length = *length;
+	cmd->status = QUEUE_STATUS_EMUCOM;
+	cmd->length = length;
+	cmd->channel = channel;
+
+	return JAYLINK_OK;
+}
+
+static int send_commands(struct jaylink_device_handle *devh,
+		const struct queue_command *commands, size_t num_commands)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	const struct queue_command *cmd;
+
+	ctx = devh->dev->ctx;
+	ret = transport_start_batch(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_start_batch() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	for (size_t i = 0; i < num_commands; i++) {
+		cmd = &commands[i];
+		ret = transport_start_write(devh, cmd->header_length +
+			cmd->num_data * cmd->data_length, true);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_start_write() failed: %s",
+				jaylink_strerror(ret));
+			transport_cancel_batch(devh);
+			return ret;
+		}
+
+		ret = transport_write(devh, cmd->header, cmd->header_length);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_write() failed: %s",
+				jaylink_strerror(ret));
+			transport_cancel_batch(devh);
+			return ret;
+		}
+
+		for (size_t j = 0; j < cmd->num_data; j++) {
+			ret = transport_write(devh, cmd->data[j],
+				cmd->data_length);
+
+			if (ret != JAYLINK_OK) {
+				log_err(ctx, "transport_write() failed: %s",
+					jaylink_strerror(ret));
+				transport_cancel_batch(devh);
+				return ret;
+			}
+		}
+	}
+
+	ret = transport_end_batch(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "transport_end_batch() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Receive the response of a command with a status in front of the response
+ * data. The response data is only received if the status indicates any.
+ */
+static int receive_status_response(struct jaylink_device_handle *devh,
+		struct queue_command *cmd)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[8];
+	uint32_t status;
+	uint32_t length;
+	int result;
+
+	ctx = devh->dev->ctx;
+
+	if (cmd->status == QUEUE_STATUS_SWO) {
+		ret = transport_read(devh, buf, 8);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		status = buffer_get_u32(buf, 0);
+		length = buffer_get_u32(buf, 4);
+
+		if (length > cmd->response_length) {
+			log_err(ctx, "Received %u bytes but only %zu bytes "
+				"were requested", length, cmd->response_length);
+			return JAYLINK_ERR_PROTO;
+		}
+
+		if (status > 0) {
+			log_err(ctx, "Failed to read data: 0x%x", status);
+			result = JAYLINK_ERR_DEV;
+		} else {
+			result = JAYLINK_OK;
+		}
+	} else {
+		ret = transport_read(devh, buf, 4);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		length = cmd->response_length;
+		result = emucom_check_read_status(ctx, cmd->channel,
+			buffer_get_u32(buf, 0), &length);
+
+		/* The device does not send any data in case of an error. */
+		if (result == JAYLINK_ERR_PROTO) {
+			return result;
+		} else if (result != JAYLINK_OK) {
+			if (result == JAYLINK_ERR_DEV_NOT_AVAILABLE)
+				*cmd->length = length;
+
+			cmd->result = result;
+			return JAYLINK_OK;
+		}
+	}
+
+	if (length > 0) {
+		ret = transport_start_read(devh, length);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_start_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		ret = transport_read(devh, cmd->response, length);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+	}
+
+	*cmd->length = length;
+	cmd->result = result;
+
+	return JAYLINK_OK;
+}
+
+static int receive_responses(struct jaylink_device_handle *devh,
+		struct queue_command *commands, size_t num_commands)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct queue_command *cmd;
+	uint8_t status;
+	uint8_t buf[4];
+
+	ctx = devh->dev->ctx;
+
+	for (size_t i = 0; i < num_commands; i++) {
+		cmd = &commands[i];
+
+		if (cmd->status != QUEUE_STATUS_NONE) {
+			ret = receive_status_response(devh, cmd);
+
+			if (ret != JAYLINK_OK)
+				return ret;
+
+			continue;
+		}
+
+		if (cmd->response_length > 0) {
+			ret = transport_read(devh, (cmd->has_value) ?
+				&cmd->value : cmd->response,
+				cmd->response_length);
+
+			if (ret != JAYLINK_OK) {
+				log_err(ctx, "transport_read() failed: %s",
+					jaylink_strerror(ret));
+				return ret;
+			}
+		}
+
+		if (cmd->trailer == QUEUE_TRAILER_NONE) {
+			cmd->result = JAYLINK_OK;
+			continue;
+		}
+
+		if (cmd->trailer == QUEUE_TRAILER_ERROR) {
+			ret = transport_read(devh, buf, 4);
+
+			if (ret != JAYLINK_OK) {
+				log_err(ctx, "transport_read() failed: %s",
+					jaylink_strerror(ret));
+				return ret;
+			}
+
+			if (buffer_get_u32(buf, 0) != 0)
+				cmd->result = JAYLINK_ERR_DEV;
+			else if (cmd->poll && (cmd->value & cmd->poll_mask) !=
+					cmd->poll_value)
+				cmd->result = JAYLINK_ERR_TIMEOUT;
+			else
+				cmd->result = JAYLINK_OK;
+
+			continue;
+		}
+
+		if (cmd->trailer == QUEUE_TRAILER_COUNT) {
+			ret = transport_read(devh, buf, 4);
+
+			if (ret != JAYLINK_OK) {
+				log_err(ctx, "transport_read() failed: %s",
+					jaylink_strerror(ret));
+				return ret;
+			}
+
+			if (buffer_get_u32(buf, 0) != cmd->count) {
+				log_err(ctx, "Unexpected number of transferred "
+					"bytes of operation %zu of the queue",
+					i);
+				cmd->result = JAYLINK_ERR_PROTO;
+			} else {
+				cmd->result = JAYLINK_OK;
+			}
+
+			continue;
+		}
+
+		ret = transport_read(devh, &status, 1);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "transport_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		if (status == IO_ERR_NO_MEMORY) {
+			cmd->result = JAYLINK_ERR_DEV_NO_MEMORY;
+		} else if (status > 0) {
+			log_err(ctx, "I/O operation %zu of the queue failed: "
+				"0x%x", i, status);
+			cmd->result = JAYLINK_ERR_DEV;
+		} else {
+			cmd->result = JAYLINK_OK;
+		}
+	}
+
+	return JAYLINK_OK;
+}
+
+static void reset_results(struct jaylink_queue *queue)
+{
+	for (size_t i = 0; i < queue->num_commands; i++)
+		queue->commands[i].result = JAYLINK_ERR;
+
+	queue->first = 0;
+	queue->num_pending = 0;
+	queue->pending_length = 0;
+}
+
+/*
+ * Send the next commands of the queue to the device and start the read
+ * operation for their responses.
+ */
+static int send_next_commands(struct jaylink_queue *queue)
+{
+	int ret;
+	struct queue_command *cmd;
+	size_t num;
+	size_t length;
+	size_t tmp;
+
+	length = 0;
+
+	/*
+	 * Collect as many commands as possible without exceeding the maximum
+	 * response length. Note that a command is always collected if it is
+	 * the first one.
+	 */
+	for (num = 0; queue->first + num < queue->num_commands; num++) {
+		cmd = &queue->commands[queue->first + num];
+
+		if (cmd->status == QUEUE_STATUS_SWO)
+			tmp = 8;
+		else if (cmd->status == QUEUE_STATUS_EMUCOM)
+			tmp = 4;
+		else
+			tmp = cmd->response_length;
+
+		if (cmd->trailer == QUEUE_TRAILER_STATUS)
+			tmp++;
+		else if (cmd->trailer != QUEUE_TRAILER_NONE)
+			tmp += 4;
+
+		if (num > 0 && length + tmp > MAX_RESPONSE_LENGTH)
+			break;
+
+		length += tmp;
+
+		/*
+		 * The length of the response data of a command with a status
+		 * is not known in advance. Therefore, the response data is
+		 * read separately and the command is the last one collected.
+		 */
+		if (cmd->status != QUEUE_STATUS_NONE) {
+			num++;
+			break;
+		}
+	}
+
+	ret = send_commands(queue->devh, queue->commands + queue->first, num);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (length > 0) {
+		ret = transport_start_read(queue->devh, length);
+
+		if (ret != JAYLINK_OK) {
+			log_err(queue->devh->dev->ctx,
+				"transport_start_read() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+	}
+
+	queue->num_pending = num;
+	queue->pending_length = length;
+
+	return JAYLINK_OK;
+}
+
+/* Receive the responses of the commands sent to the device. */
+static int finish_commands(struct jaylink_queue *queue)
+{
+	int ret;
+	struct queue_command *commands;
+
+	commands = queue->commands + queue->first;
+
+	if (queue->pending_length > 0) {
+		ret = receive_responses(queue->devh, commands,
+			queue->num_pending);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	} else {
+		for (size_t i = 0; i < queue->num_pending; i++)
+			commands[i].result = JAYLINK_OK;
+	}
+
+	queue->first += queue->num_pending;
+	queue->num_pending = 0;
+	queue->pending_length = 0;
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Abort a submitted queue. The pending responses are received in order to
+ * keep the device in sync, errors are ignored.
+ */
+static void abort_queue(struct jaylink_queue *queue)
+{
+	int ret;
+	bool ready;
+
+	ret = JAYLINK_OK;
+	ready = false;
+
+	while (queue->pending_length > 0 && !ready) {
+		ret = transport_poll_read(queue->devh, &ready);
+
+		if (ret != JAYLINK_OK)
+			break;
+
+		if (!ready)
+			thread_sleep(ABORT_INTERVAL);
+	}
+
+	if (ret == JAYLINK_OK)
+		finish_commands(queue);
+
+	queue->submitted = false;
+	transport_unlock(queue->devh);
+}
+
+static int get_first_error(const struct jaylink_queue *queue)
+{
+	for (size_t i = 0; i < queue->num_commands; i++) {
+		if (queue->commands[i].result != JAYLINK_OK)
+			return queue->commands[i].result;
+	}
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Execute a command queue.
+ *
+ * All commands of the queue are sent to the device with as few transfers as
+ * possible. Afterwards, the responses are split into the buffers of the
+ * individual commands. The result of each command can be retrieved with
+ * jaylink_queue_get_result().
+ *
+ * The commands remain in the queue after the execution, use
+ * jaylink_queue_clear() to remove them.
+ *
+ * @param[in,out] queue Command queue.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred, or the status bits of a C2
+ *                              poll did not have the expected value.
+ * @retval JAYLINK_ERR_PROTO Protocol violation of one of the operations.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_DEV_NO_MEMORY Not enough memory on the device to perform
+ *                                   one of the operations.
+ * @retval JAYLINK_ERR_DEV Unspecified device error of one of the operations.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_execute(struct jaylink_queue *queue)
+{
+	int ret;
+
+	if (!queue)
+		return JAYLINK_ERR_ARG;
+
+	if (queue->submitted)
+		return JAYLINK_ERR_ARG;
+
+	reset_results(queue);
+	transport_lock(queue->devh);
+
+	while (queue->first < queue->num_commands) {
+		ret = send_next_commands(queue);
+
+		if (ret != JAYLINK_OK) {
+			transport_unlock(queue->devh);
+			return ret;
+		}
+
+		ret = finish_commands(queue);
+
+		if (ret != JAYLINK_OK) {
+			transport_unlock(queue->devh);
+			return ret;
+		}
+	}
+
+	transport_unlock(queue->devh);
+
+	return get_first_error(queue);
+}
+
+/**
+ * Submit a command queue.
+ *
+ * This function is the non-blocking counterpart of jaylink_queue_execute().
+ * The commands of the queue are sent to the device but their responses are
+ * not waited for. Use jaylink_queue_complete() to process the responses once
+ * the file descriptors of jaylink_get_pollfds() indicate available data.
+ *
+ * If the responses of the commands exceed the amount of data the device is
+ * able to hold, the commands are sent in multiple parts. The next part is
+ * sent by jaylink_queue_complete() after the responses of the previous part
+ * have been processed.
+ *
+ * @note Neither the device handle must be used for other operations nor the
+ *       queue must be modified until the queue is completed. The queue must
+ *       be completed or freed by the same thread which submitted it.
+ *
+ * @param[in,out] queue Command queue.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the queue is already
+ *                         submitted.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @see jaylink_queue_complete()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_submit(struct jaylink_queue *queue)
+{
+	int ret;
+
+	if (!queue)
+		return JAYLINK_ERR_ARG;
+
+	if (queue->submitted)
+		return JAYLINK_ERR_ARG;
+
+	reset_results(queue);
+
+	/* The device handle stays locked until the queue is completed. */
+	transport_lock(queue->devh);
+	ret = send_next_commands(queue);
+
+	if (ret != JAYLINK_OK) {
+		transport_unlock(queue->devh);
+		return ret;
+	}
+
+	queue->submitted = true;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Complete a submitted command queue.
+ *
+ * The responses which are available are processed without blocking. Only
+ * reading the remaining data of a response that has already begun to arrive
+ * may block for a short time. The function must be called again until the
+ * queue is completed, typically whenever one of the file descriptors of
+ * jaylink_get_pollfds() is ready.
+ *
+ * On completion, the result of each command can be retrieved with
+ * jaylink_queue_get_result() as with jaylink_queue_execute().
+ *
+ * @param[in,out] queue Command queue.
+ * @param[out] completed Whether the queue is completed on success. On failure,
+ *                       the queue is always completed and this parameter is
+ *                       undefined.
+ *
+ * @retval JAYLINK_OK Success. The queue is either not completed yet or all
+ *                    of its commands were successful.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the queue is not submitted.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred, or the status bits of a C2
+ *                              poll did not have the expected value.
+ * @retval JAYLINK_ERR_PROTO Protocol violation of one of the operations.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_DEV_NO_MEMORY Not enough memory on the device to perform
+ *                                   one of the operations.
+ * @retval JAYLINK_ERR_DEV Unspecified device error of one of the operations.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @see jaylink_queue_submit()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_complete(struct jaylink_queue *queue,
+		bool *completed)
+{
+	int ret;
+	bool ready;
+
+	if (!queue || !completed)
+		return JAYLINK_ERR_ARG;
+
+	if (!queue->submitted)
+		return JAYLINK_ERR_ARG;
+
+	while (true) {
+		if (queue->pending_length > 0) {
+			ret = transport_poll_read(queue->devh, &ready);
+
+			if (ret != JAYLINK_OK)
+				break;
+
+			if (!ready) {
+				*completed = false;
+				return JAYLINK_OK;
+			}
+		}
+
+		ret = finish_commands(queue);
+
+		if (ret != JAYLINK_OK)
+			break;
+
+		if (queue->first == queue->num_commands) {
+			ret = get_first_error(queue);
+			break;
+		}
+
+		ret = send_next_commands(queue);
+
+		if (ret != JAYLINK_OK)
+			break;
+	}
+
+	queue->submitted = false;
+	*completed = true;
+	transport_unlock(queue->devh);
+
+	return ret;
+}
+
+/**
+ * Get the result of a command of an executed command queue.
+ *
+ * @param[in] queue Command queue.
+ * @param[in] index Index of the command in the order the commands were
+ *                  appended to the queue, starting at zero.
+ * @param[out] result Result of the command on success, and undefined on
+ *                    failure. The result is #JAYLINK_OK if the command was
+ *                    performed successfully, or one of the error codes of the
+ *                    equivalent function otherwise. If the command was not
+ *                    performed at all, the result is #JAYLINK_ERR.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_queue_get_result(const struct jaylink_queue *queue,
+		size_t index, int *result)
+{
+	if (!queue || !result)
+		return JAYLINK_ERR_ARG;
+
+	if (index >= queue->num_commands)
+		return JAYLINK_ERR_ARG;
+
+	*result = queue->commands[index].result;
+
+	return JAYLINK_OK;
+}
@@ -0,0 +1,243 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Single-producer / single-consumer ring buffer.
+ *
+ * The ring buffer is lock-free and can be used by exactly one producer and one
+ * consumer thread concurrently. The read and write positions are incremented
+ * continuously and wrap around at the maximum value of their type only. For
+ * that reason the buffer size is always a power of two.
+ */
+
+/**
+ * Initialize a ring buffer.
+ *
+ * @param[out] rb Ring buffer to be initialized.
+ * @param[in] size Minimum size of the ring buffer in bytes. The size is
+ *                 rounded up to the next power of two.
+ *
+ * @return Whether the ring buffer was successfully initialized.
+ */
+JAYLINK_PRIV bool ringbuffer_init(struct ringbuffer *rb, size_t size)
+{
+	size_t tmp;
+
+	if (!size)
+		return false;
+
+	tmp = 1;
+
+	while (tmp < size) {
+		if (tmp > SIZE_MAX / 2)
+			return false;
+
+		tmp <<= 1;
+	}
+
+	rb->buffer = malloc(tmp);
+
+	if (!rb->buffer)
+		return false;
+
+	rb->size = tmp;
+	rb->read_pos = 0;
+	rb->write_pos = 0;
+
+	return true;
+}
+
+/**
+ * Free the memory of a ring buffer.
+ *
+ * @param[in,out] rb Ring buffer.
+ */
+JAYLINK_PRIV void ringbuffer_free(struct ringbuffer *rb)
+{
+	free(rb->buffer);
+	rb->buffer = NULL;
+}
+
+/**
+ * Get the number of bytes available to be read from a ring buffer.
+ *
+ * @param[in] rb Ring buffer.
+ *
+ * @return Number of bytes available to be read.
+ */
+JAYLINK_PRIV size_t ringbuffer_get_length(const struct ringbuffer *rb)
+{
+	return ATOMIC_LOAD(&rb->write_pos) - ATOMIC_LOAD(&rb->read_pos);
+}
+
+/**
+ * Get the contiguous free space of a ring buffer.
+ *
+ * This function must be called by the producer only.
+ *
+ * @param[in] rb Ring buffer.
+ * @param[out] data Start of the free space.
+ *
+ * @return Number of bytes which can be written to @p data. Use
+ *         ringbuffer_commit() to make them available to the consumer.
+ */
+JAYLINK_PRIV size_t ringbuffer_get_write_area(const struct ringbuffer *rb,
+		uint8_t **data)
+{
+	size_t read_pos;
+	size_t offset;
+
+	read_pos = ATOMIC_LOAD(&rb->read_pos);
+	offset = rb->write_pos & (rb->size - 1);
+	*data = rb->buffer + offset;
+
+	return MIN(rb->size - (rb->write_pos - read_pos), rb->size - offset);
+}
+
+/**
+ * Make written data available to the consumer of a ring buffer.
+ *
+ * This function must be called by the producer only.
+ *
+ * @param[in,out] rb Ring buffer.
+ * @param[in] length Number of bytes written into the area returned by
+ *                   ringbuffer_get_write_area().
+ */
+JAYLINK_PRIV void ringbuffer_commit(struct ringbuffer *rb, size_t length)
+{
+	ATOMIC_STORE(&rb->write_pos, rb->write_pos + length);
+}
+
+/**
+ * Write data into a ring buffer.
+ *
+ * This function must be called by the producer only.
+ *
+ * @param[in,out] rb Ring buffer.
+ * @param[in] data Data to be written.
+ * @param[in] length Number of bytes to be written.
+ *
+ * @return Number of bytes written, which is less than @p length if the ring
+ *         buffer is full.
+ */
+JAYLINK_PRIV size_t ringbuffer_write(struct ringbuffer *rb,
+		const uint8_t *data, size_t length)
+{
+	uint8_t *area;
+	size_t written;
+	size_t tmp;
+
+	written = 0;
+
+	while (written < length) {
+		tmp = ringbuffer_get_write_area(rb, &area);
+
+		if (!tmp)
+			break;
+
+		tmp = MIN(tmp, length - written);
+		memcpy(area, data + written, tmp);
+		ringbuffer_commit(rb, tmp);
+		written += tmp;
+	}
+
+	return written;
+}
+
+/**
+ * Get the contiguous data available to be read from a ring buffer.
+ *
+ * This function must be called by the consumer only.
+ *
+ * @param[in] rb Ring buffer.
+ * @param[out] data Start of the available data.
+ *
+ * @return Number of bytes which can be read from @p data. Use
+ *         ringbuffer_consume() to release them.
+ */
+JAYLINK_PRIV size_t ringbuffer_get_read_area(const struct ringbuffer *rb,
+		const uint8_t **data)
+{
+	size_t write_pos;
+	size_t offset;
+
+	write_pos = ATOMIC_LOAD(&rb->write_pos);
+	offset = rb->read_pos & (rb->size - 1);
+	*data = rb->buffer + offset;
+
+	return MIN(write_pos - rb->read_pos, rb->size - offset);
+}
+
+/**
+ * Release read data of a ring buffer.
+ *
+ * This function must be called by the consumer only.
+ *
+ * @param[in,out] rb Ring buffer.
+ * @param[in] length Number of bytes to release.
+ */
+JAYLINK_PRIV void ringbuffer_consume(struct ringbuffer *rb, size_t length)
+{
+	ATOMIC_STORE(&rb->read_pos, rb->read_pos + length);
+}
+
+/**
+ * Read data from a ring buffer.
+ *
+ * This function must be called by the consumer only.
+ *
+ * @param[in,out] rb Ring buffer.
+ * @param[out] data Buffer to store the data.
+ * @param[in] length Maximum number of bytes to be read.
+ *
+ * @return Number of bytes read.
+ */
+JAYLINK_PRIV size_t ringbuffer_read(struct ringbuffer *rb, uint8_t *data,
+		size_t length)
+{
+	const uint8_t *area;
+	size_t num;
+	size_t tmp;
+
+	num = 0;
+
+	while (num < length) {
+		tmp = ringbuffer_get_read_area(rb, &area);
+
+		if (!tmp)
+			break;
+
+		tmp = MIN(tmp, length - num);
+		memcpy(data + num, area, tmp);
+		ringbuffer_consume(rb, tmp);
+		num += tmp;
+	}
+
+	return num;
+}
@@ -22,7 +22,10 @@
 #include <winsock2.h>
 #else
 #include <sys/types.h>
+#include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #endif
@@ -218,6 +221,128 @@ JAYLINK_PRIV bool socket_recv(int sock, void *buffer, size_t *length,
 	return true;
 }
 
+/**
+ * Send a message from multiple segments on a socket.
+ *
+ * @param[in] sock Socket descriptor.
+ * @param[in] iov Array of segments to send the message from.
+ * @param[in] count Number of segments, at most #MAX_IO_VECTORS.
+ * @param[out] length Number of bytes sent on success, and undefined on
+ *                    failure.
+ * @param[in] flags Flags to modify the function behaviour. Use bitwise OR to
+ *                  specify multiple flags.
+ *
+ * @return Whether the message was sent successfully.
+ */
+JAYLINK_PRIV bool socket_sendv(int sock, const struct io_vector *iov,
+		size_t count, size_t *length, int flags)
+{
+#ifdef _WIN32
+	WSABUF buffers[MAX_IO_VECTORS];
+	DWORD tmp;
+#else
+	struct iovec buffers[MAX_IO_VECTORS];
+	struct msghdr msg;
+	ssize_t ret;
+#endif
+
+	if (count > MAX_IO_VECTORS)
+		return false;
+
+	for (size_t i = 0; i < count; i++) {
+#ifdef _WIN32
+		buffers[i].buf = iov[i].buffer;
+		buffers[i].len = iov[i].length;
+#else
+		buffers[i].iov_base = iov[i].buffer;
+		buffers[i].iov_len = iov[i].length;
+#endif
+	}
+
+#ifdef _WIN32
+	if (WSASend(sock, buffers, count, &tmp, flags, NULL, NULL) != 0)
+		return false;
+
+	*length = tmp;
+#else
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = buffers;
+	msg.msg_iovlen = count;
+
+	ret = sendmsg(sock, &msg, flags);
+
+	if (ret < 0)
+		return false;
+
+	*length = ret;
+#endif
+
+	return true;
+}
+
+/**
+ * Receive a message into multiple segments from a socket.
+ *
+ * @param[in] sock Socket descriptor.
+ * @param[in] iov Array of segments to store the received message on success.
+ *                The content of the segments is undefined on failure.
+ * @param[in] count Number of segments, at most #MAX_IO_VECTORS.
+ * @param[out] length Number of bytes received on success, and undefined on
+ *                    failure.
+ * @param[in] flags Flags to modify the function behaviour. Use bitwise OR to
+ *                  specify multiple flags.
+ *
+ * @return Whether a message was successfully received.
+ */
+JAYLINK_PRIV bool socket_recvv(int sock, const struct io_vector *iov,
+		size_t count, size_t *length, int flags)
+{
+#ifdef _WIN32
+	WSABUF buffers[MAX_IO_VECTORS];
+	DWORD tmp;
+	DWORD tmp_flags;
+#else
+	struct iovec buffers[MAX_IO_VECTORS];
+	struct msghdr msg;
+	ssize_t ret;
+#endif
+
+	if (count > MAX_IO_VECTORS)
+		return false;
+
+	for (size_t i = 0; i < count; i++) {
+#ifdef _WIN32
+		buffers[i].buf = iov[i].buffer;
+		buffers[i].len = iov[i].length;
+#else
+		buffers[i].iov_base = iov[i].buffer;
+		buffers[i].iov_len = iov[i].length;
+#endif
+	}
+
+#ifdef _WIN32
+	tmp_flags = flags;
+
+	if (WSARecv(sock, buffers, count, &tmp, &tmp_flags, NULL, NULL) != 0)
+		return false;
+
+	*length = tmp;
+#else
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = buffers;
+	msg.msg_iovlen = count;
+
+	ret = recvmsg(sock, &msg, flags);
+
+	if (ret < 0)
+		return false;
+
+	*length = ret;
+#endif
+
+	return true;
+}
+
 /**
  * Send a message on a socket.
  *
@@ -384,3 +509,34 @@ JAYLINK_PRIV bool socket_set_blocking(int sock, bool blocking)
 #endif
 	return true;
 }
+
+/**
+ * Check whether data can be received from a socket without blocking.
+ *
+ * @param[in] sock Socket descriptor.
+ * @param[out] readable Whether data can be received on success, and undefined
+ *                      on failure.
+ *
+ * @return Whether the socket was checked successfully.
+ */
+JAYLINK_PRIV bool socket_is_readable(int sock, bool *readable)
+{
+	int ret;
+	fd_set fds;
+	struct timeval tv;
+
+	FD_ZERO(&fds);
+	FD_SET(sock, &fds);
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+
+	ret = select(sock + 1, &fds, NULL, NULL, &tv);
+
+	if (ret < 0)
+		return false;
+
+	*readable = ret > 0;
+
+	return true;
+}
@@ -92,12 +92,14 @@ JAYLINK_API int jaylink_spi_io(struct jaylink_device_handle *devh,
 	buffer_set_u32(buf, length * 8, 12);
 	buffer_set_u32(buf, flags, 16);
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 20 + mosi_length,
 		miso_length + 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -106,6 +108,7 @@ JAYLINK_API int jaylink_spi_io(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -115,6 +118,7 @@ JAYLINK_API int jaylink_spi_io(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_write() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return ret;
 		}
 	}
@@ -125,11 +129,13 @@ JAYLINK_API int jaylink_spi_io(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return ret;
 		}
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -0,0 +1,690 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Serial Peripheral Interface (SPI) flash functions.
+ *
+ * The flash parameters are taken from the JEDEC Serial Flash Discoverable
+ * Parameters (SFDP). All operations are built on the command queue such that
+ * the individual phases of a flash operation, including the polling of the
+ * status register, are performed with as few transfers as possible.
+ */
+
+/** @cond PRIVATE */
+#define CMD_WRITE_ENABLE	0x06
+#define CMD_READ_STATUS		0x05
+#define CMD_READ_JEDEC_ID	0x9f
+#define CMD_READ_SFDP		0x5a
+#define CMD_FAST_READ		0x0b
+#define CMD_PAGE_PROGRAM	0x02
+#define CMD_ENTER_4B_MODE	0xb7
+
+/** Write in progress (WIP) bit of the status register. */
+#define STATUS_WIP		0x01
+
+/** SFDP signature "SFDP" encoded in little-endian byte order. */
+#define SFDP_SIGNATURE		0x50444653
+
+/** Size of the SFDP header and the first parameter header in bytes. */
+#define SFDP_HEADER_SIZE	16
+
+/** Maximum number of dwords of the basic flash parameter table (BFPT). */
+#define BFPT_MAX_DWORDS		16
+
+/** Number of bytes of an SFDP read command including the dummy byte. */
+#define SFDP_CMD_LENGTH		5
+
+/** Number of bytes of a read data chunk. */
+#define READ_CHUNK_SIZE		4096
+
+/** Number of read data chunks queued at once. */
+#define READ_NUM_CHUNKS		16
+
+/**
+ * Number of bytes of a status register read.
+ *
+ * The flash outputs the status register continuously as long as chip select
+ * is asserted. The first byte is transferred during the opcode and is
+ * therefore not valid.
+ */
+#define STATUS_POLL_LENGTH	256
+
+/** Timeout of a page program operation in milliseconds. */
+#define PROGRAM_TIMEOUT		100
+
+/** Timeout of an erase operation in milliseconds. */
+#define ERASE_TIMEOUT		5000
+
+/** Largest flash size in bytes supported with 3-byte addresses. */
+#define MAX_SIZE_3B_ADDRESS	(1 << 24)
+
+#define CS_FRAME	(JAYLINK_SPI_FLAG_CS_START_0 | JAYLINK_SPI_FLAG_CS_END_1)
+#define CS_OPEN		(JAYLINK_SPI_FLAG_CS_START_0 | JAYLINK_SPI_FLAG_CS_END_U)
+#define CS_KEEP		(JAYLINK_SPI_FLAG_CS_START_U | JAYLINK_SPI_FLAG_CS_END_U)
+#define CS_CLOSE	(JAYLINK_SPI_FLAG_CS_START_U | JAYLINK_SPI_FLAG_CS_END_1)
+
+/** State of a flash operation. */
+struct flash_op {
+	/** Device handle. */
+	struct jaylink_device_handle *devh;
+	/** Flash information. */
+	const struct jaylink_spi_flash *flash;
+	/** Command queue. */
+	struct jaylink_queue *queue;
+	/** Command buffer. */
+	uint8_t cmd[6];
+	/** MOSI data of a status register read. */
+	uint8_t status_mosi[STATUS_POLL_LENGTH];
+	/** MISO data of a status register read. */
+	uint8_t status_miso[STATUS_POLL_LENGTH];
+};
+/** @endcond */
+
+static const uint8_t write_enable = CMD_WRITE_ENABLE;
+
+static size_t set_address(const struct jaylink_spi_flash *flash,
+		uint8_t *buffer, uint32_t address)
+{
+	for (uint8_t i = 0; i < flash->address_length; i++)
+		buffer[i] = address >> (8 * (flash->address_length - i - 1));
+
+	return flash->address_length;
+}
+
+static int read_sfdp(struct jaylink_device_handle *devh, uint32_t address,
+		uint8_t *buffer, size_t length)
+{
+	int ret;
+	uint8_t buf[SFDP_CMD_LENGTH + BFPT_MAX_DWORDS * 4];
+
+	memset(buf, 0x00, sizeof(buf));
+	buf[0] = CMD_READ_SFDP;
+	buf[1] = address >> 16;
+	buf[2] = address >> 8;
+	buf[3] = address;
+
+	ret = jaylink_spi_io(devh, buf, buf, SFDP_CMD_LENGTH + length,
+		CS_FRAME);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	memcpy(buffer, buf + SFDP_CMD_LENGTH, length);
+
+	return JAYLINK_OK;
+}
+
+static void parse_bfpt(struct jaylink_spi_flash *flash, const uint8_t *bfpt,
+		size_t num_dwords)
+{
+	uint32_t tmp;
+	uint8_t exponent;
+
+	tmp = buffer_get_u32(bfpt, 4);
+
+	/* Bit 31 indicates that the density is encoded as power of two. */
+	if (tmp & 0x80000000) {
+		tmp &= 0x7fffffff;
+		flash->size = (tmp < 64) ? ((uint64_t)1 << tmp) / 8 : UINT64_MAX;
+	} else {
+		flash->size = ((uint64_t)tmp + 1) / 8;
+	}
+
+	tmp = buffer_get_u32(bfpt, 0);
+
+	/* Bits 18..17 contain the supported address lengths. */
+	switch ((tmp >> 17) & 0x03) {
+	case 0x01:
+		flash->address_length =
+			(flash->size > MAX_SIZE_3B_ADDRESS) ? 4 : 3;
+		break;
+	case 0x02:
+		flash->address_length = 4;
+		break;
+	default:
+		flash->address_length = 3;
+		break;
+	}
+
+	/* Bits 1..0 indicate whether 4 KiB erase is supported. */
+	if ((tmp & 0x03) == 0x01) {
+		flash->erase_size = 4096;
+		flash->erase_opcode = tmp >> 8;
+	} else {
+		flash->erase_size = 0;
+		flash->erase_opcode = 0;
+	}
+
+	/* Dwords 8 and 9 describe up to four erase types. */
+	for (size_t i = 0; num_dwords >= 9 && i < 4; i++) {
+		exponent = bfpt[28 + 2 * i];
+
+		if (!exponent || exponent > 31)
+			continue;
+
+		if (!flash->erase_size ||
+				((uint32_t)1 << exponent) < flash->erase_size) {
+			flash->erase_size = (uint32_t)1 << exponent;
+			flash->erase_opcode = bfpt[29 + 2 * i];
+		}
+	}
+
+	/* Bits 7..4 of dword 11 contain the page size as power of two. */
+	if (num_dwords >= 11)
+		flash->page_size = 1 << ((bfpt[40] >> 4) & 0x0f);
+	else
+		flash->page_size = 256;
+}
+
+/**
+ * Probe a SPI flash.
+ *
+ * The JEDEC ID and the JEDEC basic flash parameter table of the Serial Flash
+ * Discoverable Parameters (SFDP) are read from the flash. If the flash is
+ * larger than 16 MiB and supports both 3-byte and 4-byte addresses, it is
+ * switched into 4-byte address mode.
+ *
+ * @note This function must only be used if the device has the
+ *       #JAYLINK_DEV_CAP_SPI capability and if the #JAYLINK_TIF_SPI interface
+ *       is available and selected.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] flash Flash information on success, and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_PROTO Protocol violation.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_NOT_AVAILABLE The flash does not provide the SFDP.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED The flash is not supported.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_spi_flash_probe(struct jaylink_device_handle *devh,
+		struct jaylink_spi_flash *flash)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint8_t buf[BFPT_MAX_DWORDS * 4];
+	uint32_t address;
+	size_t num_dwords;
+
+	if (!devh || !flash)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+
+	memset(buf, 0x00, 4);
+	buf[0] = CMD_READ_JEDEC_ID;
+
+	ret = jaylink_spi_io(devh, buf, buf, 4, CS_FRAME);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "jaylink_spi_io() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	memcpy(flash->jedec_id, buf + 1, 3);
+
+	ret = read_sfdp(devh, 0, buf, SFDP_HEADER_SIZE);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "read_sfdp() failed: %s", jaylink_strerror(ret));
+		return ret;
+	}
+
+	if (buffer_get_u32(buf, 0) != SFDP_SIGNATURE) {
+		log_dbg(ctx, "SPI flash does not provide SFDP");
+		return JAYLINK_ERR_NOT_AVAILABLE;
+	}
+
+	/* The first parameter table is always the basic flash table. */
+	if (buf[8] != 0x00 || buf[15] != 0xff) {
+		log_err(ctx, "SFDP basic flash parameter table not found");
+		return JAYLINK_ERR_NOT_AVAILABLE;
+	}
+
+	num_dwords = MIN(buf[11], BFPT_MAX_DWORDS);
+	address = buf[12] | (buf[13] << 8) | (buf[14] << 16);
+
+	if (num_dwords < 2) {
+		log_err(ctx, "SFDP basic flash parameter table too short");
+		return JAYLINK_ERR_NOT_AVAILABLE;
+	}
+
+	ret = read_sfdp(devh, address, buf, num_dwords * 4);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "read_sfdp() failed: %s", jaylink_strerror(ret));
+		return ret;
+	}
+
+	parse_bfpt(flash, buf, num_dwords);
+
+	if (flash->size > UINT32_MAX) {
+		log_err(ctx, "SPI flash with %llu bytes is not supported",
+			(unsigned long long)flash->size);
+		return JAYLINK_ERR_NOT_SUPPORTED;
+	}
+
+	log_dbg(ctx, "SPI flash: %llu bytes, page size = %u bytes, "
+		"erase size = %u bytes, address length = %u bytes",
+		(unsigned long long)flash->size, flash->page_size,
+		flash->erase_size, flash->address_length);
+
+	/*
+	 * Switch into 4-byte address mode only if the flash also supports
+	 * 3-byte addresses, see bits 18..17 of the first dword.
+	 */
+	if (flash->address_length == 3 ||
+			((buffer_get_u32(buf, 0) >> 17) & 0x03) != 0x01)
+		return JAYLINK_OK;
+
+	ret = jaylink_spi_io(devh, &write_enable, NULL, 1, CS_FRAME);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "jaylink_spi_io() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	buf[0] = CMD_ENTER_4B_MODE;
+	ret = jaylink_spi_io(devh, buf, NULL, 1, CS_FRAME);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "jaylink_spi_io() failed: %s",
+			jaylink_strerror(ret));
+		return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int init_op(struct flash_op *op, struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash)
+{
+	int ret;
+
+	op->devh = devh;
+	op->flash = flash;
+
+	memset(op->status_mosi, 0x00, STATUS_POLL_LENGTH);
+	op->status_mosi[0] = CMD_READ_STATUS;
+
+	ret = jaylink_queue_new(devh, &op->queue);
+
+	if (ret != JAYLINK_OK)
+		log_err(devh->dev->ctx, "jaylink_queue_new() failed: %s",
+			jaylink_strerror(ret));
+
+	return ret;
+}
+
+static bool is_ready(const struct flash_op *op)
+{
+	for (size_t i = 1; i < STATUS_POLL_LENGTH; i++) {
+		if (!(op->status_miso[i] & STATUS_WIP))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Execute the queued commands of a program or erase operation followed by a
+ * status register read, and continue to read the status register until the
+ * operation is completed. In the best case, the whole operation is performed
+ * with a single transfer.
+ */
+static int execute_op(struct flash_op *op, uint32_t timeout)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	uint64_t start;
+
+	ctx = op->devh->dev->ctx;
+	start = util_get_timestamp();
+
+	while (true) {
+		ret = jaylink_queue_spi_io(op->queue, op->status_mosi,
+			op->status_miso, STATUS_POLL_LENGTH, CS_FRAME);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "jaylink_queue_spi_io() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		ret = jaylink_queue_execute(op->queue);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "jaylink_queue_execute() failed: %s",
+				jaylink_strerror(ret));
+			return ret;
+		}
+
+		jaylink_queue_clear(op->queue);
+
+		if (is_ready(op))
+			return JAYLINK_OK;
+
+		if (util_get_timestamp() - start > (uint64_t)timeout * 1000) {
+			log_err(ctx, "SPI flash operation timed out");
+			return JAYLINK_ERR_TIMEOUT;
+		}
+	}
+}
+
+static int queue_write_command(struct flash_op *op, uint8_t opcode,
+		uint32_t address, uint32_t flags)
+{
+	size_t length;
+
+	op->cmd[0] = opcode;
+	length = 1 + set_address(op->flash, op->cmd + 1, address);
+
+	return jaylink_queue_spi_io(op->queue, op->cmd, NULL, length, flags);
+}
+
+/**
+ * Read from a SPI flash.
+ *
+ * The data is read with a single fast read command and passed to the callback
+ * function in chunks. Multiple chunks are requested from the device at once.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] flash Flash information, see jaylink_spi_flash_probe().
+ * @param[in] address Start address.
+ * @param[in] length Number of bytes to read.
+ * @param[in] callback Callback function to be called for the read data.
+ * @param[in,out] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_PROTO Protocol violation.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @return Any other value is returned by the callback function and indicates
+ *         that the read was aborted.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_spi_flash_read(struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash, uint32_t address,
+		uint32_t length, jaylink_spi_flash_read_callback callback,
+		void *user_data)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct flash_op op;
+	uint8_t *buffer;
+	uint32_t offset;
+	uint32_t num_chunks;
+	uint32_t tmp;
+	uint64_t end;
+	bool selected;
+
+	if (!devh || !flash || !length || !callback)
+		return JAYLINK_ERR_ARG;
+
+	if (address + (uint64_t)length > flash->size)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+	buffer = malloc(READ_CHUNK_SIZE * READ_NUM_CHUNKS);
+
+	if (!buffer) {
+		log_err(ctx, "SPI flash read buffer malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	ret = init_op(&op, devh, flash);
+
+	if (ret != JAYLINK_OK) {
+		free(buffer);
+		return ret;
+	}
+
+	/* The fast read command requires a dummy byte after the address. */
+	op.cmd[0] = CMD_FAST_READ;
+	tmp = 1 + set_address(flash, op.cmd + 1, address);
+	op.cmd[tmp++] = 0x00;
+
+	ret = jaylink_queue_spi_io(op.queue, op.cmd, NULL, tmp, CS_OPEN);
+	offset = 0;
+	selected = false;
+
+	while (ret == JAYLINK_OK && offset < length) {
+		num_chunks = 0;
+
+		for (uint64_t i = offset; i < length && num_chunks <
+				READ_NUM_CHUNKS; i += READ_CHUNK_SIZE) {
+			tmp = MIN(length - i, READ_CHUNK_SIZE);
+			end = i + tmp;
+			ret = jaylink_queue_spi_io(op.queue, NULL,
+				buffer + num_chunks * READ_CHUNK_SIZE, tmp,
+				(end == length) ? CS_CLOSE : CS_KEEP);
+
+			if (ret != JAYLINK_OK)
+				break;
+
+			num_chunks++;
+		}
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "jaylink_queue_spi_io() failed: %s",
+				jaylink_strerror(ret));
+			break;
+		}
+
+		selected = true;
+		ret = jaylink_queue_execute(op.queue);
+
+		if (ret != JAYLINK_OK) {
+			log_err(ctx, "jaylink_queue_execute() failed: %s",
+				jaylink_strerror(ret));
+			break;
+		}
+
+		jaylink_queue_clear(op.queue);
+
+		for (uint32_t i = 0; ret == JAYLINK_OK && i < num_chunks; i++) {
+			tmp = MIN(length - offset, READ_CHUNK_SIZE);
+			ret = callback(devh, buffer + i * READ_CHUNK_SIZE, tmp,
+				user_data);
+			offset += tmp;
+		}
+	}
+
+	/*
+	 * Release chip select if the read is aborted or failed after the
+	 * read command was sent.
+	 */
+	if (ret != JAYLINK_OK && selected && offset < length)
+		jaylink_spi_io(devh, NULL, op.cmd, 1, CS_CLOSE);
+
+	jaylink_queue_free(op.queue);
+	free(buffer);
+
+	return ret;
+}
+
+/**
+ * Erase a SPI flash.
+ *
+ * Each erase operation is sent to the device together with the write enable
+ * command and the first status register read.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] flash Flash information, see jaylink_spi_flash_probe().
+ * @param[in] address Start address. The address must be aligned to the erase
+ *                    size of the flash.
+ * @param[in] length Number of bytes to erase. The number must be a multiple of
+ *                   the erase size of the flash.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_PROTO Protocol violation.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED The flash does not provide an erase
+ *                                   operation.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_spi_flash_erase(struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash, uint32_t address,
+		uint32_t length)
+{
+	int ret;
+	struct flash_op op;
+
+	if (!devh || !flash || !length)
+		return JAYLINK_ERR_ARG;
+
+	if (!flash->erase_size)
+		return JAYLINK_ERR_NOT_SUPPORTED;
+
+	if (address % flash->erase_size || length % flash->erase_size)
+		return JAYLINK_ERR_ARG;
+
+	if (address + (uint64_t)length > flash->size)
+		return JAYLINK_ERR_ARG;
+
+	ret = init_op(&op, devh, flash);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	for (uint64_t i = 0; i < length; i += flash->erase_size) {
+		ret = jaylink_queue_spi_io(op.queue, &write_enable, NULL, 1,
+			CS_FRAME);
+
+		if (ret == JAYLINK_OK)
+			ret = queue_write_command(&op, flash->erase_opcode,
+				address + i, CS_FRAME);
+
+		if (ret == JAYLINK_OK)
+			ret = execute_op(&op, ERASE_TIMEOUT);
+
+		if (ret != JAYLINK_OK)
+			break;
+	}
+
+	jaylink_queue_free(op.queue);
+
+	return ret;
+}
+
+/**
+ * Program a SPI flash.
+ *
+ * The data is programmed page by page. Each page program operation is sent to
+ * the device together with the write enable command and the first status
+ * register read such that a page is usually programmed with a single
+ * transfer.
+ *
+ * @note The flash must be erased before.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] flash Flash information, see jaylink_spi_flash_probe().
+ * @param[in] address Start address.
+ * @param[in] buffer Buffer to read the data to be programmed from.
+ * @param[in] length Number of bytes to program.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_PROTO Protocol violation.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_spi_flash_program(struct jaylink_device_handle *devh,
+		const struct jaylink_spi_flash *flash, uint32_t address,
+		const uint8_t *buffer, uint32_t length)
+{
+	int ret;
+	struct flash_op op;
+	uint32_t offset;
+	uint32_t tmp;
+
+	if (!devh || !flash || !buffer || !length || !flash->page_size)
+		return JAYLINK_ERR_ARG;
+
+	if (address + (uint64_t)length > flash->size)
+		return JAYLINK_ERR_ARG;
+
+	ret = init_op(&op, devh, flash);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	offset = 0;
+
+	while (offset < length) {
+		/* A page program operation must not cross a page boundary. */
+		tmp = flash->page_size - (address + offset) % flash->page_size;
+		tmp = MIN(tmp, length - offset);
+
+		ret = jaylink_queue_spi_io(op.queue, &write_enable, NULL, 1,
+			CS_FRAME);
+
+		if (ret == JAYLINK_OK)
+			ret = queue_write_command(&op, CMD_PAGE_PROGRAM,
+				address + offset, CS_OPEN);
+
+		if (ret == JAYLINK_OK)
+			ret = jaylink_queue_spi_io(op.queue, buffer + offset,
+				NULL, tmp, CS_CLOSE);
+
+		if (ret == JAYLINK_OK)
+			ret = execute_op(&op, PROGRAM_TIMEOUT);
+
+		if (ret != JAYLINK_OK)
+			break;
+
+		offset += tmp;
+	}
+
+	jaylink_queue_free(op.queue);
+
+	return ret;
+}
@@ -0,0 +1,276 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Input / output statistics.
+ */
+
+static size_t get_bucket(uint64_t latency)
+{
+	size_t bucket;
+
+	bucket = 0;
+
+	while (latency >= 2 && bucket < JAYLINK_LATENCY_BUCKETS - 1) {
+		latency >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/**
+ * Start the latency measurement of a command.
+ *
+ * The measurement of the previous command, if any, is finished.
+ *
+ * @param[in,out] devh Device handle.
+ */
+JAYLINK_PRIV void stats_start_command(struct jaylink_device_handle *devh)
+{
+	stats_finish_command(devh);
+
+	devh->cmd_active = true;
+	devh->cmd_has_opcode = false;
+	devh->cmd_start = util_get_timestamp();
+	devh->last_io = devh->cmd_start;
+}
+
+/**
+ * Set the opcode of the measured command.
+ *
+ * Only the first opcode after the start of the measurement is used.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] opcode Command opcode.
+ */
+JAYLINK_PRIV void stats_set_opcode(struct jaylink_device_handle *devh,
+		uint8_t opcode)
+{
+	if (!devh->cmd_active || devh->cmd_has_opcode)
+		return;
+
+	devh->cmd_opcode = opcode;
+	devh->cmd_has_opcode = true;
+}
+
+/**
+ * Finish the latency measurement of a command.
+ *
+ * The latency is the time from the start of the measurement until the last
+ * completed input / output operation.
+ *
+ * @param[in,out] devh Device handle.
+ */
+JAYLINK_PRIV void stats_finish_command(struct jaylink_device_handle *devh)
+{
+	struct jaylink_command_stats *stats;
+	uint64_t latency;
+
+	if (!devh->cmd_active)
+		return;
+
+	devh->cmd_active = false;
+
+	if (!devh->cmd_has_opcode)
+		return;
+
+	latency = devh->last_io - devh->cmd_start;
+	mutex_lock(&devh->stats_mutex);
+
+	if (devh->command_stats) {
+		stats = &devh->command_stats[devh->cmd_opcode];
+		stats->count++;
+		stats->total_latency += latency;
+		stats->histogram[get_bucket(latency)]++;
+
+		if (latency > stats->max_latency)
+			stats->max_latency = latency;
+	}
+
+	mutex_unlock(&devh->stats_mutex);
+}
+
+/**
+ * Get the input / output statistics of a device handle.
+ *
+ * The statistics are collected since the device was opened or since the last
+ * call of jaylink_reset_io_stats().
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] stats Statistics on success, and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_get_io_stats(struct jaylink_device_handle *devh,
+		struct jaylink_io_stats *stats)
+{
+	if (!devh || !stats)
+		return JAYLINK_ERR_ARG;
+
+	stats->bytes_written = ATOMIC_LOAD(&devh->io_stats.bytes_written);
+	stats->bytes_read = ATOMIC_LOAD(&devh->io_stats.bytes_read);
+	stats->num_writes = ATOMIC_LOAD(&devh->io_stats.num_writes);
+	stats->num_reads = ATOMIC_LOAD(&devh->io_stats.num_reads);
+	stats->num_timeouts = ATOMIC_LOAD(&devh->io_stats.num_timeouts);
+	stats->num_retries = ATOMIC_LOAD(&devh->io_stats.num_retries);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Reset the input / output statistics of a device handle.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_reset_io_stats(struct jaylink_device_handle *devh)
+{
+	if (!devh)
+		return JAYLINK_ERR_ARG;
+
+	ATOMIC_STORE(&devh->io_stats.bytes_written, 0);
+	ATOMIC_STORE(&devh->io_stats.bytes_read, 0);
+	ATOMIC_STORE(&devh->io_stats.num_writes, 0);
+	ATOMIC_STORE(&devh->io_stats.num_reads, 0);
+	ATOMIC_STORE(&devh->io_stats.num_timeouts, 0);
+	ATOMIC_STORE(&devh->io_stats.num_retries, 0);
+
+	/* The measurement of a command is done with the device handle locked. */
+	transport_lock(devh);
+	devh->cmd_active = false;
+	mutex_lock(&devh->stats_mutex);
+
+	if (devh->command_stats)
+		memset(devh->command_stats, 0, JAYLINK_NUM_COMMANDS *
+			sizeof(struct jaylink_command_stats));
+
+	mutex_unlock(&devh->stats_mutex);
+	transport_unlock(devh);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Enable or disable the statistics of the protocol commands.
+ *
+ * The statistics of the protocol commands are disabled by default. They are
+ * reset when they are enabled.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] enable Determines whether to enable or disable the statistics.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ *
+ * @see jaylink_get_command_stats()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_enable_command_stats(
+		struct jaylink_device_handle *devh, bool enable)
+{
+	struct jaylink_command_stats *stats;
+
+	if (!devh)
+		return JAYLINK_ERR_ARG;
+
+	stats = NULL;
+
+	if (enable) {
+		stats = calloc(JAYLINK_NUM_COMMANDS,
+			sizeof(struct jaylink_command_stats));
+
+		if (!stats) {
+			log_err(devh->dev->ctx, "Command statistics malloc "
+				"failed");
+			return JAYLINK_ERR_MALLOC;
+		}
+	}
+
+	mutex_lock(&devh->stats_mutex);
+
+	free(devh->command_stats);
+	devh->command_stats = stats;
+
+	mutex_unlock(&devh->stats_mutex);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get the statistics of a protocol command.
+ *
+ * The statistics are collected since they were enabled or since the last call
+ * of jaylink_reset_io_stats().
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] opcode Opcode of the command.
+ * @param[out] stats Statistics of the command on success, and undefined on
+ *                   failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR The statistics of the protocol commands are not enabled.
+ *
+ * @see jaylink_enable_command_stats()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_get_command_stats(struct jaylink_device_handle *devh,
+		uint8_t opcode, struct jaylink_command_stats *stats)
+{
+	if (!devh || !stats)
+		return JAYLINK_ERR_ARG;
+
+	/* The measurement of a command is done with the device handle locked. */
+	transport_lock(devh);
+	stats_finish_command(devh);
+	transport_unlock(devh);
+
+	mutex_lock(&devh->stats_mutex);
+
+	if (!devh->command_stats) {
+		mutex_unlock(&devh->stats_mutex);
+		return JAYLINK_ERR;
+	}
+
+	*stats = devh->command_stats[opcode];
+	mutex_unlock(&devh->stats_mutex);
+
+	return JAYLINK_OK;
+}
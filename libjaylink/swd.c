@@ -17,8 +17,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "libjaylink.h"
 #include "libjaylink-internal.h"
@@ -37,6 +40,18 @@
  * perform the SWD I/O operation.
  */
 #define SWD_IO_ERR_NO_MEMORY	0x06
+
+/** Number of bits of a SWD transaction, excluding idle cycles. */
+#define TRANSACTION_LENGTH	46
+
+/**
+ * Maximum number of bits of a single SWD I/O operation used for SWD
+ * transactions.
+ *
+ * The limit ensures that the data of an operation fits into the memory of all
+ * devices.
+ */
+#define MAX_IO_LENGTH		(2048 * 8)
 /** @endcond */
 
 /**
@@ -76,6 +91,7 @@ JAYLINK_API int jaylink_swd_io(struct jaylink_device_handle *devh,
 	struct jaylink_context *ctx;
 	uint16_t num_bytes;
 	uint8_t buf[4];
+	struct io_vector iov[3];
 	uint8_t status;
 
 	if (!devh || !direction || !out || !in || !length)
@@ -84,12 +100,14 @@ JAYLINK_API int jaylink_swd_io(struct jaylink_device_handle *devh,
 	ctx = devh->dev->ctx;
 	num_bytes = (length + 7) / 8;
 
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 4 + 2 * num_bytes,
 		num_bytes + 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -97,52 +115,265 @@ JAYLINK_API int jaylink_swd_io(struct jaylink_device_handle *devh,
 	buf[1] = 0x00;
 	buffer_set_u16(buf, length, 2);
 
-	ret = transport_write(devh, buf, 4);
+	iov[0].buffer = buf;
+	iov[0].length = 4;
+	iov[1].buffer = (uint8_t *)direction;
+	iov[1].length = num_bytes;
+	iov[2].buffer = (uint8_t *)out;
+	iov[2].length = num_bytes;
+
+	ret = transport_writev(devh, iov, 3);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_write() failed: %s",
+		log_err(ctx, "transport_writev() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
-	ret = transport_write(devh, direction, num_bytes);
+	iov[0].buffer = in;
+	iov[0].length = num_bytes;
+	iov[1].buffer = &status;
+	iov[1].length = 1;
+
+	ret = transport_readv(devh, iov, 2);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_write() failed: %s",
+		log_err(ctx, "transport_readv() failed: %s",
 			jaylink_strerror(ret));
 		return ret;
 	}
 
-	ret = transport_write(devh, out, num_bytes);
+	if (status == SWD_IO_ERR_NO_MEMORY) {
+		return JAYLINK_ERR_DEV_NO_MEMORY;
+	} else if (status > 0) {
+		log_err(ctx, "SWD I/O operation failed: 0x%x", status);
+		return JAYLINK_ERR_DEV;
+	}
 
-	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_write() failed: %s",
-			jaylink_strerror(ret));
-		return ret;
+	return JAYLINK_OK;
+}
+
+static bool parity(uint32_t value)
+{
+	value ^= value >> 16;
+	value ^= value >> 8;
+	value ^= value >> 4;
+	value ^= value >> 2;
+	value ^= value >> 1;
+
+	return value & 1;
+}
+
+static uint8_t request_header(const struct jaylink_swd_transaction *t)
+{
+	uint8_t header;
+
+	/* Start and park bit. */
+	header = 0x81;
+
+	if (t->ap)
+		header |= 0x02;
+
+	if (t->read)
+		header |= 0x04;
+
+	/* Address bits A[3:2]. */
+	header |= (t->address & 0x0c) << 1;
+
+	if (parity(header & 0x1e))
+		header |= 0x20;
+
+	return header;
+}
+
+/*
+ * Encode a transaction into the direction and output buffers. The direction
+ * bits are set for all bits driven by the host.
+ */
+static void encode_transaction(uint8_t *direction, uint8_t *out,
+		size_t offset, const struct jaylink_swd_transaction *t,
+		uint8_t idle_cycles)
+{
+	jaylink_bits_fill(direction, offset, 8, 0x01, 1);
+	jaylink_bits_set(out, offset, request_header(t), 8);
+	offset += 8;
+
+	if (t->read) {
+		/*
+		 * Turnaround, acknowledge, data, parity and turnaround are
+		 * driven by the target.
+		 */
+		offset += 1 + 3 + 32 + 1 + 1;
+	} else {
+		/* Turnaround, acknowledge and turnaround. */
+		offset += 1 + 3 + 1;
+
+		jaylink_bits_fill(direction, offset, 32, 0x01, 1);
+		jaylink_bits_set(out, offset, t->data, 32);
+		offset += 32;
+
+		jaylink_bits_set(direction, offset, 0x01, 1);
+		jaylink_bits_set(out, offset, parity(t->data), 1);
+		offset += 1;
 	}
 
-	ret = transport_read(devh, in, num_bytes);
+	/* Idle cycles with the data line driven low. */
+	jaylink_bits_fill(direction, offset, idle_cycles, 0x01, 1);
+}
 
-	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_read() failed: %s",
-			jaylink_strerror(ret));
-		return ret;
+static void decode_transaction(const uint8_t *in, size_t offset,
+		struct jaylink_swd_transaction *t)
+{
+	/* Skip request and turnaround. */
+	offset += 8 + 1;
+
+	t->ack = jaylink_bits_get(in, offset, 3);
+	offset += 3;
+
+	t->parity_error = false;
+
+	if (!t->read)
+		return;
+
+	if (t->ack != JAYLINK_SWD_ACK_OK)
+		return;
+
+	t->data = jaylink_bits_get(in, offset, 32);
+	offset += 32;
+
+	t->parity_error = jaylink_bits_get(in, offset, 1) != parity(t->data);
+}
+
+/**
+ * Perform SWD transactions.
+ *
+ * The transactions are packed into as few SWD I/O operations as possible
+ * which are sent to the device at once. Afterwards, the acknowledge responses
+ * and read data are decoded into the transactions.
+ *
+ * @note This function must only be used if the #JAYLINK_TIF_SWD interface is
+ *       available and selected.
+ *
+ * @note All transactions are performed regardless of the acknowledge
+ *       responses of previous transactions. A transaction which is not
+ *       acknowledged with #JAYLINK_SWD_ACK_OK still has a data phase and
+ *       therefore requires the overrun detection of the target to be enabled,
+ *       see the ORUNDETECT bit of the CTRL/STAT register. The results of all
+ *       transactions after such a transaction are not reliable and the
+ *       transactions should be repeated after the condition is cleared.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in,out] transactions Array of transactions. On success, the
+ *                             acknowledge response, the parity error
+ *                             indication and the data of read accesses are
+ *                             updated. Their content is undefined on failure.
+ * @param[in] count Number of transactions.
+ * @param[in] idle_cycles Number of idle cycles after each transaction.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR_DEV_NO_MEMORY Not enough memory on the device to perform
+ *                                   the operation.
+ * @retval JAYLINK_ERR_DEV Unspecified device error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @see jaylink_swd_io()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swd_transfer(struct jaylink_device_handle *devh,
+		struct jaylink_swd_transaction *transactions, size_t count,
+		uint8_t idle_cycles)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct jaylink_queue *queue;
+	size_t transaction_length;
+	size_t per_io;
+	size_t num_io;
+	size_t io_bytes;
+	uint8_t *buffer;
+	uint8_t *direction;
+	uint8_t *out;
+	uint8_t *in;
+	size_t num;
+	size_t length;
+
+	if (!devh || !transactions || !count)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+
+	transaction_length = TRANSACTION_LENGTH + idle_cycles;
+	per_io = MAX_IO_LENGTH / transaction_length;
+	num_io = (count + per_io - 1) / per_io;
+	io_bytes = (MIN(count, per_io) * transaction_length + 7) / 8;
+
+	buffer = malloc(3 * num_io * io_bytes);
+
+	if (!buffer) {
+		log_err(ctx, "Transaction buffer malloc failed");
+		return JAYLINK_ERR_MALLOC;
 	}
 
-	ret = transport_read(devh, &status, 1);
+	direction = buffer;
+	out = buffer + num_io * io_bytes;
+	in = buffer + 2 * num_io * io_bytes;
+
+	memset(buffer, 0, 2 * num_io * io_bytes);
+
+	for (size_t i = 0; i < count; i++) {
+		encode_transaction(direction + (i / per_io) * io_bytes,
+			out + (i / per_io) * io_bytes,
+			(i % per_io) * transaction_length, &transactions[i],
+			idle_cycles);
+	}
+
+	if (num_io == 1) {
+		ret = jaylink_swd_io(devh, direction, out, in,
+			count * transaction_length);
+	} else {
+		ret = jaylink_queue_new(devh, &queue);
+
+		if (ret != JAYLINK_OK) {
+			free(buffer);
+			return ret;
+		}
+
+		for (size_t i = 0; i < num_io; i++) {
+			num = MIN(per_io, count - i * per_io);
+			length = num * transaction_length;
+
+			ret = jaylink_queue_swd_io(queue,
+				direction + i * io_bytes, out + i * io_bytes,
+				in + i * io_bytes, length);
+
+			if (ret != JAYLINK_OK)
+				break;
+		}
+
+		if (ret == JAYLINK_OK)
+			ret = jaylink_queue_execute(queue);
+
+		jaylink_queue_free(queue);
+	}
 
 	if (ret != JAYLINK_OK) {
-		log_err(ctx, "transport_read() failed: %s",
-			jaylink_strerror(ret));
+		free(buffer);
 		return ret;
 	}
 
-	if (status == SWD_IO_ERR_NO_MEMORY) {
-		return JAYLINK_ERR_DEV_NO_MEMORY;
-	} else if (status > 0) {
-		log_err(ctx, "SWD I/O operation failed: 0x%x", status);
-		return JAYLINK_ERR_DEV;
+	for (size_t i = 0; i < count; i++) {
+		decode_transaction(in + (i / per_io) * io_bytes,
+			(i % per_io) * transaction_length, &transactions[i]);
 	}
 
+	free(buffer);
+
 	return JAYLINK_OK;
 }
@@ -17,8 +17,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include "libjaylink.h"
 #include "libjaylink-internal.h"
@@ -43,6 +45,12 @@
 #define SWO_PARAM_BUFFER_SIZE	0x04
 
 #define SWO_ERR			0x80000000
+
+/**
+ * Maximum number of bytes requested from the device with a single read
+ * operation of a SWO stream.
+ */
+#define STREAM_MAX_READ_SIZE	0x4000
 /** @endcond */
 
 /**
@@ -83,11 +91,13 @@ JAYLINK_API int jaylink_swo_start(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 21, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -113,10 +123,12 @@ JAYLINK_API int jaylink_swo_start(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -164,11 +176,13 @@ JAYLINK_API int jaylink_swo_stop(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 3, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -181,10 +195,12 @@ JAYLINK_API int jaylink_swo_stop(struct jaylink_device_handle *devh)
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -240,11 +256,13 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 9, 8, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -262,6 +280,7 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -270,6 +289,7 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -279,6 +299,7 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 	if (tmp > *length) {
 		log_err(ctx, "Received %u bytes but only %u bytes were "
 			"requested", tmp, *length);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
@@ -290,6 +311,7 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_start_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return ret;
 		}
 
@@ -298,10 +320,13 @@ JAYLINK_API int jaylink_swo_read(struct jaylink_device_handle *devh,
 		if (ret != JAYLINK_OK) {
 			log_err(ctx, "transport_read() failed: %s",
 				jaylink_strerror(ret));
+			transport_unlock(devh);
 			return ret;
 		}
 	}
 
+	transport_unlock(devh);
+
 	if (status > 0) {
 		log_err(ctx, "Failed to read data: 0x%x", status);
 		return JAYLINK_ERR_DEV;
@@ -358,11 +383,13 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 9, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -380,6 +407,7 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -388,6 +416,7 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -396,6 +425,7 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 	if (tmp & SWO_ERR) {
 		log_err(ctx, "Failed to retrieve speed information: 0x%x",
 			tmp);
+		transport_unlock(devh);
 		return JAYLINK_ERR_DEV;
 	}
 
@@ -404,6 +434,7 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 	if (length != 28) {
 		log_err(ctx, "Unexpected number of bytes received: %u",
 			length);
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
@@ -413,10 +444,12 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, length);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -451,3 +484,400 @@ JAYLINK_API int jaylink_swo_get_speeds(struct jaylink_device_handle *devh,
 
 	return JAYLINK_OK;
 }
+
+static void stream_thread(void *arg)
+{
+	int ret;
+	struct swo_stream *stream;
+	struct jaylink_context *ctx;
+	uint8_t *data;
+	size_t size;
+	uint32_t length;
+	uint32_t tmp;
+
+	stream = arg;
+	ctx = stream->devh->dev->ctx;
+
+	while (!ATOMIC_LOAD(&stream->stop)) {
+		if (stream->callback) {
+			data = stream->buffer;
+			size = stream->buffer_size;
+		} else {
+			size = ringbuffer_get_write_area(&stream->ringbuffer,
+				&data);
+		}
+
+		length = MIN(size, STREAM_MAX_READ_SIZE);
+
+		/* Wait for the consumer if the ring buffer is full. */
+		if (!length) {
+			thread_sleep(ATOMIC_LOAD(&stream->interval));
+			continue;
+		}
+
+		tmp = length;
+		ret = jaylink_swo_read(stream->devh, data, &length);
+
+		/*
+		 * A device error, for example a buffer overrun on the device,
+		 * does not affect the received data and is not fatal.
+		 */
+		if (ret == JAYLINK_ERR_DEV) {
+			log_warn(ctx, "SWO stream: device error occurred");
+		} else if (ret != JAYLINK_OK) {
+			log_err(ctx, "SWO stream: jaylink_swo_read() failed: %s",
+				jaylink_strerror(ret));
+			ATOMIC_STORE(&stream->status, ret);
+			break;
+		}
+
+		if (length > 0) {
+			if (stream->callback)
+				stream->callback(stream->devh, data, length,
+					stream->user_data);
+			else
+				ringbuffer_commit(&stream->ringbuffer, length);
+		}
+
+		/*
+		 * Read again immediately if the device probably has more data
+		 * available.
+		 */
+		if (length < tmp)
+			thread_sleep(ATOMIC_LOAD(&stream->interval));
+	}
+}
+
+static void free_stream(struct swo_stream *stream)
+{
+	if (stream->callback)
+		free(stream->buffer);
+	else
+		ringbuffer_free(&stream->ringbuffer);
+
+	free(stream);
+}
+
+/**
+ * Start streaming of SWO data.
+ *
+ * A capture thread polls the device for captured SWO data with the specified
+ * interval. The data is either passed to the callback function or stored
+ * into a ring buffer which can be drained with jaylink_swo_stream_peek() and
+ * jaylink_swo_stream_consume().
+ *
+ * @note SWO capture must be started with jaylink_swo_start() before.
+ *
+ * @warning While streaming is active, the device handle must not be used with
+ *          any function except jaylink_swo_stop_streaming(),
+ *          jaylink_swo_stream_set_interval(), jaylink_swo_stream_peek(),
+ *          jaylink_swo_stream_consume(), the hardware status monitor
+ *          functions and jaylink_close().
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] buffer_size Size of the ring buffer in bytes, or the maximum
+ *                        number of bytes passed to the callback function at
+ *                        once. The ring buffer size is rounded up to the next
+ *                        power of two.
+ * @param[in] interval Polling interval in microseconds.
+ * @param[in] callback Callback function to be called from the capture thread
+ *                     for captured data, or NULL to store the data into the
+ *                     ring buffer.
+ * @param[in,out] user_data User data to be passed to the callback function.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, streaming or EMUCOM polling is
+ *                         already active.
+ * @retval JAYLINK_ERR_MALLOC Memory allocation error.
+ * @retval JAYLINK_ERR Other error conditions.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swo_start_streaming(struct jaylink_device_handle *devh,
+		size_t buffer_size, uint32_t interval,
+		jaylink_swo_stream_callback callback, void *user_data)
+{
+	struct jaylink_context *ctx;
+	struct swo_stream *stream;
+
+	if (!devh || !buffer_size)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->swo_stream || devh->emucom_poller)
+		return JAYLINK_ERR_ARG;
+
+	ctx = devh->dev->ctx;
+	stream = malloc(sizeof(struct swo_stream));
+
+	if (!stream) {
+		log_err(ctx, "SWO stream malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	stream->devh = devh;
+	stream->callback = callback;
+	stream->user_data = user_data;
+	stream->interval = interval;
+	stream->stop = false;
+	stream->status = JAYLINK_OK;
+
+	if (callback) {
+		stream->buffer = malloc(buffer_size);
+		stream->buffer_size = buffer_size;
+
+		if (!stream->buffer) {
+			log_err(ctx, "SWO stream buffer malloc failed");
+			free(stream);
+			return JAYLINK_ERR_MALLOC;
+		}
+	} else {
+		if (!ringbuffer_init(&stream->ringbuffer, buffer_size)) {
+			log_err(ctx, "SWO stream ring buffer malloc failed");
+			free(stream);
+			return JAYLINK_ERR_MALLOC;
+		}
+	}
+
+	if (!thread_create(&stream->thread, &stream_thread, stream)) {
+		log_err(ctx, "Failed to create SWO capture thread");
+		free_stream(stream);
+		return JAYLINK_ERR;
+	}
+
+	devh->swo_stream = stream;
+
+	return JAYLINK_OK;
+}
+
+/** @private */
+JAYLINK_PRIV void swo_stop_stream(struct jaylink_device_handle *devh)
+{
+	struct swo_stream *stream;
+
+	stream = devh->swo_stream;
+	ATOMIC_STORE(&stream->stop, true);
+
+	if (!thread_join(&stream->thread))
+		log_err(devh->dev->ctx, "Failed to join SWO capture thread");
+
+	free_stream(stream);
+	devh->swo_stream = NULL;
+}
+
+/**
+ * Stop streaming of SWO data.
+ *
+ * Data which is not yet consumed from the ring buffer is discarded.
+ *
+ * @note SWO capture on the device is not stopped, use jaylink_swo_stop()
+ *       afterwards.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or streaming is not active.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during streaming.
+ * @retval JAYLINK_ERR_IO Input/output error during streaming.
+ * @retval JAYLINK_ERR Other error conditions during streaming.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swo_stop_streaming(struct jaylink_device_handle *devh)
+{
+	int ret;
+
+	if (!devh || !devh->swo_stream)
+		return JAYLINK_ERR_ARG;
+
+	ret = ATOMIC_LOAD(&devh->swo_stream->status);
+	swo_stop_stream(devh);
+
+	return ret;
+}
+
+/**
+ * Set the polling interval of a SWO stream.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] interval Polling interval in microseconds.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or streaming is not active.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swo_stream_set_interval(
+		struct jaylink_device_handle *devh, uint32_t interval)
+{
+	if (!devh || !devh->swo_stream)
+		return JAYLINK_ERR_ARG;
+
+	ATOMIC_STORE(&devh->swo_stream->interval, interval);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Get captured data of a SWO stream.
+ *
+ * The data is not copied but remains in the ring buffer until it is released
+ * with jaylink_swo_stream_consume(). Because the ring buffer wraps around,
+ * less data than available may be returned. In that case, the remaining data
+ * is returned after the returned data is consumed.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] data Pointer to the captured data on success, and undefined on
+ *                  failure.
+ * @param[out] length Number of bytes of captured data on success, and
+ *                    undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, streaming is not active or a
+ *                         callback function is used.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during streaming and no data
+ *                             is left.
+ * @retval JAYLINK_ERR_IO Input/output error during streaming and no data is
+ *                        left.
+ * @retval JAYLINK_ERR Other error conditions during streaming and no data is
+ *                     left.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swo_stream_peek(struct jaylink_device_handle *devh,
+		const uint8_t **data, size_t *length)
+{
+	struct swo_stream *stream;
+	int status;
+
+	if (!devh || !data || !length)
+		return JAYLINK_ERR_ARG;
+
+	stream = devh->swo_stream;
+
+	if (!stream || stream->callback)
+		return JAYLINK_ERR_ARG;
+
+	/*
+	 * Load the status first to ensure that no data is missed when the
+	 * capture thread terminates in the meantime.
+	 */
+	status = ATOMIC_LOAD(&stream->status);
+	*length = ringbuffer_get_read_area(&stream->ringbuffer, data);
+
+	if (!*length && status != JAYLINK_OK)
+		return status;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Release captured data of a SWO stream.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] length Number of bytes to release. The number must not exceed the
+ *                   length returned by jaylink_swo_stream_peek().
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, streaming is not active or a
+ *                         callback function is used.
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swo_stream_consume(struct jaylink_device_handle *devh,
+		size_t length)
+{
+	struct swo_stream *stream;
+
+	if (!devh)
+		return JAYLINK_ERR_ARG;
+
+	stream = devh->swo_stream;
+
+	if (!stream || stream->callback)
+		return JAYLINK_ERR_ARG;
+
+	if (length > ringbuffer_get_length(&stream->ringbuffer))
+		return JAYLINK_ERR_ARG;
+
+	ringbuffer_consume(&stream->ringbuffer, length);
+
+	return JAYLINK_OK;
+}
+
+/**
+ * Decode captured data of a SWO stream.
+ *
+ * The captured data is decoded with an ITM packet decoder and released from
+ * the ring buffer as it is processed, without copying it. Decoding stops when
+ * no captured data is left or the event buffer is full.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in,out] decoder ITM packet decoder.
+ * @param[out] events Buffer to store the decoded events.
+ * @param[in,out] count Maximum number of events to store. On success, the
+ *                      value gets updated with the number of decoded events,
+ *                      and undefined on failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments, streaming is not active or a
+ *                         callback function is used.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred during streaming and no data
+ *                             is left.
+ * @retval JAYLINK_ERR_IO Input/output error during streaming and no data is
+ *                        left.
+ * @retval JAYLINK_ERR Other error conditions during streaming and no data is
+ *                     left.
+ *
+ * @see jaylink_itm_decode()
+ *
+ * @since 0.5.0
+ */
+JAYLINK_API int jaylink_swo_stream_decode(struct jaylink_device_handle *devh,
+		struct jaylink_itm_decoder *decoder,
+		struct jaylink_itm_event *events, size_t *count)
+{
+	int ret;
+	struct swo_stream *stream;
+	const uint8_t *data;
+	size_t length;
+	size_t num;
+	size_t tmp;
+	int status;
+
+	if (!devh || !decoder || !events || !count)
+		return JAYLINK_ERR_ARG;
+
+	stream = devh->swo_stream;
+
+	if (!stream || stream->callback)
+		return JAYLINK_ERR_ARG;
+
+	status = ATOMIC_LOAD(&stream->status);
+	num = 0;
+
+	/* The captured data is split into two parts if the buffer wraps. */
+	while (num < *count) {
+		length = ringbuffer_get_read_area(&stream->ringbuffer, &data);
+
+		if (!length)
+			break;
+
+		tmp = *count - num;
+		ret = jaylink_itm_decode(decoder, data, &length, events + num,
+			&tmp);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		ringbuffer_consume(&stream->ringbuffer, length);
+		num += tmp;
+	}
+
+	*count = num;
+
+	if (!num && status != JAYLINK_OK &&
+			!ringbuffer_get_length(&stream->ringbuffer))
+		return status;
+
+	return JAYLINK_OK;
+}
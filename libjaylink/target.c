@@ -71,11 +71,13 @@ JAYLINK_API int jaylink_set_speed(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 3, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -83,6 +85,7 @@ JAYLINK_API int jaylink_set_speed(struct jaylink_device_handle *devh,
 	buffer_set_u16(buf, speed, 1);
 
 	ret = transport_write(devh, buf, 3);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -137,11 +140,25 @@ JAYLINK_API int jaylink_get_speeds(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+
+	/*
+	 * The cached speeds are accessed with the device handle locked such
+	 * that they are consistent with the selected target interface.
+	 */
+	transport_lock(devh);
+
+	if (devh->info.has_speed) {
+		*speed = devh->info.speed;
+		transport_unlock(devh);
+		return JAYLINK_OK;
+	}
+
 	ret = transport_start_write_read(devh, 1, 6, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -152,6 +169,7 @@ JAYLINK_API int jaylink_get_speeds(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -160,6 +178,7 @@ JAYLINK_API int jaylink_get_speeds(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -167,12 +186,20 @@ JAYLINK_API int jaylink_get_speeds(struct jaylink_device_handle *devh,
 
 	if (!div) {
 		log_err(ctx, "Minimum frequency divider is zero");
+		transport_unlock(devh);
 		return JAYLINK_ERR_PROTO;
 	}
 
 	speed->freq = buffer_get_u32(buf, 0);
 	speed->div = div;
 
+	if (devh->info_cache) {
+		devh->info.speed = *speed;
+		devh->info.has_speed = true;
+	}
+
+	transport_unlock(devh);
+
 	return JAYLINK_OK;
 }
 
@@ -226,11 +253,17 @@ JAYLINK_API int jaylink_select_interface(struct jaylink_device_handle *devh,
 	}
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
+
+	/* The speed information depends on the selected target interface. */
+	devh->info.has_speed = false;
+
 	ret = transport_start_write_read(devh, 2, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -242,10 +275,12 @@ JAYLINK_API int jaylink_select_interface(struct jaylink_device_handle *devh,
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -294,11 +329,13 @@ JAYLINK_API int jaylink_get_available_interfaces(
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 2, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -310,10 +347,12 @@ JAYLINK_API int jaylink_get_available_interfaces(
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -361,11 +400,13 @@ JAYLINK_API int jaylink_get_selected_interface(
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write_read(devh, 2, 4, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write_read() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -377,10 +418,12 @@ JAYLINK_API int jaylink_get_selected_interface(
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	ret = transport_read(devh, buf, 4);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_read() failed: %s",
@@ -416,17 +459,20 @@ JAYLINK_API int jaylink_clear_reset(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_CLEAR_RESET;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -460,17 +506,20 @@ JAYLINK_API int jaylink_set_reset(struct jaylink_device_handle *devh)
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 1, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_write() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
 	buf[0] = CMD_SET_RESET;
 
 	ret = transport_write(devh, buf, 1);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -513,11 +562,13 @@ JAYLINK_API int jaylink_set_target_power(struct jaylink_device_handle *devh,
 		return JAYLINK_ERR_ARG;
 
 	ctx = devh->dev->ctx;
+	transport_lock(devh);
 	ret = transport_start_write(devh, 2, true);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_start_wrte() failed: %s",
 			jaylink_strerror(ret));
+		transport_unlock(devh);
 		return ret;
 	}
 
@@ -525,6 +576,7 @@ JAYLINK_API int jaylink_set_target_power(struct jaylink_device_handle *devh,
 	buf[1] = enable;
 
 	ret = transport_write(devh, buf, 2);
+	transport_unlock(devh);
 
 	if (ret != JAYLINK_OK) {
 		log_err(ctx, "transport_write() failed: %s",
@@ -0,0 +1,222 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Thread abstraction layer.
+ */
+
+#ifdef _WIN32
+static DWORD WINAPI thread_start(LPVOID arg)
+#else
+static void *thread_start(void *arg)
+#endif
+{
+	struct thread *thread;
+
+	thread = arg;
+	thread->function(thread->arg);
+
+#ifdef _WIN32
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * Create a thread.
+ *
+ * @param[out] thread Thread to be created.
+ * @param[in] function Function to be executed by the thread.
+ * @param[in] arg Argument to be passed to the function.
+ *
+ * @return Whether the thread was successfully created.
+ */
+JAYLINK_PRIV bool thread_create(struct thread *thread,
+		thread_function function, void *arg)
+{
+	thread->function = function;
+	thread->arg = arg;
+
+#ifdef _WIN32
+	thread->handle = CreateThread(NULL, 0, thread_start, thread, 0, NULL);
+
+	if (!thread->handle)
+		return false;
+#else
+	if (pthread_create(&thread->handle, NULL, thread_start, thread) != 0)
+		return false;
+#endif
+
+	return true;
+}
+
+/**
+ * Wait for the termination of a thread.
+ *
+ * @param[in,out] thread Thread.
+ *
+ * @return Whether the thread was successfully joined.
+ */
+JAYLINK_PRIV bool thread_join(struct thread *thread)
+{
+#ifdef _WIN32
+	if (WaitForSingleObject(thread->handle, INFINITE) != WAIT_OBJECT_0)
+		return false;
+
+	CloseHandle(thread->handle);
+#else
+	if (pthread_join(thread->handle, NULL) != 0)
+		return false;
+#endif
+
+	return true;
+}
+
+/**
+ * Suspend the execution of the calling thread.
+ *
+ * @param[in] usecs Duration in microseconds. Depending on the platform, the
+ *                  duration may be rounded up to a multiple of milliseconds.
+ */
+JAYLINK_PRIV void thread_sleep(uint32_t usecs)
+{
+#ifdef _WIN32
+	Sleep((usecs + 999) / 1000);
+#else
+	struct timespec ts;
+
+	ts.tv_sec = usecs / 1000000;
+	ts.tv_nsec = (usecs % 1000000) * 1000;
+
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+#endif
+}
+
+/**
+ * Initialize a mutex.
+ *
+ * @param[out] mutex Mutex to be initialized.
+ *
+ * @return Whether the mutex was successfully initialized.
+ */
+JAYLINK_PRIV bool mutex_init(struct mutex *mutex)
+{
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex->handle);
+#else
+	if (pthread_mutex_init(&mutex->handle, NULL) != 0)
+		return false;
+#endif
+
+	return true;
+}
+
+/**
+ * Initialize a recursive mutex.
+ *
+ * A recursive mutex can be locked multiple times by the same thread. It must
+ * be unlocked as many times as it was locked before another thread can lock
+ * it.
+ *
+ * @param[out] mutex Mutex to be initialized.
+ *
+ * @return Whether the mutex was successfully initialized.
+ */
+JAYLINK_PRIV bool mutex_init_recursive(struct mutex *mutex)
+{
+#ifdef _WIN32
+	/* Critical section objects are always recursive. */
+	InitializeCriticalSection(&mutex->handle);
+#else
+	pthread_mutexattr_t attr;
+	bool ret;
+
+	if (pthread_mutexattr_init(&attr) != 0)
+		return false;
+
+	ret = !pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) &&
+		!pthread_mutex_init(&mutex->handle, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	if (!ret)
+		return false;
+#endif
+
+	return true;
+}
+
+/**
+ * Destroy a mutex.
+ *
+ * @param[in,out] mutex Mutex to be destroyed. The mutex must not be locked.
+ */
+JAYLINK_PRIV void mutex_destroy(struct mutex *mutex)
+{
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_destroy(&mutex->handle);
+#endif
+}
+
+/**
+ * Lock a mutex.
+ *
+ * The calling thread is blocked until the mutex is available.
+ *
+ * @param[in,out] mutex Mutex.
+ */
+JAYLINK_PRIV void mutex_lock(struct mutex *mutex)
+{
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_lock(&mutex->handle);
+#endif
+}
+
+/**
+ * Unlock a mutex.
+ *
+ * @param[in,out] mutex Mutex which is locked by the calling thread.
+ */
+JAYLINK_PRIV void mutex_unlock(struct mutex *mutex)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_unlock(&mutex->handle);
+#endif
+}
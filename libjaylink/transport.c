@@ -34,6 +34,18 @@
  * Transport abstraction layer.
  */
 
+static void start_command(struct jaylink_device_handle *devh)
+{
+	/*
+	 * The latency of commands within a batch cannot be measured because
+	 * their responses are read after the end of the batch.
+	 */
+	if (devh->batch)
+		stats_finish_command(devh);
+	else
+		stats_start_command(devh);
+}
+
 /**
  * Open a device.
  *
@@ -59,6 +71,12 @@ JAYLINK_PRIV int transport_open(struct jaylink_device_handle *devh)
 	case JAYLINK_HIF_TCP:
 		ret = transport_tcp_open(devh);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_open(devh);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_open(devh);
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
@@ -92,6 +110,12 @@ JAYLINK_PRIV int transport_close(struct jaylink_device_handle *devh)
 	case JAYLINK_HIF_TCP:
 		ret = transport_tcp_close(devh);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_close(devh);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_close(devh);
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
@@ -101,6 +125,31 @@ JAYLINK_PRIV int transport_close(struct jaylink_device_handle *devh)
 	return ret;
 }
 
+/**
+ * Lock a device handle for a command.
+ *
+ * The device handle must be locked from the start of a command until its last
+ * response is received such that other threads cannot interleave their
+ * commands. The lock is recursive, so functions which are composed of other
+ * commands can lock the device handle as well.
+ *
+ * @param[in,out] devh Device handle.
+ */
+JAYLINK_PRIV void transport_lock(struct jaylink_device_handle *devh)
+{
+	mutex_lock(&devh->io_mutex);
+}
+
+/**
+ * Unlock a device handle after a command.
+ *
+ * @param[in,out] devh Device handle.
+ */
+JAYLINK_PRIV void transport_unlock(struct jaylink_device_handle *devh)
+{
+	mutex_unlock(&devh->io_mutex);
+}
+
 /**
  * Start a write operation for a device.
  *
@@ -130,12 +179,25 @@ JAYLINK_PRIV int transport_start_write(struct jaylink_device_handle *devh,
 	case JAYLINK_HIF_TCP:
 		ret = transport_tcp_start_write(devh, length, has_command);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_start_write(devh, length, has_command);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_start_write(devh, length,
+			has_command);
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
 		return JAYLINK_ERR;
 	}
 
+	if (ret == JAYLINK_OK && has_command)
+		start_command(devh);
+
+	if (ret == JAYLINK_OK && devh->capture)
+		capture_start_write(devh, length, has_command);
+
 	return ret;
 }
 
@@ -166,12 +228,21 @@ JAYLINK_PRIV int transport_start_read(struct jaylink_device_handle *devh,
 	case JAYLINK_HIF_TCP:
 		ret = transport_tcp_start_read(devh, length);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_start_read(devh, length);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_start_read(devh, length);
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
 		return JAYLINK_ERR;
 	}
 
+	if (ret == JAYLINK_OK && devh->capture)
+		capture_start_read(devh, length);
+
 	return ret;
 }
 
@@ -211,12 +282,27 @@ JAYLINK_PRIV int transport_start_write_read(struct jaylink_device_handle *devh,
 		ret = transport_tcp_start_write_read(devh, write_length,
 			read_length, has_command);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_start_write_read(devh, write_length,
+			read_length, has_command);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_start_write_read(devh, write_length,
+			read_length, has_command);
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
 		return JAYLINK_ERR;
 	}
 
+	if (ret == JAYLINK_OK && has_command)
+		start_command(devh);
+
+	if (ret == JAYLINK_OK && devh->capture)
+		capture_start_write_read(devh, write_length, read_length,
+			has_command);
+
 	return ret;
 }
 
@@ -247,6 +333,10 @@ JAYLINK_PRIV int transport_write(struct jaylink_device_handle *devh,
 		const uint8_t *buffer, size_t length)
 {
 	int ret;
+	struct io_vector iov;
+
+	iov.buffer = (uint8_t *)buffer;
+	iov.length = length;
 
 	switch (devh->dev->iface) {
 #ifdef HAVE_LIBUSB
@@ -257,12 +347,28 @@ JAYLINK_PRIV int transport_write(struct jaylink_device_handle *devh,
 	case JAYLINK_HIF_TCP:
 		ret = transport_tcp_write(devh, buffer, length);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_writev(devh, &iov, 1);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_writev(devh, &iov, 1);
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
 		return JAYLINK_ERR;
 	}
 
+	if (ret == JAYLINK_OK) {
+		if (length > 0)
+			stats_set_opcode(devh, buffer[0]);
+
+		devh->last_io = util_get_timestamp();
+
+		if (devh->capture)
+			capture_write(devh, &iov, 1);
+	}
+
 	return ret;
 }
 
@@ -289,6 +395,10 @@ JAYLINK_PRIV int transport_read(struct jaylink_device_handle *devh,
 		uint8_t *buffer, size_t length)
 {
 	int ret;
+	struct io_vector iov;
+
+	iov.buffer = buffer;
+	iov.length = length;
 
 	switch (devh->dev->iface) {
 #ifdef HAVE_LIBUSB
@@ -299,6 +409,334 @@ JAYLINK_PRIV int transport_read(struct jaylink_device_handle *devh,
 	case JAYLINK_HIF_TCP:
 		ret = transport_tcp_read(devh, buffer, length);
 		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_readv(devh, &iov, 1);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_readv(devh, &iov, 1);
+		break;
+	default:
+		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
+			devh->dev->iface);
+		return JAYLINK_ERR;
+	}
+
+	if (ret == JAYLINK_OK) {
+		devh->last_io = util_get_timestamp();
+
+		if (devh->capture)
+			capture_read(devh, &iov, 1);
+	}
+
+	return ret;
+}
+
+/**
+ * Write data from multiple segments to a device.
+ *
+ * This function behaves like consecutive calls of transport_write() for each
+ * segment. However, the data of the segments is sent to the device without
+ * copying it into the internal buffer where possible.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] iov Array of segments to write data from.
+ * @param[in] count Number of segments, at most #MAX_IO_VECTORS.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ */
+JAYLINK_PRIV int transport_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	int ret;
+
+	if (!count || count > MAX_IO_VECTORS)
+		return JAYLINK_ERR_ARG;
+
+	switch (devh->dev->iface) {
+#ifdef HAVE_LIBUSB
+	case JAYLINK_HIF_USB:
+		ret = transport_usb_writev(devh, iov, count);
+		break;
+#endif
+	case JAYLINK_HIF_TCP:
+		ret = transport_tcp_writev(devh, iov, count);
+		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_writev(devh, iov, count);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_writev(devh, iov, count);
+		break;
+	default:
+		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
+			devh->dev->iface);
+		return JAYLINK_ERR;
+	}
+
+	if (ret == JAYLINK_OK) {
+		for (size_t i = 0; i < count; i++) {
+			if (iov[i].length > 0) {
+				stats_set_opcode(devh,
+					*(const uint8_t *)iov[i].buffer);
+				break;
+			}
+		}
+
+		devh->last_io = util_get_timestamp();
+
+		if (devh->capture)
+			capture_write(devh, iov, count);
+	}
+
+	return ret;
+}
+
+/**
+ * Read data from a device into multiple segments.
+ *
+ * This function behaves like consecutive calls of transport_read() for each
+ * segment. However, the data is received directly into the segments where
+ * possible.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[in] iov Array of segments to read data into. The content of the
+ *                segments is undefined on failure.
+ * @param[in] count Number of segments, at most #MAX_IO_VECTORS.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ */
+JAYLINK_PRIV int transport_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	int ret;
+
+	if (!count || count > MAX_IO_VECTORS)
+		return JAYLINK_ERR_ARG;
+
+	switch (devh->dev->iface) {
+#ifdef HAVE_LIBUSB
+	case JAYLINK_HIF_USB:
+		ret = transport_usb_readv(devh, iov, count);
+		break;
+#endif
+	case JAYLINK_HIF_TCP:
+		ret = transport_tcp_readv(devh, iov, count);
+		break;
+	case JAYLINK_HIF_REPLAY:
+		ret = transport_replay_readv(devh, iov, count);
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		ret = transport_emulator_readv(devh, iov, count);
+		break;
+	default:
+		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
+			devh->dev->iface);
+		return JAYLINK_ERR;
+	}
+
+	if (ret == JAYLINK_OK) {
+		devh->last_io = util_get_timestamp();
+
+		if (devh->capture)
+			capture_read(devh, iov, count);
+	}
+
+	return ret;
+}
+
+/**
+ * Start a batch of write operations for a device.
+ *
+ * While a batch is active, the data of all subsequent write operations is
+ * collected in the buffer instead of being sent to the device. The collected
+ * data is sent at once with transport_end_batch(). This allows to send
+ * multiple commands to the device with a single transfer.
+ *
+ * @note Read operations must not be started while a batch is active.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ */
+JAYLINK_PRIV int transport_start_batch(struct jaylink_device_handle *devh)
+{
+	if (devh->batch)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->write_pos > 0)
+		log_warn(devh->dev->ctx, "Last write operation left %zu bytes "
+			"in the buffer", devh->write_pos);
+
+	if (devh->write_length > 0)
+		log_warn(devh->dev->ctx, "Last write operation was not "
+			"performed");
+
+	devh->write_length = 0;
+	devh->write_pos = 0;
+	devh->batch = true;
+
+	return JAYLINK_OK;
+}
+
+/**
+ * End a batch of write operations and send the collected data to a device.
+ *
+ * @param[in,out] devh Device handle.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ */
+JAYLINK_PRIV int transport_end_batch(struct jaylink_device_handle *devh)
+{
+	int ret;
+
+	if (!devh->batch)
+		return JAYLINK_ERR_ARG;
+
+	devh->batch = false;
+
+	if (devh->write_length > 0) {
+		log_err(devh->dev->ctx, "Last write operation of the batch "
+			"was not completed");
+		transport_cancel_batch(devh);
+		return JAYLINK_ERR_ARG;
+	}
+
+	switch (devh->dev->iface) {
+#ifdef HAVE_LIBUSB
+	case JAYLINK_HIF_USB:
+		ret = transport_usb_flush(devh);
+		break;
+#endif
+	case JAYLINK_HIF_TCP:
+		ret = transport_tcp_flush(devh);
+		break;
+	case JAYLINK_HIF_REPLAY:
+		/* Written data is compared immediately, nothing to flush. */
+		ret = JAYLINK_OK;
+		break;
+	case JAYLINK_HIF_EMULATOR:
+		/* Written data is processed immediately, nothing to flush. */
+		ret = JAYLINK_OK;
+		break;
+	default:
+		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
+			devh->dev->iface);
+		return JAYLINK_ERR;
+	}
+
+	return ret;
+}
+
+/**
+ * Cancel a batch of write operations.
+ *
+ * The data collected since transport_start_batch() is discarded and not sent
+ * to the device.
+ *
+ * @param[in,out] devh Device handle.
+ */
+JAYLINK_PRIV void transport_cancel_batch(struct jaylink_device_handle *devh)
+{
+	devh->batch = false;
+	devh->write_length = 0;
+	devh->write_pos = 0;
+}
+
+/**
+ * Check whether data of the current read operation is available.
+ *
+ * This function does not block. For USB devices, a transfer to receive the
+ * data is submitted with the first call and processed by the following calls.
+ * Once data is available, it is read with transport_read() or
+ * transport_readv() as usual. Note that only the first bytes of the read
+ * operation may be available and reading the remaining data may block.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] ready Whether data is available on success, and undefined on
+ *                   failure.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments.
+ * @retval JAYLINK_ERR_TIMEOUT A timeout occurred.
+ * @retval JAYLINK_ERR_IO Input/output error.
+ * @retval JAYLINK_ERR Other error conditions.
+ */
+JAYLINK_PRIV int transport_poll_read(struct jaylink_device_handle *devh,
+		bool *ready)
+{
+	int ret;
+
+	switch (devh->dev->iface) {
+#ifdef HAVE_LIBUSB
+	case JAYLINK_HIF_USB:
+		ret = transport_usb_poll_read(devh, ready);
+		break;
+#endif
+	case JAYLINK_HIF_TCP:
+		ret = transport_tcp_poll_read(devh, ready);
+		break;
+	case JAYLINK_HIF_REPLAY:
+	case JAYLINK_HIF_EMULATOR:
+		/* Responses are available immediately. */
+		*ready = true;
+		ret = JAYLINK_OK;
+		break;
+	default:
+		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
+			devh->dev->iface);
+		return JAYLINK_ERR;
+	}
+
+	return ret;
+}
+
+/**
+ * Get the file descriptors which indicate available data of a device.
+ *
+ * @param[in,out] devh Device handle.
+ * @param[out] pollfds Array to store the file descriptors on success, or NULL
+ *                     to only query their number.
+ * @param[in,out] count Number of entries of the array. On success, the number
+ *                      of file descriptors.
+ *
+ * @retval JAYLINK_OK Success.
+ * @retval JAYLINK_ERR_ARG Invalid arguments or the array is too small.
+ * @retval JAYLINK_ERR_NOT_SUPPORTED Operation not supported.
+ * @retval JAYLINK_ERR Other error conditions.
+ */
+JAYLINK_PRIV int transport_get_pollfds(struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count)
+{
+	int ret;
+
+	switch (devh->dev->iface) {
+#ifdef HAVE_LIBUSB
+	case JAYLINK_HIF_USB:
+		ret = transport_usb_get_pollfds(devh, pollfds, count);
+		break;
+#endif
+	case JAYLINK_HIF_TCP:
+		ret = transport_tcp_get_pollfds(devh, pollfds, count);
+		break;
+	case JAYLINK_HIF_REPLAY:
+	case JAYLINK_HIF_EMULATOR:
+		/* Responses are available immediately, nothing to wait for. */
+		*count = 0;
+		ret = JAYLINK_OK;
+		break;
 	default:
 		log_err(devh->dev->ctx, "BUG: Invalid host interface: %u",
 			devh->dev->iface);
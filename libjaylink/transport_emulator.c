@@ -0,0 +1,737 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Transport abstraction layer (emulator).
+ *
+ * The emulator answers the protocol in memory without a device. JTAG and SWD
+ * I/O operations loop the output data back, SWO read operations return a
+ * counting pattern, file I/O operations access a single file in memory and all
+ * EMUCOM channels share a loopback buffer. The hardware status reports a fixed
+ * target voltage.
+ */
+
+/** @cond PRIVATE */
+#define CMD_GET_VERSION		0x01
+#define CMD_GET_HW_STATUS	0x07
+#define CMD_SET_SPEED		0x05
+#define CMD_FILE_IO		0x1e
+#define CMD_JTAG_CLEAR_TMS	0xc9
+#define CMD_JTAG_SET_TMS	0xca
+#define CMD_SELECT_TIF		0xc7
+#define CMD_JTAG_IO_V2		0xce
+#define CMD_JTAG_IO_V3		0xcf
+#define CMD_JTAG_CLEAR_TCK	0xda
+#define CMD_JTAG_SET_TCK	0xdb
+#define CMD_CLEAR_RESET		0xdc
+#define CMD_SET_RESET		0xdd
+#define CMD_JTAG_CLEAR_TRST	0xde
+#define CMD_JTAG_SET_TRST	0xdf
+#define CMD_GET_CAPS		0xe8
+#define CMD_SWO			0xeb
+#define CMD_GET_EXT_CAPS	0xed
+#define CMD_EMUCOM		0xee
+#define CMD_GET_HW_VERSION	0xf0
+
+#define SWO_CMD_START		0x64
+#define SWO_CMD_STOP		0x65
+#define SWO_CMD_READ		0x66
+#define SWO_PARAM_READ_SIZE	0x03
+
+#define FILE_IO_CMD_READ	0x64
+#define FILE_IO_CMD_WRITE	0x65
+#define FILE_IO_CMD_GET_SIZE	0x66
+#define FILE_IO_CMD_DELETE	0x67
+#define FILE_IO_PARAM_OFFSET	0x02
+#define FILE_IO_PARAM_LENGTH	0x03
+#define FILE_IO_ERR		0x80000000
+
+#define EMUCOM_CMD_READ		0x00
+#define EMUCOM_CMD_WRITE	0x01
+
+#define TIF_GET_SELECTED	0xfe
+#define TIF_GET_AVAILABLE	0xff
+
+/** Firmware version string of the emulator. */
+#define FIRMWARE_VERSION	"J-Link emulator (libjaylink)"
+
+/**
+ * Hardware version of the emulator.
+ *
+ * The emulator identifies itself as J-Link V10.0.0.
+ */
+#define HARDWARE_VERSION	100000
+
+/** Target voltage of the emulator in mV. */
+#define TARGET_VOLTAGE		3300
+
+/** Initial size of the buffers in bytes. */
+#define BUFFER_SIZE		2048
+/** @endcond */
+
+static bool reserve(uint8_t **buffer, size_t *size, size_t length)
+{
+	uint8_t *tmp;
+	size_t new_size;
+
+	if (length <= *size)
+		return true;
+
+	new_size = MAX(*size * 2, length);
+	tmp = realloc(*buffer, new_size);
+
+	if (!tmp)
+		return false;
+
+	*buffer = tmp;
+	*size = new_size;
+
+	return true;
+}
+
+static uint8_t *add_response(struct jaylink_device_handle *devh,
+		size_t length)
+{
+	struct emulator_data *emu;
+	uint8_t *response;
+
+	emu = devh->emulator;
+
+	if (!reserve(&emu->response, &emu->response_size,
+			emu->response_length + length)) {
+		log_err(devh->dev->ctx, "Failed to adjust emulator response "
+			"buffer size");
+		return NULL;
+	}
+
+	response = emu->response + emu->response_length;
+	emu->response_length += length;
+
+	return response;
+}
+
+static int add_response_u32(struct jaylink_device_handle *devh,
+		uint32_t value)
+{
+	uint8_t *response;
+
+	response = add_response(devh, 4);
+
+	if (!response)
+		return JAYLINK_ERR_MALLOC;
+
+	buffer_set_u32(response, value, 0);
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Find a 32-bit parameter in a parameter list. Each parameter consists of its
+ * length, its identifier and its value. The list is terminated with a zero
+ * length.
+ */
+static bool get_param_u32(const uint8_t *buffer, size_t length, size_t offset,
+		uint8_t param, uint32_t *value)
+{
+	while (offset < length && buffer[offset] > 0) {
+		if (offset + 2 + buffer[offset] > length)
+			return false;
+
+		if (buffer[offset + 1] == param && buffer[offset] == 4) {
+			*value = buffer_get_u32(buffer, offset + 2);
+			return true;
+		}
+
+		offset += 2 + buffer[offset];
+	}
+
+	return false;
+}
+
+static int emulate_io(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	uint8_t *response;
+	size_t num_bytes;
+
+	if (length < 4)
+		return JAYLINK_ERR_PROTO;
+
+	num_bytes = (buffer_get_u16(buffer, 2) + 7) / 8;
+
+	if (length != 4 + 2 * num_bytes)
+		return JAYLINK_ERR_PROTO;
+
+	/* Loop the output data back. */
+	response = add_response(devh, num_bytes + 1);
+
+	if (!response)
+		return JAYLINK_ERR_MALLOC;
+
+	memcpy(response, buffer + 4 + num_bytes, num_bytes);
+
+	/* Only version 3 and SWD I/O operations respond with a status. */
+	if (buffer[0] == CMD_JTAG_IO_V3)
+		response[num_bytes] = 0x00;
+	else
+		devh->emulator->response_length--;
+
+	return JAYLINK_OK;
+}
+
+static int emulate_swo(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct emulator_data *emu;
+	uint8_t *response;
+	uint32_t tmp;
+
+	emu = devh->emulator;
+
+	if (length < 2)
+		return JAYLINK_ERR_PROTO;
+
+	switch (buffer[1]) {
+	case SWO_CMD_START:
+	case SWO_CMD_STOP:
+		return add_response_u32(devh, 0);
+	case SWO_CMD_READ:
+		if (!get_param_u32(buffer, length, 2, SWO_PARAM_READ_SIZE,
+				&tmp))
+			return JAYLINK_ERR_PROTO;
+
+		response = add_response(devh, 8 + tmp);
+
+		if (!response)
+			return JAYLINK_ERR_MALLOC;
+
+		buffer_set_u32(response, 0, 0);
+		buffer_set_u32(response, tmp, 4);
+
+		for (uint32_t i = 0; i < tmp; i++)
+			response[8 + i] = emu->swo_counter++;
+
+		return JAYLINK_OK;
+	default:
+		break;
+	}
+
+	return JAYLINK_ERR_NOT_SUPPORTED;
+}
+
+static int emulate_file_io(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct emulator_data *emu;
+	uint8_t *response;
+	uint32_t offset;
+	uint32_t tmp;
+	uint32_t num;
+
+	emu = devh->emulator;
+
+	if (length < 3)
+		return JAYLINK_ERR_PROTO;
+
+	switch (buffer[1]) {
+	case FILE_IO_CMD_READ:
+		if (!get_param_u32(buffer, length, 3, FILE_IO_PARAM_OFFSET,
+				&offset))
+			return JAYLINK_ERR_PROTO;
+
+		if (!get_param_u32(buffer, length, 3, FILE_IO_PARAM_LENGTH,
+				&tmp))
+			return JAYLINK_ERR_PROTO;
+
+		/*
+		 * The requested number of bytes is always sent, followed by
+		 * the number of valid bytes.
+		 */
+		response = add_response(devh, tmp + 4);
+
+		if (!response)
+			return JAYLINK_ERR_MALLOC;
+
+		memset(response, 0, tmp);
+		num = 0;
+
+		if (offset < emu->file_length) {
+			num = MIN(tmp, emu->file_length - offset);
+			memcpy(response, emu->file + offset, num);
+		}
+
+		buffer_set_u32(response, num, tmp);
+
+		return JAYLINK_OK;
+	case FILE_IO_CMD_WRITE:
+		if (!get_param_u32(buffer, length, 3, FILE_IO_PARAM_OFFSET,
+				&offset))
+			return JAYLINK_ERR_PROTO;
+
+		if (!get_param_u32(buffer, length, 3, FILE_IO_PARAM_LENGTH,
+				&tmp))
+			return JAYLINK_ERR_PROTO;
+
+		/* The data is sent with the next write operation. */
+		emu->state = EMULATOR_STATE_FILE_WRITE;
+		emu->file_offset = offset;
+
+		return JAYLINK_OK;
+	case FILE_IO_CMD_GET_SIZE:
+		return add_response_u32(devh, emu->file_length);
+	case FILE_IO_CMD_DELETE:
+		emu->file_length = 0;
+		return add_response_u32(devh, 0);
+	default:
+		break;
+	}
+
+	return JAYLINK_ERR_NOT_SUPPORTED;
+}
+
+static int emulate_emucom(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct emulator_data *emu;
+	uint8_t *response;
+	uint32_t tmp;
+	int ret;
+
+	emu = devh->emulator;
+
+	if (length != 10)
+		return JAYLINK_ERR_PROTO;
+
+	switch (buffer[1]) {
+	case EMUCOM_CMD_READ:
+		tmp = MIN(buffer_get_u32(buffer, 6), emu->emucom_length);
+		ret = add_response_u32(devh, tmp);
+
+		if (ret != JAYLINK_OK || !tmp)
+			return ret;
+
+		response = add_response(devh, tmp);
+
+		if (!response)
+			return JAYLINK_ERR_MALLOC;
+
+		memcpy(response, emu->emucom, tmp);
+		memmove(emu->emucom, emu->emucom + tmp,
+			emu->emucom_length - tmp);
+		emu->emucom_length -= tmp;
+
+		return JAYLINK_OK;
+	case EMUCOM_CMD_WRITE:
+		/* The data is sent with the next write operation. */
+		emu->state = EMULATOR_STATE_EMUCOM_WRITE;
+		return JAYLINK_OK;
+	default:
+		break;
+	}
+
+	return JAYLINK_ERR_NOT_SUPPORTED;
+}
+
+static int emulate_data(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct emulator_data *emu;
+	size_t tmp;
+
+	emu = devh->emulator;
+
+	if (emu->state == EMULATOR_STATE_FILE_WRITE) {
+		tmp = emu->file_offset + length;
+
+		if (!reserve(&emu->file, &emu->file_size, tmp))
+			return JAYLINK_ERR_MALLOC;
+
+		if (emu->file_offset > emu->file_length)
+			memset(emu->file + emu->file_length, 0,
+				emu->file_offset - emu->file_length);
+
+		memcpy(emu->file + emu->file_offset, buffer, length);
+		emu->file_length = MAX(emu->file_length, tmp);
+	} else {
+		tmp = emu->emucom_length + length;
+
+		if (!reserve(&emu->emucom, &emu->emucom_size, tmp))
+			return JAYLINK_ERR_MALLOC;
+
+		memcpy(emu->emucom + emu->emucom_length, buffer, length);
+		emu->emucom_length = tmp;
+	}
+
+	emu->state = EMULATOR_STATE_COMMAND;
+
+	return add_response_u32(devh, length);
+}
+
+static int emulate_command(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct emulator_data *emu;
+	uint8_t *response;
+	uint32_t tmp;
+
+	emu = devh->emulator;
+
+	switch (buffer[0]) {
+	case CMD_GET_VERSION:
+		tmp = sizeof(FIRMWARE_VERSION);
+		response = add_response(devh, 2 + tmp);
+
+		if (!response)
+			return JAYLINK_ERR_MALLOC;
+
+		buffer_set_u16(response, tmp, 0);
+		memcpy(response + 2, FIRMWARE_VERSION, tmp);
+
+		return JAYLINK_OK;
+	case CMD_GET_CAPS:
+	case CMD_GET_EXT_CAPS:
+		tmp = (buffer[0] == CMD_GET_CAPS) ? JAYLINK_DEV_CAPS_SIZE :
+			JAYLINK_DEV_EXT_CAPS_SIZE;
+		response = add_response(devh, tmp);
+
+		if (!response)
+			return JAYLINK_ERR_MALLOC;
+
+		memcpy(response, emu->caps, tmp);
+
+		return JAYLINK_OK;
+	case CMD_GET_HW_VERSION:
+		return add_response_u32(devh, HARDWARE_VERSION);
+	case CMD_GET_HW_STATUS:
+		response = add_response(devh, 8);
+
+		if (!response)
+			return JAYLINK_ERR_MALLOC;
+
+		/* All pin states are low. */
+		memset(response, 0, 8);
+		buffer_set_u16(response, TARGET_VOLTAGE, 0);
+
+		return JAYLINK_OK;
+	case CMD_SELECT_TIF:
+		if (length != 2)
+			return JAYLINK_ERR_PROTO;
+
+		if (buffer[1] == TIF_GET_AVAILABLE)
+			return add_response_u32(devh, (1 << JAYLINK_TIF_JTAG) |
+				(1 << JAYLINK_TIF_SWD));
+
+		tmp = emu->tif;
+
+		if (buffer[1] != TIF_GET_SELECTED)
+			emu->tif = buffer[1];
+
+		return add_response_u32(devh, tmp);
+	case CMD_SET_SPEED:
+	case CMD_JTAG_CLEAR_TMS:
+	case CMD_JTAG_SET_TMS:
+	case CMD_JTAG_CLEAR_TCK:
+	case CMD_JTAG_SET_TCK:
+	case CMD_CLEAR_RESET:
+	case CMD_SET_RESET:
+	case CMD_JTAG_CLEAR_TRST:
+	case CMD_JTAG_SET_TRST:
+		/* These commands have no response. */
+		return JAYLINK_OK;
+	case CMD_JTAG_IO_V2:
+	case CMD_JTAG_IO_V3:
+		return emulate_io(devh, buffer, length);
+	case CMD_SWO:
+		return emulate_swo(devh, buffer, length);
+	case CMD_FILE_IO:
+		return emulate_file_io(devh, buffer, length);
+	case CMD_EMUCOM:
+		return emulate_emucom(devh, buffer, length);
+	default:
+		break;
+	}
+
+	return JAYLINK_ERR_NOT_SUPPORTED;
+}
+
+static int emulate(struct jaylink_device_handle *devh)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct emulator_data *emu;
+
+	ctx = devh->dev->ctx;
+	emu = devh->emulator;
+
+	if (emu->state != EMULATOR_STATE_COMMAND)
+		ret = emulate_data(devh, devh->buffer, devh->write_pos);
+	else
+		ret = emulate_command(devh, devh->buffer, devh->write_pos);
+
+	if (ret == JAYLINK_ERR_NOT_SUPPORTED)
+		log_err(ctx, "Emulator does not support command 0x%02x",
+			devh->buffer[0]);
+	else if (ret == JAYLINK_ERR_PROTO)
+		log_err(ctx, "Emulator received invalid command 0x%02x",
+			devh->buffer[0]);
+
+	devh->write_pos = 0;
+
+	return ret;
+}
+
+JAYLINK_PRIV int transport_emulator_open(struct jaylink_device_handle *devh)
+{
+	struct jaylink_context *ctx;
+	struct emulator_data *emu;
+
+	ctx = devh->dev->ctx;
+
+	log_dbg(ctx, "Trying to open emulator");
+
+	emu = malloc(sizeof(struct emulator_data));
+
+	if (!emu) {
+		log_err(ctx, "Emulator data malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	devh->buffer_size = BUFFER_SIZE;
+	devh->buffer = malloc(devh->buffer_size);
+
+	if (!devh->buffer) {
+		log_err(ctx, "Transport buffer malloc failed");
+		free(emu);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	devh->read_length = 0;
+	devh->bytes_available = 0;
+	devh->read_pos = 0;
+
+	devh->write_length = 0;
+	devh->write_pos = 0;
+	devh->batch = false;
+
+	emu->response = NULL;
+	emu->response_size = 0;
+	emu->response_length = 0;
+	emu->response_pos = 0;
+	emu->state = EMULATOR_STATE_COMMAND;
+	emu->file = NULL;
+	emu->file_size = 0;
+	emu->file_length = 0;
+	emu->file_offset = 0;
+	emu->emucom = NULL;
+	emu->emucom_size = 0;
+	emu->emucom_length = 0;
+	emu->swo_counter = 0;
+	emu->tif = JAYLINK_TIF_JTAG;
+
+	memset(emu->caps, 0, sizeof(emu->caps));
+
+	emu->caps[JAYLINK_DEV_CAP_GET_HW_VERSION / 8] |=
+		1 << (JAYLINK_DEV_CAP_GET_HW_VERSION % 8);
+	emu->caps[JAYLINK_DEV_CAP_SELECT_TIF / 8] |=
+		1 << (JAYLINK_DEV_CAP_SELECT_TIF % 8);
+	emu->caps[JAYLINK_DEV_CAP_SWO / 8] |= 1 << (JAYLINK_DEV_CAP_SWO % 8);
+	emu->caps[JAYLINK_DEV_CAP_FILE_IO / 8] |=
+		1 << (JAYLINK_DEV_CAP_FILE_IO % 8);
+	emu->caps[JAYLINK_DEV_CAP_GET_EXT_CAPS / 8] |=
+		1 << (JAYLINK_DEV_CAP_GET_EXT_CAPS % 8);
+	emu->caps[JAYLINK_DEV_CAP_EMUCOM / 8] |=
+		1 << (JAYLINK_DEV_CAP_EMUCOM % 8);
+
+	devh->emulator = emu;
+
+	log_dbg(ctx, "Emulator opened successfully");
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_emulator_close(struct jaylink_device_handle *devh)
+{
+	struct emulator_data *emu;
+
+	emu = devh->emulator;
+
+	log_dbg(devh->dev->ctx, "Closing emulator");
+
+	free(emu->response);
+	free(emu->file);
+	free(emu->emucom);
+	free(emu);
+	free(devh->buffer);
+	devh->emulator = NULL;
+
+	log_dbg(devh->dev->ctx, "Emulator closed successfully");
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_emulator_start_write(
+		struct jaylink_device_handle *devh, size_t length,
+		bool has_command)
+{
+	(void)has_command;
+
+	if (!length)
+		return JAYLINK_ERR_ARG;
+
+	log_dbgio(devh->dev->ctx, "Starting write operation (length = %zu "
+		"bytes)", length);
+
+	devh->write_length = length;
+	devh->write_pos = 0;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_emulator_start_read(
+		struct jaylink_device_handle *devh, size_t length)
+{
+	if (!length)
+		return JAYLINK_ERR_ARG;
+
+	log_dbgio(devh->dev->ctx, "Starting read operation (length = %zu "
+		"bytes)", length);
+
+	devh->read_length = length;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_emulator_start_write_read(
+		struct jaylink_device_handle *devh, size_t write_length,
+		size_t read_length, bool has_command)
+{
+	(void)has_command;
+
+	if (!read_length || !write_length)
+		return JAYLINK_ERR_ARG;
+
+	log_dbgio(devh->dev->ctx, "Starting write / read operation (length = "
+		"%zu / %zu bytes)", write_length, read_length);
+
+	devh->write_length = write_length;
+	devh->write_pos = 0;
+	devh->read_length = read_length;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_emulator_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	struct jaylink_context *ctx;
+	size_t length;
+
+	ctx = devh->dev->ctx;
+	length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += iov[i].length;
+
+	if (length > devh->write_length) {
+		log_err(ctx, "Requested to write %zu bytes but only %zu bytes "
+			"are expected for the write operation", length,
+			devh->write_length);
+		return JAYLINK_ERR_ARG;
+	}
+
+	if (!reserve(&devh->buffer, &devh->buffer_size,
+			devh->write_pos + length)) {
+		log_err(ctx, "Failed to adjust buffer size to %zu bytes",
+			devh->write_pos + length);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		memcpy(devh->buffer + devh->write_pos, iov[i].buffer,
+			iov[i].length);
+		devh->write_pos += iov[i].length;
+	}
+
+	devh->write_length -= length;
+
+	/*
+	 * A complete write operation is processed immediately, even during a
+	 * batch, because the responses are collected in a separate buffer.
+	 */
+	if (!devh->write_length)
+		return emulate(devh);
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_emulator_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	struct jaylink_context *ctx;
+	struct emulator_data *emu;
+	size_t length;
+
+	ctx = devh->dev->ctx;
+	emu = devh->emulator;
+	length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += iov[i].length;
+
+	if (length > devh->read_length) {
+		log_err(ctx, "Requested to read %zu bytes but only %zu bytes "
+			"are expected for the read operation", length,
+			devh->read_length);
+		return JAYLINK_ERR_ARG;
+	}
+
+	if (emu->response_pos + length > emu->response_length) {
+		log_err(ctx, "Emulator has no response data available");
+		return JAYLINK_ERR_IO;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (!iov[i].length)
+			continue;
+
+		memcpy(iov[i].buffer, emu->response + emu->response_pos,
+			iov[i].length);
+		emu->response_pos += iov[i].length;
+	}
+
+	/* Reuse the response buffer once all responses are read. */
+	if (emu->response_pos == emu->response_length) {
+		emu->response_pos = 0;
+		emu->response_length = 0;
+	}
+
+	devh->read_length -= length;
+
+	return JAYLINK_OK;
+}
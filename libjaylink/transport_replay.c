@@ -0,0 +1,245 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libjaylink.h"
+#include "libjaylink-internal.h"
+
+/**
+ * @file
+ *
+ * Transport abstraction layer (replay of a capture file).
+ */
+
+JAYLINK_PRIV int transport_replay_open(struct jaylink_device_handle *devh)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct replay_data *replay;
+
+	ctx = devh->dev->ctx;
+
+	log_dbg(ctx, "Trying to open replay (file = %s)", devh->dev->filename);
+
+	replay = malloc(sizeof(struct replay_data));
+
+	if (!replay) {
+		log_err(ctx, "Replay data malloc failed");
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	ret = capture_load(ctx, devh->dev->filename, replay);
+
+	if (ret != JAYLINK_OK) {
+		free(replay);
+		return ret;
+	}
+
+	devh->buffer = NULL;
+	devh->buffer_size = 0;
+
+	devh->read_length = 0;
+	devh->bytes_available = 0;
+	devh->read_pos = 0;
+
+	devh->write_length = 0;
+	devh->write_pos = 0;
+	devh->batch = false;
+
+	devh->replay = replay;
+
+	log_dbg(ctx, "Replay opened successfully");
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_replay_close(struct jaylink_device_handle *devh)
+{
+	struct jaylink_context *ctx;
+	struct replay_data *replay;
+
+	ctx = devh->dev->ctx;
+	replay = devh->replay;
+
+	log_dbg(ctx, "Closing replay (file = %s)", devh->dev->filename);
+
+	if (replay->write_pos < replay->write_length ||
+			replay->read_pos < replay->read_length)
+		log_dbg(ctx, "Replay closed with %zu / %zu bytes of written / "
+			"read data left", replay->write_length -
+			replay->write_pos, replay->read_length -
+			replay->read_pos);
+
+	free(replay->write_data);
+	free(replay->read_data);
+	free(replay);
+	devh->replay = NULL;
+
+	log_dbg(ctx, "Replay closed successfully");
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_replay_start_write(
+		struct jaylink_device_handle *devh, size_t length,
+		bool has_command)
+{
+	(void)has_command;
+
+	if (!length)
+		return JAYLINK_ERR_ARG;
+
+	log_dbgio(devh->dev->ctx, "Starting write operation (length = %zu "
+		"bytes)", length);
+
+	devh->write_length = length;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_replay_start_read(
+		struct jaylink_device_handle *devh, size_t length)
+{
+	if (!length)
+		return JAYLINK_ERR_ARG;
+
+	log_dbgio(devh->dev->ctx, "Starting read operation (length = %zu "
+		"bytes)", length);
+
+	devh->read_length = length;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_replay_start_write_read(
+		struct jaylink_device_handle *devh, size_t write_length,
+		size_t read_length, bool has_command)
+{
+	(void)has_command;
+
+	if (!read_length || !write_length)
+		return JAYLINK_ERR_ARG;
+
+	log_dbgio(devh->dev->ctx, "Starting write / read operation (length = "
+		"%zu / %zu bytes)", write_length, read_length);
+
+	devh->write_length = write_length;
+	devh->read_length = read_length;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_replay_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	struct jaylink_context *ctx;
+	struct replay_data *replay;
+	size_t length;
+
+	ctx = devh->dev->ctx;
+	replay = devh->replay;
+
+	length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += iov[i].length;
+
+	if (length > devh->write_length) {
+		log_err(ctx, "Requested to write %zu bytes but only %zu bytes "
+			"are expected for the write operation", length,
+			devh->write_length);
+		return JAYLINK_ERR_ARG;
+	}
+
+	/*
+	 * Compare the written data with the captured data in order to detect
+	 * a divergence from the captured session.
+	 */
+	for (size_t i = 0; i < count; i++) {
+		if (!iov[i].length)
+			continue;
+
+		if (replay->write_pos + iov[i].length > replay->write_length) {
+			log_err(ctx, "Replay has no more written data");
+			return JAYLINK_ERR;
+		}
+
+		if (memcmp(replay->write_data + replay->write_pos,
+				iov[i].buffer, iov[i].length)) {
+			log_err(ctx, "Written data does not match the capture "
+				"at offset %zu", replay->write_pos);
+			return JAYLINK_ERR;
+		}
+
+		replay->write_pos += iov[i].length;
+	}
+
+	devh->write_length -= length;
+
+	log_dbgio(ctx, "Replayed %zu bytes of written data", length);
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_replay_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	struct jaylink_context *ctx;
+	struct replay_data *replay;
+	size_t length;
+
+	ctx = devh->dev->ctx;
+	replay = devh->replay;
+
+	length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += iov[i].length;
+
+	if (length > devh->read_length) {
+		log_err(ctx, "Requested to read %zu bytes but only %zu bytes "
+			"are expected for the read operation", length,
+			devh->read_length);
+		return JAYLINK_ERR_ARG;
+	}
+
+	if (replay->read_pos + length > replay->read_length) {
+		log_err(ctx, "Replay has no more read data");
+		return JAYLINK_ERR_IO;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (!iov[i].length)
+			continue;
+
+		memcpy(iov[i].buffer, replay->read_data + replay->read_pos,
+			iov[i].length);
+		replay->read_pos += iov[i].length;
+	}
+
+	devh->read_length -= length;
+
+	log_dbgio(ctx, "Replayed %zu bytes of read data", length);
+
+	return JAYLINK_OK;
+}
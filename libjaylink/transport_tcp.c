@@ -29,8 +29,10 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <poll.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #endif
 
 #include "libjaylink.h"
@@ -62,6 +64,12 @@
 /** Timeout of a send operation in milliseconds. */
 #define SEND_TIMEOUT	5000
 
+/** Socket buffer size in bytes for the latency-optimized mode. */
+#define LOW_LATENCY_BUFFER_SIZE	(256 * 1024)
+
+/** Maximum delay between connection retries in milliseconds. */
+#define MAX_RETRY_DELAY	10000
+
 /** String of the port number for the J-Link TCP/IP protocol. */
 #define PORT_STRING	"19020"
 
@@ -94,10 +102,60 @@ static int initialize_handle(struct jaylink_device_handle *devh)
 
 	devh->write_length = 0;
 	devh->write_pos = 0;
+	devh->batch = false;
+
+	devh->tcp_mode = JAYLINK_TCP_MODE_DEFAULT;
 
 	return JAYLINK_OK;
 }
 
+static int get_buffer_size(int sock, int option)
+{
+	int value;
+	size_t length;
+
+	length = sizeof(value);
+
+	if (!socket_get_option(sock, SOL_SOCKET, option, &value, &length))
+		return 0;
+
+#ifdef __linux__
+	/*
+	 * Linux reports twice the size which was set in order to account for
+	 * its bookkeeping overhead, and doubles the size when it is set.
+	 */
+	value /= 2;
+#endif
+
+	return value;
+}
+
+/*
+ * Save the socket buffer sizes of the connection such that they can be
+ * restored when the transport mode is set back to default.
+ */
+static void save_buffer_sizes(struct jaylink_device_handle *devh)
+{
+	devh->tcp_send_buffer_size = get_buffer_size(devh->sock, SO_SNDBUF);
+	devh->tcp_recv_buffer_size = get_buffer_size(devh->sock, SO_RCVBUF);
+}
+
+static void set_buffer_sizes(struct jaylink_device_handle *devh,
+		int send_size, int recv_size)
+{
+	struct jaylink_context *ctx;
+
+	ctx = devh->dev->ctx;
+
+	if (send_size > 0 && !socket_set_option(devh->sock, SOL_SOCKET,
+			SO_SNDBUF, &send_size, sizeof(send_size)))
+		log_warn(ctx, "Failed to set socket send buffer size");
+
+	if (recv_size > 0 && !socket_set_option(devh->sock, SOL_SOCKET,
+			SO_RCVBUF, &recv_size, sizeof(recv_size)))
+		log_warn(ctx, "Failed to set socket receive buffer size");
+}
+
 static void cleanup_handle(struct jaylink_device_handle *devh)
 {
 	free(devh->buffer);
@@ -123,6 +181,9 @@ static int _recv(struct jaylink_device_handle *devh, uint8_t *buffer,
 			return JAYLINK_ERR_IO;
 		}
 
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_reads, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_read, tmp);
+
 		buffer += tmp;
 		length -= tmp;
 
@@ -132,7 +193,8 @@ static int _recv(struct jaylink_device_handle *devh, uint8_t *buffer,
 	return JAYLINK_OK;
 }
 
-static int handle_server_hello(struct jaylink_device_handle *devh)
+static int handle_server_hello(struct jaylink_device_handle *devh,
+		bool *max_connections)
 {
 	int ret;
 	struct jaylink_context *ctx;
@@ -142,6 +204,7 @@ static int handle_server_hello(struct jaylink_device_handle *devh)
 	size_t length;
 
 	ctx = devh->dev->ctx;
+	*max_connections = false;
 
 	ret = _recv(devh, buf, sizeof(buf));
 
@@ -151,7 +214,7 @@ static int handle_server_hello(struct jaylink_device_handle *devh)
 	}
 
 	if (buf[0] == RESP_MAX_CONNECTIONS) {
-		log_err(ctx, "Maximum number of connections reached");
+		*max_connections = true;
 		return JAYLINK_ERR;
 	}
 
@@ -226,7 +289,8 @@ static int set_socket_timeouts(struct jaylink_device_handle *devh)
 	return JAYLINK_OK;
 }
 
-JAYLINK_PRIV int transport_tcp_open(struct jaylink_device_handle *devh)
+static int open_connection(struct jaylink_device_handle *devh,
+		bool *max_connections)
 {
 	int ret;
 	struct jaylink_context *ctx;
@@ -237,16 +301,7 @@ JAYLINK_PRIV int transport_tcp_open(struct jaylink_device_handle *devh)
 
 	dev = devh->dev;
 	ctx = dev->ctx;
-
-	log_dbg(ctx, "Trying to open device (IPv4 address = %s)",
-		dev->ipv4_address);
-
-	ret = initialize_handle(devh);
-
-	if (ret != JAYLINK_OK) {
-		log_err(ctx, "Initialize device handle failed");
-		return ret;
-	}
+	*max_connections = false;
 
 	memset(&hints, 0, sizeof(struct addrinfo));
 	hints.ai_family = AF_INET;
@@ -257,7 +312,6 @@ JAYLINK_PRIV int transport_tcp_open(struct jaylink_device_handle *devh)
 
 	if (ret != 0) {
 		log_err(ctx, "Address lookup failed");
-		cleanup_handle(devh);
 		return JAYLINK_ERR;
 	}
 
@@ -273,8 +327,8 @@ JAYLINK_PRIV int transport_tcp_open(struct jaylink_device_handle *devh)
 			CONNECT_TIMEOUT);
 
 		if (ret == JAYLINK_ERR_TIMEOUT) {
+			socket_close(sock);
 			freeaddrinfo(info);
-			cleanup_handle(devh);
 			return JAYLINK_ERR_TIMEOUT;
 		} else if (ret == JAYLINK_OK) {
 			break;
@@ -288,32 +342,265 @@ JAYLINK_PRIV int transport_tcp_open(struct jaylink_device_handle *devh)
 
 	if (sock < 0) {
 		log_err(ctx, "Failed to open device");
-		cleanup_handle(devh);
 		return JAYLINK_ERR;
 	}
 
-	log_dbg(ctx, "Device opened successfully");
-
 	devh->sock = sock;
 	ret = set_socket_timeouts(devh);
 
 	if (ret != JAYLINK_OK) {
 		socket_close(sock);
-		cleanup_handle(devh);
 		return ret;
 	}
 
-	ret = handle_server_hello(devh);
+	ret = handle_server_hello(devh, max_connections);
 
 	if (ret != JAYLINK_OK) {
 		socket_close(sock);
-		cleanup_handle(devh);
 		return ret;
 	}
 
 	return JAYLINK_OK;
 }
 
+/*
+ * Take an idle connection to the device from the connection pool.
+ *
+ * Connections which exceeded the idle timeout or which became readable in the
+ * meantime are closed instead. The latter happens if the connection was
+ * closed or reset by the device, or if the device sent unexpected data.
+ */
+static bool take_connection(struct jaylink_device_handle *devh)
+{
+	struct jaylink_context *ctx;
+	struct tcp_connection conn;
+	uint64_t timeout;
+	bool found;
+	bool readable;
+
+	ctx = devh->dev->ctx;
+
+	while (true) {
+		found = false;
+		mutex_lock(&ctx->devs_mutex);
+
+		/* Prefer the most recently released connection. */
+		for (size_t i = ctx->num_tcp_connections; i > 0; i--) {
+			conn = ctx->tcp_connections[i - 1];
+
+			if (strcmp(conn.ipv4_address, devh->dev->ipv4_address))
+				continue;
+
+			memmove(ctx->tcp_connections + i - 1,
+				ctx->tcp_connections + i,
+				(ctx->num_tcp_connections - i) *
+				sizeof(struct tcp_connection));
+			ctx->num_tcp_connections--;
+			found = true;
+			break;
+		}
+
+		timeout = (uint64_t)ctx->tcp_idle_timeout * 1000;
+		mutex_unlock(&ctx->devs_mutex);
+
+		if (!found)
+			return false;
+
+		if (timeout > 0 &&
+				util_get_timestamp() - conn.timestamp > timeout) {
+			log_dbg(ctx, "Idle connection timed out");
+			socket_close(conn.sock);
+			continue;
+		}
+
+		if (!socket_is_readable(conn.sock, &readable) || readable) {
+			log_dbg(ctx, "Idle connection is not usable anymore");
+			socket_close(conn.sock);
+			continue;
+		}
+
+		devh->sock = conn.sock;
+
+		return true;
+	}
+}
+
+/*
+ * Put the connection of a device handle into the connection pool.
+ *
+ * The connection is kept open only if no operation is pending such that the
+ * next device handle starts with the same protocol state as on a new
+ * connection.
+ */
+static bool release_connection(struct jaylink_device_handle *devh)
+{
+	struct jaylink_context *ctx;
+	struct tcp_connection *conn;
+	bool readable;
+	int value;
+
+	ctx = devh->dev->ctx;
+
+	if (!ATOMIC_LOAD(&ctx->max_tcp_connections))
+		return false;
+
+	if (devh->read_length > 0 || devh->bytes_available > 0 ||
+			devh->write_length > 0 || devh->write_pos > 0)
+		return false;
+
+	if (!socket_is_readable(devh->sock, &readable) || readable)
+		return false;
+
+	if (devh->tcp_mode != JAYLINK_TCP_MODE_DEFAULT &&
+			transport_tcp_set_mode(devh,
+			JAYLINK_TCP_MODE_DEFAULT) != JAYLINK_OK)
+		return false;
+
+	/* Detect connections which are dropped while they are idle. */
+	value = 1;
+
+	if (!socket_set_option(devh->sock, SOL_SOCKET, SO_KEEPALIVE, &value,
+			sizeof(value)))
+		log_warn(ctx, "Failed to enable TCP keepalive");
+
+	mutex_lock(&ctx->devs_mutex);
+
+	if (!ctx->max_tcp_connections) {
+		mutex_unlock(&ctx->devs_mutex);
+		return false;
+	}
+
+	/* Close the least recently released connection if the pool is full. */
+	if (ctx->num_tcp_connections == ctx->max_tcp_connections) {
+		socket_close(ctx->tcp_connections[0].sock);
+		memmove(ctx->tcp_connections, ctx->tcp_connections + 1,
+			(ctx->num_tcp_connections - 1) *
+			sizeof(struct tcp_connection));
+		ctx->num_tcp_connections--;
+	}
+
+	conn = &ctx->tcp_connections[ctx->num_tcp_connections];
+	strcpy(conn->ipv4_address, devh->dev->ipv4_address);
+	conn->sock = devh->sock;
+	conn->timestamp = util_get_timestamp();
+	ctx->num_tcp_connections++;
+
+	mutex_unlock(&ctx->devs_mutex);
+
+	return true;
+}
+
+JAYLINK_PRIV int transport_tcp_set_max_connections(
+		struct jaylink_context *ctx, size_t max_connections)
+{
+	struct tcp_connection *connections;
+	size_t num;
+
+	mutex_lock(&ctx->devs_mutex);
+
+	/* Close the least recently released connections first. */
+	num = 0;
+
+	if (ctx->num_tcp_connections > max_connections)
+		num = ctx->num_tcp_connections - max_connections;
+
+	if (num > 0) {
+		for (size_t i = 0; i < num; i++)
+			socket_close(ctx->tcp_connections[i].sock);
+
+		ctx->num_tcp_connections -= num;
+		memmove(ctx->tcp_connections, ctx->tcp_connections + num,
+			ctx->num_tcp_connections *
+			sizeof(struct tcp_connection));
+	}
+
+	if (!max_connections) {
+		free(ctx->tcp_connections);
+		ctx->tcp_connections = NULL;
+		ATOMIC_STORE(&ctx->max_tcp_connections, 0);
+		mutex_unlock(&ctx->devs_mutex);
+		return JAYLINK_OK;
+	}
+
+	connections = realloc(ctx->tcp_connections,
+		max_connections * sizeof(struct tcp_connection));
+
+	if (!connections) {
+		mutex_unlock(&ctx->devs_mutex);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	ctx->tcp_connections = connections;
+	ATOMIC_STORE(&ctx->max_tcp_connections, max_connections);
+
+	mutex_unlock(&ctx->devs_mutex);
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_tcp_open(struct jaylink_device_handle *devh)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct jaylink_device *dev;
+	unsigned int retries;
+	unsigned int delay;
+	bool max_connections;
+
+	dev = devh->dev;
+	ctx = dev->ctx;
+
+	log_dbg(ctx, "Trying to open device (IPv4 address = %s)",
+		dev->ipv4_address);
+
+	ret = initialize_handle(devh);
+
+	if (ret != JAYLINK_OK) {
+		log_err(ctx, "Initialize device handle failed");
+		return ret;
+	}
+
+	if (take_connection(devh)) {
+		save_buffer_sizes(devh);
+		log_dbg(ctx, "Device opened successfully using an idle "
+			"connection");
+		return JAYLINK_OK;
+	}
+
+	mutex_lock(&ctx->devs_mutex);
+	retries = ctx->tcp_connect_retries;
+	delay = MIN(ctx->tcp_connect_retry_delay, MAX_RETRY_DELAY);
+	mutex_unlock(&ctx->devs_mutex);
+
+	while (true) {
+		ret = open_connection(devh, &max_connections);
+
+		if (ret == JAYLINK_OK)
+			break;
+
+		if (!max_connections || !retries) {
+			if (max_connections)
+				log_err(ctx, "Maximum number of connections "
+					"reached");
+
+			cleanup_handle(devh);
+			return ret;
+		}
+
+		log_dbg(ctx, "Maximum number of connections reached, retrying "
+			"in %u ms", delay);
+
+		thread_sleep(delay * 1000);
+		delay = MIN(2 * delay, MAX_RETRY_DELAY);
+		retries--;
+	}
+
+	save_buffer_sizes(devh);
+	log_dbg(ctx, "Device opened successfully");
+
+	return JAYLINK_OK;
+}
+
 JAYLINK_PRIV int transport_tcp_close(struct jaylink_device_handle *devh)
 {
 	struct jaylink_context *ctx;
@@ -323,6 +610,12 @@ JAYLINK_PRIV int transport_tcp_close(struct jaylink_device_handle *devh)
 	log_dbg(ctx, "Closing device (IPv4 address = %s)",
 		devh->dev->ipv4_address);
 
+	if (release_connection(devh)) {
+		log_dbg(ctx, "Connection kept open for reuse");
+	} else if (!socket_close(devh->sock)) {
+		log_warn(ctx, "Failed to close socket");
+	}
+
 	cleanup_handle(devh);
 
 	log_dbg(ctx, "Device closed successfully");
@@ -330,6 +623,37 @@ JAYLINK_PRIV int transport_tcp_close(struct jaylink_device_handle *devh)
 	return JAYLINK_OK;
 }
 
+static bool adjust_buffer(struct jaylink_device_handle *devh, size_t size)
+{
+	struct jaylink_context *ctx;
+	uint8_t *buffer;
+	size_t num;
+
+	ctx = devh->dev->ctx;
+
+	/* Adjust buffer size to a multiple of BUFFER_SIZE bytes. */
+	num = size / BUFFER_SIZE;
+
+	if (size % BUFFER_SIZE > 0)
+		num++;
+
+	size = num * BUFFER_SIZE;
+	buffer = realloc(devh->buffer, size);
+
+	if (!buffer) {
+		log_err(ctx, "Failed to adjust buffer size to %zu bytes",
+			size);
+		return false;
+	}
+
+	devh->buffer = buffer;
+	devh->buffer_size = size;
+
+	log_dbg(ctx, "Adjusted buffer size to %zu bytes", size);
+
+	return true;
+}
+
 JAYLINK_PRIV int transport_tcp_start_write(struct jaylink_device_handle *devh,
 		size_t length, bool has_command)
 {
@@ -343,14 +667,33 @@ JAYLINK_PRIV int transport_tcp_start_write(struct jaylink_device_handle *devh,
 	log_dbgio(ctx, "Starting write operation (length = %zu bytes)",
 		length);
 
-	if (devh->write_pos > 0)
-		log_warn(ctx, "Last write operation left %zu bytes in the "
-			"buffer", devh->write_pos);
-
 	if (devh->write_length > 0)
 		log_warn(ctx, "Last write operation was not performed");
 
 	devh->write_length = length;
+
+	/*
+	 * Keep the data of previous write operations during a batch and
+	 * append the command prefix of this write operation.
+	 */
+	if (devh->batch) {
+		if (has_command) {
+			if (devh->write_pos + 1 > devh->buffer_size) {
+				if (!adjust_buffer(devh, devh->write_pos + 1))
+					return JAYLINK_ERR_MALLOC;
+			}
+
+			devh->buffer[devh->write_pos] = CMD_CLIENT;
+			devh->write_pos++;
+		}
+
+		return JAYLINK_OK;
+	}
+
+	if (devh->write_pos > 0)
+		log_warn(ctx, "Last write operation left %zu bytes in the "
+			"buffer", devh->write_pos);
+
 	devh->write_pos = 0;
 
 	if (has_command) {
@@ -447,6 +790,9 @@ static int _send(struct jaylink_device_handle *devh, const uint8_t *buffer,
 			return JAYLINK_ERR_IO;
 		}
 
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_writes, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_written, tmp);
+
 		buffer += tmp;
 		length -= tmp;
 
@@ -456,45 +802,145 @@ static int _send(struct jaylink_device_handle *devh, const uint8_t *buffer,
 	return JAYLINK_OK;
 }
 
-static bool adjust_buffer(struct jaylink_device_handle *devh, size_t size)
+static int _sendv(struct jaylink_device_handle *devh, struct io_vector *iov,
+		size_t count)
 {
 	struct jaylink_context *ctx;
-	uint8_t *buffer;
-	size_t num;
+	size_t tmp;
 
 	ctx = devh->dev->ctx;
 
-	/* Adjust buffer size to a multiple of BUFFER_SIZE bytes. */
-	num = size / BUFFER_SIZE;
+	while (count > 0) {
+		if (!socket_sendv(devh->sock, iov, count, &tmp, 0)) {
+			log_err(ctx, "Failed to send data to device");
+			return JAYLINK_ERR_IO;
+		}
 
-	if (size % BUFFER_SIZE > 0)
-		num++;
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_writes, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_written, tmp);
 
-	size = num * BUFFER_SIZE;
-	buffer = realloc(devh->buffer, size);
+		log_dbgio(ctx, "Sent %zu bytes to device", tmp);
 
-	if (!buffer) {
-		log_err(ctx, "Failed to adjust buffer size to %zu bytes",
-			size);
-		return false;
+		/* Skip the segments which are sent completely. */
+		while (count > 0 && tmp >= iov->length) {
+			tmp -= iov->length;
+			iov++;
+			count--;
+		}
+
+		if (count > 0) {
+			iov->buffer = (uint8_t *)iov->buffer + tmp;
+			iov->length -= tmp;
+		}
 	}
 
-	devh->buffer = buffer;
-	devh->buffer_size = size;
+	return JAYLINK_OK;
+}
 
-	log_dbg(ctx, "Adjusted buffer size to %zu bytes", size);
+static int _recvv(struct jaylink_device_handle *devh, struct io_vector *iov,
+		size_t count)
+{
+	struct jaylink_context *ctx;
+	size_t tmp;
 
-	return true;
+	ctx = devh->dev->ctx;
+
+	while (count > 0) {
+		if (!socket_recvv(devh->sock, iov, count, &tmp, 0)) {
+			log_err(ctx, "Failed to receive data from device");
+			return JAYLINK_ERR_IO;
+		} else if (!tmp) {
+			log_err(ctx, "Failed to receive data from device: "
+				"remote connection closed");
+			return JAYLINK_ERR_IO;
+		}
+
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_reads, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_read, tmp);
+
+		log_dbgio(ctx, "Received %zu bytes from device", tmp);
+
+		/* Skip the segments which are filled completely. */
+		while (count > 0 && tmp >= iov->length) {
+			tmp -= iov->length;
+			iov++;
+			count--;
+		}
+
+		if (count > 0) {
+			iov->buffer = (uint8_t *)iov->buffer + tmp;
+			iov->length -= tmp;
+		}
+	}
+
+	return JAYLINK_OK;
 }
 
-JAYLINK_PRIV int transport_tcp_write(struct jaylink_device_handle *devh,
-		const uint8_t *buffer, size_t length)
+/*
+ * Receive at least the specified number of bytes into the buffer.
+ *
+ * Additional bytes which are already available on the socket are received as
+ * well, up to the specified maximum, such that subsequent read operations can
+ * be served from the buffer without receiving data again. The buffer must be
+ * empty.
+ */
+static int receive_ahead(struct jaylink_device_handle *devh, size_t length,
+		size_t max_length)
 {
-	int ret;
 	struct jaylink_context *ctx;
 	size_t tmp;
 
 	ctx = devh->dev->ctx;
+	max_length = MIN(max_length, devh->buffer_size);
+
+	devh->read_pos = 0;
+
+	while (devh->bytes_available < length) {
+		tmp = max_length - devh->bytes_available;
+
+		if (!socket_recv(devh->sock, devh->buffer +
+				devh->bytes_available, &tmp, 0)) {
+			log_err(ctx, "Failed to receive data from device");
+			return JAYLINK_ERR_IO;
+		} else if (!tmp) {
+			log_err(ctx, "Failed to receive data from device: "
+				"remote connection closed");
+			return JAYLINK_ERR_IO;
+		}
+
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_reads, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_read, tmp);
+		devh->bytes_available += tmp;
+
+		log_dbgio(ctx, "Received %zu bytes from device", tmp);
+	}
+
+	return JAYLINK_OK;
+}
+
+static size_t get_iov_length(const struct io_vector *iov, size_t count)
+{
+	size_t length;
+
+	length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += iov[i].length;
+
+	return length;
+}
+
+JAYLINK_PRIV int transport_tcp_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct io_vector vectors[MAX_IO_VECTORS + 1];
+	size_t num_vectors;
+	size_t length;
+
+	ctx = devh->dev->ctx;
+	length = get_iov_length(iov, count);
 
 	if (length > devh->write_length) {
 		log_err(ctx, "Requested to write %zu bytes but only %zu bytes "
@@ -505,18 +951,21 @@ JAYLINK_PRIV int transport_tcp_write(struct jaylink_device_handle *devh,
 
 	/*
 	 * Store data in the buffer if the expected number of bytes for the
-	 * write operation is not reached.
+	 * write operation is not reached or a batch is active.
 	 */
-	if (length < devh->write_length) {
+	if (length < devh->write_length || devh->batch) {
 		if (devh->write_pos + length > devh->buffer_size) {
 			if (!adjust_buffer(devh, devh->write_pos + length))
 				return JAYLINK_ERR_MALLOC;
 		}
 
-		memcpy(devh->buffer + devh->write_pos, buffer, length);
+		for (size_t i = 0; i < count; i++) {
+			memcpy(devh->buffer + devh->write_pos, iov[i].buffer,
+				iov[i].length);
+			devh->write_pos += iov[i].length;
+		}
 
 		devh->write_length -= length;
-		devh->write_pos += length;
 
 		log_dbgio(ctx, "Wrote %zu bytes into buffer", length);
 		return JAYLINK_OK;
@@ -528,34 +977,41 @@ JAYLINK_PRIV int transport_tcp_write(struct jaylink_device_handle *devh,
 	 */
 	devh->write_length = 0;
 
-	/* Send data directly to the device if the buffer is empty. */
-	if (!devh->write_pos)
-		return _send(devh, buffer, length);
-
-	tmp = MIN(length, devh->buffer_size - devh->write_pos);
-
 	/*
-	 * Fill up the internal buffer in order to reduce the number of
-	 * messages sent to the device for performance reasons.
+	 * Send the buffered data together with the data of the segments in
+	 * order to reduce the number of messages sent to the device without
+	 * copying the data of the segments.
 	 */
-	memcpy(devh->buffer + devh->write_pos, buffer, tmp);
+	num_vectors = 0;
 
-	length -= tmp;
-	buffer += tmp;
+	if (devh->write_pos > 0) {
+		vectors[num_vectors].buffer = devh->buffer;
+		vectors[num_vectors].length = devh->write_pos;
+		num_vectors++;
+	}
 
-	log_dbgio(ctx, "Buffer filled up with %zu bytes", tmp);
+	for (size_t i = 0; i < count; i++) {
+		if (!iov[i].length)
+			continue;
 
-	ret = _send(devh, devh->buffer, devh->write_pos + tmp);
+		vectors[num_vectors++] = iov[i];
+	}
 
+	ret = _sendv(devh, vectors, num_vectors);
 	devh->write_pos = 0;
 
-	if (ret != JAYLINK_OK)
-		return ret;
+	return ret;
+}
 
-	if (!length)
-		return JAYLINK_OK;
+JAYLINK_PRIV int transport_tcp_write(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct io_vector iov;
+
+	iov.buffer = (uint8_t *)buffer;
+	iov.length = length;
 
-	return _send(devh, buffer, length);
+	return transport_tcp_writev(devh, &iov, 1);
 }
 
 JAYLINK_PRIV int transport_tcp_read(struct jaylink_device_handle *devh,
@@ -599,12 +1055,192 @@ JAYLINK_PRIV int transport_tcp_read(struct jaylink_device_handle *devh,
 		devh->read_pos = 0;
 	}
 
-	ret = _recv(devh, buffer, length);
+	/*
+	 * Receive large amounts of data directly into the buffer of the
+	 * caller. Otherwise, receive ahead into the buffer such that the
+	 * remaining data of the read operation, for example the status of a
+	 * command, is not received separately.
+	 */
+	if (length >= devh->buffer_size) {
+		ret = _recv(devh, buffer, length);
 
-	if (ret != JAYLINK_OK)
-		return ret;
+		if (ret != JAYLINK_OK)
+			return ret;
+	} else {
+		ret = receive_ahead(devh, length, devh->read_length);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		memcpy(buffer, devh->buffer, length);
+		devh->bytes_available -= length;
+		devh->read_pos = length;
+	}
+
+	devh->read_length -= length;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_tcp_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct io_vector vectors[MAX_IO_VECTORS];
+	size_t num_vectors;
+	size_t length;
+	size_t tmp;
+
+	ctx = devh->dev->ctx;
+	length = get_iov_length(iov, count);
+
+	if (length > devh->read_length) {
+		log_err(ctx, "Requested to read %zu bytes but only %zu bytes "
+			"are expected for the read operation", length,
+			devh->read_length);
+		return JAYLINK_ERR_ARG;
+	}
+
+	num_vectors = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		tmp = MIN(iov[i].length, devh->bytes_available);
+
+		if (tmp > 0) {
+			memcpy(iov[i].buffer, devh->buffer + devh->read_pos,
+				tmp);
+
+			devh->bytes_available -= tmp;
+			devh->read_pos += tmp;
+
+			log_dbgio(ctx, "Read %zu bytes from buffer", tmp);
+		}
+
+		if (tmp == iov[i].length)
+			continue;
+
+		vectors[num_vectors].buffer = (uint8_t *)iov[i].buffer + tmp;
+		vectors[num_vectors].length = iov[i].length - tmp;
+		num_vectors++;
+	}
+
+	if (!devh->bytes_available)
+		devh->read_pos = 0;
+
+	tmp = get_iov_length(vectors, num_vectors);
+
+	if (tmp >= devh->buffer_size) {
+		/* Receive the remaining data directly into the segments. */
+		ret = _recvv(devh, vectors, num_vectors);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	} else if (tmp > 0) {
+		ret = receive_ahead(devh, tmp,
+			devh->read_length - (length - tmp));
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		for (size_t i = 0; i < num_vectors; i++) {
+			memcpy(vectors[i].buffer, devh->buffer + devh->read_pos,
+				vectors[i].length);
+			devh->read_pos += vectors[i].length;
+		}
+
+		devh->bytes_available -= tmp;
+	}
 
 	devh->read_length -= length;
 
 	return JAYLINK_OK;
 }
+
+JAYLINK_PRIV int transport_tcp_flush(struct jaylink_device_handle *devh)
+{
+	int ret;
+
+	if (!devh->write_pos)
+		return JAYLINK_OK;
+
+	ret = _send(devh, devh->buffer, devh->write_pos);
+	devh->write_pos = 0;
+
+	return ret;
+}
+
+JAYLINK_PRIV int transport_tcp_set_mode(struct jaylink_device_handle *devh,
+		enum jaylink_tcp_mode mode)
+{
+	struct jaylink_context *ctx;
+	int value;
+
+	ctx = devh->dev->ctx;
+
+	/*
+	 * Disable Nagle's algorithm in the latency-optimized mode such that
+	 * short commands are sent immediately instead of waiting for the
+	 * acknowledgement of previously sent data.
+	 */
+	value = (mode == JAYLINK_TCP_MODE_LOW_LATENCY);
+
+	if (!socket_set_option(devh->sock, IPPROTO_TCP, TCP_NODELAY, &value,
+			sizeof(value))) {
+		log_err(ctx, "Failed to set TCP_NODELAY socket option");
+		return JAYLINK_ERR;
+	}
+
+	/*
+	 * Enlarge the socket buffers such that large transfers are not
+	 * throttled. The original sizes are restored in the default mode such
+	 * that pooled connections do not keep the enlarged buffers.
+	 */
+	if (mode == JAYLINK_TCP_MODE_LOW_LATENCY)
+		set_buffer_sizes(devh, LOW_LATENCY_BUFFER_SIZE,
+			LOW_LATENCY_BUFFER_SIZE);
+	else if (devh->tcp_mode == JAYLINK_TCP_MODE_LOW_LATENCY)
+		set_buffer_sizes(devh, devh->tcp_send_buffer_size,
+			devh->tcp_recv_buffer_size);
+
+	devh->tcp_mode = mode;
+
+	log_dbg(ctx, "TCP/IP transport mode set to %s",
+		(mode == JAYLINK_TCP_MODE_LOW_LATENCY) ?
+		"low-latency" : "default");
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_tcp_poll_read(struct jaylink_device_handle *devh,
+		bool *ready)
+{
+	if (devh->bytes_available > 0 || !devh->read_length) {
+		*ready = true;
+		return JAYLINK_OK;
+	}
+
+	if (!socket_is_readable(devh->sock, ready)) {
+		log_err(devh->dev->ctx, "Failed to check socket for data");
+		return JAYLINK_ERR_IO;
+	}
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_tcp_get_pollfds(
+		struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count)
+{
+	if (pollfds) {
+		if (*count < 1)
+			return JAYLINK_ERR_ARG;
+
+		pollfds[0].fd = devh->sock;
+		pollfds[0].events = POLLIN;
+	}
+
+	*count = 1;
+
+	return JAYLINK_OK;
+}
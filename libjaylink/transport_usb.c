@@ -31,17 +31,123 @@
  * Transport abstraction layer (USB).
  */
 
-/** Timeout of an USB transfer in milliseconds. */
+/**
+ * Default timeout of an USB transfer in milliseconds.
+ *
+ * The time which is required to transfer the data at the speed of the USB
+ * connection is added to this timeout.
+ */
 #define USB_TIMEOUT	1000
 
 /**
- * Number of consecutive timeouts before an USB transfer will be treated as
- * timed out.
+ * Default number of consecutive timeouts before an USB transfer will be
+ * treated as timed out.
  */
 #define NUM_TIMEOUTS	2
 
-/** Chunk size in bytes in which data is transferred. */
-#define CHUNK_SIZE	2048
+/** Chunk size in bytes in which data is transferred at full-speed. */
+#define CHUNK_SIZE_FULL_SPEED	2048
+
+/** Chunk size in bytes in which data is transferred at high-speed. */
+#define CHUNK_SIZE_HIGH_SPEED	16384
+
+/** Chunk size in bytes in which data is transferred at SuperSpeed. */
+#define CHUNK_SIZE_SUPER_SPEED	65536
+
+/**
+ * Conservative estimate of the bulk transfer throughput at full-speed in
+ * bytes per millisecond.
+ */
+#define THROUGHPUT_FULL_SPEED	500
+
+/**
+ * Conservative estimate of the bulk transfer throughput at high-speed in
+ * bytes per millisecond.
+ */
+#define THROUGHPUT_HIGH_SPEED	15000
+
+/**
+ * Conservative estimate of the bulk transfer throughput at SuperSpeed in
+ * bytes per millisecond.
+ */
+#define THROUGHPUT_SUPER_SPEED	150000
+
+/** State of an asynchronous bulk data transfer. */
+struct async_io {
+	/** Device handle. */
+	struct jaylink_device_handle *devh;
+	/** Endpoint address. */
+	uint8_t endpoint;
+	/** Data buffer. */
+	uint8_t *buffer;
+	/** Number of bytes to be transferred. */
+	size_t length;
+	/** Number of bytes covered by submitted transfers. */
+	size_t submitted;
+	/** Number of bytes transferred. */
+	size_t transferred;
+	/** Number of transfers in flight. */
+	size_t num_pending;
+	/** Indicates whether all transfers are completed. */
+	int completed;
+	/** Status of the operation. */
+	int status;
+};
+
+/*
+ * Derive the chunk size and the throughput estimation for the timeouts from
+ * the speed of the USB connection and the maximum packet size of the
+ * endpoints.
+ */
+static void set_link_parameters(struct jaylink_device_handle *devh)
+{
+	int speed;
+	size_t chunk_size;
+
+	speed = libusb_get_device_speed(devh->dev->usb_dev);
+
+	if (speed >= LIBUSB_SPEED_SUPER) {
+		chunk_size = CHUNK_SIZE_SUPER_SPEED;
+		devh->throughput = THROUGHPUT_SUPER_SPEED;
+	} else if (speed == LIBUSB_SPEED_HIGH) {
+		chunk_size = CHUNK_SIZE_HIGH_SPEED;
+		devh->throughput = THROUGHPUT_HIGH_SPEED;
+	} else {
+		chunk_size = CHUNK_SIZE_FULL_SPEED;
+		devh->throughput = THROUGHPUT_FULL_SPEED;
+	}
+
+	/*
+	 * Data is always requested from the device in whole chunks. Use a
+	 * multiple of the maximum packet size to prevent an overflow.
+	 */
+	if (!devh->max_packet_size)
+		devh->max_packet_size = 64;
+
+	if (chunk_size % devh->max_packet_size)
+		chunk_size += devh->max_packet_size -
+			(chunk_size % devh->max_packet_size);
+
+	devh->default_chunk_size = chunk_size;
+	devh->chunk_size = chunk_size;
+	devh->timeout = USB_TIMEOUT;
+	devh->num_timeouts = NUM_TIMEOUTS;
+
+	log_dbg(devh->dev->ctx, "Using chunk size of %zu bytes (speed = %i, "
+		"maximum packet size = %u bytes)", chunk_size, speed,
+		devh->max_packet_size);
+}
+
+/*
+ * Get the timeout of a transfer in milliseconds. The timeout grows with the
+ * time which is required to transfer the data.
+ */
+static unsigned int get_timeout(const struct jaylink_device_handle *devh,
+		size_t length)
+{
+	return devh->timeout + (length + devh->throughput - 1) /
+		devh->throughput;
+}
 
 static int initialize_handle(struct jaylink_device_handle *devh)
 {
@@ -99,6 +205,8 @@ static int initialize_handle(struct jaylink_device_handle *devh)
 	found_endpoint_in = false;
 	found_endpoint_out = false;
 
+	devh->max_packet_size = 0;
+
 	for (uint8_t i = 0; i < desc->bNumEndpoints; i++) {
 		epdesc = &desc->endpoint[i];
 
@@ -109,6 +217,10 @@ static int initialize_handle(struct jaylink_device_handle *devh)
 			devh->endpoint_out = epdesc->bEndpointAddress;
 			found_endpoint_out = true;
 		}
+
+		/* Bits 10..0 contain the maximum packet size. */
+		devh->max_packet_size = MAX(devh->max_packet_size,
+			epdesc->wMaxPacketSize & 0x7ff);
 	}
 
 	libusb_free_config_descriptor(config);
@@ -126,8 +238,10 @@ static int initialize_handle(struct jaylink_device_handle *devh)
 	log_dbg(ctx, "Using endpoint %02x (IN) and %02x (OUT)",
 		devh->endpoint_in, devh->endpoint_out);
 
-	/* Buffer size must be a multiple of CHUNK_SIZE bytes. */
-	devh->buffer_size = CHUNK_SIZE;
+	set_link_parameters(devh);
+
+	/* Buffer size must be a multiple of the chunk size. */
+	devh->buffer_size = devh->chunk_size;
 	devh->buffer = malloc(devh->buffer_size);
 
 	if (!devh->buffer) {
@@ -141,12 +255,26 @@ static int initialize_handle(struct jaylink_device_handle *devh)
 
 	devh->write_length = 0;
 	devh->write_pos = 0;
+	devh->batch = false;
+
+	devh->num_transfers = 1;
+
+	for (size_t i = 0; i < JAYLINK_USB_MAX_TRANSFERS; i++)
+		devh->transfers[i] = NULL;
+
+	devh->poll_transfer = NULL;
+	devh->poll_pending = false;
 
 	return JAYLINK_OK;
 }
 
 static void cleanup_handle(struct jaylink_device_handle *devh)
 {
+	for (size_t i = 0; i < JAYLINK_USB_MAX_TRANSFERS; i++)
+		libusb_free_transfer(devh->transfers[i]);
+
+	libusb_free_transfer(devh->poll_transfer);
+
 	free(devh->buffer);
 }
 
@@ -210,6 +338,17 @@ JAYLINK_PRIV int transport_usb_close(struct jaylink_device_handle *devh)
 		libusb_get_bus_number(dev->usb_dev),
 		libusb_get_device_address(dev->usb_dev));
 
+	/* The poll transfer refers to the buffer of the device handle. */
+	if (devh->poll_pending) {
+		libusb_cancel_transfer(devh->poll_transfer);
+
+		while (!devh->poll_completed)
+			libusb_handle_events_completed(ctx->usb_ctx,
+				&devh->poll_completed);
+
+		devh->poll_pending = false;
+	}
+
 	ret = libusb_release_interface(devh->usb_devh, devh->interface_number);
 
 	libusb_close(devh->usb_devh);
@@ -240,14 +379,19 @@ JAYLINK_PRIV int transport_usb_start_write(struct jaylink_device_handle *devh,
 
 	log_dbgio(ctx, "Starting write operation (length = %zu bytes)", length);
 
-	if (devh->write_pos > 0)
-		log_warn(ctx, "Last write operation left %zu bytes in the "
-			"buffer", devh->write_pos);
-
 	if (devh->write_length > 0)
 		log_warn(ctx, "Last write operation was not performed");
 
 	devh->write_length = length;
+
+	/* Keep the data of previous write operations during a batch. */
+	if (devh->batch)
+		return JAYLINK_OK;
+
+	if (devh->write_pos > 0)
+		log_warn(ctx, "Last write operation left %zu bytes in the "
+			"buffer", devh->write_pos);
+
 	devh->write_pos = 0;
 
 	return JAYLINK_OK;
@@ -320,6 +464,207 @@ JAYLINK_PRIV int transport_usb_start_write_read(
 	return JAYLINK_OK;
 }
 
+static void LIBUSB_CALL async_callback(struct libusb_transfer *transfer);
+
+static bool async_submit(struct async_io *io, struct libusb_transfer *transfer)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	size_t length;
+
+	ctx = io->devh->dev->ctx;
+
+	/*
+	 * Data from the device is always requested in whole chunks. This
+	 * guarantees that a transfer never receives more data than fits into
+	 * its part of the buffer.
+	 */
+	if (io->endpoint & LIBUSB_ENDPOINT_IN) {
+		if (io->submitted + io->devh->chunk_size > io->length)
+			return true;
+
+		length = io->devh->chunk_size;
+	} else {
+		if (io->submitted == io->length)
+			return true;
+
+		length = MIN(io->devh->chunk_size, io->length - io->submitted);
+	}
+
+	/*
+	 * The timeout of a transfer starts with its submission. Scale the
+	 * timeout with the number of transfers queued in front of it in order
+	 * to grant each transfer the same amount of time as with synchronous
+	 * transfers.
+	 */
+	libusb_fill_bulk_transfer(transfer, io->devh->usb_devh, io->endpoint,
+		(unsigned char *)io->buffer + io->submitted, length,
+		&async_callback, io, get_timeout(io->devh, length) *
+		io->devh->num_timeouts * (io->num_pending + 1));
+
+	ret = libusb_submit_transfer(transfer);
+
+	if (ret != LIBUSB_SUCCESS) {
+		log_err(ctx, "Failed to submit transfer: %s",
+			libusb_error_name(ret));
+		return false;
+	}
+
+	io->submitted += length;
+	io->num_pending++;
+
+	return true;
+}
+
+static void LIBUSB_CALL async_callback(struct libusb_transfer *transfer)
+{
+	struct async_io *io;
+	struct jaylink_context *ctx;
+	const uint8_t *data;
+	size_t length;
+
+	io = transfer->user_data;
+	ctx = io->devh->dev->ctx;
+
+	io->num_pending--;
+
+	if (!io->num_pending)
+		io->completed = 1;
+
+	/* Ignore the remaining transfers after a failure. */
+	if (io->status != JAYLINK_OK)
+		return;
+
+	data = transfer->buffer;
+	length = transfer->actual_length;
+
+	if (io->endpoint & LIBUSB_ENDPOINT_IN) {
+		ATOMIC_ADD_FETCH(&io->devh->io_stats.num_reads, 1);
+		ATOMIC_ADD_FETCH(&io->devh->io_stats.bytes_read, length);
+	} else {
+		ATOMIC_ADD_FETCH(&io->devh->io_stats.num_writes, 1);
+		ATOMIC_ADD_FETCH(&io->devh->io_stats.bytes_written, length);
+	}
+
+	if (transfer->status == LIBUSB_TRANSFER_TIMED_OUT) {
+		ATOMIC_ADD_FETCH(&io->devh->io_stats.num_timeouts, 1);
+
+		/* Ignore a possible timeout if at least one byte was received. */
+		if (!(io->endpoint & LIBUSB_ENDPOINT_IN) || !length) {
+			log_err(ctx, "Asynchronous transfer timed out");
+			io->status = JAYLINK_ERR_TIMEOUT;
+			return;
+		}
+	} else if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		log_err(ctx, "Asynchronous transfer failed (status = %u)",
+			transfer->status);
+		io->status = JAYLINK_ERR;
+		return;
+	}
+
+	if (io->endpoint & LIBUSB_ENDPOINT_IN) {
+		/*
+		 * Transfers complete in the order of their submission. Move the
+		 * data down in case a preceding transfer was not completely
+		 * filled by the device.
+		 */
+		if (data != io->buffer + io->transferred)
+			memmove(io->buffer + io->transferred, data, length);
+
+		log_dbgio(ctx, "Received %zu bytes from device", length);
+	} else {
+		if ((int)length != transfer->length) {
+			log_err(ctx, "Asynchronous transfer sent only %zu of "
+				"%i bytes", length, transfer->length);
+			io->status = JAYLINK_ERR;
+			return;
+		}
+
+		log_dbgio(ctx, "Sent %zu bytes to device", length);
+	}
+
+	io->transferred += length;
+
+	if (!async_submit(io, transfer)) {
+		io->status = JAYLINK_ERR;
+		return;
+	}
+
+	if (io->num_pending > 0)
+		io->completed = 0;
+}
+
+static int usb_transfer_async(struct jaylink_device_handle *devh,
+		uint8_t endpoint, uint8_t *buffer, size_t length,
+		size_t *transferred)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct async_io io;
+	bool cancelled;
+
+	ctx = devh->dev->ctx;
+
+	io.devh = devh;
+	io.endpoint = endpoint;
+	io.buffer = buffer;
+	io.length = length;
+	io.submitted = 0;
+	io.transferred = 0;
+	io.num_pending = 0;
+	io.completed = 0;
+	io.status = JAYLINK_OK;
+
+	for (size_t i = 0; i < devh->num_transfers; i++) {
+		if (!devh->transfers[i]) {
+			devh->transfers[i] = libusb_alloc_transfer(0);
+
+			if (!devh->transfers[i]) {
+				log_err(ctx, "Failed to allocate transfer");
+				io.status = JAYLINK_ERR_MALLOC;
+				break;
+			}
+		}
+
+		if (!async_submit(&io, devh->transfers[i])) {
+			io.status = JAYLINK_ERR;
+			break;
+		}
+	}
+
+	cancelled = false;
+
+	while (io.num_pending > 0) {
+		/*
+		 * Cancel all outstanding transfers after a failure. Note that
+		 * we have to wait for their completion anyway because they
+		 * refer to the buffer and the state on the stack.
+		 */
+		if (io.status != JAYLINK_OK && !cancelled) {
+			for (size_t i = 0; i < devh->num_transfers; i++) {
+				if (devh->transfers[i])
+					libusb_cancel_transfer(
+						devh->transfers[i]);
+			}
+
+			cancelled = true;
+		}
+
+		ret = libusb_handle_events_completed(ctx->usb_ctx,
+			&io.completed);
+
+		if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED) {
+			log_err(ctx, "Failed to handle events: %s",
+				libusb_error_name(ret));
+			io.status = JAYLINK_ERR;
+		}
+	}
+
+	*transferred = io.transferred;
+
+	return io.status;
+}
+
 static int usb_recv(struct jaylink_device_handle *devh, uint8_t *buffer,
 		size_t *length)
 {
@@ -330,19 +675,28 @@ static int usb_recv(struct jaylink_device_handle *devh, uint8_t *buffer,
 
 	ctx = devh->dev->ctx;
 
-	tries = NUM_TIMEOUTS;
+	tries = devh->num_timeouts;
 	transferred = 0;
 
 	while (tries > 0 && !transferred) {
-		/* Always request CHUNK_SIZE bytes from the device. */
+		/* Always request a whole chunk from the device. */
 		ret = libusb_bulk_transfer(devh->usb_devh, devh->endpoint_in,
-			(unsigned char *)buffer, CHUNK_SIZE, &transferred,
-			USB_TIMEOUT);
+			(unsigned char *)buffer, devh->chunk_size, &transferred,
+			get_timeout(devh, devh->chunk_size));
+
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_reads, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_read, transferred);
 
 		if (ret == LIBUSB_ERROR_TIMEOUT) {
 			log_warn(ctx, "Failed to receive data from "
 				"device: %s", libusb_error_name(ret));
+			ATOMIC_ADD_FETCH(&devh->io_stats.num_timeouts, 1);
 			tries--;
+
+			if (tries > 0 && !transferred)
+				ATOMIC_ADD_FETCH(&devh->io_stats.num_retries,
+					1);
+
 			continue;
 		} else if (ret != LIBUSB_SUCCESS) {
 			log_err(ctx, "Failed to receive data from "
@@ -372,13 +726,13 @@ static bool adjust_buffer(struct jaylink_device_handle *devh, size_t size)
 
 	ctx = devh->dev->ctx;
 
-	/* Adjust buffer size to a multiple of CHUNK_SIZE bytes. */
-	num_chunks = size / CHUNK_SIZE;
+	/* Adjust buffer size to a multiple of the chunk size. */
+	num_chunks = size / devh->chunk_size;
 
-	if (size % CHUNK_SIZE > 0)
+	if (size % devh->chunk_size > 0)
 		num_chunks++;
 
-	size = num_chunks * CHUNK_SIZE;
+	size = num_chunks * devh->chunk_size;
 	buffer = realloc(devh->buffer, size);
 
 	if (!buffer) {
@@ -402,22 +756,38 @@ static int usb_send(struct jaylink_device_handle *devh, const uint8_t *buffer,
 	struct jaylink_context *ctx;
 	unsigned int tries;
 	int transferred;
+	size_t bytes_sent;
+	size_t chunk;
 
 	ctx = devh->dev->ctx;
-	tries = NUM_TIMEOUTS;
+
+	if (devh->num_transfers > 1 && length > devh->chunk_size)
+		return usb_transfer_async(devh, devh->endpoint_out,
+			(uint8_t *)buffer, length, &bytes_sent);
+
+	tries = devh->num_timeouts;
 
 	while (tries > 0 && length > 0) {
-		/* Send data in chunks of CHUNK_SIZE bytes to the device. */
+		/* Send data in chunks to the device. */
+		chunk = MIN(devh->chunk_size, length);
 		ret = libusb_bulk_transfer(devh->usb_devh, devh->endpoint_out,
-			(unsigned char *)buffer, MIN(CHUNK_SIZE, length),
-			&transferred, USB_TIMEOUT);
+			(unsigned char *)buffer, chunk, &transferred,
+			get_timeout(devh, chunk));
+
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_writes, 1);
+		ATOMIC_ADD_FETCH(&devh->io_stats.bytes_written, transferred);
 
 		if (ret == LIBUSB_SUCCESS) {
-			tries = NUM_TIMEOUTS;
+			tries = devh->num_timeouts;
 		} else if (ret == LIBUSB_ERROR_TIMEOUT) {
 			log_warn(ctx, "Failed to send data to device: %s",
 				libusb_error_name(ret));
+			ATOMIC_ADD_FETCH(&devh->io_stats.num_timeouts, 1);
 			tries--;
+
+			if (tries > 0)
+				ATOMIC_ADD_FETCH(&devh->io_stats.num_retries,
+					1);
 		} else {
 			log_err(ctx, "Failed to send data to device: %s",
 				libusb_error_name(ret));
@@ -438,16 +808,29 @@ static int usb_send(struct jaylink_device_handle *devh, const uint8_t *buffer,
 	return JAYLINK_ERR_TIMEOUT;
 }
 
-JAYLINK_PRIV int transport_usb_write(struct jaylink_device_handle *devh,
-		const uint8_t *buffer, size_t length)
+static size_t get_iov_length(const struct io_vector *iov, size_t count)
+{
+	size_t length;
+
+	length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += iov[i].length;
+
+	return length;
+}
+
+JAYLINK_PRIV int transport_usb_writev(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
 {
 	int ret;
 	struct jaylink_context *ctx;
-	size_t num_chunks;
-	size_t fill_bytes;
+	const uint8_t *buffer;
+	size_t length;
 	size_t tmp;
 
 	ctx = devh->dev->ctx;
+	length = get_iov_length(iov, count);
 
 	if (length > devh->write_length) {
 		log_err(ctx, "Requested to write %zu bytes but only %zu bytes "
@@ -458,18 +841,21 @@ JAYLINK_PRIV int transport_usb_write(struct jaylink_device_handle *devh,
 
 	/*
 	 * Store data in the buffer if the expected number of bytes for the
-	 * write operation is not reached.
+	 * write operation is not reached or a batch is active.
 	 */
-	if (length < devh->write_length) {
+	if (length < devh->write_length || devh->batch) {
 		if (devh->write_pos + length > devh->buffer_size) {
 			if (!adjust_buffer(devh, devh->write_pos + length))
 				return JAYLINK_ERR_MALLOC;
 		}
 
-		memcpy(devh->buffer + devh->write_pos, buffer, length);
+		for (size_t i = 0; i < count; i++) {
+			memcpy(devh->buffer + devh->write_pos, iov[i].buffer,
+				iov[i].length);
+			devh->write_pos += iov[i].length;
+		}
 
 		devh->write_length -= length;
-		devh->write_pos += length;
 
 		log_dbgio(ctx, "Wrote %zu bytes into buffer", length);
 		return JAYLINK_OK;
@@ -481,46 +867,81 @@ JAYLINK_PRIV int transport_usb_write(struct jaylink_device_handle *devh,
 	 */
 	devh->write_length = 0;
 
-	/* Send data directly to the device if the buffer is empty. */
-	if (!devh->write_pos)
-		return usb_send(devh, buffer, length);
+	for (size_t i = 0; i < count; i++) {
+		buffer = iov[i].buffer;
+		length = iov[i].length;
 
-	/*
-	 * Calculate the number of bytes to fill up the buffer to reach a
-	 * multiple of CHUNK_SIZE bytes. This ensures that the data from the
-	 * buffer will be sent to the device in chunks of CHUNK_SIZE bytes.
-	 * Note that this is why the buffer size must be a multiple of
-	 * CHUNK_SIZE bytes.
-	 */
-	num_chunks = devh->write_pos / CHUNK_SIZE;
+		/*
+		 * Calculate the number of bytes to fill up the buffer to reach
+		 * a multiple of the chunk size. This ensures that the data
+		 * from the buffer will be sent to the device in whole chunks.
+		 * Note that this is why the buffer size must be a multiple of
+		 * the chunk size.
+		 */
+		tmp = devh->write_pos % devh->chunk_size;
 
-	if (devh->write_pos % CHUNK_SIZE)
-		num_chunks++;
+		if (tmp > 0) {
+			tmp = MIN(length, devh->chunk_size - tmp);
+			memcpy(devh->buffer + devh->write_pos, buffer, tmp);
 
-	fill_bytes = (num_chunks * CHUNK_SIZE) - devh->write_pos;
-	tmp = MIN(length, fill_bytes);
+			devh->write_pos += tmp;
+			buffer += tmp;
+			length -= tmp;
 
-	if (tmp > 0) {
-		memcpy(devh->buffer + devh->write_pos, buffer, tmp);
+			log_dbgio(ctx, "Buffer filled up with %zu bytes", tmp);
+		}
+
+		if (!length)
+			continue;
 
-		length -= tmp;
-		buffer += tmp;
+		/* Send buffered data to the device. */
+		if (devh->write_pos > 0) {
+			ret = usb_send(devh, devh->buffer, devh->write_pos);
+			devh->write_pos = 0;
 
-		log_dbgio(ctx, "Buffer filled up with %zu bytes", tmp);
+			if (ret != JAYLINK_OK)
+				return ret;
+		}
+
+		/*
+		 * Send the data of the segment directly to the device. Except
+		 * for the last segment, only whole chunks are sent and the
+		 * remaining data is stored in the buffer.
+		 */
+		tmp = length;
+
+		if (i < count - 1)
+			tmp -= length % devh->chunk_size;
+
+		if (tmp > 0) {
+			ret = usb_send(devh, buffer, tmp);
+
+			if (ret != JAYLINK_OK)
+				return ret;
+		}
+
+		if (length > tmp) {
+			memcpy(devh->buffer, buffer + tmp, length - tmp);
+			devh->write_pos = length - tmp;
+
+			log_dbgio(ctx, "Wrote %zu bytes into buffer",
+				length - tmp);
+		}
 	}
 
-	/* Send buffered data to the device. */
-	ret = usb_send(devh, devh->buffer, devh->write_pos + tmp);
-	devh->write_pos = 0;
+	/* Send remaining buffered data to the device. */
+	return transport_usb_flush(devh);
+}
 
-	if (ret != JAYLINK_OK)
-		return ret;
+JAYLINK_PRIV int transport_usb_write(struct jaylink_device_handle *devh,
+		const uint8_t *buffer, size_t length)
+{
+	struct io_vector iov;
 
-	if (!length)
-		return JAYLINK_OK;
+	iov.buffer = (uint8_t *)buffer;
+	iov.length = length;
 
-	/* Send remaining data to the device. */
-	return usb_send(devh, buffer, length);
+	return transport_usb_writev(devh, &iov, 1);
 }
 
 JAYLINK_PRIV int transport_usb_read(struct jaylink_device_handle *devh,
@@ -568,16 +989,16 @@ JAYLINK_PRIV int transport_usb_read(struct jaylink_device_handle *devh,
 
 	while (length > 0) {
 		/*
-		 * If less than CHUNK_SIZE bytes are requested from the device,
-		 * store the received data into the internal buffer instead of
-		 * directly into the user provided buffer. This is necessary to
-		 * prevent a possible buffer overflow because the number of
-		 * requested bytes from the device is always CHUNK_SIZE and
-		 * therefore up to CHUNK_SIZE bytes may be received.
+		 * If less than a chunk is requested from the device, store the
+		 * received data into the internal buffer instead of directly
+		 * into the user provided buffer. This is necessary to prevent
+		 * a possible buffer overflow because the number of requested
+		 * bytes from the device is always a whole chunk and therefore
+		 * up to a chunk may be received.
 		 * Note that this is why the internal buffer size must be at
-		 * least CHUNK_SIZE bytes.
+		 * least the chunk size.
 		 */
-		if (length < CHUNK_SIZE) {
+		if (length < devh->chunk_size) {
 			ret = usb_recv(devh, devh->buffer, &bytes_received);
 
 			if (ret != JAYLINK_OK)
@@ -600,6 +1021,25 @@ JAYLINK_PRIV int transport_usb_read(struct jaylink_device_handle *devh,
 			devh->read_length -= tmp;
 
 			log_dbgio(ctx, "Read %zu bytes from buffer", tmp);
+		} else if (devh->num_transfers > 1 &&
+				length >= 2 * devh->chunk_size) {
+			/*
+			 * Queue multiple transfers to receive the data. Only
+			 * whole chunks are received this way, the remaining
+			 * data is received with the next iteration.
+			 */
+			ret = usb_transfer_async(devh, devh->endpoint_in,
+				buffer, length, &bytes_received);
+
+			if (ret != JAYLINK_OK)
+				return ret;
+
+			buffer += bytes_received;
+			length -= bytes_received;
+			devh->read_length -= bytes_received;
+
+			log_dbgio(ctx, "Read %zu bytes from device",
+				bytes_received);
 		} else {
 			ret = usb_recv(devh, buffer, &bytes_received);
 
@@ -617,3 +1057,241 @@ JAYLINK_PRIV int transport_usb_read(struct jaylink_device_handle *devh,
 
 	return JAYLINK_OK;
 }
+
+JAYLINK_PRIV int transport_usb_readv(struct jaylink_device_handle *devh,
+		const struct io_vector *iov, size_t count)
+{
+	int ret;
+	size_t length;
+
+	length = get_iov_length(iov, count);
+
+	if (length > devh->read_length) {
+		log_err(devh->dev->ctx, "Requested to read %zu bytes but only "
+			"%zu bytes are expected for the read operation", length,
+			devh->read_length);
+		return JAYLINK_ERR_ARG;
+	}
+
+	/*
+	 * The data of each segment is received directly into the segment as
+	 * long as at least a whole chunk is left for it. Only the
+	 * remaining data is received through the buffer.
+	 */
+	for (size_t i = 0; i < count; i++) {
+		if (!iov[i].length)
+			continue;
+
+		ret = transport_usb_read(devh, iov[i].buffer, iov[i].length);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_usb_flush(struct jaylink_device_handle *devh)
+{
+	int ret;
+
+	if (!devh->write_pos)
+		return JAYLINK_OK;
+
+	ret = usb_send(devh, devh->buffer, devh->write_pos);
+	devh->write_pos = 0;
+
+	return ret;
+}
+
+JAYLINK_PRIV int transport_usb_set_chunk_size(
+		struct jaylink_device_handle *devh, size_t size)
+{
+	size_t chunk_size;
+
+	if (!size)
+		size = devh->default_chunk_size;
+
+	if (size % devh->max_packet_size)
+		return JAYLINK_ERR_ARG;
+
+	if (devh->write_length > 0 || devh->write_pos > 0 ||
+			devh->read_length > 0 || devh->bytes_available > 0) {
+		log_err(devh->dev->ctx, "Chunk size cannot be changed during "
+			"a write or read operation");
+		return JAYLINK_ERR;
+	}
+
+	chunk_size = devh->chunk_size;
+	devh->chunk_size = size;
+
+	if (!adjust_buffer(devh, size)) {
+		devh->chunk_size = chunk_size;
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	return JAYLINK_OK;
+}
+
+static void LIBUSB_CALL poll_callback(struct libusb_transfer *transfer)
+{
+	struct jaylink_device_handle *devh;
+
+	devh = transfer->user_data;
+	devh->poll_completed = 1;
+}
+
+static int submit_poll_transfer(struct jaylink_device_handle *devh)
+{
+	int ret;
+	struct jaylink_context *ctx;
+
+	ctx = devh->dev->ctx;
+
+	if (!devh->poll_transfer) {
+		devh->poll_transfer = libusb_alloc_transfer(0);
+
+		if (!devh->poll_transfer) {
+			log_err(ctx, "Failed to allocate transfer");
+			return JAYLINK_ERR_MALLOC;
+		}
+	}
+
+	/*
+	 * Always request a whole chunk from the device. The internal buffer
+	 * is at least the chunk size and not used while a read operation is
+	 * waiting for data.
+	 */
+	libusb_fill_bulk_transfer(devh->poll_transfer, devh->usb_devh,
+		devh->endpoint_in, devh->buffer, devh->chunk_size,
+		&poll_callback, devh,
+		get_timeout(devh, devh->chunk_size) * devh->num_timeouts);
+
+	ret = libusb_submit_transfer(devh->poll_transfer);
+
+	if (ret != LIBUSB_SUCCESS) {
+		log_err(ctx, "Failed to submit transfer: %s",
+			libusb_error_name(ret));
+		return JAYLINK_ERR;
+	}
+
+	devh->poll_pending = true;
+	devh->poll_completed = 0;
+
+	return JAYLINK_OK;
+}
+
+JAYLINK_PRIV int transport_usb_poll_read(struct jaylink_device_handle *devh,
+		bool *ready)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct timeval tv;
+	struct libusb_transfer *transfer;
+
+	ctx = devh->dev->ctx;
+
+	if (devh->bytes_available > 0 || !devh->read_length) {
+		*ready = true;
+		return JAYLINK_OK;
+	}
+
+	if (!devh->poll_pending) {
+		ret = submit_poll_transfer(devh);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	}
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+
+	ret = libusb_handle_events_timeout_completed(ctx->usb_ctx, &tv,
+		&devh->poll_completed);
+
+	if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED) {
+		log_err(ctx, "Failed to handle events: %s",
+			libusb_error_name(ret));
+		return JAYLINK_ERR;
+	}
+
+	if (!devh->poll_completed) {
+		*ready = false;
+		return JAYLINK_OK;
+	}
+
+	transfer = devh->poll_transfer;
+	devh->poll_pending = false;
+
+	ATOMIC_ADD_FETCH(&devh->io_stats.num_reads, 1);
+	ATOMIC_ADD_FETCH(&devh->io_stats.bytes_read, transfer->actual_length);
+
+	/* Ignore a possible timeout if at least one byte was received. */
+	if (transfer->status == LIBUSB_TRANSFER_TIMED_OUT &&
+			!transfer->actual_length) {
+		log_err(ctx, "Receiving data from device timed out");
+		ATOMIC_ADD_FETCH(&devh->io_stats.num_timeouts, 1);
+		return JAYLINK_ERR_TIMEOUT;
+	} else if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+			transfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		log_err(ctx, "Failed to receive data from device (status = %u)",
+			transfer->status);
+		return JAYLINK_ERR;
+	}
+
+	log_dbgio(ctx, "Received %i bytes from device",
+		transfer->actual_length);
+
+	devh->bytes_available = transfer->actual_length;
+	devh->read_pos = 0;
+	*ready = true;
+
+	return JAYLINK_OK;
+}
+
+static void free_pollfds(const struct libusb_pollfd **pollfds)
+{
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000104
+	libusb_free_pollfds(pollfds);
+#else
+	/* Before libusb 1.0.20, the array must be free'd by the caller. */
+	free(pollfds);
+#endif
+}
+
+JAYLINK_PRIV int transport_usb_get_pollfds(
+		struct jaylink_device_handle *devh,
+		struct jaylink_pollfd *pollfds, size_t *count)
+{
+	struct jaylink_context *ctx;
+	const struct libusb_pollfd **usb_pollfds;
+	size_t num;
+
+	ctx = devh->dev->ctx;
+	usb_pollfds = libusb_get_pollfds(ctx->usb_ctx);
+
+	if (!usb_pollfds) {
+		log_err(ctx, "Failed to get libusb file descriptors");
+		return JAYLINK_ERR_NOT_SUPPORTED;
+	}
+
+	num = 0;
+
+	while (usb_pollfds[num])
+		num++;
+
+	if (pollfds && *count < num) {
+		free_pollfds(usb_pollfds);
+		return JAYLINK_ERR_ARG;
+	}
+
+	for (size_t i = 0; pollfds && i < num; i++) {
+		pollfds[i].fd = usb_pollfds[i]->fd;
+		pollfds[i].events = usb_pollfds[i]->events;
+	}
+
+	free_pollfds(usb_pollfds);
+	*count = num;
+
+	return JAYLINK_OK;
+}
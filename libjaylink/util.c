@@ -18,8 +18,15 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 #include "libjaylink.h"
+#include "libjaylink-internal.h"
 
 /**
  * @file
@@ -54,3 +61,30 @@ JAYLINK_API bool jaylink_has_cap(const uint8_t *caps, uint32_t cap)
 
 	return false;
 }
+
+/**
+ * Get a timestamp of a monotonic clock.
+ *
+ * @return Timestamp in microseconds. The starting point is unspecified and
+ *         the timestamp is only useful to measure time intervals.
+ */
+JAYLINK_PRIV uint64_t util_get_timestamp(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (counter.QuadPart / frequency.QuadPart) * 1000000 +
+		((counter.QuadPart % frequency.QuadPart) * 1000000) /
+		frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
@@ -0,0 +1,310 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the library overhead with the emulated device.
+ *
+ * Each operation is measured for a range of payload sizes without any
+ * hardware. The results are printed to standard output with one JSON object
+ * per line. All durations are in nanoseconds and all throughputs are in bytes
+ * per second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include <libjaylink/libjaylink.h>
+
+/* Number of iterations of each measurement. */
+#define ITERATIONS		200
+
+/* Maximum payload size in bytes. */
+#define MAX_PAYLOAD_SIZE	65536
+
+/*
+ * Maximum payload size of JTAG and SWD I/O operations in bytes, limited by
+ * the 16-bit length in bits.
+ */
+#define MAX_IO_PAYLOAD_SIZE	4096
+
+#define ARRAY_SIZE(x)		(sizeof(x) / sizeof((x)[0]))
+
+/* EMUCOM channel to be used. */
+#define EMUCOM_CHANNEL		0
+
+/* Name of the file to be used. */
+#define FILENAME		"bench"
+
+struct buffers {
+	/* SWD I/O direction, all bits set. */
+	uint8_t *dir;
+	/* Output data, all bits cleared. */
+	uint8_t *out;
+	/* Input data. */
+	uint8_t *in;
+};
+
+struct benchmark {
+	/* Name of the operation. */
+	const char *name;
+	/* Maximum payload size of the operation in bytes. */
+	size_t max_size;
+	/* Prepare a single operation, or NULL. It is not measured. */
+	int (*prepare)(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size);
+	/* Execute a single operation. */
+	int (*execute)(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size);
+};
+
+static const size_t payload_sizes[] = {
+	16, 256, 4096, MAX_PAYLOAD_SIZE
+};
+
+static uint64_t get_timestamp(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int execute_jtag_io(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size)
+{
+	/* Keep TMS low such that the state of the target does not change. */
+	return jaylink_jtag_io(devh, buffers->out, buffers->out, buffers->in,
+		size * 8, JAYLINK_JTAG_VERSION_3);
+}
+
+static int execute_swd_io(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size)
+{
+	return jaylink_swd_io(devh, buffers->dir, buffers->out, buffers->in,
+		size * 8);
+}
+
+static int execute_swo_read(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size)
+{
+	uint32_t length;
+
+	length = size;
+
+	return jaylink_swo_read(devh, buffers->in, &length);
+}
+
+static int execute_file_read(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size)
+{
+	uint32_t length;
+
+	length = size;
+
+	return jaylink_file_read(devh, FILENAME, buffers->in, 0, &length);
+}
+
+static int prepare_emucom_read(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size)
+{
+	uint32_t length;
+
+	length = size;
+
+	return jaylink_emucom_write(devh, EMUCOM_CHANNEL, buffers->out,
+		&length);
+}
+
+static int execute_emucom_read(struct jaylink_device_handle *devh,
+		const struct buffers *buffers, size_t size)
+{
+	uint32_t length;
+
+	length = size;
+
+	return jaylink_emucom_read(devh, EMUCOM_CHANNEL, buffers->in,
+		&length);
+}
+
+static const struct benchmark benchmarks[] = {
+	{"jtag_io", MAX_IO_PAYLOAD_SIZE, NULL, &execute_jtag_io},
+	{"swd_io", MAX_IO_PAYLOAD_SIZE, NULL, &execute_swd_io},
+	{"swo_read", MAX_PAYLOAD_SIZE, NULL, &execute_swo_read},
+	{"file_read", MAX_PAYLOAD_SIZE, NULL, &execute_file_read},
+	{"emucom_read", MAX_PAYLOAD_SIZE, &prepare_emucom_read,
+		&execute_emucom_read},
+};
+
+static int measure(struct jaylink_device_handle *devh,
+		const struct benchmark *benchmark,
+		const struct buffers *buffers, size_t size)
+{
+	int ret;
+	uint64_t start;
+	uint64_t duration;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+
+	min = UINT64_MAX;
+	max = 0;
+	sum = 0;
+
+	for (size_t i = 0; i < ITERATIONS; i++) {
+		if (benchmark->prepare) {
+			ret = benchmark->prepare(devh, buffers, size);
+
+			if (ret != JAYLINK_OK)
+				return ret;
+		}
+
+		start = get_timestamp();
+		ret = benchmark->execute(devh, buffers, size);
+		duration = get_timestamp() - start;
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		if (duration < min)
+			min = duration;
+
+		if (duration > max)
+			max = duration;
+
+		sum += duration;
+	}
+
+	printf("{\"benchmark\":\"%s\",\"bytes\":%zu,\"iterations\":%u,"
+		"\"min_ns\":%llu,\"mean_ns\":%llu,\"max_ns\":%llu,"
+		"\"throughput\":%llu}\n", benchmark->name, size, ITERATIONS,
+		(unsigned long long)min,
+		(unsigned long long)(sum / ITERATIONS),
+		(unsigned long long)max,
+		(unsigned long long)(sum ? (uint64_t)size * ITERATIONS *
+		1000000000 / sum : 0));
+
+	return JAYLINK_OK;
+}
+
+/* Start the SWO capture and create the file to be read. */
+static int prepare(struct jaylink_device_handle *devh,
+		const struct buffers *buffers)
+{
+	int ret;
+	uint32_t length;
+
+	ret = jaylink_select_interface(devh, JAYLINK_TIF_SWD, NULL);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = jaylink_swo_start(devh, JAYLINK_SWO_MODE_UART, 1000000,
+		MAX_PAYLOAD_SIZE);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	length = MAX_PAYLOAD_SIZE;
+
+	return jaylink_file_write(devh, FILENAME, buffers->out, 0, &length);
+}
+
+int main(void)
+{
+	int ret;
+	struct jaylink_context *ctx;
+	struct jaylink_device_handle *devh;
+	const struct benchmark *benchmark;
+	struct buffers buffers;
+	uint8_t *buffer;
+	size_t size;
+	bool success;
+
+	buffer = calloc(3, MAX_PAYLOAD_SIZE);
+
+	if (!buffer) {
+		fprintf(stderr, "Buffer malloc failed\n");
+		return EXIT_FAILURE;
+	}
+
+	buffers.dir = buffer;
+	buffers.out = buffer + MAX_PAYLOAD_SIZE;
+	buffers.in = buffer + 2 * MAX_PAYLOAD_SIZE;
+	memset(buffers.dir, 0xff, MAX_PAYLOAD_SIZE);
+
+	ret = jaylink_init(&ctx);
+
+	if (ret != JAYLINK_OK) {
+		fprintf(stderr, "jaylink_init() failed: %s\n",
+			jaylink_strerror(ret));
+		free(buffer);
+		return EXIT_FAILURE;
+	}
+
+	ret = jaylink_emulator_open(ctx, &devh);
+
+	if (ret != JAYLINK_OK) {
+		fprintf(stderr, "jaylink_emulator_open() failed: %s\n",
+			jaylink_strerror(ret));
+		jaylink_exit(ctx);
+		free(buffer);
+		return EXIT_FAILURE;
+	}
+
+	success = true;
+	ret = prepare(devh, &buffers);
+
+	if (ret != JAYLINK_OK) {
+		fprintf(stderr, "Failed to prepare the emulator: %s\n",
+			jaylink_strerror(ret));
+		success = false;
+	}
+
+	for (size_t i = 0; success && i < ARRAY_SIZE(benchmarks); i++) {
+		benchmark = &benchmarks[i];
+
+		for (size_t j = 0; j < ARRAY_SIZE(payload_sizes); j++) {
+			size = payload_sizes[j];
+
+			if (size > benchmark->max_size)
+				break;
+
+			ret = measure(devh, benchmark, &buffers, size);
+
+			if (ret != JAYLINK_OK) {
+				fprintf(stderr, "%s (%zu bytes) failed: %s\n",
+					benchmark->name, size,
+					jaylink_strerror(ret));
+				success = false;
+				break;
+			}
+		}
+	}
+
+	jaylink_close(devh);
+	jaylink_exit(ctx);
+	free(buffer);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
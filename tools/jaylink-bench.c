@@ -0,0 +1,660 @@
+/*
+ * This file is part of the libjaylink project.
+ *
+ * Copyright (C) 2026 Marc Schink <dev@zapb.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the latency and throughput of a device.
+ *
+ * The results are printed to standard output with one JSON object per line.
+ * All durations are in microseconds and all throughputs are in bytes per
+ * second.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libjaylink/libjaylink.h>
+
+/* Default number of iterations of each measurement. */
+#define DEFAULT_ITERATIONS	100
+
+/* Number of bits of a single JTAG or SWD I/O operation. */
+#define IO_LENGTH		32768
+
+/* Minimum target interface speed to measure in kHz. */
+#define MIN_SPEED		100
+
+/* Maximum number of target interface speeds to measure. */
+#define MAX_NUM_SPEEDS		8
+
+/* Size of the SWO capture buffer on the device in bytes. */
+#define SWO_BUFFER_SIZE		4096
+
+/* Duration of the SWO capture in microseconds. */
+#define SWO_DURATION		1000000
+
+struct options {
+	bool emulator;
+	bool has_serial_number;
+	uint32_t serial_number;
+	const char *address;
+	const char *filename;
+	size_t iterations;
+};
+
+struct samples {
+	uint64_t *values;
+	size_t count;
+};
+
+static uint64_t get_timestamp(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_values(const void *a, const void *b)
+{
+	uint64_t x;
+	uint64_t y;
+
+	x = *(const uint64_t *)a;
+	y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint64_t get_percentile(const struct samples *samples,
+		unsigned int percentile)
+{
+	return samples->values[(samples->count - 1) * percentile / 100];
+}
+
+static uint64_t get_sum(const struct samples *samples)
+{
+	uint64_t sum;
+
+	sum = 0;
+
+	for (size_t i = 0; i < samples->count; i++)
+		sum += samples->values[i];
+
+	return sum;
+}
+
+/* Print the statistics of the samples as members of a JSON object. */
+static void print_samples(struct samples *samples)
+{
+	qsort(samples->values, samples->count, sizeof(uint64_t),
+		&compare_values);
+
+	printf("\"samples\":%zu,\"min_us\":%llu,\"p50_us\":%llu,"
+		"\"p90_us\":%llu,\"p99_us\":%llu,\"max_us\":%llu",
+		samples->count,
+		(unsigned long long)samples->values[0],
+		(unsigned long long)get_percentile(samples, 50),
+		(unsigned long long)get_percentile(samples, 90),
+		(unsigned long long)get_percentile(samples, 99),
+		(unsigned long long)samples->values[samples->count - 1]);
+}
+
+static uint64_t get_throughput(uint64_t bytes, uint64_t duration)
+{
+	if (!duration)
+		return 0;
+
+	return bytes * 1000000 / duration;
+}
+
+static void print_error(const char *benchmark, const char *name, int ret)
+{
+	printf("{\"benchmark\":\"%s\",\"name\":\"%s\",\"error\":\"%s\"}\n",
+		benchmark, name, jaylink_strerror_name(ret));
+}
+
+static int measure_latency(struct jaylink_device_handle *devh,
+		struct samples *samples, const char *name)
+{
+	int ret;
+	struct jaylink_hardware_status status;
+	uint8_t caps[JAYLINK_DEV_CAPS_SIZE];
+	uint64_t start;
+
+	for (size_t i = 0; i < samples->count; i++) {
+		start = get_timestamp();
+
+		if (!strcmp(name, "get_hardware_status"))
+			ret = jaylink_get_hardware_status(devh, &status);
+		else
+			ret = jaylink_get_caps(devh, caps);
+
+		if (ret != JAYLINK_OK) {
+			print_error("latency", name, ret);
+			return ret;
+		}
+
+		samples->values[i] = get_timestamp() - start;
+	}
+
+	printf("{\"benchmark\":\"latency\",\"name\":\"%s\",", name);
+	print_samples(samples);
+	printf("}\n");
+
+	return JAYLINK_OK;
+}
+
+static int measure_io(struct jaylink_device_handle *devh,
+		struct samples *samples, enum jaylink_target_interface iface,
+		uint16_t speed)
+{
+	int ret;
+	const char *name;
+	uint8_t *dir;
+	uint8_t *out;
+	uint8_t *in;
+	uint64_t start;
+
+	name = (iface == JAYLINK_TIF_JTAG) ? "jtag" : "swd";
+	ret = jaylink_set_speed(devh, speed);
+
+	if (ret != JAYLINK_OK) {
+		print_error(name, "set_speed", ret);
+		return ret;
+	}
+
+	dir = malloc(IO_LENGTH / 8);
+	out = calloc(1, IO_LENGTH / 8);
+	in = malloc(IO_LENGTH / 8);
+
+	if (!dir || !out || !in) {
+		free(dir);
+		free(out);
+		free(in);
+		return JAYLINK_ERR_MALLOC;
+	}
+
+	memset(dir, 0xff, IO_LENGTH / 8);
+
+	for (size_t i = 0; i < samples->count; i++) {
+		start = get_timestamp();
+
+		/*
+		 * Keep TMS low for JTAG and drive SWDIO for SWD such that the
+		 * state of the target does not change.
+		 */
+		if (iface == JAYLINK_TIF_JTAG) {
+			ret = jaylink_jtag_io(devh, out, out, in, IO_LENGTH,
+				JAYLINK_JTAG_VERSION_3);
+		} else {
+			ret = jaylink_swd_io(devh, dir, out, in, IO_LENGTH);
+		}
+
+		if (ret != JAYLINK_OK) {
+			print_error(name, "io", ret);
+			break;
+		}
+
+		samples->values[i] = get_timestamp() - start;
+	}
+
+	free(dir);
+	free(out);
+	free(in);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	printf("{\"benchmark\":\"%s\",\"speed_khz\":%u,\"bits\":%u,"
+		"\"throughput\":%llu,", name, speed, IO_LENGTH,
+		(unsigned long long)get_throughput((uint64_t)samples->count *
+		IO_LENGTH / 8, get_sum(samples)));
+	print_samples(samples);
+	printf("}\n");
+
+	return JAYLINK_OK;
+}
+
+/* Measure the I/O operations at each speed of a target interface. */
+static int measure_interface(struct jaylink_device_handle *devh,
+		struct samples *samples, const uint8_t *caps,
+		enum jaylink_target_interface iface)
+{
+	int ret;
+	struct jaylink_speed speed;
+	const char *name;
+	uint32_t tmp;
+
+	name = (iface == JAYLINK_TIF_JTAG) ? "jtag" : "swd";
+
+	if (jaylink_has_cap(caps, JAYLINK_DEV_CAP_SELECT_TIF)) {
+		ret = jaylink_select_interface(devh, iface, NULL);
+
+		if (ret != JAYLINK_OK) {
+			print_error(name, "select_interface", ret);
+			return ret;
+		}
+	} else if (iface != JAYLINK_TIF_JTAG) {
+		return JAYLINK_OK;
+	}
+
+	if (!jaylink_has_cap(caps, JAYLINK_DEV_CAP_GET_SPEEDS))
+		return JAYLINK_OK;
+
+	ret = jaylink_get_speeds(devh, &speed);
+
+	if (ret != JAYLINK_OK) {
+		print_error(name, "get_speeds", ret);
+		return ret;
+	}
+
+	/* Start with the maximum speed and halve it for each measurement. */
+	for (uint32_t i = 0; i < MAX_NUM_SPEEDS; i++) {
+		tmp = (speed.freq / 1000 / speed.div) >> i;
+
+		if (tmp < MIN_SPEED)
+			break;
+
+		if (tmp >= JAYLINK_SPEED_ADAPTIVE_CLOCKING)
+			tmp = JAYLINK_SPEED_ADAPTIVE_CLOCKING - 1;
+
+		ret = measure_io(devh, samples, iface, tmp);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+	}
+
+	return JAYLINK_OK;
+}
+
+static int measure_swo(struct jaylink_device_handle *devh,
+		struct samples *samples)
+{
+	int ret;
+	struct jaylink_swo_speed speed;
+	struct samples reads;
+	uint8_t *buffer;
+	uint32_t baudrate;
+	uint32_t length;
+	uint64_t bytes;
+	uint64_t start;
+	uint64_t end;
+
+	ret = jaylink_select_interface(devh, JAYLINK_TIF_SWD, NULL);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = jaylink_swo_get_speeds(devh, JAYLINK_SWO_MODE_UART, &speed);
+
+	if (ret != JAYLINK_OK) {
+		print_error("swo", "get_speeds", ret);
+		return ret;
+	}
+
+	buffer = malloc(SWO_BUFFER_SIZE);
+
+	if (!buffer)
+		return JAYLINK_ERR_MALLOC;
+
+	baudrate = speed.freq / speed.min_div;
+	ret = jaylink_swo_start(devh, JAYLINK_SWO_MODE_UART, baudrate,
+		SWO_BUFFER_SIZE);
+
+	if (ret != JAYLINK_OK) {
+		print_error("swo", "start", ret);
+		free(buffer);
+		return ret;
+	}
+
+	/*
+	 * Read the captured data as fast as possible for a fixed duration or
+	 * until the number of iterations is reached.
+	 */
+	reads.values = samples->values;
+	reads.count = 0;
+	bytes = 0;
+	end = get_timestamp() + SWO_DURATION;
+
+	while (reads.count < samples->count) {
+		length = SWO_BUFFER_SIZE;
+		start = get_timestamp();
+
+		if (start >= end)
+			break;
+
+		ret = jaylink_swo_read(devh, buffer, &length);
+
+		/* A buffer overrun on the device is not fatal. */
+		if (ret != JAYLINK_OK && ret != JAYLINK_ERR_DEV) {
+			print_error("swo", "read", ret);
+			break;
+		}
+
+		ret = JAYLINK_OK;
+		reads.values[reads.count++] = get_timestamp() - start;
+		bytes += length;
+	}
+
+	free(buffer);
+	jaylink_swo_stop(devh);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	printf("{\"benchmark\":\"swo\",\"baudrate\":%u,\"bytes\":%llu,"
+		"\"throughput\":%llu,", baudrate, (unsigned long long)bytes,
+		(unsigned long long)get_throughput(bytes, get_sum(&reads)));
+	print_samples(&reads);
+	printf("}\n");
+
+	return JAYLINK_OK;
+}
+
+static int measure_file_read(struct jaylink_device_handle *devh,
+		struct samples *samples, const char *filename)
+{
+	int ret;
+	uint8_t *buffer;
+	uint32_t size;
+	uint32_t length;
+	uint64_t start;
+
+	ret = jaylink_file_get_size(devh, filename, &size);
+
+	if (ret != JAYLINK_OK) {
+		print_error("file_read", filename, ret);
+		return ret;
+	}
+
+	/* Empty files cannot be read. */
+	if (!size) {
+		print_error("file_read", filename, JAYLINK_ERR_ARG);
+		return JAYLINK_ERR_ARG;
+	}
+
+	if (size > JAYLINK_FILE_MAX_TRANSFER_SIZE)
+		size = JAYLINK_FILE_MAX_TRANSFER_SIZE;
+
+	buffer = malloc(size);
+
+	if (!buffer)
+		return JAYLINK_ERR_MALLOC;
+
+	for (size_t i = 0; i < samples->count; i++) {
+		length = size;
+		start = get_timestamp();
+		ret = jaylink_file_read(devh, filename, buffer, 0, &length);
+
+		if (ret != JAYLINK_OK) {
+			print_error("file_read", filename, ret);
+			free(buffer);
+			return ret;
+		}
+
+		samples->values[i] = get_timestamp() - start;
+	}
+
+	free(buffer);
+
+	printf("{\"benchmark\":\"file_read\",\"name\":\"%s\",\"bytes\":%u,"
+		"\"throughput\":%llu,", filename, size,
+		(unsigned long long)get_throughput((uint64_t)samples->count *
+		size, get_sum(samples)));
+	print_samples(samples);
+	printf("}\n");
+
+	return JAYLINK_OK;
+}
+
+/*
+ * Run all measurements. A failed measurement is reported and does not prevent
+ * the remaining measurements.
+ */
+static bool run(struct jaylink_device_handle *devh,
+		const struct options *options)
+{
+	int ret;
+	struct samples samples;
+	uint8_t caps[JAYLINK_DEV_CAPS_SIZE];
+	bool success;
+
+	ret = jaylink_get_caps(devh, caps);
+
+	if (ret != JAYLINK_OK) {
+		fprintf(stderr, "jaylink_get_caps() failed: %s\n",
+			jaylink_strerror(ret));
+		return false;
+	}
+
+	samples.count = options->iterations;
+	samples.values = malloc(samples.count * sizeof(uint64_t));
+
+	if (!samples.values) {
+		fprintf(stderr, "Samples malloc failed\n");
+		return false;
+	}
+
+	success = true;
+
+	if (measure_latency(devh, &samples,
+			"get_hardware_status") != JAYLINK_OK)
+		success = false;
+
+	if (measure_latency(devh, &samples, "get_caps") != JAYLINK_OK)
+		success = false;
+
+	if (measure_interface(devh, &samples, caps,
+			JAYLINK_TIF_JTAG) != JAYLINK_OK)
+		success = false;
+
+	if (measure_interface(devh, &samples, caps,
+			JAYLINK_TIF_SWD) != JAYLINK_OK)
+		success = false;
+
+	if (jaylink_has_cap(caps, JAYLINK_DEV_CAP_SWO) &&
+			jaylink_has_cap(caps, JAYLINK_DEV_CAP_SELECT_TIF)) {
+		if (measure_swo(devh, &samples) != JAYLINK_OK)
+			success = false;
+	}
+
+	if (options->filename) {
+		if (measure_file_read(devh, &samples,
+				options->filename) != JAYLINK_OK)
+			success = false;
+	}
+
+	free(samples.values);
+
+	return success;
+}
+
+/* Find a device by its IPv4 address or by its serial number. */
+static int find_device(struct jaylink_context *ctx,
+		const struct options *options, struct jaylink_device **dev)
+{
+	int ret;
+	struct jaylink_device **devs;
+	char address[16];
+
+	if (options->address) {
+		ret = jaylink_discovery_add_tcp_target(ctx, options->address,
+			1);
+
+		if (ret != JAYLINK_OK)
+			return ret;
+
+		ret = jaylink_discovery_scan(ctx, JAYLINK_HIF_TCP);
+	} else {
+		ret = jaylink_discovery_scan(ctx, 0);
+	}
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	if (options->has_serial_number)
+		return jaylink_find_device_by_serial(ctx,
+			options->serial_number, 0, dev);
+
+	ret = jaylink_get_devices(ctx, &devs, NULL);
+
+	if (ret != JAYLINK_OK)
+		return ret;
+
+	ret = JAYLINK_ERR_NOT_AVAILABLE;
+
+	for (size_t i = 0; devs[i]; i++) {
+		if (options->address) {
+			if (jaylink_device_get_ipv4_address(devs[i],
+					address) != JAYLINK_OK)
+				continue;
+
+			if (strcmp(address, options->address))
+				continue;
+		}
+
+		*dev = jaylink_ref_device(devs[i]);
+		ret = JAYLINK_OK;
+		break;
+	}
+
+	jaylink_free_devices(devs, true);
+
+	return ret;
+}
+
+static void print_usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-s serial] [-a address] [-e] "
+		"[-n iterations] [-f filename]\n\n"
+		"  -s serial      Serial number of the device\n"
+		"  -a address     IPv4 address of the device\n"
+		"  -e             Use the emulated device\n"
+		"  -n iterations  Number of iterations (default: %u)\n"
+		"  -f filename    File on the device to measure file reads\n",
+		name, DEFAULT_ITERATIONS);
+}
+
+static bool parse_options(int argc, char **argv, struct options *options)
+{
+	int opt;
+	char *end;
+	unsigned long tmp;
+
+	options->emulator = false;
+	options->has_serial_number = false;
+	options->serial_number = 0;
+	options->address = NULL;
+	options->filename = NULL;
+	options->iterations = DEFAULT_ITERATIONS;
+
+	while ((opt = getopt(argc, argv, "s:a:en:f:")) != -1) {
+		switch (opt) {
+		case 's':
+			tmp = strtoul(optarg, &end, 10);
+
+			if (*end || end == optarg || tmp > UINT32_MAX)
+				return false;
+
+			options->serial_number = tmp;
+			options->has_serial_number = true;
+			break;
+		case 'a':
+			options->address = optarg;
+			break;
+		case 'e':
+			options->emulator = true;
+			break;
+		case 'n':
+			tmp = strtoul(optarg, &end, 10);
+
+			if (*end || end == optarg || !tmp)
+				return false;
+
+			options->iterations = tmp;
+			break;
+		case 'f':
+			options->filename = optarg;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return optind == argc;
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	struct options options;
+	struct jaylink_context *ctx;
+	struct jaylink_device *dev;
+	struct jaylink_device_handle *devh;
+	bool success;
+
+	if (!parse_options(argc, argv, &options)) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	ret = jaylink_init(&ctx);
+
+	if (ret != JAYLINK_OK) {
+		fprintf(stderr, "jaylink_init() failed: %s\n",
+			jaylink_strerror(ret));
+		return EXIT_FAILURE;
+	}
+
+	if (options.emulator) {
+		ret = jaylink_emulator_open(ctx, &devh);
+	} else {
+		ret = find_device(ctx, &options, &dev);
+
+		if (ret != JAYLINK_OK) {
+			fprintf(stderr, "Failed to find device: %s\n",
+				jaylink_strerror(ret));
+			jaylink_exit(ctx);
+			return EXIT_FAILURE;
+		}
+
+		ret = jaylink_open(dev, &devh);
+		jaylink_unref_device(dev);
+	}
+
+	if (ret != JAYLINK_OK) {
+		fprintf(stderr, "Failed to open device: %s\n",
+			jaylink_strerror(ret));
+		jaylink_exit(ctx);
+		return EXIT_FAILURE;
+	}
+
+	success = run(devh, &options);
+
+	jaylink_close(devh);
+	jaylink_exit(ctx);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}